@@ -36,14 +36,23 @@ int main(int argc, char **argv)
     usage();
   }
 
-  // Read transformation
-  transformation.irtkTransformation::Read(argv[1]);
+  // Read transformation, only the global transformation of a container file
+  if (IsTransformationContainer(argv[1])) {
+    irtkTransformationContainer container(argv[1]);
+    irtkHomogeneousTransformation *global = container.ReadGlobalTransformation();
+    if (global == NULL) {
+      cerr << "Transformation " << argv[1] << " has no global transformation" << endl;
+      exit(1);
+    }
+    matrix = global->GetMatrix();
+    delete global;
+  } else {
+    transformation.irtkTransformation::Read(argv[1]);
+    matrix = transformation.GetMatrix();
+  }
   argc--;
   argv++;
 
-  // Convert to matrix
-  matrix = transformation.GetMatrix();
-
 // Parse remaining parameters
   while (argc > 1) {
     ok = false;
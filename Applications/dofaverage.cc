@@ -120,6 +120,9 @@ void PrintHelp(const char *name)
   cout << "                                      Note that if this option is used, the named input transformation file" << endl;
   cout << "                                      which is listed in the -dofnames list does not need to exist." << endl;
   cout << "                                      (default: read input transformation from file)" << endl;
+  cout << "  -pipeline <n>              Maximum number of input transformations which are read and processed" << endl;
+  cout << "                             concurrently. Memory for one dense displacement field is allocated" << endl;
+  cout << "                             for each of these. The result does not depend on this number. (default: 1)" << endl;
   cout << endl;
   cout << "Average transformation options:" << endl;
   cout << "  -[no]rotation              Average rotation    or assume none to be present. (default: -norotation)" << endl;
@@ -157,6 +160,232 @@ bool isRelativePath(const string &path)
   return path.size() > 0 && path[0] != '/';
 }
 
+// ---------------------------------------------------------------------------
+/// Pre-multiply displacement vectors by linear transformation matrix
+struct TransformDisplacements
+{
+  irtkMatrix                _Matrix;
+  irtkGenericImage<double> *_Displacement;
+
+  void operator ()(const blocked_range3d<int> &re) const
+  {
+    const irtkMatrix &A = _Matrix;
+    irtkGenericImage<double> &d = *_Displacement;
+    double x, y, z;
+    for (int k = re.pages().begin(); k != re.pages().end(); ++k)
+    for (int j = re.rows ().begin(); j != re.rows ().end(); ++j)
+    for (int i = re.cols ().begin(); i != re.cols ().end(); ++i) {
+      x = d(i, j, k, 0), y = d(i, j, k, 1), z = d(i, j, k, 2);
+      d(i, j, k, 0) = A(0, 0) * x + A(0, 1) * y + A(0, 2) * z;
+      d(i, j, k, 1) = A(1, 0) * x + A(1, 1) * y + A(1, 2) * z;
+      d(i, j, k, 2) = A(2, 0) * x + A(2, 1) * y + A(2, 2) * z;
+    }
+  }
+};
+
+// ---------------------------------------------------------------------------
+/// Evaluate local displacements at lattice points and remove dependency on
+/// the global transformation by pre-multiplying them with its inverse matrix
+struct EvaluateLocalDisplacement
+{
+  const irtkTransformation *_Transformation;
+  irtkMatrix                _InvA;
+  irtkMatrix                _I2W;
+  irtkGenericImage<double> *_Displacement;
+
+  void operator ()(const blocked_range3d<int> &re) const
+  {
+    const irtkMatrix &invA = _InvA;
+    const irtkMatrix &i2w  = _I2W;
+    irtkGenericImage<double> &d = *_Displacement;
+    double x, y, z;
+    for (int k = re.pages().begin(); k != re.pages().end(); ++k)
+    for (int j = re.rows ().begin(); j != re.rows ().end(); ++j)
+    for (int i = re.cols ().begin(); i != re.cols ().end(); ++i) {
+      // Convert voxel indices to world coordinates
+      x = i2w(0, 0) * i + i2w(0, 1) * j + i2w(0, 2) * k + i2w(0, 3);
+      y = i2w(1, 0) * i + i2w(1, 1) * j + i2w(1, 2) * k + i2w(1, 3);
+      z = i2w(2, 0) * i + i2w(2, 1) * j + i2w(2, 2) * k + i2w(2, 3);
+      // Evaluate (total) local voxel displacement
+      _Transformation->LocalDisplacement(x, y, z);
+      // Remove dependency on global transformation
+      d(i, j, k, 0) = invA(0, 0) * x + invA(0, 1) * y + invA(0, 2) * z;
+      d(i, j, k, 1) = invA(1, 0) * x + invA(1, 1) * y + invA(1, 2) * z;
+      d(i, j, k, 2) = invA(2, 0) * x + invA(2, 1) * y + invA(2, 2) * z;
+    }
+  }
+};
+
+// ---------------------------------------------------------------------------
+/// Read window of input transformations concurrently and compute their
+/// weighted local displacements and/or global transformation matrices
+///
+/// Each input transformation in the window is assigned one of the
+/// pre-allocated displacement buffers. These are added to the sum of local
+/// transformations by the caller in the order of the input transformations
+/// such that the result does not depend on the size of the window.
+struct ProcessInputDoFs
+{
+  const vector<string>     *_DoFName;
+  string                    _Identity;
+  const double             *_Weight;
+  irtkImageAttributes       _Attributes;
+  int                       _N;
+  int                       _Offset;
+  bool                      _Deformation;
+  bool                      _Translation;
+  bool                      _Rotation;
+  bool                      _Scaling;
+  bool                      _Shearing;
+  bool                      _Invert;
+  bool                      _AverageDoFs;
+  bool                      _LogSpace;
+  irtkMatrix               *_A;
+  irtkGenericImage<double> *_Displacement;
+  char                     *_HasDisplacement;
+  string                   *_Error;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int s = re.begin(); s != re.end(); ++s) {
+      _HasDisplacement[s] = false;
+      _Error[s].clear();
+      Process(_Offset + s, s);
+    }
+  }
+
+  void Process(int n, int s) const
+  {
+    const string &dofin = (*_DoFName)[n];
+    const irtkImageAttributes &attr = _Attributes;
+    if (dofin == _Identity) return;
+    // Read transformation from file
+    std::unique_ptr<irtkTransformation> t(irtkTransformation::New(dofin.c_str()));
+    // Determine actual type of transformation
+    irtkHomogeneousTransformation   *global     = NULL;
+    irtkRigidTransformation         *rigid      = NULL;
+    irtkSimilarityTransformation    *similarity = NULL;
+    irtkAffineTransformation        *affine     = NULL;
+    irtkFreeFormTransformation3D    *ffd        = NULL;
+    irtkMultiLevelTransformation    *mffd       = NULL;
+    irtkFluidFreeFormTransformation *fluid      = NULL;
+    if (!((fluid      = dynamic_cast<irtkFluidFreeFormTransformation *>(t.get())) ||
+          (mffd       = dynamic_cast<irtkMultiLevelTransformation    *>(t.get())) ||
+          (ffd        = dynamic_cast<irtkFreeFormTransformation3D    *>(t.get())) ||
+          (affine     = dynamic_cast<irtkAffineTransformation        *>(t.get())) ||
+          (similarity = dynamic_cast<irtkSimilarityTransformation    *>(t.get())) ||
+          (rigid      = dynamic_cast<irtkRigidTransformation         *>(t.get())))) {
+      _Error[s] = "Cannot process transformation \"" + dofin + "\" of type " + t->NameOfClass();
+      return;
+    }
+    // Set base class pointers for common interface access,
+    // e.g., rigid components can be modified using the common
+    // irtkRigidTransformation interface even if the actual transformation
+    // is of type irtkSimilarityTransformation, irtkAffineTransformation,
+    // or even a subclass of irtkMultiLevelTransformation.
+    if (fluid) mffd = fluid;
+    if (mffd) {
+      affine = mffd->GetGlobalTransformation();
+      if (mffd->NumberOfLevels() > 0) {
+        irtkFreeFormTransformation *affd = mffd->GetLocalTransformation(mffd->NumberOfLevels() - 1);
+        ffd = dynamic_cast<irtkFreeFormTransformation3D *>(affd);
+        if (!ffd) {
+          _Error[s] = "Cannot process MFFD \"" + dofin + "\" with level of type " + affd->NameOfClass();
+          return;
+        }
+      }
+    }
+    if (affine    ) similarity = affine;
+    if (similarity) rigid      = similarity;
+    if (rigid     ) global     = rigid;
+    // Get local transformation parameters
+    if (_Deformation && ffd) {
+      if (_Invert) {
+        _Error[s] = "-invert option only supported for rigid/affine transformations";
+        return;
+      }
+      irtkGenericImage<double> &d = _Displacement[s];
+      // Get inverse of the linear transformation matrix
+      irtkMatrix invA(4, 4);
+      if (global) {
+        invA = global->GetMatrix();
+        invA.Invert();
+      } else invA.Ident();
+      // Average parameters at control points directly when possible
+      double x, y, z;
+      if (_AverageDoFs) {
+        for (int k = 0; k < attr._z; ++k) {
+          for (int j = 0; j < attr._y; ++j) {
+            for (int i = 0; i < attr._x; ++i) {
+              // Get control point parameters
+              ffd->Get(i, j, k, x, y, z);
+              // Remove dependency on global transformation
+              // Note: Applies also when the FFD parameters are stationary velocities, see below.
+              d(i, j, k, 0) = invA(0, 0) * x + invA(0, 1) * y + invA(0, 2) * z;
+              d(i, j, k, 1) = invA(1, 0) * x + invA(1, 1) * y + invA(1, 2) * z;
+              d(i, j, k, 2) = invA(2, 0) * x + invA(2, 1) * y + invA(2, 2) * z;
+            }
+          }
+        }
+      // Otherwise,...
+      } else {
+        // Get local displacement field
+        EvaluateLocalDisplacement eval;
+        eval._Transformation = t.get();
+        eval._InvA           = invA;
+        eval._I2W            = attr.GetImageToWorldMatrix();
+        eval._Displacement   = &d;
+        parallel_for(blocked_range3d<int>(0, attr._z, 0, attr._y, 0, attr._x), eval);
+        // Compute stationary velocity field
+        if (_LogSpace) {
+          log(&d);
+          // Smooth velocities if only few transformations are being averaged,
+          // otherwise rely on the average velocity field to be sufficiently smooth
+          if (_N < 5) {
+            irtkGaussianBlurring<double> blur(max(attr._dx, max(attr._dy, attr._dz)));
+            blur.SetInput (&d);
+            blur.SetOutput(&d);
+            blur.Run();
+          }
+        }
+      }
+      // Weight local transformation
+      if (_Weight) d *= _Weight[n];
+      _HasDisplacement[s] = true;
+    }
+    // Get global transformation parameters
+    // (**after** local parameters as the following modifies the transformation)
+    if (_A && global) {
+      if (_Invert) global->Invert();
+      if (!_Translation) {
+        rigid->PutTranslationX(0);
+        rigid->PutTranslationY(0);
+        rigid->PutTranslationZ(0);
+      }
+      if (!_Rotation) {
+        rigid->PutRotationX(0);
+        rigid->PutRotationY(0);
+        rigid->PutRotationZ(0);
+      }
+      if (!_Scaling) {
+        if (affine) {
+          affine->PutScaleX(100);
+          affine->PutScaleY(100);
+          affine->PutScaleZ(100);
+        } else if (similarity) {
+          similarity->PutScale(100);
+        }
+      }
+      if (!_Shearing && affine) {
+        affine->PutShearXY(0);
+        affine->PutShearXZ(0);
+        affine->PutShearYZ(0);
+      }
+      _A[n] = global->GetMatrix();
+    }
+  }
+};
+
 // ===========================================================================
 // Main
 // ===========================================================================
@@ -199,6 +428,7 @@ int main(int argc, char **argv)
   double      sigma          = .0;
   double      epsilon        = EPSILON;
   int         frechet_iter   = 20;
+  int         pipeline       = 1;          // max. number of transformations processed at once
 
   for (ALL_OPTIONS) {
     if      (OPTION("-target"))        target_name = ARGUMENT;
@@ -237,6 +467,7 @@ int main(int argc, char **argv)
     else if (OPTION("-add-identity-with-weight")) { identity_value = atof(ARGUMENT); }
     else if (OPTION("-add-identity-for-dofname")) { identity_name  = ARGUMENT; }
     else if (OPTION("-max-frechet-iterations")) frechet_iter = atoi(ARGUMENT);
+    else if (OPTION("-pipeline")) pipeline = atoi(ARGUMENT);
     else HANDLE_STANDARD_OR_UNKNOWN_OPTION();
   }
 
@@ -381,6 +612,16 @@ int main(int argc, char **argv)
     if (verbose) cout << "Checking type of input transformations...", cout.flush();
     for (size_t i = 0; i < dofin.size(); ++i) {
       if (dofin[i] == identity_name) continue;
+      // Read only last level of multi-level transformation in container file
+      if (IsTransformationContainer(dofin[i].c_str())) {
+        irtkTransformationContainer container(dofin[i].c_str());
+        if (container.IsMultiLevel() && container.NumberOfLevels() > 1) {
+          std::unique_ptr<irtkFreeFormTransformation> ffd(container.ReadLocalTransformation(-1));
+          attr = ffd->Attributes();
+          type.clear();
+          break;
+        }
+      }
       std::unique_ptr<irtkTransformation> t(irtkTransformation::New(dofin[i].c_str()));
       irtkTransformation           *p    = t.get();
       irtkMultiLevelTransformation *mffd = dynamic_cast<irtkMultiLevelTransformation *>(t.get());
@@ -448,7 +689,7 @@ int main(int argc, char **argv)
 
   // Initialize intermediate data structures
   irtkMatrix              *A = NULL;
-  irtkGenericImage<double> d, avgD;
+  irtkGenericImage<double> avgD;
 
   if (translation || rotation || scaling || shearing) {
     A = new irtkMatrix[N];
@@ -458,146 +699,50 @@ int main(int argc, char **argv)
     }
   }
   if (deformation && attr.NumberOfLatticePoints() > 0) {
-    d   .Initialize(attr, 3);
     avgD.Initialize(attr, 3);
   }
 
-  // Read parameters of input transformations
-  for (size_t i = 0; i < dofin.size(); ++i) {
-    if (dofin[i] == identity_name) continue;
-    // Read transformation from file
-    std::unique_ptr<irtkTransformation> t(irtkTransformation::New(dofin[i].c_str()));
-    // Determine actual type of transformation
-    irtkHomogeneousTransformation   *global     = NULL;
-    irtkRigidTransformation         *rigid      = NULL;
-    irtkSimilarityTransformation    *similarity = NULL;
-    irtkAffineTransformation        *affine     = NULL;
-    irtkFreeFormTransformation3D    *ffd        = NULL;
-    irtkMultiLevelTransformation    *mffd       = NULL;
-    irtkFluidFreeFormTransformation *fluid      = NULL;
-    if (!((fluid      = dynamic_cast<irtkFluidFreeFormTransformation *>(t.get())) ||
-          (mffd       = dynamic_cast<irtkMultiLevelTransformation    *>(t.get())) ||
-          (ffd        = dynamic_cast<irtkFreeFormTransformation3D    *>(t.get())) ||
-          (affine     = dynamic_cast<irtkAffineTransformation        *>(t.get())) ||
-          (similarity = dynamic_cast<irtkSimilarityTransformation    *>(t.get())) ||
-          (rigid      = dynamic_cast<irtkRigidTransformation         *>(t.get())))) {
-      cerr << EXECNAME << ": Cannot process transformation \"" << dofin[i] << "\" of type " << t->NameOfClass() << endl;
-      exit(1);
-    }
-    // Set base class pointers for common interface access,
-    // e.g., rigid components can be modified using the common
-    // irtkRigidTransformation interface even if the actual transformation
-    // is of type irtkSimilarityTransformation, irtkAffineTransformation,
-    // or even a subclass of irtkMultiLevelTransformation.
-    if (fluid) mffd = fluid;
-    if (mffd) {
-      affine = mffd->GetGlobalTransformation();
-      if (mffd->NumberOfLevels() > 0) {
-        irtkFreeFormTransformation *affd = mffd->GetLocalTransformation(mffd->NumberOfLevels() - 1);
-        ffd = dynamic_cast<irtkFreeFormTransformation3D *>(affd);
-        if (!ffd) {
-          cerr << EXECNAME << ": Cannot process MFFD \"" << dofin[i] << "\" with level of type " << affd->NameOfClass() << endl;
-          exit(1);
-        }
-      }
-    }
-    if (affine    ) similarity = affine;
-    if (similarity) rigid      = similarity;
-    if (rigid     ) global     = rigid;
-    // Get local transformation parameters
-    if (deformation && ffd) {
-      if (invert) {
-        cerr << EXECNAME << ": -invert option only supported for rigid/affine transformations" << endl;
+  // Read and process input transformations, keeping at most the given number
+  // of transformations and local displacement fields in memory at a time
+  ProcessInputDoFs process;
+  process._DoFName     = &dofin;
+  process._Identity    = identity_name;
+  process._Weight      = w;
+  process._Attributes  = attr;
+  process._N           = N;
+  process._Deformation = deformation;
+  process._Translation = translation;
+  process._Rotation    = rotation;
+  process._Scaling     = scaling;
+  process._Shearing    = shearing;
+  process._Invert      = invert;
+  process._AverageDoFs = avgdofs;
+  process._LogSpace    = (logspace != 0);
+  process._A           = A;
+
+  if (pipeline < 1) pipeline = 1;
+  if (pipeline > static_cast<int>(dofin.size())) pipeline = max(1, static_cast<int>(dofin.size()));
+  vector<irtkGenericImage<double> > d(avgD.IsEmpty() ? 0 : pipeline);
+  vector<char>                      has_d(pipeline, false);
+  vector<string>                    error(pipeline);
+  for (size_t n = 0; n < d.size(); ++n) d[n].Initialize(attr, 3);
+  process._Displacement    = (d.empty() ? NULL : &d[0]);
+  process._HasDisplacement = &has_d[0];
+  process._Error           = &error[0];
+
+  for (int i = 0; i < static_cast<int>(dofin.size()); i += pipeline) {
+    const int n = min(pipeline, static_cast<int>(dofin.size()) - i);
+    process._Offset = i;
+    parallel_for(blocked_range<int>(0, n, 1), process);
+    for (int s = 0; s < n; ++s) {
+      if (!error[s].empty()) {
+        cerr << EXECNAME << ": " << error[s] << endl;
         exit(1);
       }
-      // Get inverse of the linear transformation matrix
-      irtkMatrix invA(4, 4);
-      if (global) {
-        invA = global->GetMatrix();
-        invA.Invert();
-      } else invA.Ident();
-      // Average parameters at control points directly when possible
-      double x, y, z;
-      if (avgdofs) {
-        for (int k = 0; k < attr._z; ++k) {
-          for (int j = 0; j < attr._y; ++j) {
-            for (int i = 0; i < attr._x; ++i) {
-              // Get control point parameters
-              ffd->Get(i, j, k, x, y, z);
-              // Remove dependency on global transformation
-              // Note: Applies also when the FFD parameters are stationary velocities, see below.
-              d(i, j, k, 0) = invA(0, 0) * x + invA(0, 1) * y + invA(0, 2) * z;
-              d(i, j, k, 1) = invA(1, 0) * x + invA(1, 1) * y + invA(1, 2) * z;
-              d(i, j, k, 2) = invA(2, 0) * x + invA(2, 1) * y + invA(2, 2) * z;
-            }
-          }
-        }
-      // Otherwise,...
-      } else {
-        // Get local displacement field
-        irtkMatrix i2w = attr.GetImageToWorldMatrix();
-        for (int k = 0; k < attr._z; ++k) {
-          for (int j = 0; j < attr._y; ++j) {
-            for (int i = 0; i < attr._x; ++i) {
-              // Convert voxel indices to world coordinates
-              x = i2w(0, 0) * i + i2w(0, 1) * j + i2w(0, 2) * k + i2w(0, 3);
-              y = i2w(1, 0) * i + i2w(1, 1) * j + i2w(1, 2) * k + i2w(1, 3);
-              z = i2w(2, 0) * i + i2w(2, 1) * j + i2w(2, 2) * k + i2w(2, 3);
-              // Evaluate (total) local voxel displacement
-              t->LocalDisplacement(x, y, z);
-              // Remove dependency on global transformation
-              d(i, j, k, 0) = invA(0, 0) * x + invA(0, 1) * y + invA(0, 2) * z;
-              d(i, j, k, 1) = invA(1, 0) * x + invA(1, 1) * y + invA(1, 2) * z;
-              d(i, j, k, 2) = invA(2, 0) * x + invA(2, 1) * y + invA(2, 2) * z;
-            }
-          }
-        }
-        // Compute stationary velocity field
-        if (logspace) {
-          log(&d);
-          // Smooth velocities if only few transformations are being averaged,
-          // otherwise rely on the average velocity field to be sufficiently smooth
-          if (N < 5) {
-            irtkGaussianBlurring<double> blur(max(attr._dx, max(attr._dy, attr._dz)));
-            blur.SetInput (&d);
-            blur.SetOutput(&d);
-            blur.Run();
-          }
-        }
-      }
-      // Add to sum of local transformations
-      if (w) d *= w[i];
-      avgD += d;
     }
-    // Get global transformation parameters
-    // (**after** local parameters as the following modifies the transformation)
-    if (A && global) {
-      if (invert) global->Invert();
-      if (!translation) {
-        rigid->PutTranslationX(0);
-        rigid->PutTranslationY(0);
-        rigid->PutTranslationZ(0);
-      }
-      if (!rotation) {
-        rigid->PutRotationX(0);
-        rigid->PutRotationY(0);
-        rigid->PutRotationZ(0);
-      }
-      if (!scaling) {
-        if (affine) {
-          affine->PutScaleX(100);
-          affine->PutScaleY(100);
-          affine->PutScaleZ(100);
-        } else if (similarity) {
-          similarity->PutScale(100);
-        }
-      }
-      if (!shearing && affine) {
-        affine->PutShearXY(0);
-        affine->PutShearXZ(0);
-        affine->PutShearYZ(0);
-      }
-      A[i] = global->GetMatrix();
+    // Add to sum of local transformations in order of input transformations
+    for (int s = 0; s < n; ++s) {
+      if (has_d[s]) avgD += d[s];
     }
   }
 
@@ -666,18 +811,10 @@ int main(int argc, char **argv)
     // of the family of explicit Runge-Kutta methods for the exponentiation step which
     // consists of a sum of the velocities at different time steps, i.e.,
     // avgT(x) = avgA x + avgA sum_i b_i h v(x_i) = avgA x + sum_i b_i h (avgA v(x_i)).
-    double x, y, z;
-    const irtkMatrix &avgA = globalAvg.GetMatrix();
-    for (int k = 0; k < attr._z; ++k) {
-      for (int j = 0; j < attr._y; ++j) {
-        for (int i = 0; i < attr._x; ++i) {
-          x = avgD(i, j, k, 0), y = avgD(i, j, k, 1), z = avgD(i, j, k, 2);
-          avgD(i, j, k, 0) = avgA(0, 0) * x + avgA(0, 1) * y + avgA(0, 2) * z;
-          avgD(i, j, k, 1) = avgA(1, 0) * x + avgA(1, 1) * y + avgA(1, 2) * z;
-          avgD(i, j, k, 2) = avgA(2, 0) * x + avgA(2, 1) * y + avgA(2, 2) * z;
-        }
-      }
-    }
+    TransformDisplacements premultiply;
+    premultiply._Matrix       = globalAvg.GetMatrix();
+    premultiply._Displacement = &avgD;
+    parallel_for(blocked_range3d<int>(0, attr._z, 0, attr._y, 0, attr._x), premultiply);
     // Construct FFD from average deformation
     irtkFreeFormTransformation *ffd = NULL;
     if (avgdofs) {
@@ -46,6 +46,7 @@ void PrintSynopsis(const char *name)
   cout << "       " << name << " -image <image1> <image2>... [options]" << endl;
   cout << "       " << name << " <image1> <image2>... [options]" << endl;
   cout << "       " << name << " <image_sequence> [options]" << endl;
+  cout << "       " << name << " -image <image1>... -batch <jobs.lst> [options]" << endl;
 #ifdef HAS_VTK
   cout << "       " << name << " -pset <pointset1> [-dof <dof1>] -pset <pointset2> [-dof <dof2>]... [options]" << endl;
   cout << "       " << name << " <dataset1> <dataset2>... [options]" << endl;
@@ -75,6 +76,9 @@ void PrintUsage(const char* name)
   cout << "  -mask   <file>          Reference mask which defines the domain within which to evaluate the" << endl;
   cout << "                          energy function (i.e. data fidelity terms). (default: none)" << endl;
   cout << "  -dofin  <file>          Initial transformation estimate. (default: align centroids)" << endl;
+  cout << "  -batch  <file>          Register each image listed in the text file in turn. (default: none)" << endl;
+  cout << "  -checkpoint <file>      Save state of registration after each resolution level. (default: none)" << endl;
+  cout << "  -resume <file>          Resume registration from checkpoint file if it exists. (default: none)" << endl;
   cout << "  -par '<name>=<value>'   Specify parameter value directly as command argument." << endl;
   cout << "  -parin  <file>          Read parameters from configuration file. If \"stdin\" or \"cin\"," << endl;
   cout << "                          the parameters are read from standard input instead. (default: ireg.cfg)" << endl;
@@ -170,6 +174,25 @@ void PrintHelp(const char* name)
   cout << "                               of the chosen transformation model at the initial resolution level." << endl;
   cout << "                               The input transformation may thus be of different type than the" << endl;
   cout << "                               output transformation of the registration. (default: none)" << endl;
+  cout << "  -batch <file>                Text file with one registration per line. Each line contains the" << endl;
+  cout << "                               name of an input image which is appended to the input images given" << endl;
+  cout << "                               on the command-line, followed by the name of the output transformation" << endl;
+  cout << "                               and optionally the name of the initial transformation (cf. -dofin)." << endl;
+  cout << "                               Relative paths are relative to the directory of the text file." << endl;
+  cout << "                               The registrations are performed one after the other. The input images" << endl;
+  cout << "                               given on the command-line, the mask, and the configuration are read" << endl;
+  cout << "                               only once and the resolution pyramids of these images and the mask" << endl;
+  cout << "                               are reused by all registrations. For example, to register an atlas" << endl;
+  cout << "                               to many subjects, specify the atlas as first image and the subject" << endl;
+  cout << "                               images in the batch file. (default: none)" << endl;
+  cout << "  -checkpoint <file>           Write current transformation estimate and resolution level to the named" << endl;
+  cout << "                               file each time a resolution level is completed. (default: none)" << endl;
+  cout << "  -resume <file>               Resume interrupted registration from the named checkpoint file. The" << endl;
+  cout << "                               completed resolution levels are skipped. If the file does not exist," << endl;
+  cout << "                               the registration starts from the beginning. The same configuration" << endl;
+  cout << "                               must be used as for the interrupted run. To continue a pre-empted" << endl;
+  cout << "                               job, rerun the same command with \"-checkpoint <file> -resume <file>\"." << endl;
+  cout << "                               (default: none)" << endl;
   cout << "  -par '<name>=<value>'        Specify parameter value directly as command argument." << endl;
   cout << "  -parin  <file>               Read parameters from configuration file. If \"stdin\" or \"cin\"," << endl;
   cout << "                               the parameters are read from standard input instead. (default: none)" << endl;
@@ -406,6 +429,100 @@ bool IsIdentity(const string &name)
   return name.empty() || name == "identity" || name == "Identity" || name == "Id";
 }
 
+// -----------------------------------------------------------------------------
+bool IsNone(const string &name)
+{
+  return name == "none" || name == "None" || name == "NONE";
+}
+
+// -----------------------------------------------------------------------------
+/// Read input image, output and initial transformation file names of batch registrations
+int read_batch_list_file(const char *list_name, vector<string> &images, vector<string> &dofouts, vector<string> &dofins)
+{
+  const string base_dir = Directory(list_name); // Base directory of relative file paths
+  ifstream     iff(list_name);                  // List input file stream
+  string       line;                            // Input line
+  string       entry;                           // Column entry
+  int          l = 0;                           // Line number
+
+  images .clear();
+  dofouts.clear();
+  dofins .clear();
+
+  if (!iff) {
+    cerr << "Error: Cannot open list file " << list_name << endl;
+    return 0;
+  }
+
+  while (getline(iff, line)) {
+    l++;
+    istringstream lss(line);
+    vector<string> entries;
+    while (lss >> entry) {
+      // Ignore comments starting with # character
+      if (entry[0] == '#') break;
+      entries.push_back(entry);
+    }
+    // Make file paths relative to list file, but keep keyword entries
+    if (!base_dir.empty()) {
+      for (size_t i = 0; i < entries.size() && i < 3; ++i) {
+        if (entries[i][0] == PATHSEP) continue;
+        if (i == 1 && IsNone    (entries[i])) continue;
+        if (i == 2 && IsIdentity(entries[i])) continue;
+        entries[i] = base_dir + PATHSEP + entries[i];
+      }
+    }
+    if (entries.empty()) continue; // Skip empty lines
+    if (entries.size() < 2) {
+      cerr << "Error: " << list_name << ":" << l << ": Missing output transformation name!" << endl;
+    } else if (entries.size() > 3) {
+      cerr << "Error: " << list_name << ":" << l << ": Too many entries!" << endl;
+    }
+    if (entries.size() < 2 || entries.size() > 3) {
+      images .clear();
+      dofouts.clear();
+      dofins .clear();
+      return 0;
+    }
+    images .push_back(entries[0]);
+    dofouts.push_back(entries[1]);
+    dofins .push_back(entries.size() > 2 ? entries[2] : string());
+  }
+
+  return static_cast<int>(images.size());
+}
+
+// -----------------------------------------------------------------------------
+/// Set registration parameters from configuration file, command arguments,
+/// and standard input, whose contents were read into the respective strings
+void ReadConfiguration(irtkGenericRegistrationFilter &registration,
+                       const char *parin_name, const string &parin,
+                       const string &params, const string &input, bool echo)
+{
+  // 1. Read parameters from file
+  if (!parin.empty()) {
+    istringstream is(parin);
+    if (!registration.Read(is, echo)) {
+      cerr << "Failed to read configuration from file \"" << parin_name << "\"!" << endl;
+      exit(1);
+    }
+  }
+  // 2. Set parameters provided as command arguments
+  istringstream is(params);
+  if (!registration.Read(is, echo)) {
+    cerr << "Failed to parse configuration given as command arguments!" << endl;
+    exit(1);
+  }
+  // 3. Add any parameters read from standard input stream
+  if (!input.empty()) {
+    istringstream is(input);
+    if (!registration.Read(is, echo)) {
+      cerr << "Failed to read configuration from standard input stream!" << endl;
+      exit(1);
+    }
+  }
+}
+
 // =============================================================================
 // Read input
 // =============================================================================
@@ -579,6 +696,9 @@ int main(int argc, char **argv)
   const char *parin_name         = NULL;
   const char *parout_name        = NULL;
   const char *mask_name          = NULL;
+  const char *batch_list_name    = NULL;
+  const char *checkpoint_name    = NULL;
+  const char *resume_name        = NULL;
   stringstream params;
 
   enum {
@@ -653,6 +773,9 @@ int main(int argc, char **argv)
     else if (OPTION("-dofin" )) dofin_name      = ARGUMENT;
     else if (OPTION("-dofout")) dofout_name     = ARGUMENT;
     else if (OPTION("-mask"))   mask_name       = ARGUMENT;
+    else if (OPTION("-batch"))  batch_list_name = ARGUMENT;
+    else if (OPTION("-checkpoint")) checkpoint_name = ARGUMENT;
+    else if (OPTION("-resume"))     resume_name     = ARGUMENT;
     else if (OPTION("-nodebug-level-prefix")) debug_output_level_prefix = false;
     // Parameter
     else if (OPTION("-par"))    params << ARGUMENT << endl;
@@ -670,6 +793,11 @@ int main(int argc, char **argv)
     else HANDLE_COMMON_OR_UNKNOWN_OPTION();
   }
 
+  if (batch_list_name && (checkpoint_name || resume_name)) {
+    cerr << "Options -checkpoint and -resume cannot be used together with -batch" << endl;
+    exit(1);
+  }
+
   // TODO: Read initial transformations from list file (cf. obsolete tdreg)
   if (dofin_list_name) {
     cerr << "Option -dofins currently not implemented" << endl;
@@ -694,26 +822,27 @@ int main(int argc, char **argv)
   bool parin_stdin = (parin_name && (strcmp(parin_name, "stdin") == 0 ||
                                      strcmp(parin_name, "STDIN") == 0 ||
                                      strcmp(parin_name, "cin")   == 0));
-  // 1. Read parameters from file
-  if (!parin_stdin && parin_name && !registration.Read(parin_name, verbose > 2)) {
-    cerr << "Failed to read configuration from file \"" << parin_name << "\"!" << endl;
-    exit(1);
-  }
-  // 2. Set parameters provided as command arguments
-  if (!registration.Read(params, verbose > 2)) {
-    cerr << "Failed to parse configuration given as command arguments!" << endl;
-    exit(1);
+  // Keep configuration in memory to re-apply it for each batch registration
+  string parin_text, stdin_text;
+  if (!parin_stdin && parin_name) {
+    ifstream from(parin_name);
+    if (!from) {
+      cerr << "Failed to read configuration from file \"" << parin_name << "\"!" << endl;
+      exit(1);
+    }
+    stringstream text;
+    text << from.rdbuf();
+    parin_text = text.str();
   }
-  // 3. Add any parameters read from standard input stream
   if (parin_stdin) {
     if (verbose) {
       cout << "\nEnter additional parameters now (press Ctrl-D to continue):" << endl;
     }
-    if (!registration.Read(cin, verbose > 2)) {
-      cerr << "Failed to read configuration from standard input stream!" << endl;
-      exit(1);
-    }
+    stringstream text;
+    text << cin.rdbuf();
+    stdin_text = text.str();
   }
+  ReadConfiguration(registration, parin_name, parin_text, params.str(), stdin_text, verbose > 2);
   if (verbose > 2 || (parin_stdin && verbose > 0)) {
     if (verbose > 2) cout << "\n";
     cout << "Reading configuration ... done";
@@ -721,12 +850,22 @@ int main(int argc, char **argv)
     cout << endl;
   }
 
+  // ---------------------------------------------------------------------------
+  // Read list of batch registrations
+  vector<string> batch_images, batch_dofouts, batch_dofins;
+  if (batch_list_name) {
+    if (read_batch_list_file(batch_list_name, batch_images, batch_dofouts, batch_dofins) == 0) {
+      cerr << "Error: Failed to parse batch list file " << batch_list_name << "!" << endl;
+      exit(1);
+    }
+  }
+
   // ---------------------------------------------------------------------------
   // Determine number of input images
   vector<double>                   image_times;
   vector<std::unique_ptr<irtkBaseImage> > images;
 
-  if (image_names.size() == 1) {
+  if (image_names.size() == 1 && !batch_list_name) {
     std::unique_ptr<irtkBaseImage> sequence(irtkBaseImage::New(image_names[0].c_str()));
     const int nframes = sequence->GetT();
     if (nframes < 2) {
@@ -775,10 +914,22 @@ int main(int argc, char **argv)
 
   // ---------------------------------------------------------------------------
   // Parse energy formula to determine which input files are really used
-  registration.ParseEnergyFormula(static_cast<int>(image_names.size()),
-                                  static_cast<int>(pset_names .size()), 1);
+  //
+  // In batch mode, the image of each batch registration is appended to the
+  // input images given on the command-line.
+  if (batch_list_name) {
+    image_names.push_back(batch_images[0]);
+  }
+  const int nenergy_images = static_cast<int>(image_names.size());
+  const int nenergy_psets  = static_cast<int>(pset_names .size());
+  registration.ParseEnergyFormula(nenergy_images, nenergy_psets, 1);
 
   const int nimages = registration.NumberOfRequiredImages();
+  if (batch_list_name && nimages != nenergy_images) {
+    cerr << "Error: Energy function must use image I(" << nenergy_images
+         << ") of batch registrations and no further images!" << endl;
+    exit(1);
+  }
   image_names .resize(nimages);
   image_times .resize(nimages);
   imdof_names .resize(nimages);
@@ -808,39 +959,6 @@ int main(int argc, char **argv)
     cout << endl;
   }
 
-  // ---------------------------------------------------------------------------
-  // Read input images
-  {
-    if (nimages > 0 && verbose > 1) {
-      cout << "Reading images ..........";
-      cout.flush();
-    }
-
-    ConcurrentImageReader::Error *errors = new ConcurrentImageReader::Error[nimages];
-    ConcurrentImageReader::Run(image_names, imdof_names, imdof_invert, images, errors);
-
-    int nerrors = 0;
-    for (int n = 0; n < nimages; ++n) {
-      if (errors[n] == ConcurrentImageReader::InvalidDoF) {
-        ++nerrors;
-        if (verbose > 1 && nerrors == 1) cout << " failed\n" << endl;
-        cerr << "Error: Implicit transformation of image " << (n+1) << " can only be affine" << endl;
-      }
-    }
-    delete[] errors;
-    if (nerrors > 0) exit(1);
-
-    if (nimages > 0 && verbose > 1) {
-      cout << " done" << endl;
-    }
-  }
-
-  // Set input images
-  for (int n = 0; n < nimages; ++n) {
-    images[n]->PutTOrigin(image_times[n]);
-    registration.AddInput(images[n].get());
-  }
-
   // ---------------------------------------------------------------------------
   // Read input point sets
 #ifdef HAS_VTK
@@ -887,15 +1005,6 @@ int main(int argc, char **argv)
   }
 #endif
 
-  // ---------------------------------------------------------------------------
-  // Read initial transformation
-  std::unique_ptr<irtkTransformation> dofin;
-  if (dofin_name) {
-    if (IsIdentity(dofin_name)) dofin.reset(new irtkRigidTransformation());
-    else                        dofin.reset(irtkTransformation::New(dofin_name));
-    registration.InitialGuess(dofin.get());
-  }
-
   // ---------------------------------------------------------------------------
   // Read mask which defines domain on which similarity is evaluated
   std::unique_ptr<irtkBinaryImage> mask;
@@ -904,10 +1013,8 @@ int main(int argc, char **argv)
     registration.Domain(mask.get());
   }
 
-  IRTK_DEBUG_TIMING(1, "reading input data");
-
   // ---------------------------------------------------------------------------
-  // Run registration
+  // Attach observers
   irtkGenericRegistrationLogger   logger;
   irtkGenericRegistrationDebugger debugger("ireg_");
   debugger.LevelPrefix(debug_output_level_prefix);
@@ -921,59 +1028,149 @@ int main(int argc, char **argv)
     registration.AddObserver(debugger);
   }
 
-  irtkTransformation *dofout = NULL;
-  registration.Output(&dofout);
+  // ---------------------------------------------------------------------------
+  // Perform registration(s)
+  const int njobs = (batch_list_name ? static_cast<int>(batch_images.size()) : 1);
+  for (int job = 0; job < njobs; ++job) {
+
+    const char *job_dofin_name  = dofin_name;
+    const char *job_dofout_name = dofout_name;
 
-  // Write initial parameters to file
-  // Note: Will be overwritten once the registration finished successfully
-  //       with the actual parameters used below.
-  if (parout_name) {
-    registration.GuessParameter();
-    registration.Write(parout_name);
-  }
+    if (batch_list_name) {
+      if (verbose) {
+        cout << "\nBatch registration " << (job + 1) << " of " << njobs << ": " << batch_images[job] << endl;
+      }
+      // Reset settings modified by previous registration, but keep input
+      if (job > 0) {
+        registration.Reset();
+        ReadConfiguration(registration, parin_name, parin_text, params.str(), stdin_text, false);
+        registration.ParseEnergyFormula(nenergy_images, nenergy_psets, 1);
+      }
+      image_names.back() = batch_images[job];
+      images     .back().reset();
+      if (!batch_dofins[job].empty()) job_dofin_name = batch_dofins[job].c_str();
+      job_dofout_name = batch_dofouts[job].c_str();
+    }
+
+    // -------------------------------------------------------------------------
+    // Read input images
+    {
+      if (nimages > 0 && verbose > 1) {
+        cout << "Reading images ..........";
+        cout.flush();
+      }
+
+      ConcurrentImageReader::Error *errors = new ConcurrentImageReader::Error[nimages];
+      ConcurrentImageReader::Run(image_names, imdof_names, imdof_invert, images, errors);
+
+      int nerrors = 0;
+      for (int n = 0; n < nimages; ++n) {
+        if (errors[n] == ConcurrentImageReader::InvalidDoF) {
+          ++nerrors;
+          if (verbose > 1 && nerrors == 1) cout << " failed\n" << endl;
+          cerr << "Error: Implicit transformation of image " << (n+1) << " can only be affine" << endl;
+        }
+      }
+      delete[] errors;
+      if (nerrors > 0) exit(1);
+
+      if (nimages > 0 && verbose > 1) {
+        cout << " done" << endl;
+      }
+    }
+
+    // Set input images
+    {
+      vector<const irtkBaseImage *> input(nimages);
+      for (int n = 0; n < nimages; ++n) {
+        images[n]->PutTOrigin(image_times[n]);
+        input[n] = images[n].get();
+      }
+      registration.Input(nimages, nimages > 0 ? &input[0] : NULL);
+    }
+
+    // Keep resolution pyramids of images and mask shared by batch registrations
+    if (batch_list_name && job == 0) {
+      for (int n = 0; n < nimages - 1; ++n) {
+        registration.KeepPyramid(images[n].get());
+      }
+      registration.KeepPyramid(mask.get());
+    }
+
+    // -------------------------------------------------------------------------
+    // Read initial transformation
+    std::unique_ptr<irtkTransformation> dofin;
+    if (job_dofin_name) {
+      if (IsIdentity(job_dofin_name)) dofin.reset(new irtkRigidTransformation());
+      else                            dofin.reset(irtkTransformation::New(job_dofin_name));
+    }
+    registration.InitialGuess(dofin.get());
+
+    IRTK_DEBUG_TIMING(1, "reading input data");
+
+    // -------------------------------------------------------------------------
+    // Run registration
+    irtkTransformation *dofout = NULL;
+    registration.Output(&dofout);
+
+    // Save/restore state of registration
+    if (checkpoint_name) registration.CheckpointFile(checkpoint_name);
+    if (resume_name && ifstream(resume_name).good()) {
+      if (verbose) cout << "Resuming registration from " << resume_name << endl;
+      registration.ResumeFile(resume_name);
+    }
+
+    // Write initial parameters to file
+    // Note: Will be overwritten once the registration finished successfully
+    //       with the actual parameters used below.
+    if (parout_name) {
+      registration.GuessParameter();
+      registration.Write(parout_name);
+    }
 
 #ifdef HAS_TBB
-  tick_count start_time = tick_count::now();
+    tick_count start_time = tick_count::now();
 #else
-  clock_t start_time = clock();
+    clock_t start_time = clock();
 #endif
 
-  registration.Run();
+    registration.Run();
 
-  if (verbose) {
-    double elapsed_time;
+    if (verbose) {
+      double elapsed_time;
 #ifdef HAS_TBB
-    elapsed_time = (tick_count::now() - start_time).seconds();
+      elapsed_time = (tick_count::now() - start_time).seconds();
 #else
-    elapsed_time = static_cast<double>(clock() - start_time)
-                 / static_cast<double>(CLOCKS_PER_SEC);
+      elapsed_time = static_cast<double>(clock() - start_time)
+                   / static_cast<double>(CLOCKS_PER_SEC);
 #endif
-    int m = floor(elapsed_time / 60.0);
-    int s = round(elapsed_time - m * 60);
-    if (s == 60) m += 1, s = 0;
-    cout << "\nFinished in " << m << " min " << s << " sec" << endl;
-  }
-
-  // Write final transformation
-  if (dofout_name && strcmp(dofout_name, "none") != 0 &&
-                     strcmp(dofout_name, "None") != 0 &&
-                     strcmp(dofout_name, "NONE") != 0) {
-    if (dofout->TypeOfClass() == IRTKTRANSFORMATION_SIMILARITY) {
-      // Write affine transformation instead, because most other programs
-      // cannot deal with the new similarity transformation type (yet)
-      // TODO: Update other tools (e.g., rview) to handle irtkSimilarityTransformation
-      irtkAffineTransformation aff(*static_cast<irtkSimilarityTransformation *>(dofout));
-      aff.Write(dofout_name);
-    } else {
-      dofout->Write(dofout_name);
+      int m = floor(elapsed_time / 60.0);
+      int s = round(elapsed_time - m * 60);
+      if (s == 60) m += 1, s = 0;
+      cout << "\nFinished in " << m << " min " << s << " sec" << endl;
     }
-  }
 
-  // Write actual parameters used to file
-  if (parout_name) registration.Write(parout_name);
+    // Write final transformation
+    if (job_dofout_name && !IsNone(job_dofout_name)) {
+      if (dofout->TypeOfClass() == IRTKTRANSFORMATION_SIMILARITY) {
+        // Write affine transformation instead, because most other programs
+        // cannot deal with the new similarity transformation type (yet)
+        // TODO: Update other tools (e.g., rview) to handle irtkSimilarityTransformation
+        irtkAffineTransformation aff(*static_cast<irtkSimilarityTransformation *>(dofout));
+        aff.Write(job_dofout_name);
+      } else {
+        dofout->Write(job_dofout_name);
+      }
+    }
+
+    // Write actual parameters used to file
+    if (parout_name) registration.Write(parout_name);
+
+    // Clean up
+    registration.InitialGuess(NULL);
+    delete dofout;
+  }
 
-  // Clean up
-  delete dofout;
   registration.DeleteObserver(logger);
   registration.DeleteObserver(debugger);
 
@@ -26,6 +26,7 @@
 #include <vtkImageDataToPointSet.h>
 #include <vtkPoints.h>
 #include <vtkPointData.h>
+#include <vtkFloatArray.h>
 #include <vtkCellData.h>
 #include <vtkDataSetWriter.h>
 #include <vtkDataSetReader.h>
@@ -61,11 +62,82 @@ void PrintHelp(const char *name)
   cout << "  -normals          Whether to recompute normals of input surface mesh. (default: off)" << endl;
   cout << "  -point-normals    Whether to recompute point normals of input surface mesh. (default: off)" << endl;
   cout << "  -cell-normals     Whether to recompute cell  normals of input surface mesh. (default: off)" << endl;
+  cout << "  -jacobian-normals Transform point normals of input dataset by the Jacobian of the" << endl;
+  cout << "                    transformation instead of recomputing them. (default: off)" << endl;
+  cout << "  -jacobian-determinant [<name>]" << endl;
+  cout << "                    Add point data array with Jacobian determinant of the" << endl;
+  cout << "                    transformation. (default: off, name: Jacobian)" << endl;
+  cout << "  -jacobian-matrix [<name>]" << endl;
+  cout << "                    Add point data array with Jacobian matrix of the transformation" << endl;
+  cout << "                    in row-major order. (default: off, name: JacobianMatrix)" << endl;
   cout << "  -ascii            Set file type of output VTK file to ASCII.  (default: input file type)" << endl;
   cout << "  -binary           Set file type of output VTK file to BINARY. (default: input file type)" << endl;
   PrintStandardOptions(cout);
 }
 
+// -----------------------------------------------------------------------------
+/// Compose Jacobian matrices of consecutive transformations, i.e., J = J1 * J
+struct ComposeJacobians
+{
+  double       *_Jacobian;
+  const double *_Next;
+  bool          _Invert;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    double A[9], J[9], det;
+    for (int n = re.begin(); n != re.end(); ++n) {
+      const double *J1 = _Next     + 9 * n;
+      double       *J0 = _Jacobian + 9 * n;
+      // Jacobian of inverse transformation is inverse of Jacobian
+      if (_Invert) {
+        A[0] = J1[4] * J1[8] - J1[5] * J1[7];
+        A[1] = J1[2] * J1[7] - J1[1] * J1[8];
+        A[2] = J1[1] * J1[5] - J1[2] * J1[4];
+        A[3] = J1[5] * J1[6] - J1[3] * J1[8];
+        A[4] = J1[0] * J1[8] - J1[2] * J1[6];
+        A[5] = J1[2] * J1[3] - J1[0] * J1[5];
+        A[6] = J1[3] * J1[7] - J1[4] * J1[6];
+        A[7] = J1[1] * J1[6] - J1[0] * J1[7];
+        A[8] = J1[0] * J1[4] - J1[1] * J1[3];
+        det  = J1[0] * A[0] + J1[1] * A[3] + J1[2] * A[6];
+        if (det != .0) det = 1.0 / det;
+        for (int i = 0; i < 9; ++i) A[i] *= det;
+      } else {
+        memcpy(A, J1, 9 * sizeof(double));
+      }
+      for (int r = 0; r < 3; ++r)
+      for (int c = 0; c < 3; ++c) {
+        J[3*r+c] = A[3*r] * J0[c] + A[3*r+1] * J0[3+c] + A[3*r+2] * J0[6+c];
+      }
+      memcpy(J0, J, 9 * sizeof(double));
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Transform normal vectors by the inverse transpose of the Jacobian matrix
+struct TransformNormals
+{
+  const double *_Jacobian;
+  double       *_Normals;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    double m[3], norm;
+    for (int i = re.begin(); i != re.end(); ++i) {
+      const double *J = _Jacobian + 9 * i;
+      double       *n = _Normals  + 3 * i;
+      // Multiply by cofactor matrix, i.e., det(J) * inv(J)^T
+      m[0] = (J[4] * J[8] - J[5] * J[7]) * n[0] + (J[5] * J[6] - J[3] * J[8]) * n[1] + (J[3] * J[7] - J[4] * J[6]) * n[2];
+      m[1] = (J[2] * J[7] - J[1] * J[8]) * n[0] + (J[0] * J[8] - J[2] * J[6]) * n[1] + (J[1] * J[6] - J[0] * J[7]) * n[2];
+      m[2] = (J[1] * J[5] - J[2] * J[4]) * n[0] + (J[2] * J[3] - J[0] * J[5]) * n[1] + (J[0] * J[4] - J[1] * J[3]) * n[2];
+      norm = sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+      if (norm > .0) n[0] = m[0] / norm, n[1] = m[1] / norm, n[2] = m[2] / norm;
+    }
+  }
+};
+
 // -----------------------------------------------------------------------------
 int main(int argc, char **argv)
 {
@@ -78,7 +150,7 @@ int main(int argc, char **argv)
   }
 
   vtkSmartPointer<vtkPointSet> pointset;
-  irtkPointSet                 points;
+  vector<double>               x, y, z;
 
   // Positional arguments
   const char *input_name  = NULL;
@@ -98,6 +170,9 @@ int main(int argc, char **argv)
   irtkGreyImage        target, source;
   bool compute_point_normals = false;
   bool compute_cell_normals  = false;
+  bool jacobian_normals      = false;
+  const char *jacobian_det_name = NULL;
+  const char *jacobian_mat_name = NULL;
   int  pnumber               = 0;
   int  output_file_type      = -1;
   double tt = .0, ts = 1.0; // Temporal origin, used by velocity based transformations
@@ -129,6 +204,13 @@ int main(int argc, char **argv)
     else if (OPTION("-normals")) compute_point_normals = compute_cell_normals = true;
     else if (OPTION("-point-normals")) compute_point_normals = true;
     else if (OPTION("-cell-normals")) compute_cell_normals = true;
+    else if (OPTION("-jacobian-normals")) jacobian_normals = true;
+    else if (OPTION("-jacobian-determinant")) {
+      jacobian_det_name = (HAS_ARGUMENT ? ARGUMENT : "Jacobian");
+    }
+    else if (OPTION("-jacobian-matrix")) {
+      jacobian_mat_name = (HAS_ARGUMENT ? ARGUMENT : "JacobianMatrix");
+    }
     else if (OPTION("-ascii"))  output_file_type = VTK_ASCII;
     else if (OPTION("-binary")) output_file_type = VTK_BINARY;
     else HANDLE_STANDARD_OR_UNKNOWN_OPTION();
@@ -177,40 +259,73 @@ int main(int argc, char **argv)
       cerr << "Input VTK dataset has no points" << endl;
       exit(1);
     }
-    points.Resize(pointset->GetNumberOfPoints());
-    for (vtkIdType i = 0; i < pointset->GetNumberOfPoints(); ++i) {
+    const int n = static_cast<int>(pointset->GetNumberOfPoints());
+    x.resize(n), y.resize(n), z.resize(n);
+    for (int i = 0; i < n; ++i) {
       pointset->GetPoint(i, p);
-      points(i) = p;
+      x[i] = p[0], y[i] = p[1], z[i] = p[2];
     }
   } else {
     if (output_file_type == -1) output_file_type = VTK_BINARY;
     while (cin) {
       cin >> p[0] >> p[1] >> p[2];
       if (!cin) break;
-      points.Add(p);
+      x.push_back(p[0]), y.push_back(p[1]), z.push_back(p[2]);
+    }
+  }
+  const int npoints = static_cast<int>(x.size());
+  if (pnumber <= 0 || pnumber > npoints) pnumber = npoints;
+
+  // Jacobian of composite transformation
+  const bool jacobian = (jacobian_normals || jacobian_det_name || jacobian_mat_name);
+  if (jacobian && !pointset) {
+    cerr << "Options -jacobian-normals, -jacobian-determinant, and -jacobian-matrix require VTK input dataset" << endl;
+    exit(1);
+  }
+  vector<double> jac, next;
+  if (jacobian) {
+    jac.resize(9 * npoints, .0);
+    next.resize(9 * pnumber);
+    for (int i = 0; i < npoints; ++i) {
+      jac[9*i] = jac[9*i+4] = jac[9*i+8] = 1.0;
     }
-    points.ShrinkToFit();
   }
-  if (pnumber <= 0) pnumber = points.Size();
 
   // Map all points from target world to source world
   if (!target.IsEmpty() && !source.IsEmpty()) {
-    for (int i = 0; i < points.Size(); ++i) {
-      irtkPoint &pt = points(i);
+    const irtkMatrix A = source.GetImageToWorldMatrix() * target.GetWorldToImageMatrix();
+    for (int i = 0; i < npoints; ++i) {
+      irtkPoint pt(x[i], y[i], z[i]);
       target.WorldToImage(pt);
       source.ImageToWorld(pt);
+      x[i] = pt._x, y[i] = pt._y, z[i] = pt._z;
+      if (jacobian) {
+        for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c) {
+          jac[9*i+3*r+c] = A(r, c);
+        }
+      }
     }
   }
 
   // Transform first pnumber points
-  for (size_t i = 0; i < dofin_name.size(); ++i) {
+  for (size_t i = 0; pnumber > 0 && i < dofin_name.size(); ++i) {
     std::unique_ptr<irtkTransformation> dofin(irtkTransformation::New(dofin_name[i]));
     if (dofin_invert[i]) {
       if (verbose) cout << "Apply inverse of " << dofin_name[i] << endl;
-      for (int i = 0; i < pnumber; ++i) dofin->Inverse(points(i), ts, tt);
-    } else {
+      dofin->Inverse(pnumber, &x[0], &y[0], &z[0], ts, tt);
+    }
+    if (jacobian) {
+      dofin->Jacobian(pnumber, &x[0], &y[0], &z[0], &next[0], NULL, ts, tt);
+      ComposeJacobians compose;
+      compose._Jacobian = &jac[0];
+      compose._Next     = &next[0];
+      compose._Invert   = dofin_invert[i];
+      parallel_for(blocked_range<int>(0, pnumber), compose);
+    }
+    if (!dofin_invert[i]) {
       if (verbose) cout << "Apply " << dofin_name[i] << endl;
-      for (int i = 0; i < pnumber; ++i) dofin->Transform(points(i), ts, tt);
+      dofin->Transform(pnumber, &x[0], &y[0], &z[0], ts, tt);
     }
   }
 
@@ -219,12 +334,50 @@ int main(int argc, char **argv)
     // Set output points
     vtkPoints *output_points = pointset->GetPoints();
     for (int i = 0; i < pnumber; ++i) {
-      const irtkPoint &pt = points(i);
-      output_points->SetPoint(i, pt._x, pt._y, pt._z);
+      output_points->SetPoint(i, x[i], y[i], z[i]);
+    }
+
+    // Transform point normals by Jacobian
+    vtkSmartPointer<vtkDataArray> point_normals = pointset->GetPointData()->GetNormals();
+    if (jacobian_normals) {
+      if (!point_normals) {
+        cerr << "Input dataset has no point normals to transform (-jacobian-normals)" << endl;
+        exit(1);
+      }
+      vector<double> normals(3 * npoints);
+      for (int i = 0; i < npoints; ++i) point_normals->GetTuple(i, &normals[3*i]);
+      TransformNormals transform;
+      transform._Jacobian = &jac[0];
+      transform._Normals  = &normals[0];
+      parallel_for(blocked_range<int>(0, npoints), transform);
+      for (int i = 0; i < npoints; ++i) point_normals->SetTuple(i, &normals[3*i]);
+    }
+
+    // Add Jacobian determinant and/or matrix to point data
+    if (jacobian_det_name) {
+      vtkSmartPointer<vtkFloatArray> array = vtkSmartPointer<vtkFloatArray>::New();
+      array->SetName(jacobian_det_name);
+      array->SetNumberOfComponents(1);
+      array->SetNumberOfTuples(npoints);
+      for (int i = 0; i < npoints; ++i) {
+        const double *J = &jac[9*i];
+        array->SetValue(i, J[0] * (J[4] * J[8] - J[5] * J[7]) +
+                           J[1] * (J[5] * J[6] - J[3] * J[8]) +
+                           J[2] * (J[3] * J[7] - J[4] * J[6]));
+      }
+      pointset->GetPointData()->AddArray(array);
+    }
+    if (jacobian_mat_name) {
+      vtkSmartPointer<vtkFloatArray> array = vtkSmartPointer<vtkFloatArray>::New();
+      array->SetName(jacobian_mat_name);
+      array->SetNumberOfComponents(9);
+      array->SetNumberOfTuples(npoints);
+      for (int i = 0; i < npoints; ++i) array->SetTuple(i, &jac[9*i]);
+      pointset->GetPointData()->AddArray(array);
     }
 
     // Generate surface normals
-    if (pointset->GetPointData()->HasArray("Normals")) compute_point_normals = true;
+    if (pointset->GetPointData()->HasArray("Normals") && !jacobian_normals) compute_point_normals = true;
     if (pointset->GetCellData ()->HasArray("Normals")) compute_cell_normals  = true;
 
     if (compute_point_normals || compute_cell_normals) {
@@ -237,6 +390,10 @@ int main(int argc, char **argv)
       normals->SetComputeCellNormals (compute_cell_normals);
       normals->Update();
       pointset = normals->GetOutput();
+      // vtkPolyDataNormals does not pass input point normals through
+      if (jacobian_normals && !compute_point_normals) {
+        pointset->GetPointData()->SetNormals(point_normals);
+      }
     }
 
     // Write the final dataset
@@ -263,9 +420,8 @@ int main(int argc, char **argv)
   } else {
 
     // Print transformed points
-    for (int i = 0; i < points.Size(); ++i) {
-      const irtkPoint &pt = points(i);
-      cout << pt._x << " " << pt._y << " " << pt._z << endl;
+    for (int i = 0; i < npoints; ++i) {
+      cout << x[i] << " " << y[i] << " " << z[i] << endl;
     }
 
   }
@@ -0,0 +1,25 @@
+# Any copyright is dedicated to the Public Domain.
+# http://creativecommons.org/publicdomain/zero/1.0/
+
+# - Try to find ARPACK
+# Once done this will define
+#  ARPACK_FOUND - System has ARPACK
+#  ARPACK_LIBRARIES - The libraries needed to use ARPACK
+#
+# ARPACK is a FORTRAN library without C headers. The prototypes of the
+# routines used by IRTK are declared in irtkArpack.h instead.
+
+find_package(PkgConfig)
+pkg_check_modules(PC_ARPACK QUIET arpack)
+
+find_library(ARPACK_LIBRARY NAMES arpack libarpack
+             HINTS ${PC_ARPACK_LIBDIR}
+                   ${PC_ARPACK_LIBRARY_DIRS})
+
+set(ARPACK_LIBRARIES ${ARPACK_LIBRARY})
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(ARPACK  DEFAULT_MSG
+                                  ARPACK_LIBRARY)
+
+mark_as_advanced(ARPACK_LIBRARY)
@@ -0,0 +1,29 @@
+# Any copyright is dedicated to the Public Domain.
+# http://creativecommons.org/publicdomain/zero/1.0/
+
+# - Try to find UMFPACK
+# Once done this will define
+#  UMFPACK_FOUND - System has UMFPACK
+#  UMFPACK_INCLUDE_DIRS - The UMFPACK include directories
+#  UMFPACK_LIBRARIES - The libraries needed to use UMFPACK
+
+find_package(PkgConfig)
+pkg_check_modules(PC_UMFPACK QUIET umfpack)
+
+find_path(UMFPACK_INCLUDE_DIR umfpack.h
+          HINTS ${PC_UMFPACK_INCLUDEDIR}
+                ${PC_UMFPACK_INCLUDE_DIRS}
+          PATH_SUFFIXES suitesparse)
+
+find_library(UMFPACK_LIBRARY NAMES umfpack libumfpack
+             HINTS ${PC_UMFPACK_LIBDIR}
+                   ${PC_UMFPACK_LIBRARY_DIRS})
+
+set(UMFPACK_LIBRARIES ${UMFPACK_LIBRARY})
+set(UMFPACK_INCLUDE_DIRS ${UMFPACK_INCLUDE_DIR})
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(UMFPACK  DEFAULT_MSG
+                                  UMFPACK_LIBRARY UMFPACK_INCLUDE_DIR)
+
+mark_as_advanced(UMFPACK_INCLUDE_DIR UMFPACK_LIBRARY)
@@ -68,6 +68,15 @@ if(WITH_EIGEN)
   add_definitions(-DHAS_EIGEN -DHAVE_EIGEN)
 endif()
 
+option(WITH_ARPACK "Build with optional support for ARPACK." OFF)
+if(WITH_ARPACK)
+  find_package(ARPACK REQUIRED)
+  find_package(UMFPACK REQUIRED)
+  include_directories(${UMFPACK_INCLUDE_DIRS})
+  link_libraries(${ARPACK_LIBRARIES} ${UMFPACK_LIBRARIES})
+  add_definitions(-DHAS_ARPACK -DHAVE_ARPACK)
+endif()
+
 option(WITH_FLANN "Build with optional support for FLANN." OFF)
 if(WITH_FLANN)
   find_package(LibFLANN REQUIRED)
@@ -0,0 +1,240 @@
+/* The Image Registration Toolkit (IRTK)
+ *
+ * Copyright 2008-2015 Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#ifndef _IRTKBUFFERPOOL_H
+#define _IRTKBUFFERPOOL_H
+
+#include <irtkObject.h>
+#include <irtkIndent.h>
+#include <irtkParallel.h>
+
+#include <mutex>
+
+
+/**
+ * Size-classed pool of large memory buffers
+ *
+ * Image filters and registration energy terms repeatedly allocate and free
+ * buffers of the same size, e.g., for intermediate images of each resolution
+ * level or each separable convolution pass. Instead of returning these buffers
+ * to the system, where the pages have to be mapped and faulted in again upon
+ * the next allocation, released buffers are kept in free lists of the size
+ * class they belong to and handed out again by subsequent requests of the same
+ * size class. Size classes divide each power of two into four steps, such that
+ * at most a quarter of a buffer remains unused. Requests smaller than
+ * MinimumSize are not pooled. The total size of cached buffers is bounded by
+ * MaximumCachedSize, buffers released beyond this limit are freed immediately.
+ *
+ * Pooled buffers of at least 2 MB are mapped as anonymous memory on Linux and
+ * marked as candidates for transparent huge pages, which reduces the number of
+ * page faults and TLB misses when these buffers are traversed. Buffers newly
+ * allocated from the system are otherwise untouched, so that their pages are
+ * placed on the NUMA node of the thread which first writes to them, and
+ * PoolAllocate initializes large arrays in parallel to distribute these pages
+ * among the worker threads. Cached buffers which are handed out again keep
+ * the page placement of their first use. Trim releases all cached buffers,
+ * e.g., at the end of each resolution level of a registration.
+ *
+ * All member functions are thread-safe. The global buffer pool used by
+ * irtkGenericImage and the PoolAllocate/PoolDeallocate functions is returned
+ * by irtkBufferPool::Instance.
+ */
+class irtkBufferPool : public irtkObject
+{
+  irtkObjectMacro(irtkBufferPool);
+
+public:
+
+  /// Allocation statistics
+  struct Statistics
+  {
+    size_t _Allocations;       ///< Number of buffer requests
+    size_t _Reuses;            ///< Number of requests served by a cached buffer
+    size_t _RequestedBytes;    ///< Total number of requested bytes
+    size_t _ReusedBytes;       ///< Total number of requested bytes served by cached buffers
+    size_t _SystemBytes;       ///< Total number of bytes allocated from the system
+    size_t _InUseBytes;        ///< Current number of bytes of buffers in use
+    size_t _PeakInUseBytes;    ///< Peak number of bytes of buffers in use
+    size_t _CachedBytes;       ///< Current number of bytes of cached buffers
+    size_t _PeakBytes;         ///< Peak number of bytes of buffers in use or cached
+  };
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+
+  /// Whether to cache released buffers
+  irtkPublicAttributeMacro(bool, Enabled);
+
+  /// Minimum size of pooled buffers in bytes
+  irtkPublicAttributeMacro(size_t, MinimumSize);
+
+  /// Maximum total size of cached buffers in bytes
+  irtkPublicAttributeMacro(size_t, MaximumCachedSize);
+
+  /// Whether to request transparent huge pages for large buffers
+  irtkPublicAttributeMacro(bool, HugePages);
+
+private:
+
+  /// Number of size classes per power of two
+  static const int SubClasses = 4;
+
+  /// Maximum number of size classes
+  static const int MaxClasses = SubClasses * 64;
+
+  /// Cached buffers of each size class
+  vector<void *> _FreeList[MaxClasses];
+
+  /// Allocation statistics
+  Statistics _Statistics;
+
+  /// Mutex protecting free lists and statistics
+  mutable std::mutex _Mutex;
+
+  /// Copy constructor
+  /// \note Intentionally not implemented
+  irtkBufferPool(const irtkBufferPool &);
+
+  /// Assignment operator
+  /// \note Intentionally not implemented
+  void operator =(const irtkBufferPool &);
+
+  // ---------------------------------------------------------------------------
+  // Construction/Destruction
+public:
+
+  /// Constructor
+  irtkBufferPool();
+
+  /// Destructor
+  virtual ~irtkBufferPool();
+
+  /// Global buffer pool
+  ///
+  /// The global instance is never destroyed such that buffers of objects with
+  /// static storage duration can still be released at program termination.
+  static irtkBufferPool &Instance();
+
+  // ---------------------------------------------------------------------------
+  // Allocation
+
+  /// Allocate buffer of at least the given number of bytes
+  ///
+  /// \returns Pointer to uninitialized buffer aligned to 64 bytes, or NULL if
+  ///          the requested size is zero.
+  void *Allocate(size_t);
+
+  /// Release buffer allocated by this pool
+  void Deallocate(void *);
+
+  /// Requested size of buffer allocated by this pool in bytes
+  static size_t Size(const void *);
+
+  /// Free all cached buffers
+  ///
+  /// Buffers currently in use are not affected. Subsequent requests are served
+  /// by new buffers, whose pages are placed upon first touch.
+  void Trim();
+
+  // ---------------------------------------------------------------------------
+  // Statistics
+
+  /// Get allocation statistics
+  Statistics GetStatistics() const;
+
+  /// Reset allocation statistics except for the current number of bytes
+  void ResetStatistics();
+
+  /// Print allocation statistics
+  void Print(irtkIndent = 0) const;
+
+};
+
+// =============================================================================
+// Auxiliary functors
+// =============================================================================
+
+namespace irtkBufferPoolUtils {
+
+// -----------------------------------------------------------------------------
+/// Construct elements of pooled buffer
+template <class Type>
+struct ConstructElements
+{
+  Type       *_Data;
+  const Type *_Value;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); ++i) new (_Data + i) Type(*_Value);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Destruct elements of pooled buffer
+template <class Type>
+struct DestructElements
+{
+  Type *_Data;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); ++i) _Data[i].~Type();
+  }
+};
+
+
+} // namespace irtkBufferPoolUtils
+
+// =============================================================================
+// Pooled 1D array
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Allocate 1D array from global buffer pool and initialize it
+///
+/// The elements of large arrays are initialized in parallel such that the
+/// memory pages of a newly allocated buffer are first touched by the worker
+/// threads rather than by the calling thread only.
+template <class Type>
+inline Type *PoolAllocate(int n, const Type &init = Type())
+{
+  if (n <= 0) return NULL;
+  Type *data = reinterpret_cast<Type *>(irtkBufferPool::Instance().Allocate(n * sizeof(Type)));
+  irtkBufferPoolUtils::ConstructElements<Type> body;
+  body._Data  = data;
+  body._Value = &init;
+  parallel_for(blocked_range<int>(0, n, 65536), body);
+  return data;
+}
+
+// -----------------------------------------------------------------------------
+/// Free 1D array allocated by PoolAllocate
+template <class Type>
+inline void PoolDeallocate(Type *&data)
+{
+  if (data) {
+    const int n = static_cast<int>(irtkBufferPool::Size(data) / sizeof(Type));
+    irtkBufferPoolUtils::DestructElements<Type> body;
+    body._Data = data;
+    body(blocked_range<int>(0, n));
+    irtkBufferPool::Instance().Deallocate(data);
+    data = NULL;
+  }
+}
+
+
+#endif
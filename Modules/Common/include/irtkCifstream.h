@@ -40,6 +40,15 @@ class irtkCifstream : public irtkObject
   FILE  *_File;
 #endif
 
+  /// Memory buffer read instead of file if not NULL
+  const char *_Buffer;
+
+  /// Size of memory buffer
+  long _Size;
+
+  /// Current position in memory buffer
+  long _Position;
+
   /// Flag indicating whether file bytes are swapped
   irtkPublicAttributeMacro(bool, Swapped);
 
@@ -84,6 +93,12 @@ public:
   /// Open file
   void Open(const char *);
 
+  /// Open memory buffer of given size, which is not copied
+  ///
+  /// The data is read from the buffer in the same format as it is read
+  /// from an uncompressed file. The buffer must remain valid until Close.
+  void Open(const char *, long);
+
   /// Close file
   void Close();
 
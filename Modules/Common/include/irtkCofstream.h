@@ -43,6 +43,12 @@ class irtkCofstream : public irtkObject
   gzFile _ZFile;
 #endif
 
+  /// Memory buffer written instead of file if not NULL
+  vector<char> *_Buffer;
+
+  /// Current position in memory buffer
+  long _Position;
+
   /// Flag whether file is compressed
   irtkPublicAttributeMacro(bool, Compressed);
 
@@ -106,6 +112,12 @@ public:
   /// Open file
   void Open(const char *);
 
+  /// Open memory buffer
+  ///
+  /// The data is appended to the buffer in the same format as it is written
+  /// to an uncompressed file. Offsets are relative to the start of the buffer. The buffer must remain valid until Close.
+  void Open(vector<char> &);
+
   /// Close file
   void Close();
 
@@ -35,6 +35,7 @@
 #include <irtkException.h>
 #include <irtkOptions.h>
 #include <irtkParallel.h>
+#include <irtkBufferPool.h>
 #include <irtkPath.h>
 #include <irtkProfiling.h>
 #include <irtkFloat.h>
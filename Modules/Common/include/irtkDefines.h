@@ -29,6 +29,12 @@
 /// 0: single-precision 1: double-precision
 #define USE_FLOAT_BY_DEFAULT 0
 
+/// Precision of registered images, their derivatives, and cached displacements
+/// 0: double-precision 1: single-precision
+#ifndef USE_FLOAT_REGISTERED_IMAGE
+#  define USE_FLOAT_REGISTERED_IMAGE 0
+#endif
+
 // ===========================================================================
 // CUDA
 // ===========================================================================
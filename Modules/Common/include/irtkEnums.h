@@ -538,7 +538,8 @@ enum irtkOptimizationMethod
   LBFGS,
   LineSearch,
   EulerMethod,            ///< Explicit Euler method for deformable surface models
-  EulerMethodWithMomentum ///< Explicit Euler method with momentum for deformable surface models
+  EulerMethodWithMomentum, ///< Explicit Euler method with momentum for deformable surface models
+  GaussNewton              ///< Levenberg-Marquardt damped Gauss-Newton method for sums of squares
 };
 
 // -----------------------------------------------------------------------------
@@ -555,6 +556,7 @@ inline string ToString(const irtkOptimizationMethod &m)
     case LineSearch:                 return "LineSearch";
     case EulerMethod:                return "EulerMethod";
     case EulerMethodWithMomentum:    return "EulerMethodWithMomentum";
+    case GaussNewton:                return "GaussNewton";
     default:                         return "Unknown";
   }
 }
@@ -573,6 +575,8 @@ inline bool FromString(const char *str, irtkOptimizationMethod &m)
   else if (strcmp(str, "LineSearch")                 == 0) m = LineSearch;
   else if (strcmp(str, "EulerMethod")                == 0) m = EulerMethod;
   else if (strcmp(str, "EulerMethodWithMomentum")    == 0) m = EulerMethodWithMomentum;
+  else if (strcmp(str, "GaussNewton")                == 0 || strcmp(str, "GN") == 0 ||
+           strcmp(str, "LevenbergMarquardt")         == 0 || strcmp(str, "LM") == 0) m = GaussNewton;
   else return false;
   return true;
 }
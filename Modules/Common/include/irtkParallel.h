@@ -34,6 +34,17 @@ extern int debug_gpu;
 /// Debugging level of TBB code
 extern int tbb_debug;
 
+/// Maximum number of threads as set by -threads option (0: automatic)
+extern int tbb_no_threads;
+
+/// Number of threads used for parallel execution
+///
+/// This is the number of threads set by the -threads option if specified, or
+/// the default number of threads of the task scheduler otherwise. It should
+/// be used to choose the number of blocks of data processed by separate worker
+/// threads, e.g., partial results which are merged subsequently.
+int NumberOfThreads();
+
 // =============================================================================
 // Command help
 // =============================================================================
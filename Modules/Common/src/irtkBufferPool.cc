@@ -0,0 +1,283 @@
+/* The Image Registration Toolkit (IRTK)
+ *
+ * Copyright 2008-2015 Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#include <irtkCommon.h>
+
+#if defined(__linux__)
+#  include <sys/mman.h>
+#endif
+
+
+// =============================================================================
+// Auxiliary functions
+// =============================================================================
+
+namespace irtkBufferPoolUtils {
+
+/// Alignment of buffers and size of buffer header in bytes
+const size_t Alignment = 64;
+
+/// Minimum size of buffers which are mapped as anonymous memory
+const size_t HugePageSize = 2 * 1024 * 1024;
+
+// -----------------------------------------------------------------------------
+/// Header stored in front of each buffer
+struct BufferHeader
+{
+  void   *_Base;     ///< Start address of system allocation
+  size_t  _Size;     ///< Requested size in bytes
+  size_t  _Capacity; ///< Usable size in bytes
+  size_t  _Length;   ///< Size of system allocation in bytes
+  int     _Class;    ///< Size class or -1 if buffer is not pooled
+  int     _Mapped;   ///< Whether memory was allocated using mmap
+};
+
+// -----------------------------------------------------------------------------
+inline BufferHeader *Header(void *p)
+{
+  return reinterpret_cast<BufferHeader *>(reinterpret_cast<char *>(p) - Alignment);
+}
+
+// -----------------------------------------------------------------------------
+inline const BufferHeader *Header(const void *p)
+{
+  return reinterpret_cast<const BufferHeader *>(reinterpret_cast<const char *>(p) - Alignment);
+}
+
+// -----------------------------------------------------------------------------
+/// Determine size class and usable size of pooled buffer
+inline int SizeClass(size_t size, int subclasses, size_t &capacity)
+{
+  int e = 0;
+  while ((static_cast<size_t>(1) << (e + 1)) <= size) ++e;
+  const size_t base = static_cast<size_t>(1) << e;
+  const size_t step = max(base / subclasses, static_cast<size_t>(1));
+  const size_t k    = (size - base + step - 1) / step;
+  capacity = base + k * step;
+  return subclasses * e + static_cast<int>(k);
+}
+
+// -----------------------------------------------------------------------------
+/// Allocate buffer with header from the system
+void *SystemAllocate(size_t size, size_t capacity, int cls, bool hugepages)
+{
+  void   *base   = NULL;
+  size_t  length = 0;
+  int     mapped = 0;
+#if defined(__linux__)
+  if (cls >= 0 && capacity >= HugePageSize) {
+    length = capacity + Alignment;
+    base   = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+      base = NULL;
+    } else {
+      mapped = 1;
+#  ifdef MADV_HUGEPAGE
+      if (hugepages) madvise(base, length, MADV_HUGEPAGE);
+#  endif
+    }
+  }
+#endif
+  if (base == NULL) {
+    length = capacity + 2 * Alignment;
+    base   = malloc(length);
+    if (base == NULL) {
+      cerr << "irtkBufferPool::Allocate: Failed to allocate " << size << " bytes" << endl;
+      exit(1);
+    }
+  }
+  // Align buffer, leaving room for header in front of it
+  size_t addr = reinterpret_cast<size_t>(base) + Alignment;
+  addr = ((addr + Alignment - 1) / Alignment) * Alignment;
+  void *p = reinterpret_cast<void *>(addr);
+  BufferHeader *header = Header(p);
+  header->_Base     = base;
+  header->_Size     = size;
+  header->_Capacity = capacity;
+  header->_Length   = length;
+  header->_Class    = cls;
+  header->_Mapped   = mapped;
+  return p;
+}
+
+// -----------------------------------------------------------------------------
+/// Return buffer to the system
+void SystemDeallocate(void *p)
+{
+  BufferHeader *header = Header(p);
+#if defined(__linux__)
+  if (header->_Mapped) {
+    munmap(header->_Base, header->_Length);
+    return;
+  }
+#endif
+  free(header->_Base);
+}
+
+
+} // namespace irtkBufferPoolUtils
+using namespace irtkBufferPoolUtils;
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+irtkBufferPool::irtkBufferPool()
+:
+  _Enabled(true),
+  _MinimumSize(64 * 1024),
+  _MaximumCachedSize(static_cast<size_t>(1024) * 1024 * 1024),
+  _HugePages(true)
+{
+  memset(&_Statistics, 0, sizeof(_Statistics));
+}
+
+// -----------------------------------------------------------------------------
+irtkBufferPool::~irtkBufferPool()
+{
+  Trim();
+}
+
+// -----------------------------------------------------------------------------
+irtkBufferPool &irtkBufferPool::Instance()
+{
+  static irtkBufferPool *instance = new irtkBufferPool();
+  return *instance;
+}
+
+// =============================================================================
+// Allocation
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void *irtkBufferPool::Allocate(size_t size)
+{
+  if (size == 0) return NULL;
+
+  // Determine size class
+  size_t capacity = size;
+  int    cls      = -1;
+  if (_Enabled && size >= _MinimumSize) {
+    cls = SizeClass(size, SubClasses, capacity);
+    if (cls >= MaxClasses) cls = -1, capacity = size;
+  }
+
+  // Reuse cached buffer of same size class
+  void *p = NULL;
+  {
+    std::lock_guard<std::mutex> lock(_Mutex);
+    _Statistics._Allocations    += 1;
+    _Statistics._RequestedBytes += size;
+    if (cls >= 0 && !_FreeList[cls].empty()) {
+      p = _FreeList[cls].back();
+      _FreeList[cls].pop_back();
+      Header(p)->_Size = size;
+      _Statistics._Reuses      += 1;
+      _Statistics._ReusedBytes += size;
+      _Statistics._CachedBytes -= capacity;
+    } else {
+      _Statistics._SystemBytes += capacity;
+    }
+    _Statistics._InUseBytes += capacity;
+    _Statistics._PeakInUseBytes = max(_Statistics._PeakInUseBytes, _Statistics._InUseBytes);
+    _Statistics._PeakBytes      = max(_Statistics._PeakBytes, _Statistics._InUseBytes + _Statistics._CachedBytes);
+  }
+
+  // Otherwise, allocate new buffer
+  if (p == NULL) p = SystemAllocate(size, capacity, cls, _HugePages);
+  return p;
+}
+
+// -----------------------------------------------------------------------------
+void irtkBufferPool::Deallocate(void *p)
+{
+  if (p == NULL) return;
+  BufferHeader *header = Header(p);
+  const size_t capacity = header->_Capacity;
+  bool cached = false;
+  {
+    std::lock_guard<std::mutex> lock(_Mutex);
+    _Statistics._InUseBytes -= capacity;
+    if (_Enabled && header->_Class >= 0 &&
+        _Statistics._CachedBytes + capacity <= _MaximumCachedSize) {
+      _FreeList[header->_Class].push_back(p);
+      _Statistics._CachedBytes += capacity;
+      cached = true;
+    }
+  }
+  if (!cached) SystemDeallocate(p);
+}
+
+// -----------------------------------------------------------------------------
+size_t irtkBufferPool::Size(const void *p)
+{
+  return (p ? Header(p)->_Size : 0);
+}
+
+// -----------------------------------------------------------------------------
+void irtkBufferPool::Trim()
+{
+  vector<void *> buffers;
+  {
+    std::lock_guard<std::mutex> lock(_Mutex);
+    for (int c = 0; c < MaxClasses; ++c) {
+      buffers.insert(buffers.end(), _FreeList[c].begin(), _FreeList[c].end());
+      _FreeList[c].clear();
+    }
+    _Statistics._CachedBytes = 0;
+  }
+  for (size_t i = 0; i < buffers.size(); ++i) SystemDeallocate(buffers[i]);
+}
+
+// =============================================================================
+// Statistics
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+irtkBufferPool::Statistics irtkBufferPool::GetStatistics() const
+{
+  std::lock_guard<std::mutex> lock(_Mutex);
+  return _Statistics;
+}
+
+// -----------------------------------------------------------------------------
+void irtkBufferPool::ResetStatistics()
+{
+  std::lock_guard<std::mutex> lock(_Mutex);
+  const size_t inuse  = _Statistics._InUseBytes;
+  const size_t cached = _Statistics._CachedBytes;
+  memset(&_Statistics, 0, sizeof(_Statistics));
+  _Statistics._InUseBytes     = inuse;
+  _Statistics._PeakInUseBytes = inuse;
+  _Statistics._CachedBytes    = cached;
+  _Statistics._PeakBytes      = inuse + cached;
+}
+
+// -----------------------------------------------------------------------------
+void irtkBufferPool::Print(irtkIndent indent) const
+{
+  const Statistics stats = this->GetStatistics();
+  const double MB = 1024.0 * 1024.0;
+  cout << indent << "Buffer allocations:  " << stats._Allocations
+                 << " (" << stats._Reuses << " reused)" << endl;
+  cout << indent << "Requested memory:    " << stats._RequestedBytes / MB << " MB" << endl;
+  cout << indent << "Reused memory:       " << stats._ReusedBytes    / MB << " MB" << endl;
+  cout << indent << "System memory:       " << stats._SystemBytes    / MB << " MB" << endl;
+  cout << indent << "Peak memory in use:  " << stats._PeakInUseBytes / MB << " MB" << endl;
+  cout << indent << "Peak memory:         " << stats._PeakBytes      / MB << " MB" << endl;
+  cout << indent << "Cached memory:       " << stats._CachedBytes    / MB << " MB" << endl;
+}
@@ -19,7 +19,7 @@
 // -----------------------------------------------------------------------------
 irtkCifstream::irtkCifstream(const char *fname)
 :
-  _File(NULL), _Swapped(true)
+  _File(NULL), _Buffer(NULL), _Size(0), _Position(0), _Swapped(true)
 {
 #ifdef WORDS_BIGENDIAN
   _Swapped = false;
@@ -47,9 +47,21 @@ void irtkCifstream::Open(const char *fname)
   }
 }
 
+// -----------------------------------------------------------------------------
+void irtkCifstream::Open(const char *data, long size)
+{
+  Close();
+  _Buffer   = data;
+  _Size     = size;
+  _Position = 0;
+}
+
 // -----------------------------------------------------------------------------
 void irtkCifstream::Close()
 {
+  _Buffer   = NULL;
+  _Size     = 0;
+  _Position = 0;
   if (_File != NULL) {
 #ifdef HAS_ZLIB
     gzclose(_File);
@@ -75,6 +87,7 @@ void irtkCifstream::IsSwapped(int swapped)
 // -----------------------------------------------------------------------------
 long irtkCifstream::Tell() const
 {
+  if (_Buffer) return _Position;
 #ifdef HAS_ZLIB
   return gztell(_File);
 #else
@@ -85,6 +98,10 @@ long irtkCifstream::Tell() const
 // -----------------------------------------------------------------------------
 void irtkCifstream::Seek(long offset)
 {
+  if (_Buffer) {
+    _Position = offset;
+    return;
+  }
 #ifdef HAS_ZLIB
   gzseek(_File, offset, SEEK_SET);
 #else
@@ -95,6 +112,13 @@ void irtkCifstream::Seek(long offset)
 // -----------------------------------------------------------------------------
 bool irtkCifstream::Read(char *mem, long start, long num)
 {
+  if (_Buffer) {
+    if (start != -1) _Position = start;
+    if (_Position < 0 || num < 0 || _Position + num > _Size) return false;
+    memcpy(mem, _Buffer + _Position, num);
+    _Position += num;
+    return true;
+  }
 #ifdef HAS_ZLIB
   if (start != -1) gzseek(_File, start, SEEK_SET);
   return (gzread(_File, mem, num) == num);
@@ -168,13 +192,24 @@ bool irtkCifstream::ReadAsDouble(double *data, long length, long offset)
 bool irtkCifstream::ReadAsString(char *data, long length, long offset)
 {
   // Read string
+  if (_Buffer) {
+    if (offset != -1) _Position = offset;
+    if (length < 1 || _Position < 0 || _Position >= _Size) return false;
+    long n = 0;
+    while (n < length - 1 && _Position < _Size) {
+      data[n] = _Buffer[_Position++];
+      if (data[n++] == '\n') break;
+    }
+    data[n] = '\0';
+  } else {
 #ifdef HAS_ZLIB
-  if (offset != -1) gzseek(_File, offset, SEEK_SET);
-  if (gzgets(_File, data, length) == Z_NULL) return false;
+    if (offset != -1) gzseek(_File, offset, SEEK_SET);
+    if (gzgets(_File, data, length) == Z_NULL) return false;
 #else
-  if (offset != -1) fseek(_File, offset, SEEK_SET);
-  if (fgets(data, length, _File) == NULL) return false;
+    if (offset != -1) fseek(_File, offset, SEEK_SET);
+    if (fgets(data, length, _File) == NULL) return false;
 #endif
+  }
 
   // Discard end-of-line character(s)
   const size_t len = strlen(data);
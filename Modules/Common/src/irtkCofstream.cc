@@ -28,6 +28,8 @@ irtkCofstream::irtkCofstream(const char *fname)
 #else
   _Swapped = false;
 #endif
+  _Buffer     = NULL;
+  _Position   = 0;
   _Compressed = false;
   if (fname) Open(fname);
 }
@@ -68,9 +70,20 @@ void irtkCofstream::Open(const char *fname)
   }
 }
 
+// -----------------------------------------------------------------------------
+void irtkCofstream::Open(vector<char> &buffer)
+{
+  Close();
+  _Buffer     = &buffer;
+  _Position   = static_cast<long>(buffer.size());
+  _Compressed = false;
+}
+
 // -----------------------------------------------------------------------------
 void irtkCofstream::Close()
 {
+  _Buffer   = NULL;
+  _Position = 0;
 #ifdef HAS_ZLIB
   if (_ZFile) {
     gzclose(_ZFile);
@@ -110,6 +123,16 @@ void irtkCofstream::IsSwapped(int swapped)
 // -----------------------------------------------------------------------------
 bool irtkCofstream::Write(const char *data, long offset, long length)
 {
+  if (_Buffer) {
+    if (offset != -1) _Position = offset;
+    if (_Position < 0 || length < 0) return false;
+    if (static_cast<size_t>(_Position + length) > _Buffer->size()) {
+      _Buffer->resize(_Position + length);
+    }
+    if (length > 0) memcpy(&(*_Buffer)[_Position], data, length);
+    _Position += length;
+    return true;
+  }
 #ifdef HAS_ZLIB
   if (_Compressed) {
     if (offset != -1) {
@@ -250,6 +273,7 @@ bool irtkCofstream::WriteAsDouble(double data, long offset)
 // -----------------------------------------------------------------------------
 bool irtkCofstream::WriteAsString(const char *data, long offset)
 {
+  if (_Buffer) return Write(data, offset, static_cast<long>(strlen(data)));
 #ifdef HAS_ZLIB
   if (_Compressed) {
     if (offset != -1) gzseek(_ZFile, offset, SEEK_SET);
@@ -40,8 +40,8 @@ void sort2(int index, float *array1, float *array2)
        // create array with indices to be sorted
        indices[i] = i;
        // keep a back up of the original arrays
-       array1_store[i] = array1[i];
-       array2_store[i] = array2[i];
+       array1_store[i] = array1[i+1];
+       array2_store[i] = array2[i+1];
     }
 
     // sort the first array and keep the index order
@@ -55,7 +55,7 @@ void sort2(int index, float *array1, float *array2)
         bool operator()(int i, int j) { return _array[i] < _array[j]; }
     };
 
-    std::sort(indices, indices + index, sort_indices(array1));
+    std::sort(indices, indices + index, sort_indices(array1_store));
 
     // update the arrays
     for (int i = 0; i < index; i++) {
@@ -30,10 +30,24 @@ int debug_gpu = 0;
 // Default: No debugging of TBB code
 int tbb_debug = 0;
 
+// Default: Automatic number of threads
+int tbb_no_threads = 0;
+
 #ifdef HAS_TBB
 std::unique_ptr<task_scheduler_init> tbb_scheduler;
 #endif
 
+// -----------------------------------------------------------------------------
+int NumberOfThreads()
+{
+#ifdef HAS_TBB
+  if (tbb_no_threads > 0) return tbb_no_threads;
+  return task_scheduler_init::default_num_threads();
+#else
+  return 1;
+#endif
+}
+
 // =============================================================================
 // Command help
 // =============================================================================
@@ -75,6 +89,7 @@ void ParseParallelOption(int &OPTIDX, int &argc, char *argv[])
     } else if (no_threads == 0) {
       no_threads = 1;
     }
+    tbb_no_threads = no_threads;
 #ifdef HAS_TBB
     if (!tbb_scheduler.get()) tbb_scheduler.reset(new task_scheduler_init(no_threads));
     else                      tbb_scheduler.get()->initialize(no_threads);
@@ -89,6 +89,9 @@ protected:
   /// CCS: Indices of non-zero entries for each row
   vector<int> *_Index;
 
+  /// Sparse matrices with other entry type
+  template <class TOtherEntry> friend class irtkGenericSparseMatrix;
+
   /// Copy other matrix, used by copy constructor and assignment operator only
   template <class TOtherEntry>
   void Copy(const irtkGenericSparseMatrix<TOtherEntry> &);
@@ -109,10 +112,16 @@ public:
   /// Construct sparse m x n matrix with specified number of non-zero entries
   irtkGenericSparseMatrix(int, int, int, StorageLayout = CCS);
 
+  /// Copy constructor
+  irtkGenericSparseMatrix(const irtkGenericSparseMatrix &);
+
   /// Copy constructor
   template <class TOtherEntry>
   explicit irtkGenericSparseMatrix(const irtkGenericSparseMatrix<TOtherEntry> &);
 
+  /// Assignment operator
+  irtkGenericSparseMatrix &operator =(const irtkGenericSparseMatrix &);
+
   /// Assignment operator
   template <class TOtherEntry>
   irtkGenericSparseMatrix &operator =(const irtkGenericSparseMatrix<TOtherEntry> &);
@@ -286,9 +295,31 @@ public:
   /// \note This function is most efficient when the CCS layout is used.
   EntryType ColumnSum(int) const;
 
-  /// Multiply matrix by vector, used to interface with ARPACK
+  /// Multiply matrix by vector, i.e., w = A v
+  ///
+  /// The rows of the result are computed in parallel. In case of the CCS
+  /// layout, the columns are instead divided into blocks whose products are
+  /// accumulated in private result vectors which are summed up afterwards.
+  /// The vector elements may be of a different type than the matrix entries,
+  /// e.g., a compact single precision matrix in CRS layout (irtkSparseFloatMatrix)
+  /// can be multiplied by double precision vectors.
+  ///
   /// \note This function is most efficient when the CRS layout is used.
-  void MultAv(EntryType [], EntryType []) const;
+  template <class TValue>
+  void MultAv(const TValue *v, TValue *w) const;
+
+  /// Multiply matrix by block of m vectors, i.e., W = A V
+  ///
+  /// The vectors of each block are stored interleaved, i.e., the i-th element
+  /// of the j-th vector at index i * m + j. Each non-zero entry is thus
+  /// multiplied with m consecutive values, which the compiler vectorizes.
+  ///
+  /// \note This function is most efficient when the CRS layout is used.
+  template <class TValue>
+  void MultAV(const TValue *V, TValue *W, int m) const;
+
+  /// Multiply matrix by dense matrix, i.e., W = A V
+  void MultAV(const irtkMatrix &V, irtkMatrix &W) const;
 
   /// Multiply by a scalar in-place
   irtkGenericSparseMatrix &operator *=(EntryType);
@@ -327,9 +358,16 @@ public:
   ///
   /// Uses an iterative eigen solver to compute the \p k eigenvalues
   /// which have largest or smallest magnitude, respectively, or are closest in
-  /// magnitude to the specified \p sigma value. Uses the Implicitly Restarted
-  /// Arnoldi Method implemented by ARPACK. The LU factorization used for the
-  /// shift-and-invert mode is computed using UMFPACK.
+  /// magnitude to the specified \p sigma value. The largest eigenvalues ('LM',
+  /// 'LA') of a symmetric matrix are computed by a built-in thick-restart Lanczos
+  /// method with parallel matrix-vector products. The smallest eigenvalues ('SM')
+  /// of a symmetric matrix are computed by this Lanczos method applied to the
+  /// inverse of the matrix shifted by a small negative value, whose products
+  /// are computed by the preconditioned conjugate gradient method. Otherwise,
+  /// uses the Implicitly Restarted Arnoldi Method implemented by ARPACK. The LU
+  /// factorization used for the shift-and-invert mode is computed using UMFPACK.
+  /// When ARPACK is not available, the Lanczos method is used for all other
+  /// eigenvalues of a symmetric matrix.
   ///
   /// \param[out] v     Converged eigenvalues.
   /// \param[in]  k     Number of requested eigenvalues.
@@ -337,12 +375,12 @@ public:
   ///                   or numeric value sigma used for shift-and-invert mode.
   /// \param[in]  p     Number of Lanczos basis vectors.
   /// \param[in]  tol   Ritz estimate residual <= tol*norm(this).
+  ///                   Default of Lanczos method is 1e-10.
   /// \param[in]  maxit Maximum number of iterations.
   /// \param[in]  v0    Starting vector. By default randomly generated.
   ///
   /// \returns Number of converged eigenvalues.
   ///
-  /// \note Only implemented for real double precision sparse matrices.
   int Eigenvalues(irtkVector &v, int k, const char *sigma = "LM",
                   int p = 0, double tol = .0, int maxit = 0, irtkVector *v0 = NULL) const;
 
@@ -351,8 +389,14 @@ public:
   /// Uses an iterative eigen solver to compute the eigenvectors corresponding
   /// to the \p k eigenvalues which have largest or smallest magnitude,
   /// respectively, or are closest in magnitude to the specified \p sigma value.
-  /// Uses the Implicitly Restarted Arnoldi Method (IRAM) implemented by ARPACK.
-  /// The LU factorization for the shift-and-invert mode is computed using UMFPACK.
+  /// Eigenvectors of the largest eigenvalues ('LM', 'LA') of a symmetric matrix
+  /// are computed by a built-in thick-restart Lanczos method. Eigenvectors of
+  /// the smallest eigenvalues ('SM') are computed by this method applied to the
+  /// inverse of the slightly shifted matrix using a conjugate gradient solver.
+  /// Otherwise, uses the Implicitly Restarted Arnoldi Method (IRAM) implemented
+  /// by ARPACK. The LU factorization for the shift-and-invert mode is computed
+  /// using UMFPACK. When ARPACK is not available, the Lanczos method is used for
+  /// all other eigenvectors of a symmetric matrix.
   ///
   /// \param[out]    E     Matrix of eigenvectors in columns.
   /// \param[in]     k     Number of requested eigenvalues.
@@ -360,13 +404,13 @@ public:
   ///                      or numeric value sigma used for shift-and-invert mode.
   /// \param[in]     p     Number of Lanczos basis vectors.
   /// \param[in]     tol   Ritz estimate residual <= tol*norm(this).
+  ///                      Default of Lanczos method is 1e-10.
   /// \param[in]     maxit Maximum number of iterations.
   /// \param[in,out] v0    Input:  Starting vector. By default randomly generated.
   ///                      Output: Final residual vector.
   ///
   /// \returns Number of converged eigenvalues.
   ///
-  /// \note Only implemented for real double precision sparse matrices.
   int Eigenvectors(irtkMatrix &E, int k, const char *sigma = "LM",
                    int p = 0, double tol = .0, int maxit = 0, irtkVector *v0 = NULL) const;
 
@@ -374,9 +418,16 @@ public:
   ///
   /// Uses an iterative eigen solver to compute the \p k eigenvalues
   /// which have largest or smallest magnitude, respectively, or are closest in
-  /// magnitude to the specified \p sigma value. Uses the Implicitly Restarted
-  /// Arnoldi Method implemented by ARPACK. The LU factorization used for the
-  /// shift-and-invert mode is computed using UMFPACK.
+  /// magnitude to the specified \p sigma value. The largest eigenvalues ('LM',
+  /// 'LA') of a symmetric matrix are computed by a built-in thick-restart Lanczos
+  /// method with parallel matrix-vector products. The smallest eigenvalues ('SM')
+  /// of a symmetric matrix are computed by this Lanczos method applied to the
+  /// inverse of the matrix shifted by a small negative value, whose products
+  /// are computed by the preconditioned conjugate gradient method. Otherwise,
+  /// uses the Implicitly Restarted Arnoldi Method implemented by ARPACK. The LU
+  /// factorization used for the shift-and-invert mode is computed using UMFPACK.
+  /// When ARPACK is not available, the Lanczos method is used for all other
+  /// eigenvalues of a symmetric matrix.
   ///
   /// \param[out] E     Matrix of eigenvectors in columns.
   /// \param[out] v     Converged eigenvalues.
@@ -385,12 +436,12 @@ public:
   ///                   or numeric value sigma used for shift-and-invert mode.
   /// \param[in]  p     Number of Lanczos basis vectors.
   /// \param[in]  tol   Ritz estimate residual <= tol*norm(this).
+  ///                   Default of Lanczos method is 1e-10.
   /// \param[in]  maxit Maximum number of iterations.
   /// \param[in]  v0    Starting vector. By default randomly generated.
   ///
   /// \returns Number of converged eigenvalues.
   ///
-  /// \note Only implemented for real double precision sparse matrices.
   int Eigenvectors(irtkMatrix &E, irtkVector &v, int k, const char *sigma = "LM",
                    int p = 0, double tol = .0, int maxit = 0, irtkVector *v0 = NULL) const;
 
@@ -466,7 +517,7 @@ void irtkGenericSparseMatrix<TEntry>::Copy(const irtkGenericSparseMatrix<TOtherE
   Deallocate(_Data);
   Deallocate(_Index);
   // Copy attributes of other matrix
-  _Layout = other._Layout;
+  _Layout = static_cast<StorageLayout>(other._Layout);
   _Rows   = other._Rows;
   _Cols   = other._Cols;
   _NNZ    = other._NNZ;
@@ -478,7 +529,7 @@ void irtkGenericSparseMatrix<TEntry>::Copy(const irtkGenericSparseMatrix<TOtherE
     _Col  = Allocate<int>   (_Size);
     _Data = Allocate<TEntry>(_Size);
     for (int r = 0; r <= _Rows; ++r) _Row[r] = other._Row[r];
-    for (int i = 0; i <= _NNZ;  ++i) {
+    for (int i = 0; i <  _NNZ;  ++i) {
       _Col [i] = other._Col [i];
       _Data[i] = other._Data[i];
     }
@@ -487,7 +538,7 @@ void irtkGenericSparseMatrix<TEntry>::Copy(const irtkGenericSparseMatrix<TOtherE
     _Col  = Allocate<int>   (_Cols + 1);
     _Data = Allocate<TEntry>(_Size);
     for (int c = 0; c <= _Cols; ++c) _Col[c] = other._Col[c];
-    for (int i = 0; i <= _NNZ;  ++i) {
+    for (int i = 0; i <  _NNZ;  ++i) {
       _Row [i] = other._Row [i];
       _Data[i] = other._Data[i];
     }
@@ -555,6 +606,16 @@ irtkGenericSparseMatrix<TEntry>::irtkGenericSparseMatrix(int m, int n, int nnz,
   _Data = Allocate<TEntry>(nnz);
 }
 
+// -----------------------------------------------------------------------------
+template <class TEntry>
+irtkGenericSparseMatrix<TEntry>::irtkGenericSparseMatrix(const irtkGenericSparseMatrix &rhs)
+:
+  irtkObject(rhs),
+  _Row(NULL), _Col(NULL), _Data(NULL), _Index(NULL)
+{
+  Copy(rhs);
+}
+
 // -----------------------------------------------------------------------------
 template <class TEntry> template <class TOtherEntry>
 irtkGenericSparseMatrix<TEntry>::irtkGenericSparseMatrix(const irtkGenericSparseMatrix<TOtherEntry> &rhs)
@@ -564,12 +625,21 @@ irtkGenericSparseMatrix<TEntry>::irtkGenericSparseMatrix(const irtkGenericSparse
   Copy(rhs);
 }
 
+// -----------------------------------------------------------------------------
+template <class TEntry>
+irtkGenericSparseMatrix<TEntry> &irtkGenericSparseMatrix<TEntry>
+::operator =(const irtkGenericSparseMatrix &rhs)
+{
+  if (this != &rhs) Copy(rhs);
+  return *this;
+}
+
 // -----------------------------------------------------------------------------
 template <class TEntry> template <class TOtherEntry>
 irtkGenericSparseMatrix<TEntry> &irtkGenericSparseMatrix<TEntry>
 ::operator =(const irtkGenericSparseMatrix<TOtherEntry> &rhs)
 {
-  if (this != &rhs) Copy(rhs);
+  Copy(rhs);
   return *this;
 }
 
@@ -1575,34 +1645,164 @@ TEntry irtkGenericSparseMatrix<TEntry>::ColumnSum(int c) const
 }
 
 // -----------------------------------------------------------------------------
-template <class TEntry>
-void irtkGenericSparseMatrix<TEntry>::MultAv(TEntry v[], TEntry w[]) const
+namespace irtkSparseMatrixUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Number of blocks of columns of CCS matrix multiplied in parallel
+inline int NumberOfColumnBlocks(int cols, int nnz)
 {
-  const TEntry zero(0);
-  if (_Layout == CRS) {
-    for (int r = 0; r < _Rows; ++r) {
-      w[r] = zero;
-      for (int i = _Row[r]; i != _Row[r+1]; ++i) w[r] += _Data[i] * v[_Col[i]];
-    }
-  } else {
-    if (_Index) {
-      int i;
-      for (int r = 0; r < _Rows; ++r) {
-        w[r] = zero;
-        for (size_t c = 0; c < _Index[r].size(); ++c) {
-          i = _Index[r][c];
-          w[r] += _Data[i] * v[_Col[i]];
+  int nblocks = NumberOfThreads();
+  if (nblocks > nnz / 4096) nblocks = nnz / 4096;
+  if (nblocks > cols)       nblocks = cols;
+  if (nblocks < 1)          nblocks = 1;
+  return nblocks;
+}
+
+// -----------------------------------------------------------------------------
+/// Multiply rows of CRS matrix by block of m interleaved vectors
+template <class TEntry, class TValue>
+struct MultiplyRowsCRS
+{
+  const int    *_Row;
+  const int    *_Col;
+  const TEntry *_Data;
+  const TValue *_V;
+  TValue       *_W;
+  int           _M;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    if (_M == 1) {
+      for (int r = re.begin(); r != re.end(); ++r) {
+        TValue s(0);
+        for (int i = _Row[r]; i != _Row[r+1]; ++i) {
+          s += static_cast<TValue>(_Data[i]) * _V[_Col[i]];
         }
+        _W[r] = s;
       }
     } else {
-      for (int r = 0; r < _Rows; ++r) w[r] = zero;
-      for (int c = 0; c < _Cols; ++c) {
+      for (int r = re.begin(); r != re.end(); ++r) {
+        TValue *w = _W + r * _M;
+        for (int j = 0; j < _M; ++j) w[j] = TValue(0);
+        for (int i = _Row[r]; i != _Row[r+1]; ++i) {
+          const TValue  a = static_cast<TValue>(_Data[i]);
+          const TValue *v = _V + _Col[i] * _M;
+          for (int j = 0; j < _M; ++j) w[j] += a * v[j];
+        }
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Multiply blocks of columns of CCS matrix by block of m interleaved vectors,
+/// where the products of each block are stored in a private result vector
+template <class TEntry, class TValue>
+struct MultiplyColumnsCCS
+{
+  const int    *_Row;
+  const int    *_Col;
+  const TEntry *_Data;
+  const TValue *_V;
+  TValue       *_W;
+  int           _M;
+  int           _Rows;
+  int           _Cols;
+  int           _NumberOfBlocks;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int b = re.begin(); b != re.end(); ++b) {
+      TValue *W = _W + static_cast<size_t>(b) * _Rows * _M;
+      for (int r = 0; r < _Rows * _M; ++r) W[r] = TValue(0);
+      const int c1 = static_cast<int>(static_cast<long>(_Cols) *  b      / _NumberOfBlocks);
+      const int c2 = static_cast<int>(static_cast<long>(_Cols) * (b + 1) / _NumberOfBlocks);
+      for (int c = c1; c < c2; ++c) {
+        const TValue *v = _V + c * _M;
         for (int i = _Col[c]; i != _Col[c+1]; ++i) {
-          w[_Row[c]] += _Data[i] * v[c];
+          const TValue  a = static_cast<TValue>(_Data[i]);
+          TValue       *w = W + _Row[i] * _M;
+          for (int j = 0; j < _M; ++j) w[j] += a * v[j];
         }
       }
     }
   }
+};
+
+// -----------------------------------------------------------------------------
+/// Sum up private result vectors of MultiplyColumnsCCS
+template <class TValue>
+struct SumPartialProducts
+{
+  const TValue *_Partial;
+  TValue       *_W;
+  size_t        _Size;
+  int           _NumberOfBlocks;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int i = re.begin(); i != re.end(); ++i) {
+      TValue s(0);
+      const TValue *p = _Partial + i;
+      for (int b = 0; b < _NumberOfBlocks; ++b, p += _Size) s += *p;
+      _W[i] = s;
+    }
+  }
+};
+
+
+} // namespace irtkSparseMatrixUtils
+
+// -----------------------------------------------------------------------------
+template <class TEntry> template <class TValue>
+void irtkGenericSparseMatrix<TEntry>::MultAV(const TValue *V, TValue *W, int m) const
+{
+  using namespace irtkSparseMatrixUtils;
+  if (_Layout == CRS) {
+    MultiplyRowsCRS<TEntry, TValue> mult;
+    mult._Row  = _Row;
+    mult._Col  = _Col;
+    mult._Data = _Data;
+    mult._V    = V;
+    mult._W    = W;
+    mult._M    = m;
+    parallel_for(blocked_range<int>(0, _Rows), mult);
+  } else {
+    const int    nblocks = NumberOfColumnBlocks(_Cols, _NNZ);
+    const size_t size    = static_cast<size_t>(_Rows) * static_cast<size_t>(m);
+    vector<TValue> partial;
+    MultiplyColumnsCCS<TEntry, TValue> mult;
+    mult._Row            = _Row;
+    mult._Col            = _Col;
+    mult._Data           = _Data;
+    mult._V              = V;
+    mult._M              = m;
+    mult._Rows           = _Rows;
+    mult._Cols           = _Cols;
+    mult._NumberOfBlocks = nblocks;
+    if (nblocks == 1) {
+      mult._W = W;
+      mult(blocked_range<int>(0, 1));
+    } else {
+      partial.resize(size * nblocks);
+      mult._W = &partial[0];
+      parallel_for(blocked_range<int>(0, nblocks, 1), mult);
+      SumPartialProducts<TValue> sum;
+      sum._Partial        = &partial[0];
+      sum._W              = W;
+      sum._Size           = size;
+      sum._NumberOfBlocks = nblocks;
+      parallel_for(blocked_range<int>(0, static_cast<int>(size)), sum);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+template <class TEntry> template <class TValue>
+void irtkGenericSparseMatrix<TEntry>::MultAv(const TValue *v, TValue *w) const
+{
+  MultAV(v, w, 1);
 }
 
 // -----------------------------------------------------------------------------
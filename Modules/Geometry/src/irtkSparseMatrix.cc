@@ -15,22 +15,79 @@
  * limitations under the License. */
 
 #include <irtkSparseMatrix.h>
+#include <irtkMatrix.h>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_01.hpp>
 
 #ifdef HAVE_ARPACK
 #  include <irtkArpack.h>
 #  include <irtkUmfpack.h>
-#  include <boost/random/mersenne_twister.hpp>
-#  include <boost/random/uniform_01.hpp>
 #endif
 
 
+// =============================================================================
+// Common operations
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+template <class TEntry>
+void irtkGenericSparseMatrix<TEntry>::MultAV(const irtkMatrix &V, irtkMatrix &W) const
+{
+  if (V.Rows() != _Cols) {
+    cerr << "irtkGenericSparseMatrix::MultAV: Number of rows of dense matrix must equal number of columns" << endl;
+    exit(1);
+  }
+  const int m = V.Cols();
+  vector<double> v(static_cast<size_t>(_Cols) * m);
+  vector<double> w(static_cast<size_t>(_Rows) * m);
+  for (int j = 0; j < m; ++j) {
+    const double *col = V.RawPointer(0, j);
+    for (int i = 0; i < _Cols; ++i) v[i * m + j] = col[i];
+  }
+  MultAV(&v[0], &w[0], m);
+  W.Initialize(_Rows, m);
+  for (int j = 0; j < m; ++j) {
+    double *col = W.RawPointer(0, j);
+    for (int i = 0; i < _Rows; ++i) col[i] = w[i * m + j];
+  }
+}
+
 // =============================================================================
 // Eigen decomposition
 // =============================================================================
 
+namespace irtkSparseMatrixUtils {
+
 // -----------------------------------------------------------------------------
-int eigs(const irtkGenericSparseMatrix<double> &A, irtkMatrix *E, irtkVector &v,
-         int k, const char *eigs_sigma, int p, double tol, int maxit, irtkVector *v0)
+/// Parse eigs sigma argument
+///
+/// \returns Whether sigma is one of 'LM', 'LA', 'SM', 'SA'. Otherwise, the
+///          numeric shift value is returned in \p sigma.
+bool ParseSigma(const char *eigs_sigma, char which[3], double &sigma)
+{
+  which[0] = 'L', which[1] = 'M', which[2] = '\0';
+  sigma    = .0;
+  if (strlen(eigs_sigma) == 2 && (!isdigit(eigs_sigma[0]) || !isdigit(eigs_sigma[1]))) {
+    which[0] = toupper(eigs_sigma[0]);
+    which[1] = toupper(eigs_sigma[1]);
+    if (strcmp(which, "LM") != 0 && strcmp(which, "SM") != 0 &&
+        strcmp(which, "LA") != 0 && strcmp(which, "SA") != 0) {
+      cerr << "eigs: Invalid sigma string: " << eigs_sigma << endl;
+      exit(1);
+    }
+    return true;
+  }
+  if (!FromString(eigs_sigma, sigma)) {
+    cerr << "eigs: Invalid sigma string or value: " << eigs_sigma << endl;
+    exit(1);
+  }
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+int EigsArpack(const irtkGenericSparseMatrix<double> &A, irtkMatrix *E, irtkVector &v,
+               int k, const char *eigs_sigma, int p, double tol, int maxit, irtkVector *v0)
 {
   int nconv = 0; // Number of converged eigenvalues
 
@@ -60,27 +117,16 @@ int eigs(const irtkGenericSparseMatrix<double> &A, irtkMatrix *E, irtkVector &v,
     for (int i = 0; i < n; ++i) resid[i] = dist(gen);
   }
 
-  char   which[3] = { "LM" };
-  double sigma    = .0;
-  int    mode     = 1;
+  char   which[3];
+  double sigma;
+  int    mode = 1;
 
-  if (strlen(eigs_sigma) == 2 && (!isdigit(eigs_sigma[0]) || !isdigit(eigs_sigma[1]))) {
-    which[0] = toupper(eigs_sigma[0]);
-    which[1] = toupper(eigs_sigma[1]);
+  if (ParseSigma(eigs_sigma, which, sigma)) {
     if (strcmp(which, "SM") == 0) {
       which[0] = 'L';
       mode     = 3;
     }
-    if (strcmp(which, "LM") != 0 && strcmp(which, "SM") != 0 &&
-        strcmp(which, "LA") != 0 && strcmp(which, "SA") != 0) {
-      cerr << "eigs: Invalid sigma string: " << sigma << endl;
-      exit(1);
-    }
   } else {
-    if (!FromString(eigs_sigma, sigma)) {
-      cerr << "eigs: Invalid sigma string or value: " << sigma << endl;
-      exit(1);
-    }
     mode = 3;
   }
 
@@ -283,7 +329,7 @@ int eigs(const irtkGenericSparseMatrix<double> &A, irtkMatrix *E, irtkVector &v,
   Deallocate(basis);
 
 #else
-  cerr << "eigs: Only available if ARPACK was enabled during build configuration" << endl;
+  cerr << "eigs: Only available for non-symmetric matrices if ARPACK was enabled during build configuration" << endl;
   exit(1);
 #endif
 
@@ -291,52 +337,610 @@ int eigs(const irtkGenericSparseMatrix<double> &A, irtkMatrix *E, irtkVector &v,
 }
 
 // -----------------------------------------------------------------------------
+int EigsArpack(const irtkGenericSparseMatrix<float> &A, irtkMatrix *E, irtkVector &v,
+               int k, const char *sigma, int p, double tol, int maxit, irtkVector *v0)
+{
+  irtkGenericSparseMatrix<double> B(A);
+  return EigsArpack(B, E, v, k, sigma, p, tol, maxit, v0);
+}
+
+// -----------------------------------------------------------------------------
+/// Inner products h = V^T w of interleaved Lanczos basis vectors with w
+struct ProjectOntoBasis
+{
+  const double   *_V;
+  const double   *_W;
+  int             _Stride;
+  int             _Size;
+  vector<double>  _H;
+
+  ProjectOntoBasis(const double *V, const double *w, int stride, int size)
+  :
+    _V(V), _W(w), _Stride(stride), _Size(size), _H(size, .0)
+  {}
+
+  ProjectOntoBasis(const ProjectOntoBasis &lhs, split)
+  :
+    _V(lhs._V), _W(lhs._W), _Stride(lhs._Stride), _Size(lhs._Size), _H(lhs._Size, .0)
+  {}
+
+  void join(const ProjectOntoBasis &rhs)
+  {
+    for (int i = 0; i < _Size; ++i) _H[i] += rhs._H[i];
+  }
+
+  void operator ()(const blocked_range<int> &re)
+  {
+    double *h = &_H[0];
+    for (int r = re.begin(); r != re.end(); ++r) {
+      const double *v = _V + static_cast<size_t>(r) * _Stride;
+      const double  w = _W[r];
+      for (int i = 0; i < _Size; ++i) h[i] += v[i] * w;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Subtract w -= V h and return squared norm of result
+struct SubtractProjection
+{
+  const double *_V;
+  const double *_H;
+  double       *_W;
+  int           _Stride;
+  int           _Size;
+  double        _Norm2;
+
+  SubtractProjection(const double *V, const double *h, double *w, int stride, int size)
+  :
+    _V(V), _H(h), _W(w), _Stride(stride), _Size(size), _Norm2(.0)
+  {}
+
+  SubtractProjection(const SubtractProjection &lhs, split)
+  :
+    _V(lhs._V), _H(lhs._H), _W(lhs._W), _Stride(lhs._Stride), _Size(lhs._Size), _Norm2(.0)
+  {}
+
+  void join(const SubtractProjection &rhs)
+  {
+    _Norm2 += rhs._Norm2;
+  }
+
+  void operator ()(const blocked_range<int> &re)
+  {
+    for (int r = re.begin(); r != re.end(); ++r) {
+      const double *v = _V + static_cast<size_t>(r) * _Stride;
+      double s = .0;
+      for (int i = 0; i < _Size; ++i) s += v[i] * _H[i];
+      _W[r] -= s;
+      _Norm2 += _W[r] * _W[r];
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Replace first l interleaved basis vectors by linear combinations V Y,
+/// where Y is a m x l matrix stored in row-major order
+struct RotateBasis
+{
+  double       *_V;
+  const double *_Y;
+  int           _Stride;
+  int           _M;
+  int           _L;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    vector<double> tmp(_L);
+    for (int r = re.begin(); r != re.end(); ++r) {
+      double *v = _V + static_cast<size_t>(r) * _Stride;
+      for (int i = 0; i < _L; ++i) tmp[i] = .0;
+      for (int c = 0; c < _M; ++c) {
+        const double  a = v[c];
+        const double *y = _Y + c * _L;
+        for (int i = 0; i < _L; ++i) tmp[i] += a * y[i];
+      }
+      for (int i = 0; i < _L; ++i) v[i] = tmp[i];
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Orthogonalize w against first m interleaved basis vectors
+///
+/// Classical Gram-Schmidt is repeated twice (CGS2) to maintain the full
+/// orthogonality of the basis. The coefficients are added to \p h.
+///
+/// \returns Norm of orthogonalized vector.
+double Orthogonalize(const vector<double> &V, int stride, int n, int m,
+                     vector<double> &w, double *h)
+{
+  double norm2 = .0;
+  for (int pass = 0; pass < 2; ++pass) {
+    ProjectOntoBasis proj(&V[0], &w[0], stride, m);
+    parallel_reduce(blocked_range<int>(0, n), proj);
+    SubtractProjection sub(&V[0], &proj._H[0], &w[0], stride, m);
+    parallel_reduce(blocked_range<int>(0, n), sub);
+    if (h) for (int i = 0; i < m; ++i) h[i] += proj._H[i];
+    norm2 = sub._Norm2;
+  }
+  return sqrt(norm2);
+}
+
+// -----------------------------------------------------------------------------
+/// Comparator of Ritz values used to order them by preference
+struct CompareRitzValues
+{
+  const irtkVector &_Theta;
+  char              _Which[3];
+  double            _Sigma;
+  bool              _Shift;
+
+  double Key(int i) const
+  {
+    const double &theta = _Theta(i);
+    if (_Shift)               return  fabs(theta - _Sigma);
+    if (_Which[0] == 'S') {
+      return (_Which[1] == 'M') ? fabs(theta) : theta;
+    }
+    return (_Which[1] == 'M') ? -fabs(theta) : -theta;
+  }
+
+  bool operator ()(int a, int b) const
+  {
+    return Key(a) < Key(b);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Thick-restart Lanczos method for symmetric matrices
+///
+/// The Lanczos basis is kept fully orthogonal and stored interleaved, i.e.,
+/// one row of all basis vectors per cache line, such that the projections
+/// onto the basis are computed by vectorized loops in parallel over rows.
+/// At each restart, the basis is reduced to the Ritz vectors of the wanted
+/// Ritz values, extended by the residual vector (Wu and Simon, 2000).
+///
+/// The matrix type only needs to provide the Rows() and MultAv() functions
+/// such that the method can also be applied to the inverse of a matrix.
+///
+/// \param[in] shift Whether to find eigenvalues closest to \p sigma. Note that
+///                  interior eigenvalues converge slowly without the spectral
+///                  transformation implemented by the ARPACK solver, which is
+///                  therefore only used when ARPACK is not available.
+template <class TMatrix>
+int EigsLanczos(const TMatrix &A, irtkMatrix *E, irtkVector &v,
+                int k, const char *which, double sigma, bool shift,
+                int p, double tol, int maxit, irtkVector *v0)
+{
+  const int n = A.Rows();
+  if (k < 1 || k > n) {
+    cerr << "eigs: Number of requested eigenvalues must be in [1, " << n << "]" << endl;
+    exit(1);
+  }
+
+  // Default parameters
+  if (p     <=  0) p     = max(2 * k, 20);
+  if (p     <=  k) p     = k + 1;
+  if (p     >   n) p     = n;
+  if (tol   <= .0) tol   = 1e-10;
+  if (maxit <=  0) maxit = max(300, static_cast<int>(ceil(2.0 * n / p)));
+
+  // Lanczos basis with one additional vector for the residual
+  const int      stride = p + 1;
+  vector<double> V(static_cast<size_t>(n) * stride, .0);
+  vector<double> x(n), w(n);
+  irtkMatrix     T(p, p);
+  vector<double> h(stride);
+
+  boost::mt19937            gen;
+  boost::uniform_01<double> dist;
+
+  // Starting vector
+  if (v0 && v0->Rows() != 0) {
+    if (v0->Rows() != n) {
+      cerr << "eigs: Initial vector v0 must have " << n << " rows" << endl;
+      exit(1);
+    }
+    for (int r = 0; r < n; ++r) w[r] = v0->Get(r);
+  } else {
+    for (int r = 0; r < n; ++r) w[r] = dist(gen) - .5;
+  }
+  double beta = .0;
+  for (int r = 0; r < n; ++r) beta += w[r] * w[r];
+  beta = sqrt(beta);
+  if (beta == .0) {
+    cerr << "eigs: Initial vector v0 must not be zero" << endl;
+    exit(1);
+  }
+  for (int r = 0; r < n; ++r) V[static_cast<size_t>(r) * stride] = w[r] / beta;
+
+  irtkMatrix  Y;
+  irtkVector  theta;
+  vector<int> idx;
+  double      anorm = .0;
+  int         l     = 0;   // Number of kept Ritz vectors
+  int         m     = p;   // Size of current basis
+  int         nconv = 0;   // Number of converged wanted Ritz values
+  bool        exhausted;   // Whether basis spans invariant subspace
+
+  for (int iter = 0; ; ++iter) {
+
+    // Extend basis by Lanczos steps
+    exhausted = false;
+    m = p;
+    for (int j = l; j < p; ++j) {
+      for (int r = 0; r < n; ++r) x[r] = V[static_cast<size_t>(r) * stride + j];
+      A.MultAv(&x[0], &w[0]);
+      for (int i = 0; i <= j; ++i) h[i] = .0;
+      beta = Orthogonalize(V, stride, n, j + 1, w, &h[0]);
+      for (int i = 0; i < j; ++i) T(i, j) = T(j, i) = h[i];
+      T(j, j) = h[j];
+      anorm = max(anorm, fabs(h[j]));
+      // Continue with random vector if basis spans invariant subspace
+      if (beta <= 1e-12 * max(anorm, 1.0)) {
+        exhausted = (j + 1 == n);
+        if (!exhausted) {
+          for (int r = 0; r < n; ++r) w[r] = dist(gen) - .5;
+          double norm = Orthogonalize(V, stride, n, j + 1, w, NULL);
+          if (norm <= 1e-12) exhausted = true;
+          else for (int r = 0; r < n; ++r) w[r] /= norm;
+        }
+        if (exhausted) {
+          m = j + 1;
+          break;
+        }
+        beta = .0;
+        for (int r = 0; r < n; ++r) V[static_cast<size_t>(r) * stride + j + 1] = w[r];
+      } else {
+        for (int r = 0; r < n; ++r) V[static_cast<size_t>(r) * stride + j + 1] = w[r] / beta;
+      }
+    }
+
+    // Rayleigh-Ritz projection
+    irtkMatrix Tm(m, m);
+    for (int j = 0; j < m; ++j)
+    for (int i = 0; i < m; ++i) Tm(i, j) = T(i, j);
+    Tm.SymmetricEigen(Y, theta);
+    for (int i = 0; i < m; ++i) anorm = max(anorm, fabs(theta(i)));
+
+    // Order Ritz values by preference
+    CompareRitzValues cmp = { theta, { which[0], which[1], '\0' }, sigma, shift };
+    idx.resize(m);
+    for (int i = 0; i < m; ++i) idx[i] = i;
+    sort(idx.begin(), idx.end(), cmp);
+
+    // Check convergence of wanted Ritz values
+    const int nev = min(k, m);
+    nconv = 0;
+    for (int i = 0; i < nev; ++i) {
+      if (exhausted || fabs(beta * Y(m - 1, idx[i])) <= tol * anorm) ++nconv;
+    }
+    if (nconv == nev || exhausted || iter + 1 >= maxit) break;
+
+    // Restart with Ritz vectors of wanted and some more Ritz values
+    l = min(nev + (m - nev) / 2, m - 1);
+    vector<double> Ysel(static_cast<size_t>(m) * l);
+    for (int c = 0; c < m; ++c)
+    for (int i = 0; i < l; ++i) Ysel[c * l + i] = Y(c, idx[i]);
+    RotateBasis rotate;
+    rotate._V      = &V[0];
+    rotate._Y      = &Ysel[0];
+    rotate._Stride = stride;
+    rotate._M      = m;
+    rotate._L      = l;
+    parallel_for(blocked_range<int>(0, n), rotate);
+    for (int r = 0; r < n; ++r) {
+      double *vr = &V[static_cast<size_t>(r) * stride];
+      vr[l] = vr[m];
+    }
+    for (int j = 0; j < p; ++j)
+    for (int i = 0; i < p; ++i) T(i, j) = .0;
+    for (int i = 0; i < l; ++i) T(i, i) = theta(idx[i]);
+  }
+
+  // Optionally return final residual vector
+  if (v0) {
+    v0->Initialize(n);
+    if (!exhausted) {
+      for (int r = 0; r < n; ++r) v0->Put(r, beta * V[static_cast<size_t>(r) * stride + m]);
+    }
+  }
+
+  // Converged eigenvalues (and -vectors) in order of preference
+  const int nev = min(k, m);
+  vector<int> conv;
+  for (int i = 0; i < nev; ++i) {
+    if (exhausted || fabs(beta * Y(m - 1, idx[i])) <= tol * anorm) conv.push_back(idx[i]);
+  }
+  nconv = static_cast<int>(conv.size());
+  v.Initialize(nconv);
+  for (int i = 0; i < nconv; ++i) v(i) = theta(conv[i]);
+  if (E) {
+    E->Clear();
+    if (nconv > 0) {
+      E->Initialize(n, nconv);
+      vector<double> Ysel(static_cast<size_t>(m) * nconv);
+      for (int c = 0; c < m; ++c)
+      for (int i = 0; i < nconv; ++i) Ysel[c * nconv + i] = Y(c, conv[i]);
+      RotateBasis rotate;
+      rotate._V      = &V[0];
+      rotate._Y      = &Ysel[0];
+      rotate._Stride = stride;
+      rotate._M      = m;
+      rotate._L      = nconv;
+      parallel_for(blocked_range<int>(0, n), rotate);
+      for (int i = 0; i < nconv; ++i) {
+        double *col = E->RawPointer(0, i);
+        for (int r = 0; r < n; ++r) col[r] = V[static_cast<size_t>(r) * stride + i];
+      }
+    }
+  }
+
+  return nconv;
+}
+
+// -----------------------------------------------------------------------------
+/// Shift product q = A p by -sigma p and compute inner product p^T q
+struct ShiftProduct
+{
+  const double *_P;
+  double       *_Q;
+  double        _Sigma;
+  double        _Dot;
+
+  ShiftProduct(const double *p, double *q, double sigma)
+  :
+    _P(p), _Q(q), _Sigma(sigma), _Dot(.0)
+  {}
+
+  ShiftProduct(const ShiftProduct &lhs, split)
+  :
+    _P(lhs._P), _Q(lhs._Q), _Sigma(lhs._Sigma), _Dot(.0)
+  {}
+
+  void join(const ShiftProduct &rhs)
+  {
+    _Dot += rhs._Dot;
+  }
+
+  void operator ()(const blocked_range<int> &re)
+  {
+    for (int r = re.begin(); r != re.end(); ++r) {
+      _Q[r] -= _Sigma * _P[r];
+      _Dot  += _P[r]  * _Q[r];
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Update solution and residual of conjugate gradient method and apply
+/// Jacobi preconditioner to the new residual
+struct UpdateConjugateGradient
+{
+  const double *_P;
+  const double *_Q;
+  const double *_M;
+  double       *_X;
+  double       *_R;
+  double       *_Z;
+  double        _Alpha;
+  double        _RR;
+  double        _RZ;
+
+  UpdateConjugateGradient(const double *p, const double *q, const double *m,
+                          double *x, double *r, double *z, double alpha)
+  :
+    _P(p), _Q(q), _M(m), _X(x), _R(r), _Z(z), _Alpha(alpha), _RR(.0), _RZ(.0)
+  {}
+
+  UpdateConjugateGradient(const UpdateConjugateGradient &lhs, split)
+  :
+    _P(lhs._P), _Q(lhs._Q), _M(lhs._M), _X(lhs._X), _R(lhs._R), _Z(lhs._Z),
+    _Alpha(lhs._Alpha), _RR(.0), _RZ(.0)
+  {}
+
+  void join(const UpdateConjugateGradient &rhs)
+  {
+    _RR += rhs._RR;
+    _RZ += rhs._RZ;
+  }
+
+  void operator ()(const blocked_range<int> &re)
+  {
+    for (int r = re.begin(); r != re.end(); ++r) {
+      _X[r] += _Alpha * _P[r];
+      _R[r] -= _Alpha * _Q[r];
+      _Z[r]  = _M[r]  * _R[r];
+      _RR   += _R[r]  * _R[r];
+      _RZ   += _R[r]  * _Z[r];
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Update search direction p = z + beta p of conjugate gradient method
+struct UpdateSearchDirection
+{
+  const double *_Z;
+  double       *_P;
+  double        _Beta;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int r = re.begin(); r != re.end(); ++r) _P[r] = _Z[r] + _Beta * _P[r];
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Inverse (A - sigma I)^-1 of shifted symmetric positive definite matrix
+///
+/// The products with the inverse are computed by the conjugate gradient method
+/// with Jacobi preconditioner. This is used by the Lanczos method to find the
+/// eigenvalues of A closest to sigma without a factorization of the matrix.
+/// When the shifted matrix turns out to be indefinite, the solver stops and
+/// the \c _Indefinite flag is set.
 template <class TEntry>
-int irtkGenericSparseMatrix<TEntry>
-::Eigenvalues(irtkVector &, int, const char *, int, double, int, irtkVector *) const
+struct ShiftedInverse
 {
-  cerr << "irtkGenericSparseMatrix::Eigenvalues: Only implemented for sparse double precision matrices" << endl;
-  exit(1);
+  const irtkGenericSparseMatrix<TEntry> *_Matrix;
+  double                                  _Sigma;
+  double                                  _Tolerance;
+  int                                     _MaxIterations;
+  vector<double>                          _Precond;
+  mutable vector<double>                  _R, _Z, _P, _Q;
+  mutable bool                            _Indefinite;
+
+  ShiftedInverse(const irtkGenericSparseMatrix<TEntry> &A, double sigma, double tol)
+  :
+    _Matrix(&A), _Sigma(sigma), _Tolerance(tol), _MaxIterations(max(1000, A.Rows())),
+    _Precond(A.Rows()), _R(A.Rows()), _Z(A.Rows()), _P(A.Rows()), _Q(A.Rows()),
+    _Indefinite(false)
+  {
+    for (int r = 0; r < A.Rows(); ++r) {
+      const double d = A.Get(r, r) - sigma;
+      if (d <= .0) _Indefinite = true;
+      else         _Precond[r] = 1.0 / d;
+    }
+  }
+
+  int Rows() const
+  {
+    return _Matrix->Rows();
+  }
+
+  /// Solve (A - sigma I) x = b
+  void MultAv(const double *b, double *x) const
+  {
+    const int n = _Matrix->Rows();
+    double bnorm2 = .0, rz = .0;
+    for (int r = 0; r < n; ++r) {
+      x [r] = .0;
+      _R[r] = b[r];
+      _Z[r] = _P[r] = _Precond[r] * b[r];
+      bnorm2 += b[r] * b[r];
+      rz     += b[r] * _Z[r];
+    }
+    if (bnorm2 == .0) return;
+    const double eps2 = _Tolerance * _Tolerance * bnorm2;
+    for (int iter = 0; iter < _MaxIterations; ++iter) {
+      _Matrix->MultAv(&_P[0], &_Q[0]);
+      ShiftProduct pq(&_P[0], &_Q[0], _Sigma);
+      parallel_reduce(blocked_range<int>(0, n), pq);
+      if (pq._Dot <= .0) {
+        _Indefinite = true;
+        break;
+      }
+      UpdateConjugateGradient update(&_P[0], &_Q[0], &_Precond[0], x, &_R[0], &_Z[0], rz / pq._Dot);
+      parallel_reduce(blocked_range<int>(0, n), update);
+      if (update._RR <= eps2) break;
+      UpdateSearchDirection dir;
+      dir._Z    = &_Z[0];
+      dir._P    = &_P[0];
+      dir._Beta = update._RZ / rz;
+      parallel_for(blocked_range<int>(0, n), dir);
+      rz = update._RZ;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Smallest magnitude eigenvalues of symmetric matrix using shift-and-invert
+///
+/// Applies the Lanczos method to the inverse of the matrix shifted by a small
+/// negative value, such that a singular positive semi-definite matrix such as
+/// a graph Laplacian becomes positive definite. The smallest eigenvalues of the
+/// matrix are the largest eigenvalues of this inverse, which are well separated
+/// and thus converge within few Lanczos steps. When the matrix is indefinite,
+/// the Lanczos method is applied to the matrix itself instead.
+template <class TEntry>
+int EigsShiftInvert(const irtkGenericSparseMatrix<TEntry> &A, irtkMatrix *E, irtkVector &v,
+                    int k, int p, double tol, int maxit, irtkVector *v0)
+{
+  // Bound on spectral norm given by maximum absolute column sum
+  typename irtkGenericSparseMatrix<TEntry>::Entries col;
+  double anorm = .0;
+  for (int c = 0; c < A.Cols(); ++c) {
+    A.GetCol(c, col);
+    double sum = .0;
+    for (size_t i = 0; i < col.size(); ++i) sum += fabs(col[i].second);
+    anorm = max(anorm, sum);
+  }
+  if (anorm == .0) return EigsLanczos(A, E, v, k, "SM", .0, false, p, tol, maxit, v0);
+
+  // Keep starting vector in case the Lanczos method is applied to A instead
+  irtkVector start;
+  if (v0) start = *v0;
+
+  // Lanczos method applied to inverse of shifted matrix
+  const double sigma = -1e-6 * anorm;
+  ShiftedInverse<TEntry> inv(A, sigma, 1e-12);
+  if (!inv._Indefinite) {
+    const int nconv = EigsLanczos(inv, E, v, k, "LA", .0, false, p, tol, maxit, v0);
+    if (!inv._Indefinite) {
+      for (int i = 0; i < nconv; ++i) v(i) = sigma + 1.0 / v(i);
+      return nconv;
+    }
+    if (v0) *v0 = start;
+  }
+
+  // Matrix is not positive semi-definite
+  return EigsLanczos(A, E, v, k, "SM", .0, false, p, tol, maxit, v0);
 }
 
-template <>
-int irtkGenericSparseMatrix<double>
-::Eigenvalues(irtkVector &v, int k, const char *sigma, int p, double tol, int maxit, irtkVector *v0) const
+// -----------------------------------------------------------------------------
+/// Compute eigenvalues (and -vectors) using either Lanczos method or ARPACK
+template <class TEntry>
+int Eigs(const irtkGenericSparseMatrix<TEntry> &A, irtkMatrix *E, irtkVector &v,
+         int k, const char *eigs_sigma, int p, double tol, int maxit, irtkVector *v0)
 {
-  return eigs(*this, NULL, v, k, sigma, p, tol, maxit, v0);
+  if (A.Cols() != A.Rows()) {
+    cerr << "eigs: Matrix must be square" << endl;
+    exit(1);
+  }
+  char   which[3];
+  double sigma;
+  const bool shift = !ParseSigma(eigs_sigma, which, sigma);
+  if (A.IsSymmetric()) {
+    if (!shift && strcmp(which, "SM") == 0) {
+      return EigsShiftInvert(A, E, v, k, p, tol, maxit, v0);
+    }
+#ifdef HAVE_ARPACK
+    // Use shift-and-invert mode of ARPACK for smallest algebraic and interior eigenvalues
+    if (!shift && which[0] == 'L')
+#endif
+    return EigsLanczos(A, E, v, k, which, sigma, shift, p, tol, maxit, v0);
+  }
+  return EigsArpack(A, E, v, k, eigs_sigma, p, tol, maxit, v0);
 }
 
+
+} // namespace irtkSparseMatrixUtils
+using namespace irtkSparseMatrixUtils;
+
 // -----------------------------------------------------------------------------
 template <class TEntry>
 int irtkGenericSparseMatrix<TEntry>
-::Eigenvectors(irtkMatrix &, int, const char *, int, double, int, irtkVector *) const
+::Eigenvalues(irtkVector &v, int k, const char *sigma, int p, double tol, int maxit, irtkVector *v0) const
 {
-  cerr << "irtkGenericSparseMatrix::Eigenvectors: Only implemented for sparse double precision matrices" << endl;
-  exit(1);
+  return Eigs(*this, NULL, v, k, sigma, p, tol, maxit, v0);
 }
 
-template <>
-int irtkGenericSparseMatrix<double>
+// -----------------------------------------------------------------------------
+template <class TEntry>
+int irtkGenericSparseMatrix<TEntry>
 ::Eigenvectors(irtkMatrix &E, int k, const char *sigma, int p, double tol, int maxit, irtkVector *v0) const
 {
   irtkVector v;
-  return eigs(*this, &E, v, k, sigma, p, tol, maxit, v0);
+  return Eigs(*this, &E, v, k, sigma, p, tol, maxit, v0);
 }
 
 // -----------------------------------------------------------------------------
 template <class TEntry>
 int irtkGenericSparseMatrix<TEntry>
-::Eigenvectors(irtkMatrix &, irtkVector &, int, const char *, int, double, int, irtkVector *) const
-{
-  cerr << "irtkGenericSparseMatrix::Eigenpairs: Only implemented for sparse double precision matrices" << endl;
-  exit(1);
-}
-
-template <>
-int irtkGenericSparseMatrix<double>
 ::Eigenvectors(irtkMatrix &E, irtkVector &v, int k, const char *sigma, int p, double tol, int maxit, irtkVector *v0) const
 {
-  return eigs(*this, &E, v, k, sigma, p, tol, maxit, v0);
+  return Eigs(*this, &E, v, k, sigma, p, tol, maxit, v0);
 }
 
 // =============================================================================
@@ -0,0 +1,165 @@
+/* The Image Registration Toolkit (IRTK)
+ *
+ * Copyright 2008-2015 Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#ifndef _IRTKCONNECTEDCOMPONENTS_H
+#define _IRTKCONNECTEDCOMPONENTS_H
+
+#include <irtkImage.h>
+#include <irtkNeighbourhoodOffsets.h>
+
+
+/// Size and bounding box of connected component in voxel units
+struct irtkConnectedComponent
+{
+  int _Size;          ///< Number of voxels
+  int _X1, _Y1, _Z1;  ///< Lower bounding box corner
+  int _X2, _Y2, _Z2;  ///< Upper bounding box corner
+};
+
+
+/**
+ * Connected component labelling by parallel union-find
+ *
+ * The foreground voxels of each frame (or of each slice in 2D mode) are
+ * labelled independently, where the frames are processed in parallel. Each
+ * frame is divided into slabs of consecutive slices (rows in 2D) which are
+ * scanned in parallel, and every foreground voxel is united with its already
+ * scanned neighbours of the same slab. Trees of disjoint sets are linked
+ * to the root with the smaller voxel index and compressed by each find. The
+ * sets of neighbouring voxels of adjacent slabs are merged afterwards. The
+ * root of each component is thus its first voxel in raster order, and the
+ * components are numbered 1, ..., n in this order independent of the number
+ * of slabs.
+ *
+ * The labels are stored in an image of the same size as the input, where
+ * background voxels have label zero. For each component, the number of
+ * voxels and its bounding box are recorded such that small components can be
+ * removed or the largest component be selected with one pass over the image.
+ */
+template <class VoxelType>
+class irtkConnectedComponents
+{
+public:
+
+  /// Connectivity of foreground voxels, i.e., 4 (in-plane), 6, 18, or 26
+  irtkPublicAttributeMacro(irtkConnectivityType, Connectivity);
+
+  /// Whether to label each slice separately
+  irtkPublicAttributeMacro(bool, Mode2D);
+
+  // ---------------------------------------------------------------------------
+  // Construction/Destruction
+public:
+
+  /// Constructor
+  irtkConnectedComponents(irtkConnectivityType = CONNECTIVITY_26);
+
+  // ---------------------------------------------------------------------------
+  // Labelling
+
+  /// Label connected components of non-zero voxels
+  void Run(const irtkGenericImage<VoxelType> *);
+
+  /// Label connected components of voxels with given value
+  void Run(const irtkGenericImage<VoxelType> *, VoxelType);
+
+  /// Component labels of voxels, zero for background
+  const irtkGenericImage<int> &Labels() const;
+
+  /// Number of frames or slices which were labelled separately
+  int NumberOfChunks() const;
+
+  /// Index of chunk containing given slice and frame
+  int Chunk(int z, int t) const;
+
+  /// Number of connected components of chunk
+  int NumberOfComponents(int chunk = 0) const;
+
+  /// Size and bounding box of component with given label in [1, n]
+  const irtkConnectedComponent &Component(int label, int chunk = 0) const;
+
+  /// Label of largest component of chunk or zero if chunk has no foreground
+  int LargestComponent(int chunk = 0) const;
+
+  // ---------------------------------------------------------------------------
+  // Selection
+
+  /// Set voxels of largest component of each chunk to one and others to zero
+  void ExtractLargestComponent(irtkGenericImage<VoxelType> *) const;
+
+  /// Set voxels of components with less than the given number of voxels to
+  /// the background value and leave other voxels unchanged
+  void RemoveSmallComponents(irtkGenericImage<VoxelType> *, int, VoxelType = 0) const;
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+private:
+
+  /// Component labels
+  irtkGenericImage<int> _Labels;
+
+  /// Number of slices per chunk
+  int _ChunkSize;
+
+  /// Components of each chunk, where element i corresponds to label i+1
+  vector<vector<irtkConnectedComponent> > _Components;
+
+  /// Label foreground voxels of given mask
+  void Label(const vector<char> &);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+////////////////////////////////////////////////////////////////////////////////
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+inline const irtkGenericImage<int> &irtkConnectedComponents<VoxelType>::Labels() const
+{
+  return _Labels;
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+inline int irtkConnectedComponents<VoxelType>::NumberOfChunks() const
+{
+  return static_cast<int>(_Components.size());
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+inline int irtkConnectedComponents<VoxelType>::Chunk(int z, int t) const
+{
+  return t * (_Labels.GetZ() / _ChunkSize) + z / _ChunkSize;
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+inline int irtkConnectedComponents<VoxelType>::NumberOfComponents(int chunk) const
+{
+  return static_cast<int>(_Components[chunk].size());
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+inline const irtkConnectedComponent &
+irtkConnectedComponents<VoxelType>::Component(int label, int chunk) const
+{
+  return _Components[chunk][label - 1];
+}
+
+
+#endif
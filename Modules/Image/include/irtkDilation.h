@@ -19,12 +19,17 @@
 #define _IRTKDILATION_H
 
 #include <irtkImageToImage.h>
+#include <irtkMorphology.h>
 
 /**
  * Class for dilation of images
  *
  * This class defines and implements the morphological dilation of images.
  *
+ * By default, each voxel is replaced by the maximum over its neighbourhood of
+ * given connectivity excluding the image boundary. If a radius is set, the
+ * structuring element is instead a box, approximate sphere, or exact ball
+ * of this radius in voxel units (see irtkMorphology).
  */
 
 template <class VoxelType>
@@ -57,6 +62,12 @@ public:
   SetMacro(Connectivity, irtkConnectivityType);
 
   GetMacro(Connectivity, irtkConnectivityType);
+
+  /// Radius of structuring element in voxels or zero to use connectivity
+  irtkPublicAttributeMacro(int, Radius);
+
+  /// Shape of structuring element of non-zero radius
+  irtkPublicAttributeMacro(irtkStructuringElement, StructuringElement);
 };
 
 #endif
@@ -34,6 +34,12 @@ public:
   /// 2D or 3D distance transform
   enum irtkDistanceTransformMode { irtkDistanceTransform2D, irtkDistanceTransform3D };
 
+  /// Whether to compute the signed Euclidean distance to the boundary of the
+  /// foreground (non-zero voxels) instead of the squared distance to it.
+  /// The signed distance is negative inside and positive outside the
+  /// foreground, and both are computed in one call of Run.
+  irtkPublicAttributeMacro(bool, SignedDistance);
+
 protected:
 
   /// 2D or 3D distance transform
@@ -48,14 +54,11 @@ protected:
   /// Calculate 3D distance transform
   void edtComputeEDT_3D(char *, long *, long, long, long);
 
-  /// Calculate the Vornoi diagram for anisotripic voxel sizes
-  int edtVornoiEDT_anisotropic(VoxelType *, long, double);
-
   /// Calculate 2D distance transform for anisotripic voxel sizes
-  void edtComputeEDT_2D_anisotropic(VoxelType *, VoxelType *, long, long, double, double);
+  void edtComputeEDT_2D_anisotropic(const VoxelType *, VoxelType *, long, long, double, double);
 
   /// Calculate 3D distance transform for anisotripic voxel sizes
-  void edtComputeEDT_3D_anisotropic(VoxelType *, VoxelType *, long, long, long, double, double, double);
+  void edtComputeEDT_3D_anisotropic(const VoxelType *, VoxelType *, long, long, long, double, double, double);
 
 public:
 
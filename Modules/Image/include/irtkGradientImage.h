@@ -22,12 +22,16 @@
  * Class for caluclating the gradient of an image.
  * The class provides an iterface to subclasses which calculate the gradient in
  * x- , y- and z- directions.
+ *
+ * The gradient is evaluated row by row in parallel by irtkImageRowFilter,
+ * where rows with all central differences inside the image skip the bounds
+ * checks of the voxels at the image boundary.
  */
 
-#include <irtkImageToImage.h>
+#include <irtkImageRowFilter.h>
 
 template <class VoxelType>
-class irtkGradientImage : public irtkImageToImage<VoxelType>
+class irtkGradientImage : public irtkImageRowFilter<VoxelType>
 {
   irtkImageFilterMacro(irtkGradientImage);
 
@@ -36,8 +40,14 @@ protected:
   /// padding value
   VoxelType _Padding;
 
-  /// Runs the filter on a single voxel.
-  virtual double Run(int, int, int, int);
+  /// Initialize the filter
+  virtual void Initialize();
+
+  /// Calculate gradient magnitude of row segment inside the image
+  virtual void FilterInterior(irtkNoRowFilterState &, const irtkImageRowSegment<VoxelType> &) const;
+
+  /// Calculate gradient magnitude of row segment at the image boundary
+  virtual void FilterBoundary(irtkNoRowFilterState &, const irtkImageRowSegment<VoxelType> &) const;
 
 public:
   /// Constructor
@@ -45,9 +55,6 @@ public:
   /// Set Padding
   virtual SetMacro(Padding,VoxelType);
 
-  /// Run the convolution filter
-  virtual void Run();
-
 };
 
 #include <irtkGradientImageX.h>
@@ -31,13 +31,14 @@ class irtkGradientImageX : public irtkGradientImage<VoxelType>
 
 protected:
 
-  // Calculate the gradient on a single voxel.
-  virtual double Run(int, int, int, int);
+  /// Initialize the filter
+  virtual void Initialize();
 
-public:
+  /// Calculate the gradient of a row segment inside the image
+  virtual void FilterInterior(irtkNoRowFilterState &, const irtkImageRowSegment<VoxelType> &) const;
 
-  /// Run the convolution filter
-  virtual void Run();
+  /// Calculate the gradient of a row segment at the image boundary
+  virtual void FilterBoundary(irtkNoRowFilterState &, const irtkImageRowSegment<VoxelType> &) const;
 };
 
 
@@ -0,0 +1,239 @@
+/* The Image Registration Toolkit (IRTK)
+ *
+ * Copyright 2008-2015 Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#ifndef _IRTKIMAGEROWFILTER_H
+#define _IRTKIMAGEROWFILTER_H
+
+#include <irtkImageToImage.h>
+
+
+/// Kernel state of row filters which require no per-thread state
+struct irtkNoRowFilterState {};
+
+
+/// Segment [x1, x2) of image row passed to the kernels of irtkImageRowFilter
+template <class VoxelType>
+struct irtkImageRowSegment
+{
+  const VoxelType *_Input;    ///< First voxel of input row, i.e., at x = 0
+  VoxelType       *_Output;   ///< First voxel of output row, i.e., at x = 0
+  int              _X1, _X2;  ///< Range of voxels to filter
+  int              _Y, _Z, _T;///< Indices of row
+  int              _StrideY;  ///< Offset between voxels of adjacent rows
+  int              _StrideZ;  ///< Offset between voxels of adjacent slices
+};
+
+
+/**
+ * Abstract base class of image filters evaluated row by row
+ *
+ * Instead of a virtual function call per voxel whose result is written by
+ * PutAsDouble, subclasses implement typed kernels which filter a segment of
+ * an image row at once and write the output voxels directly. The rows of all
+ * frames are divided into as many contiguous tiles as there are worker
+ * threads, and the tiles are filtered in parallel.
+ *
+ * The kernels are const member functions and must not modify the filter.
+ * Instead, each tile owns one instance of the kernel state type created by
+ * NewState, which may hold scratch buffers, random number generators, or
+ * partial results. After all tiles are filtered, the states are passed to
+ * MergeState in the order of the tiles, i.e., independent of the scheduling.
+ *
+ * The margin of the filter is the extent of the neighbourhood accessed by
+ * the kernel around each voxel. Row segments whose neighbourhoods are inside
+ * the image are passed to FilterInterior without bounds checks, and the
+ * remaining voxels are passed to FilterBoundary, which calls FilterInterior
+ * unless overridden. Subclasses set the margin in Initialize.
+ */
+template <class VoxelType, class StateType = irtkNoRowFilterState>
+class irtkImageRowFilter : public irtkImageToImage<VoxelType>
+{
+  irtkAbstractMacro(irtkImageRowFilter);
+
+protected:
+
+  /// Margin of kernel neighbourhood along x
+  int _MarginX;
+
+  /// Margin of kernel neighbourhood along y
+  int _MarginY;
+
+  /// Margin of kernel neighbourhood along z
+  int _MarginZ;
+
+  /// Constructor
+  irtkImageRowFilter();
+
+  /// Set margin of kernel neighbourhood
+  void SetMargin(int, int, int);
+
+  // ---------------------------------------------------------------------------
+  // Kernel
+
+  /// Create kernel state of one tile
+  virtual StateType *NewState() const;
+
+  /// Merge kernel state of tile after all tiles were filtered
+  virtual void MergeState(StateType &);
+
+  /// Filter row segment whose neighbourhood is inside the image
+  virtual void FilterInterior(StateType &, const irtkImageRowSegment<VoxelType> &) const = 0;
+
+  /// Filter row segment at the image boundary
+  virtual void FilterBoundary(StateType &, const irtkImageRowSegment<VoxelType> &) const;
+
+public:
+
+  /// Run filter on entire image
+  virtual void Run();
+
+  // ---------------------------------------------------------------------------
+  // Auxiliary functors
+private:
+
+  /// Filter rows of each tile
+  struct FilterTiles
+  {
+    const irtkImageRowFilter *_Filter;
+    StateType               **_States;
+    int                       _NumberOfTiles;
+    int                       _NumberOfRows;
+
+    void operator ()(const blocked_range<int> &re) const
+    {
+      const irtkGenericImage<VoxelType> *input  = _Filter->_input;
+      irtkGenericImage<VoxelType>       *output = _Filter->_output;
+      const int nx = input->GetX();
+      const int ny = input->GetY();
+      const int nz = input->GetZ();
+      const int mx = _Filter->_MarginX;
+      const int my = _Filter->_MarginY;
+      const int mz = _Filter->_MarginZ;
+
+      irtkImageRowSegment<VoxelType> row;
+      row._StrideY = nx;
+      row._StrideZ = nx * ny;
+
+      for (int b = re.begin(); b != re.end(); ++b) {
+        StateType &state = *_States[b];
+        const int r1 = static_cast<int>(static_cast<long>(_NumberOfRows) *  b      / _NumberOfTiles);
+        const int r2 = static_cast<int>(static_cast<long>(_NumberOfRows) * (b + 1) / _NumberOfTiles);
+        for (int r = r1; r < r2; ++r) {
+          row._Y      = r % ny;
+          row._Z      = (r / ny) % nz;
+          row._T      = r / (ny * nz);
+          row._Input  = input ->GetPointerToVoxels(0, row._Y, row._Z, row._T);
+          row._Output = output->GetPointerToVoxels(0, row._Y, row._Z, row._T);
+          if (row._Y < my || row._Y >= ny - my || row._Z < mz || row._Z >= nz - mz || nx <= 2 * mx) {
+            row._X1 = 0, row._X2 = nx;
+            _Filter->FilterBoundary(state, row);
+          } else {
+            if (mx > 0) {
+              row._X1 = 0, row._X2 = mx;
+              _Filter->FilterBoundary(state, row);
+            }
+            row._X1 = mx, row._X2 = nx - mx;
+            _Filter->FilterInterior(state, row);
+            if (mx > 0) {
+              row._X1 = nx - mx, row._X2 = nx;
+              _Filter->FilterBoundary(state, row);
+            }
+          }
+        }
+      }
+    }
+  };
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+////////////////////////////////////////////////////////////////////////////////
+
+// -----------------------------------------------------------------------------
+template <class VoxelType, class StateType>
+irtkImageRowFilter<VoxelType, StateType>::irtkImageRowFilter()
+:
+  _MarginX(0), _MarginY(0), _MarginZ(0)
+{
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType, class StateType>
+inline void irtkImageRowFilter<VoxelType, StateType>::SetMargin(int mx, int my, int mz)
+{
+  _MarginX = mx;
+  _MarginY = my;
+  _MarginZ = mz;
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType, class StateType>
+StateType *irtkImageRowFilter<VoxelType, StateType>::NewState() const
+{
+  return new StateType();
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType, class StateType>
+void irtkImageRowFilter<VoxelType, StateType>::MergeState(StateType &)
+{
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType, class StateType>
+void irtkImageRowFilter<VoxelType, StateType>
+::FilterBoundary(StateType &state, const irtkImageRowSegment<VoxelType> &row) const
+{
+  this->FilterInterior(state, row);
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType, class StateType>
+void irtkImageRowFilter<VoxelType, StateType>::Run()
+{
+  // Do the initial set up
+  this->Initialize();
+
+  // Number of tiles, i.e., one per worker thread unless only few rows
+  const int nrows = this->_input->GetY() * this->_input->GetZ() * this->_input->GetT();
+  int ntiles = NumberOfThreads();
+  if (ntiles > nrows) ntiles = nrows;
+  if (ntiles < 1)     ntiles = 1;
+
+  // Filter tiles in parallel, each with its own kernel state
+  vector<StateType *> states(ntiles);
+  for (int b = 0; b < ntiles; ++b) states[b] = this->NewState();
+
+  FilterTiles body;
+  body._Filter        = this;
+  body._States        = &states[0];
+  body._NumberOfTiles = ntiles;
+  body._NumberOfRows  = nrows;
+  parallel_for(blocked_range<int>(0, ntiles, 1), body);
+
+  // Merge kernel states in order of tiles
+  for (int b = 0; b < ntiles; ++b) {
+    this->MergeState(*states[b]);
+    delete states[b];
+  }
+
+  // Do the final cleaning up
+  this->Finalize();
+}
+
+
+#endif
@@ -19,12 +19,15 @@
 #define _IRTKLARGESTCONNECTEDCOMPONENT_H
 
 #include <irtkImageToImage.h>
+#include <irtkConnectedComponents.h>
 
 /**
  * Class for extracting the largest connected component from a labelled image
  *
  * This class defines and implements the extraction of the largest connected component
- * from a labelled image.
+ * from a labelled image. The voxels with the cluster label are labelled by
+ * irtkConnectedComponents using 6-connectivity (4-connectivity in 2D mode),
+ * where each frame (or each slice in 2D mode) is processed separately.
  *
  */
 
@@ -35,9 +38,6 @@ class irtkLargestConnectedComponent : public irtkImageToImage<VoxelType>
 
 private:
 
-  /// Size of current cluster
-  int _currentClusterSize;
-
   /// Size of largest cluster
   int _largestClusterSize;
 
@@ -47,14 +47,6 @@ private:
   /// Mode
   bool _Mode2D;
 
-protected:
-
-  /// Recursive region growing
-  void Grow2D(int, int, int, int);
-
-  /// Recursive region growing
-  void Grow3D(int, int, int, int);
-
 public:
 
   /// Constructor
@@ -23,6 +23,15 @@
 /**
  * Class for median filtering an image
  *
+ * The median of each voxel is taken over the cubic neighbourhood of the
+ * given kernel radius, where only voxels with non-zero mask value are
+ * considered if a mask is set. Voxels closer to the image boundary than the
+ * kernel radius keep their input value. If all input values of a frame are
+ * integral with a limited range, e.g., for integer voxel types or quantized
+ * floating point values, the median is found using a histogram of the window
+ * which is updated incrementally as the window moves along each row.
+ * Otherwise, the median is selected by partial sorting of a buffer which is
+ * reused for each voxel. In both cases, slabs of slices are filtered in parallel.
  */
 
 template <class VoxelType>
@@ -38,6 +47,7 @@ protected:
   /// What connectivity to assume when running the filter.
   int _kernelRadius;
 
+  /// Optional mask of voxels included in the median
   irtkRealImage* _mask;
 
 public:
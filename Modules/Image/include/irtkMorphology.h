@@ -0,0 +1,71 @@
+/* The Image Registration Toolkit (IRTK)
+ *
+ * Copyright 2008-2015 Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#ifndef _IRTKMORPHOLOGY_H
+#define _IRTKMORPHOLOGY_H
+
+#include <irtkImage.h>
+
+
+/// Shape of structuring element of given radius
+enum irtkStructuringElement
+{
+  StructuringElement_Box,    ///< Cube of side length 2r+1
+  StructuringElement_Sphere, ///< Polyhedral approximation of a sphere by line segments
+  StructuringElement_Ball    ///< Exact digital ball of binary image via distance transform
+};
+
+
+/**
+ * Morphological dilation and erosion with large structuring elements
+ *
+ * A box is decomposed into line segments along the image axes, and a sphere
+ * is approximated by the Minkowski sum of line segments along the 3 axes,
+ * the 6 face diagonals, and the 4 body diagonals of a voxel (the 2 diagonals
+ * in 2D), whose lengths are chosen such that the resulting polyhedron
+ * deviates least from a sphere of the given radius. The maximum/minimum
+ * over each line segment is computed by the van Herk/Gil-Werman algorithm
+ * with about three comparisons per voxel, independent of the radius. Lines
+ * are processed in parallel. Voxels outside the image domain are ignored,
+ * i.e., the structuring element is clipped at the image boundary.
+ *
+ * The exact ball is only available for binary images, i.e., where non-zero
+ * voxels are foreground. It thresholds the Euclidean distance transform of
+ * the foreground (dilation) or background (erosion), and the foreground of
+ * the output is set to one.
+ *
+ * The radius is given in voxel units and each frame is processed separately.
+ */
+template <class VoxelType>
+class irtkMorphology
+{
+public:
+
+  /// Dilate image, i.e., maximum of voxel values within structuring element
+  static void Dilate(const irtkGenericImage<VoxelType> *, irtkGenericImage<VoxelType> *,
+                     int radius, irtkStructuringElement = StructuringElement_Box);
+
+  /// Erode image, i.e., minimum of voxel values within structuring element
+  static void Erode(const irtkGenericImage<VoxelType> *, irtkGenericImage<VoxelType> *,
+                    int radius, irtkStructuringElement = StructuringElement_Box);
+
+  /// Radii of line segments along the axes, face and body diagonals whose
+  /// Minkowski sum approximates a sphere of given radius
+  static void SphereDecomposition(int radius, bool volume, int &a, int &b, int &c);
+};
+
+
+#endif
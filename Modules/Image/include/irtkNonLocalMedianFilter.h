@@ -28,6 +28,14 @@
  * based denoising. Commun. Math. Sci., 7(3):741–753, 2009.
  * The non local weight is a Gaussian function of 4D distance where intensity is
  * considered as the fourth dimension
+ *
+ * The filter mirrors the input and the optional scale and occlusion images at
+ * the boundary into padded copies, such that neighbours are accessed by fixed
+ * offsets. The spatial weights of the two window sizes, i.e., at edges and
+ * elsewhere, and the intensity weights of all scale differences are computed
+ * once. Rows of voxels are then filtered in parallel, where each task collects
+ * the neighbours with non-zero weight in its own buffers. Unless the fidelity
+ * weight lambda is positive, the weighted median is found by quickselect.
  */
 
 template <class VoxelType>
@@ -51,10 +59,6 @@ protected:
 
   irtkGenericImage<VoxelType> *_edge;
 
-  float *_localweight;
-
-  float *_localneighbor;
-
   float _dx;
 
   float _dy;
@@ -73,11 +77,6 @@ protected:
 
   virtual double EvaluateWeight(const double &);
 
-  /** Run This method is protected and should only
-  *  be called from within public member function Run().
-  */
-  virtual double Run(int, int, int, int);
-
 public:
 
   /// Constructor to remvoe the non-local term
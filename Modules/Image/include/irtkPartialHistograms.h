@@ -0,0 +1,278 @@
+/* The Image Registration Toolkit (IRTK)
+ *
+ * Copyright 2008-2015 Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#ifndef _IRTKPARTIALHISTOGRAMS_H
+#define _IRTKPARTIALHISTOGRAMS_H
+
+#include <irtkCommon.h>
+
+
+/// Type used to sum up partial histogram counts
+template <class TCount> struct irtkPartialHistogramSum      { typedef TCount Type; };
+template <>             struct irtkPartialHistogramSum<int> { typedef long   Type; };
+
+
+/**
+ * Private histograms used to fill a histogram in parallel
+ *
+ * The samples are divided into as many contiguous blocks as there are worker
+ * threads. Each block is counted by one task into its own partial histogram.
+ * The partial histograms are stored in one buffer, where each is padded to a
+ * multiple of the cache line size to avoid false sharing, and the buffer is
+ * reused by subsequent fills of the same size. Only once all samples are
+ * counted, the partial counts are summed up in parallel over disjoint ranges
+ * of bins and converted to the bin type of the output histogram, e.g.,
+ * irtkHistogram_1D<double>::RawPointer().
+ *
+ * Integer partial histograms (irtkPartialHistograms) count samples of a bin
+ * function, whereas floating point partial histograms can be filled with
+ * weighted samples such as Parzen windows.
+ *
+ * Because the blocks do not depend on the task scheduling, the resulting
+ * counts are moreover identical for each run.
+ */
+template <class TCount>
+class irtkGenericPartialHistograms
+{
+public:
+
+  /// Type of partial bin counts
+  typedef TCount CountType;
+
+  // ---------------------------------------------------------------------------
+  // Construction/Destruction
+
+  /// Constructor
+  irtkGenericPartialHistograms();
+
+  // ---------------------------------------------------------------------------
+  // Counting
+
+  /// Count samples of given bin function
+  ///
+  /// The bin function is called as <tt>int bin = f(idx)</tt> for each sample
+  /// index in [0, n) and returns a negative value for samples to be ignored.
+  template <class BinFunction>
+  void Count(int nbins, int n, const BinFunction &f);
+
+  /// Add weighted samples of given fill function
+  ///
+  /// The fill function is called as <tt>f(idx, counts)</tt> for each sample
+  /// index in [0, n) and adds the sample to the given partial bin counts.
+  template <class FillFunction>
+  void Fill(int nbins, int n, const FillFunction &f);
+
+  /// Add partial counts to given histogram bins
+  ///
+  /// \returns Total number of counted samples.
+  template <class BinType>
+  BinType AddTo(BinType *bins) const;
+
+  /// Number of bins
+  int NumberOfBins() const;
+
+  /// Number of partial histograms used by last Count or Fill
+  int NumberOfPartialHistograms() const;
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+private:
+
+  /// Number of bins of each histogram
+  int _NumberOfBins;
+
+  /// Number of bin counts between two consecutive partial histograms
+  int _Stride;
+
+  /// Number of partial histograms
+  int _NumberOfPartialHistograms;
+
+  /// Partial bin counts
+  vector<CountType> _Counts;
+
+  /// Number of bin counts per cache line
+  static const int _CacheLineSize = 64 / sizeof(CountType);
+
+  /// (Re-)allocate partial histograms for n samples
+  void Allocate(int nbins, int n);
+
+  // ---------------------------------------------------------------------------
+  // Auxiliary functors
+
+  /// Count samples of bin function
+  template <class BinFunction>
+  struct CountSample
+  {
+    const BinFunction &_Function;
+
+    CountSample(const BinFunction &f) : _Function(f) {}
+
+    void operator ()(int idx, CountType *counts) const
+    {
+      int bin;
+      if ((bin = _Function(idx)) >= 0) ++counts[bin];
+    }
+  };
+
+  /// Fill one block of samples per partial histogram
+  template <class FillFunction>
+  struct FillBlock
+  {
+    const FillFunction &_Function;
+    CountType          *_Counts;
+    int                 _Stride;
+    int                 _NumberOfBins;
+    int                 _NumberOfBlocks;
+    int                 _NumberOfSamples;
+
+    FillBlock(const FillFunction &f, CountType *counts, int stride,
+              int nbins, int nblocks, int n)
+    :
+      _Function(f), _Counts(counts), _Stride(stride),
+      _NumberOfBins(nbins), _NumberOfBlocks(nblocks), _NumberOfSamples(n)
+    {}
+
+    void operator ()(const blocked_range<int> &re) const
+    {
+      for (int b = re.begin(); b != re.end(); ++b) {
+        CountType *counts = _Counts + b * _Stride;
+        memset(counts, 0, _NumberOfBins * sizeof(CountType));
+        const int idx1 = static_cast<int>(static_cast<long>(_NumberOfSamples) *  b      / _NumberOfBlocks);
+        const int idx2 = static_cast<int>(static_cast<long>(_NumberOfSamples) * (b + 1) / _NumberOfBlocks);
+        for (int idx = idx1; idx < idx2; ++idx) _Function(idx, counts);
+      }
+    }
+  };
+
+  /// Sum up partial counts of range of bins
+  template <class BinType>
+  struct MergeBins
+  {
+    const CountType *_Counts;
+    BinType         *_Bins;
+    int              _Stride;
+    int              _NumberOfBlocks;
+    typename irtkPartialHistogramSum<CountType>::Type _NumberOfSamples;
+
+    MergeBins(const CountType *counts, BinType *bins, int stride, int nblocks)
+    :
+      _Counts(counts), _Bins(bins), _Stride(stride), _NumberOfBlocks(nblocks),
+      _NumberOfSamples(0)
+    {}
+
+    MergeBins(const MergeBins &lhs, split)
+    :
+      _Counts(lhs._Counts), _Bins(lhs._Bins), _Stride(lhs._Stride),
+      _NumberOfBlocks(lhs._NumberOfBlocks), _NumberOfSamples(0)
+    {}
+
+    void join(const MergeBins &rhs)
+    {
+      _NumberOfSamples += rhs._NumberOfSamples;
+    }
+
+    void operator ()(const blocked_range<int> &re)
+    {
+      for (int i = re.begin(); i != re.end(); ++i) {
+        const CountType *counts = _Counts + i;
+        typename irtkPartialHistogramSum<CountType>::Type sum = 0;
+        for (int b = 0; b < _NumberOfBlocks; ++b, counts += _Stride) sum += *counts;
+        _Bins[i] += static_cast<BinType>(sum);
+        _NumberOfSamples += sum;
+      }
+    }
+  };
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+////////////////////////////////////////////////////////////////////////////////
+
+// -----------------------------------------------------------------------------
+template <class TCount>
+inline irtkGenericPartialHistograms<TCount>::irtkGenericPartialHistograms()
+:
+  _NumberOfBins(0), _Stride(0), _NumberOfPartialHistograms(0)
+{
+}
+
+// -----------------------------------------------------------------------------
+template <class TCount>
+inline int irtkGenericPartialHistograms<TCount>::NumberOfBins() const
+{
+  return _NumberOfBins;
+}
+
+// -----------------------------------------------------------------------------
+template <class TCount>
+inline int irtkGenericPartialHistograms<TCount>::NumberOfPartialHistograms() const
+{
+  return _NumberOfPartialHistograms;
+}
+
+// -----------------------------------------------------------------------------
+template <class TCount>
+void irtkGenericPartialHistograms<TCount>::Allocate(int nbins, int n)
+{
+  // Number of blocks, i.e., one per worker thread unless only few samples
+  int nblocks = NumberOfThreads();
+  if (nblocks > n / 1024) nblocks = n / 1024;
+  if (nblocks < 1) nblocks = 1;
+
+  // (Re-)allocate partial histograms, padded by at least one cache line
+  _NumberOfBins              = nbins;
+  _Stride                    = ((nbins + 2 * _CacheLineSize - 1) / _CacheLineSize) * _CacheLineSize;
+  _NumberOfPartialHistograms = nblocks;
+  const size_t size = static_cast<size_t>(_Stride) * static_cast<size_t>(nblocks);
+  if (_Counts.size() < size) _Counts.resize(size);
+}
+
+// -----------------------------------------------------------------------------
+template <class TCount> template <class BinFunction>
+void irtkGenericPartialHistograms<TCount>::Count(int nbins, int n, const BinFunction &f)
+{
+  Fill(nbins, n, CountSample<BinFunction>(f));
+}
+
+// -----------------------------------------------------------------------------
+template <class TCount> template <class FillFunction>
+void irtkGenericPartialHistograms<TCount>::Fill(int nbins, int n, const FillFunction &f)
+{
+  Allocate(nbins, n);
+  FillBlock<FillFunction> fill(f, &_Counts[0], _Stride, nbins, _NumberOfPartialHistograms, n);
+  parallel_for(blocked_range<int>(0, _NumberOfPartialHistograms, 1), fill);
+}
+
+// -----------------------------------------------------------------------------
+template <class TCount> template <class BinType>
+BinType irtkGenericPartialHistograms<TCount>::AddTo(BinType *bins) const
+{
+  if (_NumberOfPartialHistograms == 0) return BinType(0);
+  MergeBins<BinType> merge(&_Counts[0], bins, _Stride, _NumberOfPartialHistograms);
+  parallel_reduce(blocked_range<int>(0, _NumberOfBins), merge);
+  return static_cast<BinType>(merge._NumberOfSamples);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Partial histogram types
+////////////////////////////////////////////////////////////////////////////////
+
+/// Private integer histograms used to count samples in parallel
+typedef irtkGenericPartialHistograms<int> irtkPartialHistograms;
+
+
+#endif
@@ -17,6 +17,194 @@
 #include <irtkImage.h>
 #include <irtkAnisoDiffusion.h>
 
+#include <vector>
+
+
+// =============================================================================
+// Auxiliary functors
+// =============================================================================
+
+namespace anisoDiffusionUtils {
+
+// -----------------------------------------------------------------------------
+/// Number of lines along y, z, or t which are gathered into one tile buffer
+const int LinesPerTile = 32;
+
+// -----------------------------------------------------------------------------
+/// Semi-implicit diffusion along one axis of the image
+///
+/// The lines along the axis are independent tridiagonal systems and are solved
+/// in parallel by the Thomas algorithm. The diffusivity of each voxel is
+/// computed from the central difference of the current image while the system
+/// is assembled. Lines along y, z, and t are copied in tiles of neighbouring
+/// lines from and to a transposed buffer such that voxels are read and written
+/// in the order in which they are stored in memory. The image is fixed at the
+/// voxels beyond the end of each line to the initial values at the boundary.
+struct DiffuseAlongAxis
+{
+  float       *_Image;      ///< Current image
+  const float *_Initial;    ///< Initial image whose boundary values are fixed
+  int          _Size[4];    ///< Image size
+  int          _Stride[4];  ///< Offset between adjacent voxels along each axis
+  int          _Axis;       ///< Axis of diffusion
+  double       _Tau;        ///< Time step divided by number of axes
+  double       _Spacing;    ///< Distance between voxels along axis
+  double       _Contrast;   ///< Significant grey value difference along axis
+  float        _Weight;     ///< Reciprocal of squared distance between voxels
+
+  /// Number of lines (x) or tiles of lines (y, z, t)
+  int NumberOfTasks() const
+  {
+    const int nlines = _Size[0] * _Size[1] * _Size[2] * _Size[3] / _Size[_Axis];
+    if (_Axis == 0) return nlines;
+    return (nlines / _Size[0]) * ((_Size[0] + LinesPerTile - 1) / LinesPerTile);
+  }
+
+  /// Offset of first voxel of line with given index of all lines (x) or
+  /// row of lines along x (y, z, t) with given index of all such rows
+  int Offset(int i) const
+  {
+    int offset = 0;
+    for (int d = 1; d < 4; ++d) {
+      if (d == _Axis) continue;
+      offset += (i % _Size[d]) * _Stride[d];
+      i      /=  _Size[d];
+    }
+    return offset;
+  }
+
+  /// Solve tridiagonal system of one line in place given its end values
+  void Solve(float *u, float lo, float hi, float *a, float *b, float *c, float *d, float *x) const
+  {
+    const int n = _Size[_Axis];
+    double dIdx;
+    float  D;
+    for (int k = 0; k < n; ++k) {
+      const float prev = (k == 0    ) ? lo : u[k-1];
+      const float next = (k == n - 1) ? hi : u[k+1];
+      dIdx = (next - prev) / (2 * _Spacing);
+      D = static_cast<float>((1 - exp(-3.314 / pow((dIdx / _Contrast), 4))) * _Weight);
+      a[k+2] = _Tau * D;
+      b[k+2] = -1 - 2 * _Tau * D;
+      c[k+2] = _Tau * D;
+      d[k+2] = u[k];
+    }
+    // Mirror system at both ends to avoid boundary effects
+    const int i0 = (n > 2 ? 4 : 3), i1 = (n > 2 ? n - 1 : 2);
+    a[1] = a[3]; a[0] = a[i0]; a[n+2] = a[n]; a[n+3] = a[i1];
+    b[1] = b[3]; b[0] = b[i0]; b[n+2] = b[n]; b[n+3] = b[i1];
+    c[1] = c[3]; c[0] = c[i0]; c[n+2] = c[n]; c[n+3] = c[i1];
+    d[1] = d[3]; d[0] = d[i0]; d[n+2] = d[n]; d[n+3] = d[i1];
+    TridiagonalSolveFloat(a, b, c, d, x, n + 4);
+    for (int k = 0; k < n; ++k) u[k] = -x[k+2];
+  }
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int n = _Size[_Axis];
+    const int s = _Stride[_Axis];
+    vector<float> scratch(5 * (n + 4));
+    float *a = &scratch[0];
+    float *b = a + (n + 4);
+    float *c = b + (n + 4);
+    float *d = c + (n + 4);
+    float *x = d + (n + 4);
+
+    if (_Axis == 0) {
+      for (int i = re.begin(); i != re.end(); ++i) {
+        const int offset = Offset(i);
+        Solve(_Image + offset, _Initial[offset], _Initial[offset + n - 1], a, b, c, d, x);
+      }
+    } else {
+      const int ntiles = (_Size[0] + LinesPerTile - 1) / LinesPerTile;
+      vector<float> tile(LinesPerTile * n);
+      for (int i = re.begin(); i != re.end(); ++i) {
+        const int x1     = (i % ntiles) * LinesPerTile;
+        const int x2     = min(x1 + LinesPerTile, _Size[0]);
+        const int offset = Offset(i / ntiles) + x1;
+        const int nlines = x2 - x1;
+        // Gather lines, reading consecutive voxels along x
+        for (int k = 0; k < n; ++k) {
+          const float *in = _Image + offset + k * s;
+          for (int l = 0; l < nlines; ++l) tile[l * n + k] = in[l];
+        }
+        // Solve tridiagonal systems
+        for (int l = 0; l < nlines; ++l) {
+          Solve(&tile[l * n], _Initial[offset + l], _Initial[offset + (n - 1) * s + l], a, b, c, d, x);
+        }
+        // Scatter lines, writing consecutive voxels along x
+        for (int k = 0; k < n; ++k) {
+          float *out = _Image + offset + k * s;
+          for (int l = 0; l < nlines; ++l) out[l] = tile[l * n + k];
+        }
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Semi-implicit anisotropic diffusion of image along first naxes axes
+///
+/// The image is diffused along each axis in turn, where the time step of
+/// each axis is the virtual time step divided by the number of axes.
+/// Axes of size one are not diffused. When the time is not an axis of the
+/// diffusion, the frames are processed independently.
+template <class VoxelType>
+void DiffuseSemiImplicit(const irtkGenericImage<VoxelType> *input,
+                         irtkGenericImage<VoxelType>       *output,
+                         int naxes, const double contrast[4], const double spacing[4],
+                         float dTau, int niterations)
+{
+  const int nvox = input->GetNumberOfVoxels();
+
+  // Copy image to buffers of floating point values
+  vector<float> image(nvox), initial(nvox);
+  const VoxelType *in = input->GetPointerToVoxels();
+  for (int i = 0; i < nvox; ++i) image[i] = static_cast<float>(in[i]);
+  initial = image;
+
+  DiffuseAlongAxis diffuse;
+  diffuse._Image     = &image[0];
+  diffuse._Initial   = &initial[0];
+  diffuse._Size[0]   = input->GetX();
+  diffuse._Size[1]   = input->GetY();
+  diffuse._Size[2]   = input->GetZ();
+  diffuse._Size[3]   = input->GetT();
+  diffuse._Stride[0] = 1;
+  diffuse._Stride[1] = diffuse._Stride[0] * diffuse._Size[0];
+  diffuse._Stride[2] = diffuse._Stride[1] * diffuse._Size[1];
+  diffuse._Stride[3] = diffuse._Stride[2] * diffuse._Size[2];
+  diffuse._Tau       = dTau / static_cast<double>(naxes);
+
+  // As in the explicit scheme, the temporal diffusivity is scaled by the
+  // distance between slices rather than frames
+  float weight[4];
+  weight[0] = 1. / pow(spacing[0], 2);
+  weight[1] = 1. / pow(spacing[1], 2);
+  weight[2] = 1. / pow(spacing[2], 2);
+  weight[3] = weight[2];
+
+  for (int iteration = 0; iteration < niterations; ++iteration) {
+    cout << "| Iteration " << iteration + 1 << " / " << niterations << "\n";
+    for (int axis = 0; axis < naxes; ++axis) {
+      if (diffuse._Size[axis] < 2) continue;
+      diffuse._Axis     = axis;
+      diffuse._Spacing  = spacing [axis];
+      diffuse._Contrast = contrast[axis];
+      diffuse._Weight   = weight  [axis];
+      parallel_for(blocked_range<int>(0, diffuse.NumberOfTasks()), diffuse);
+    }
+  }
+
+  // Convert filtered image to output voxel type
+  VoxelType *out = output->GetPointerToVoxels();
+  for (int i = 0; i < nvox; ++i) out[i] = static_cast<VoxelType>(image[i]);
+}
+
+
+} // namespace anisoDiffusionUtils
+using namespace anisoDiffusionUtils;
+
 
 template <class VoxelType> anisoDiffusion<VoxelType>::anisoDiffusion(){
   //default parameters
@@ -38,24 +226,7 @@ template <class VoxelType> anisoDiffusion<VoxelType>::~anisoDiffusion(void)
 {}
 
 template <class VoxelType> void anisoDiffusion<VoxelType>::Run_3D_semiImplicit(){
-	int i, j, x, y, z, t;
-	double  ax,ay,az,at,dx,dy,dz,dt;
-	float dTau;
-	float*** imageE;
-	float*** imageO;
-	int NBX,NBY,NBZ,NBT;
-	double dIdx,dIdy,dIdz;
-	float DivDgradI;
-	float *Va;
-	float *Vb; 
-	float *Vc;
-	float *Vd;
-	float *Vx;
-	int n;
-	int ITERATIONS_NB;
-	float Dxx_div_dxSq,Dyy_div_dySq,Dzz_div_dzSq;
-	int iteration;
-	float DivPowDxSqu,DivPowDySqu,DivPowDzSqu,DivPowDtSqu;
+	double contrast[4], spacing[4];
 	
 	//1) INITIALISATION
 	
@@ -63,193 +234,18 @@ template <class VoxelType> void anisoDiffusion<VoxelType>::Run_3D_semiImplicit()
 	this->Initialize();
 	
 	//variables definition
-	ax=this->ax;
-	ay=this->ay;
-	az=this->az;
-	at=this->at;
-	dx=this->dx;
-	dy=this->dy;
-	dz=this->dz;
-	dt=this->dt;
-	dTau=this->dTau;
-	ITERATIONS_NB=this->ITERATIONS_NB;
-	NBX=this->_input->GetX()+2;  //for boundary effects
-	NBY=this->_input->GetY()+2;  //for boundary effects
-	NBZ=this->_input->GetZ()+2;  //for boundary effects
-	NBT=this->_input->GetT();
-	cout << "Image size: " << (NBX-2) <<  " , "  <<  (NBY-2)  <<  " , "  << (NBZ-2)  <<  " , " << NBT  << " + boundaries \n";
-	
-	//temporary input and output images
-	imageE= (float***) malloc (NBZ*sizeof(float**));
-	for (i=0;i<NBZ;i++) imageE[i]= (float**) malloc (NBY*sizeof(float*));
-	for (i=0;i<NBZ;i++) for (j=0;j<NBY;j++) imageE[i][j]= (float*) malloc (NBX*sizeof(float));
+	contrast[0]=this->ax;
+	contrast[1]=this->ay;
+	contrast[2]=this->az;
+	contrast[3]=this->at;
+	spacing[0]=this->dx;
+	spacing[1]=this->dy;
+	spacing[2]=this->dz;
+	spacing[3]=this->dt;
+	cout << "Image size: " << this->_input->GetX() <<  " , "  <<  this->_input->GetY()  <<  " , "  << this->_input->GetZ()  <<  " , " << this->_input->GetT()  << "\n";
 	
-	imageO= (float***) malloc (NBZ*sizeof(float**));
-	for (i=0;i<NBZ;i++) imageO[i]= (float**) malloc (NBY*sizeof(float*));
-	for (i=0;i<NBZ;i++) for (j=0;j<NBY;j++) imageO[i][j]= (float*) malloc (NBX*sizeof(float));
-	
-	//precomputed values
-	DivPowDxSqu=1./pow(dx,2);
-	DivPowDySqu=1./pow(dy,2);
-	DivPowDzSqu=1./pow(dz,2);
-	DivPowDtSqu=1./pow(dt,2);
-	
-	//temporary variables dedicated to the semi implicit scheme (+4 is to avoid boundary effects)
-	n=max(max(max(NBX,NBY),NBZ),NBT)+4; //for boundary effects
-	Va=(float*)malloc(n*sizeof(float));
-	Vb=(float*)malloc(n*sizeof(float));
-	Vc=(float*)malloc(n*sizeof(float));
-	Vd=(float*)malloc(n*sizeof(float));
-	Vx=(float*)malloc(n*sizeof(float));
-
-	//2) ANISOTROPIC DIFFUSION
-	for (t = 0; t < NBT; t++) {
-		cout << "Image " << t+1 << " / " << NBT << "\n";
-		//2.1) convert the values of the input image at time t in double in a temporary 3D image
-		for (z = 0; z < NBZ-2; z++)  for (y = 0; y < NBY-2; y++) for (x = 0; x < NBX-2; x++)
-			imageE[z+1][y+1][x+1]=static_cast<float>(this->_input->Get(x, y, z, t));
-		
-		for (z = 0; z < NBZ-2; z++)  for (y = 0; y < NBY-2; y++) for (x = 0; x < NBX-2; x++)
-			imageO[z+1][y+1][x+1]=static_cast<float>(this->_input->Get(x, y, z, t));
-		
-		//image extension to avoid boundary effects
-		for (z = 0; z < NBZ; z++) for (y = 0; y < NBY; y++) imageE[z][y][0]=imageE[z][y][1];
-		for (z = 0; z < NBZ; z++) for (y = 0; y < NBY; y++) imageE[z][y][NBX-1]=imageE[z][y][NBX-2];
-		for (z = 0; z < NBZ; z++) for (y = 0; y < NBY; y++) imageO[z][y][0]=imageO[z][y][1];
-		for (z = 0; z < NBZ; z++) for (y = 0; y < NBY; y++) imageO[z][y][NBX-1]=imageO[z][y][NBX-2];
-		
-		for (z = 0; z < NBZ; z++) for (x = 0; x < NBX; x++) imageE[z][0][x]=imageE[z][1][x];
-		for (z = 0; z < NBZ; z++) for (x = 0; x < NBX; x++) imageE[z][NBY-1][x]=imageE[z][NBY-2][x];
-		for (z = 0; z < NBZ; z++) for (x = 0; x < NBX; x++) imageO[z][0][x]=imageO[z][1][x];
-		for (z = 0; z < NBZ; z++) for (x = 0; x < NBX; x++) imageO[z][NBY-1][x]=imageO[z][NBY-2][x];
-		
-		for (y = 0; y < NBY; y++) for (x = 0; x < NBX; x++) imageE[0][y][x]=imageE[1][y][x];
-		for (y = 0; y < NBY; y++) for (x = 0; x < NBX; x++) imageE[NBZ-1][y][x]=imageE[NBZ-2][y][x];
-		for (y = 0; y < NBY; y++) for (x = 0; x < NBX; x++) imageO[0][y][x]=imageO[1][y][x];
-		for (y = 0; y < NBY; y++) for (x = 0; x < NBX; x++) imageO[NBZ-1][y][x]=imageO[NBZ-2][y][x];
-		
-		//2.2) diffusion in the temporary 3D image - ADI semi implicit scheme
-		for (iteration=0 ; iteration<ITERATIONS_NB; iteration++){
-			cout << "| Iteration " << iteration+1 << " / " << ITERATIONS_NB << "\n";
-			
-			//2.2.2) diffusion - x implicit / y,z explicit
-			//2.2.2.1) explicit part
-			for (z = 1; z < NBZ-1; z++) for (y = 1; y < NBY-1; y++) for (x = 1; x < NBX-1; x++) {
-				dIdy=(imageE[z][y+1][x]-imageE[z][y-1][x])/(2*dy);
-				Dyy_div_dySq=static_cast<float>((1-exp(-3.314/pow((dIdy/ay),4)))*DivPowDySqu);
-				dIdz=(imageE[z+1][y][x]-imageE[z-1][y][x])/(2*dz);
-				Dzz_div_dzSq=static_cast<float>((1-exp(-3.314/pow((dIdz/az),4)))*DivPowDzSqu);
-				//new value of the voxel
-				DivDgradI=(imageE[z][y+1][x]-2*imageE[z][y][x]+imageE[z][y-1][x])*Dyy_div_dySq+
-					(imageE[z+1][y][x]-2*imageE[z][y][x]+imageE[z-1][y][x])*Dzz_div_dzSq;
-				
-				imageO[z][y][x]=imageE[z][y][x]+(dTau/3.)*DivDgradI;
-			}
-				
-			//2.2.2.2) implicit part
-			for (z = 1; z < NBZ-1; z++) for (y = 1; y < NBY-1; y++) {
-				for (x = 1; x < NBX-1; x++){
-					dIdx=(imageE[z][y][x+1]-imageE[z][y][x-1])/(2*dx);
-					Dxx_div_dxSq=static_cast<float>((1-exp(-3.314/pow((dIdx/ax),4)))*DivPowDxSqu);
-					Va[x+1]=(dTau/3.)*Dxx_div_dxSq;
-					Vb[x+1]=-1-2*(dTau/3.)*Dxx_div_dxSq;
-					Vc[x+1]=(dTau/3.)*Dxx_div_dxSq;
-                                        Vd[x+1]=imageE[z][y][x]; //why not imageO ???
-				}
-				Va[1]=Va[3]; Va[0]=Va[4]; Va[NBX]=Va[NBX-2]; Va[NBX+1]=Va[NBX-3]; //to avoid boundary effects
-				Vb[1]=Vb[3]; Vb[0]=Vb[4]; Vb[NBX]=Vb[NBX-2]; Vb[NBX+1]=Vb[NBX-3]; //to avoid boundary effects
-				Vc[1]=Vc[3]; Vc[0]=Vc[4]; Vc[NBX]=Vc[NBX-2]; Vc[NBX+1]=Vc[NBX-3]; //to avoid boundary effects
-				Vd[1]=Vd[3]; Vd[0]=Vd[4]; Vd[NBX]=Vd[NBX-2]; Vd[NBX+1]=Vd[NBX-3]; //to avoid boundary effects
-				TridiagonalSolveFloat(Va,Vb,Vc,Vd,Vx,NBX+2);
-				for (x = 1; x < NBX-1; x++) imageO[z][y][x]=-Vx[x+1];
-			}
-			
-			//2.2.3) diffusion - y implicit / x,z explicit
-			//2.2.3.1) explicit part
-			for (z = 1; z < NBZ-1; z++) for (y = 1; y < NBY-1; y++) for (x = 1; x < NBX-1; x++) {
-				dIdx=(imageO[z][y][x+1]-imageO[z][y][x-1])/(2*dx);
-				Dxx_div_dxSq=static_cast<float>((1-exp(-3.314/pow((dIdx/ax),4)))*DivPowDxSqu);
-				dIdz=(imageO[z+1][y][x]-imageO[z-1][y][x])/(2*dz);
-				Dzz_div_dzSq=static_cast<float>((1-exp(-3.314/pow((dIdz/az),4)))*DivPowDzSqu);
-				//new value of the voxel
-				DivDgradI=(imageO[z][y][x+1]-2*imageO[z][y][x]+imageO[z][y][x-1])*Dxx_div_dxSq+
-						(imageO[z+1][y][x]-2*imageO[z][y][x]+imageO[z-1][y][x])*Dzz_div_dzSq;
-				
-				imageE[z][y][x]=imageO[z][y][x]+(dTau/3.)*DivDgradI;
-			}
-			
-			//2.2.3.2) implicit part
-			for (z = 1; z < NBZ-1; z++) for (x = 1; x < NBX-1; x++){
-				for (y = 1; y < NBY-1; y++){
-					dIdy=(imageO[z][y+1][x]-imageO[z][y-1][x])/(2*dy);
-					Dyy_div_dySq=static_cast<float>((1-exp(-3.314/pow((dIdy/ay),4)))*DivPowDySqu);
-					Va[y+1]=(dTau/3.)*Dyy_div_dySq;
-					Vb[y+1]=-1-2*(dTau/3.)*Dyy_div_dySq;
-					Vc[y+1]=(dTau/3.)*Dyy_div_dySq;
-					Vd[y+1]=imageO[z][y][x];
-				}
-				Va[1]=Va[3]; Va[0]=Va[4]; Va[NBY]=Va[NBY-2]; Va[NBY+1]=Va[NBY-3]; //to avoid boundary effects
-				Vb[1]=Vb[3]; Vb[0]=Vb[4]; Vb[NBY]=Vb[NBY-2]; Vb[NBY+1]=Vb[NBY-3]; //to avoid boundary effects
-				Vc[1]=Vc[3]; Vc[0]=Vc[4]; Vc[NBY]=Vc[NBY-2]; Vc[NBY+1]=Vc[NBY-3]; //to avoid boundary effects
-				Vd[1]=Vd[3]; Vd[0]=Vd[4]; Vd[NBY]=Vd[NBY-2]; Vd[NBY+1]=Vd[NBY-3]; //to avoid boundary effects
-				TridiagonalSolveFloat(Va,Vb,Vc,Vd,Vx,NBY+2);
-				for (y = 1; y < NBY-1; y++) imageE[z][y][x]=-Vx[y+1];
-			}
-		
-			//2.2.4) diffusion - z implicit / x,y explicit
-			//2.2.4.1) explicit part
-			for (z = 1; z < NBZ-1; z++) for (y = 1; y < NBY-1; y++) for (x = 1; x < NBX-1; x++) {
-				dIdx=(imageE[z][y][x+1]-imageE[z][y][x-1])/(2*dx);
-				Dxx_div_dxSq=static_cast<float>((1-exp(-3.314/pow((dIdx/ax),4)))*DivPowDxSqu);
-				dIdy=(imageE[z][y+1][x]-imageE[z][y-1][x])/(2*dy);
-				Dyy_div_dySq=static_cast<float>((1-exp(-3.314/pow((dIdy/ay),4)))*DivPowDySqu);
-				//new value of the voxel
-				DivDgradI=(imageE[z][y][x+1]-2*imageE[z][y][x]+imageE[z][y][x-1])*Dxx_div_dxSq+
-					(imageE[z][y+1][x]-2*imageE[z][y][x]+imageE[z][y-1][x])*Dyy_div_dySq;
-					
-				imageO[z][y][x]=imageE[z][y][x]+(dTau/3.)*DivDgradI;
-			}
-			
-			//2.2.4.2) implicit part
-			for (y = 1; y < NBY-1; y++) for (x = 1; x < NBX-1; x++) {
-				for (z = 1; z < NBZ-1; z++){
-					dIdz=(imageE[z+1][y][x]-imageE[z-1][y][x])/(2*dz);
-					Dzz_div_dzSq=static_cast<float>((1-exp(-3.314/pow((dIdz/az),4)))*DivPowDzSqu);
-					Va[z+1]=(dTau/3.)*Dzz_div_dzSq;
-					Vb[z+1]=-1-2*(dTau/3.)*Dzz_div_dzSq;
-					Vc[z+1]=(dTau/3.)*Dzz_div_dzSq;
-					Vd[z+1]=imageE[z][y][x];
-				}
-				Va[1]=Va[3]; Va[0]=Va[4]; Va[NBZ]=Va[NBZ-2]; Va[NBZ+1]=Va[NBZ-3]; //to avoid boundary effects
-				Vb[1]=Vb[3]; Vb[0]=Vb[4]; Vb[NBZ]=Vb[NBZ-2]; Vb[NBZ+1]=Vb[NBZ-3]; //to avoid boundary effects
-				Vc[1]=Vc[3]; Vc[0]=Vc[4]; Vc[NBZ]=Vc[NBZ-2]; Vc[NBZ+1]=Vc[NBZ-3]; //to avoid boundary effects
-				Vd[1]=Vd[3]; Vd[0]=Vd[4]; Vd[NBZ]=Vd[NBZ-2]; Vd[NBZ+1]=Vd[NBZ-3]; //to avoid boundary effects
-				TridiagonalSolveFloat(Va,Vb,Vc,Vd,Vx,NBZ+2);
-				for (z = 1; z < NBZ-1; z++) imageO[z][y][x]=-Vx[z+1];
-			}
-			
-			/*for (y = 1; y < NBY-1; y++) for (x = 1; x < NBX-1; x++) {
-				for (z = 1; z < NBZ-1; z++){
-					dIdz=(imageE[z+1][y][x]-imageE[z-1][y][x])/(2*dz);
-					Dzz_div_dzSq=static_cast<float>((1-exp(-3.314/pow((dIdz/az),4)))*DivPowDzSqu);
-					Va[z-1]=(dTau/3.)*Dzz_div_dzSq;
-					Vb[z-1]=-1-2*(dTau/3.)*Dzz_div_dzSq;
-					Vc[z-1]=(dTau/3.)*Dzz_div_dzSq;
-					Vd[z-1]=imageE[z][y][x];
-				}
-				TridiagonalSolveFloat(Va,Vb,Vc,Vd,Vx,NBZ-2);
-				for (z = 1; z < NBZ-1; z++) imageO[z][y][x]=-Vx[z-1];
-			}*/
-		
-			//2.2.5) temporary output image is reinjected in temporary input image
-			for (z = 0; z < NBZ; z++) for (y = 0; y < NBY; y++) for (x = 0; x < NBX; x++)
-				imageE[z][y][x]=imageO[z][y][x];
-				
-		}
-		//2.3) save the filtered temporary 3D image in VoxelType in the  output image at time t
-		for (z = 0; z < NBZ-2; z++) for (y = 0; y < NBY-2; y++) for (x = 0; x < NBX-2; x++) 
-			this->_output->Put(x, y, z, t, static_cast<VoxelType>(imageE[z+1][y+1][x+1]));
-	}
+	//2) ANISOTROPIC DIFFUSION - ADI semi implicit scheme, each frame separately
+	DiffuseSemiImplicit(this->_input, this->_output, 3, contrast, spacing, this->dTau, this->ITERATIONS_NB);
 	
 	//3) END OF THE FUNCTION
 	// Do the final cleaning up
@@ -258,25 +254,9 @@ template <class VoxelType> void anisoDiffusion<VoxelType>::Run_3D_semiImplicit()
 
 
 
+
 template <class VoxelType> void anisoDiffusion<VoxelType>::Run_4D_semiImplicit(){
-	int i, j, x, y, z, t;
-	double  ax,ay,az,at,dx,dy,dz,dt;
-	float dTau;
-	float**** imageE;
-	float**** imageO;
-	int NBX,NBY,NBZ,NBT;
-	double dIdx,dIdy,dIdz,dIdt;
-	float DivDgradI;
-	float *Va;
-	float *Vb; 
-	float *Vc;
-	float *Vd;
-	float *Vx;
-	int n;
-	int ITERATIONS_NB;
-	float Dxx_div_dxSq,Dyy_div_dySq,Dzz_div_dzSq,Dtt_div_dtSq;
-	int iteration;
-	float DivPowDxSqu,DivPowDySqu,DivPowDzSqu,DivPowDtSqu;
+	double contrast[4], spacing[4];
 	
 	//1) INITIALISATION
 	
@@ -284,232 +264,22 @@ template <class VoxelType> void anisoDiffusion<VoxelType>::Run_4D_semiImplicit()
 	this->Initialize();
 	
 	//variables definition
-	ax=this->ax;
-	ay=this->ay;
-	az=this->az;
-	at=this->at;
-	dx=this->dx;
-	dy=this->dy;
-	dz=this->dz;
-	dt=this->dt;
-	dTau=this->dTau;
-	ITERATIONS_NB=this->ITERATIONS_NB;
-	NBX=this->_input->GetX()+2;
-	NBY=this->_input->GetY()+2;
-	NBZ=this->_input->GetZ()+2;
-	NBT=this->_input->GetT()+2;
-	cout << "Image size: " << (NBX-2) <<  " , "  <<  (NBY-2)  <<  " , "  << (NBZ-2)  <<  " , " << (NBT-2)  << " + boundaries \n";
-	
-	//temporary input and output images
-	imageE= (float****) malloc (NBT*sizeof(float***));
-	for (t=0;t<NBT;t++) imageE[t]= (float***) malloc (NBZ*sizeof(float**));
-	for (t=0;t<NBT;t++) for (i=0;i<NBZ;i++) imageE[t][i]= (float**) malloc (NBY*sizeof(float*));
-	for (t=0;t<NBT;t++) for (i=0;i<NBZ;i++) for (j=0;j<NBY;j++) imageE[t][i][j]= (float*) malloc (NBX*sizeof(float));
-	
-	imageO= (float****) malloc (NBT*sizeof(float***));
-	for (t=0;t<NBT;t++) imageO[t]= (float***) malloc (NBZ*sizeof(float**));
-	for (t=0;t<NBT;t++) for (i=0;i<NBZ;i++) imageO[t][i]= (float**) malloc (NBY*sizeof(float*));
-	for (t=0;t<NBT;t++) for (i=0;i<NBZ;i++) for (j=0;j<NBY;j++) imageO[t][i][j]= (float*) malloc (NBX*sizeof(float));
-	
-	//precomputed values
-	DivPowDxSqu=1./pow(dx,2);
-	DivPowDySqu=1./pow(dy,2);
-	DivPowDzSqu=1./pow(dz,2);
-	DivPowDtSqu=1./pow(dt,2);
-	
-	//temporary variables dedicated to the semi implicit scheme
-	n=max(max(max(NBX,NBY),NBZ),NBT)+4; //for boundary effects
-	Va=(float*)malloc(n*sizeof(float));
-	Vb=(float*)malloc(n*sizeof(float));
-	Vc=(float*)malloc(n*sizeof(float));
-	Vd=(float*)malloc(n*sizeof(float));
-	Vx=(float*)malloc(n*sizeof(float));
-
-	//2) ANISOTROPIC DIFFUSION
-		
-	//2.1) convert the values of the input image at time t in double in a temporary 3D image
-	for (t = 0; t < NBT-2; t++) for (z = 0; z < NBZ-2; z++)  for (y = 0; y < NBY-2; y++) for (x = 0; x < NBX-2; x++)
-		imageE[t+1][z+1][y+1][x+1]=static_cast<float>(this->_input->Get(x, y, z, t));
-	
-	for (t = 0; t < NBT-2; t++) for (z = 0; z < NBZ-2; z++)  for (y = 0; y < NBY-2; y++) for (x = 0; x < NBX-2; x++)
-		imageO[t+1][z+1][y+1][x+1]=static_cast<float>(this->_input->Get(x, y, z, t));
-	
-	for (t = 0; t < NBT; t++)  for (z = 0; z < NBZ; z++) for (y = 0; y < NBY; y++) imageE[t][z][y][0]=imageE[t][z][y][1];
-	for (t = 0; t < NBT; t++)  for (z = 0; z < NBZ; z++) for (y = 0; y < NBY; y++) imageE[t][z][y][NBX-1]=imageE[t][z][y][NBX-2];
-	for (t = 0; t < NBT; t++)  for (z = 0; z < NBZ; z++) for (y = 0; y < NBY; y++) imageO[t][z][y][0]=imageO[t][z][y][1];
-	for (t = 0; t < NBT; t++)  for (z = 0; z < NBZ; z++) for (y = 0; y < NBY; y++) imageO[t][z][y][NBX-1]=imageO[t][z][y][NBX-2];
-	
-	for (t = 0; t < NBT; t++)  for (z = 0; z < NBZ; z++) for (x = 0; x < NBX; x++) imageE[t][z][0][x]=imageE[t][z][1][x];
-	for (t = 0; t < NBT; t++)  for (z = 0; z < NBZ; z++) for (x = 0; x < NBX; x++) imageE[t][z][NBY-1][x]=imageE[t][z][NBY-2][x];
-	for (t = 0; t < NBT; t++)  for (z = 0; z < NBZ; z++) for (x = 0; x < NBX; x++) imageO[t][z][0][x]=imageO[t][z][1][x];
-	for (t = 0; t < NBT; t++)  for (z = 0; z < NBZ; z++) for (x = 0; x < NBX; x++) imageO[t][z][NBY-1][x]=imageO[t][z][NBY-2][x];
-	
-	
-	for (t = 0; t < NBT; t++)  for (y = 0; y < NBY; y++) for (x = 0; x < NBX; x++) imageE[t][0][y][x]=imageE[t][1][y][x];
-	for (t = 0; t < NBT; t++)  for (y = 0; y < NBY; y++) for (x = 0; x < NBX; x++) imageE[t][NBZ-1][y][x]=imageE[t][NBZ-2][y][x];
-	for (t = 0; t < NBT; t++)  for (y = 0; y < NBY; y++) for (x = 0; x < NBX; x++) imageO[t][0][y][x]=imageO[t][1][y][x];
-	for (t = 0; t < NBT; t++)  for (y = 0; y < NBY; y++) for (x = 0; x < NBX; x++) imageO[t][NBZ-1][y][x]=imageO[t][NBZ-2][y][x];
-
-	for (z = 0; z < NBZ; z++)  for (y = 0; y < NBY; y++) for (x = 0; x < NBX; x++) imageE[0][z][y][x]=imageE[0][z][y][x];
-	for (z = 0; z < NBZ; z++)  for (y = 0; y < NBY; y++) for (x = 0; x < NBX; x++) imageE[NBT-1][z][y][x]=imageE[NBT-1][z][y][x];
-	for (z = 0; z < NBZ; z++)  for (y = 0; y < NBY; y++) for (x = 0; x < NBX; x++) imageO[0][z][y][x]=imageO[0][z][y][x];
-	for (z = 0; z < NBZ; z++)  for (y = 0; y < NBY; y++) for (x = 0; x < NBX; x++) imageO[NBT-1][z][y][x]=imageO[NBT-1][z][y][x];
-
-	
-	//2.2) DIFFUSION
-	//2.2) diffusion in the temporary 4D image - ADI semi implicit scheme
-	for (iteration=0 ; iteration<ITERATIONS_NB; iteration++){
-		cout << "| Iteration " << iteration+1 << " / " << ITERATIONS_NB << "\n";
-		
-		//2.2.1) diffusion - x implicit / y,z,t explicit
-		//2.2.1.1) explicit part
-		for (t = 1; t < NBT-1; t++) for (z = 1; z < NBZ-1; z++) for (y = 1; y < NBY-1; y++) for (x = 1; x < NBX-1; x++) {
-			dIdy=(imageE[t][z][y+1][x]-imageE[t][z][y-1][x])/(2*dy);
-			Dyy_div_dySq=static_cast<float>((1-exp(-3.314/pow((dIdy/ay),4)))*DivPowDySqu);
-			dIdz=(imageE[t][z+1][y][x]-imageE[t][z-1][y][x])/(2*dz);
-			Dzz_div_dzSq=static_cast<float>((1-exp(-3.314/pow((dIdz/az),4)))*DivPowDzSqu);
-			dIdt=(imageE[t+1][z][y][x]-imageE[t-1][z][y][x])/(2*dt);
-			Dtt_div_dtSq=static_cast<float>((1-exp(-3.314/pow((dIdt/at),4)))*DivPowDzSqu);
-			//new value of the voxel
-			DivDgradI=(imageE[t][z][y+1][x]-2*imageE[t][z][y][x]+imageE[t][z][y-1][x])*Dyy_div_dySq+
-					(imageE[t][z+1][y][x]-2*imageE[t][z][y][x]+imageE[t][z-1][y][x])*Dzz_div_dzSq+
-					(imageE[t+1][z][y][x]-2*imageE[t][z][y][x]+imageE[t-1][z][y][x])*Dtt_div_dtSq;
-
-			imageO[t][z][y][x]=imageE[t][z][y][x]+(dTau/4.)*DivDgradI;
-		}
-		
-		//2.2.1.2) implicit part
-		for (t = 1; t < NBT-1; t++) for (z = 1; z < NBZ-1; z++) for (y = 1; y < NBY-1; y++) {
-			for (x = 1; x < NBX-1; x++){
-				dIdx=(imageE[t][z][y][x+1]-imageE[t][z][y][x-1])/(2*dx);
-				Dxx_div_dxSq=static_cast<float>((1-exp(-3.314/pow((dIdx/ax),4)))*DivPowDxSqu);
-				Va[x+1]=(dTau/4.)*Dxx_div_dxSq;
-				Vb[x+1]=-1-2*(dTau/4.)*Dxx_div_dxSq;
-				Vc[x+1]=(dTau/4.)*Dxx_div_dxSq;
-				Vd[x+1]=imageE[t][z][y][x];
-			}
-			Va[1]=Va[3]; Va[0]=Va[4]; Va[NBX]=Va[NBX-2]; Va[NBX+1]=Va[NBX-3]; //to avoid boundary effects
-			Vb[1]=Vb[3]; Vb[0]=Vb[4]; Vb[NBX]=Vb[NBX-2]; Vb[NBX+1]=Vb[NBX-3]; //to avoid boundary effects
-			Vc[1]=Vc[3]; Vc[0]=Vc[4]; Vc[NBX]=Vc[NBX-2]; Vc[NBX+1]=Vc[NBX-3]; //to avoid boundary effects
-			Vd[1]=Vd[3]; Vd[0]=Vd[4]; Vd[NBX]=Vd[NBX-2]; Vd[NBX+1]=Vd[NBX-3]; //to avoid boundary effects
-			TridiagonalSolveFloat(Va,Vb,Vc,Vd,Vx,NBX+2);
-			for (x = 1; x < NBX-1; x++) imageO[t][z][y][x]=-Vx[x+1];
-		}
-		
-		//2.2.2) diffusion - y implicit / x,z,t explicit
-		//2.2.2.1) explicit part
-		for (t = 1; t < NBT-1; t++) for (z = 1; z < NBZ-1; z++) for (y = 1; y < NBY-1; y++) for (x = 1; x < NBX-1; x++) {
-			dIdx=(imageO[t][z][y][x+1]-imageO[t][z][y][x-1])/(2*dx);
-			Dxx_div_dxSq=static_cast<float>((1-exp(-3.314/pow((dIdx/ax),4)))*DivPowDxSqu);
-			dIdz=(imageO[t][z+1][y][x]-imageO[t][z-1][y][x])/(2*dz);
-			Dzz_div_dzSq=static_cast<float>((1-exp(-3.314/pow((dIdz/az),4)))*DivPowDzSqu);
-			dIdt=(imageO[t+1][z][y][x]-imageO[t-1][z][y][x])/(2*dt);
-			Dtt_div_dtSq=static_cast<float>((1-exp(-3.314/pow((dIdt/at),4)))*DivPowDzSqu);
-			//new value of the voxel
-			DivDgradI=(imageO[t][z][y][x+1]-2*imageO[t][z][y][x]+imageO[t][z][y][x-1])*Dxx_div_dxSq+
-					(imageO[t][z+1][y][x]-2*imageO[t][z][y][x]+imageO[t][z-1][y][x])*Dzz_div_dzSq+
-					(imageO[t+1][z][y][x]-2*imageO[t][z][y][x]+imageO[t-1][z][y][x])*Dtt_div_dtSq;
-			
-			imageE[t][z][y][x]=imageO[t][z][y][x]+(dTau/4.)*DivDgradI;
-		}
-		
-		//2.2.2.2) implicit part
-		for (t = 1; t < NBT-1; t++) for (z = 1; z < NBZ-1; z++) for (x = 1; x < NBX-1; x++){
-			for (y = 1; y < NBY-1; y++){
-				dIdy=(imageO[t][z][y+1][x]-imageO[t][z][y-1][x])/(2*dy);
-				Dyy_div_dySq=static_cast<float>((1-exp(-3.314/pow((dIdy/ay),4)))*DivPowDySqu);
-				Va[y+1]=(dTau/4.)*Dyy_div_dySq;
-				Vb[y+1]=-1-2*(dTau/4.)*Dyy_div_dySq;
-				Vc[y+1]=(dTau/4.)*Dyy_div_dySq;
-				Vd[y+1]=imageO[t][z][y][x];
-			}
-			Va[1]=Va[3]; Va[0]=Va[4]; Va[NBY]=Va[NBY-2]; Va[NBY+1]=Va[NBY-3]; //to avoid boundary effects
-			Vb[1]=Vb[3]; Vb[0]=Vb[4]; Vb[NBY]=Vb[NBY-2]; Vb[NBY+1]=Vb[NBY-3]; //to avoid boundary effects
-			Vc[1]=Vc[3]; Vc[0]=Vc[4]; Vc[NBY]=Vc[NBY-2]; Vc[NBY+1]=Vc[NBY-3]; //to avoid boundary effects
-			Vd[1]=Vd[3]; Vd[0]=Vd[4]; Vd[NBY]=Vd[NBY-2]; Vd[NBY+1]=Vd[NBY-3]; //to avoid boundary effects
-			TridiagonalSolveFloat(Va,Vb,Vc,Vd,Vx,NBY+2);
-			for (y = 1; y < NBY-1; y++) imageE[t][z][y][x]=-Vx[y+1];
-		}
-	
-		//2.2.3) diffusion - z implicit / x,y,t explicit
-		//2.2.3.1) explicit part
-		for (t = 1; t < NBT-1; t++) for (z = 1; z < NBZ-1; z++) for (y = 1; y < NBY-1; y++) for (x = 1; x < NBX-1; x++) {
-			dIdx=(imageE[t][z][y][x+1]-imageE[t][z][y][x-1])/(2*dx);
-			Dxx_div_dxSq=static_cast<float>((1-exp(-3.314/pow((dIdx/ax),4)))*DivPowDxSqu);
-			dIdy=(imageE[t][z][y+1][x]-imageE[t][z][y-1][x])/(2*dy);
-			Dyy_div_dySq=static_cast<float>((1-exp(-3.314/pow((dIdy/ay),4)))*DivPowDySqu);
-			dIdt=(imageE[t+1][z][y][x]-imageE[t-1][z][y][x])/(2*dt);
-			Dtt_div_dtSq=static_cast<float>((1-exp(-3.314/pow((dIdt/at),4)))*DivPowDzSqu);
-			//new value of the voxel
-			DivDgradI=(imageE[t][z][y][x+1]-2*imageE[t][z][y][x]+imageE[t][z][y][x-1])*Dxx_div_dxSq+
-					(imageE[t][z][y+1][x]-2*imageE[t][z][y][x]+imageE[t][z][y-1][x])*Dyy_div_dySq+
-					(imageE[t+1][z][y][x]-2*imageE[t][z][y][x]+imageE[t-1][z][y][x])*Dtt_div_dtSq;
-	
-			imageO[t][z][y][x]=imageE[t][z][y][x]+(dTau/4.)*DivDgradI;
-		}
-		
-		//2.2.3.2) implicit part
-		for (t = 1; t < NBT-1; t++) for (y = 1; y < NBY-1; y++) for (x = 1; x < NBX-1; x++) {
-			for (z = 1; z < NBZ-1; z++){
-				dIdz=(imageE[t][z+1][y][x]-imageE[t][z-1][y][x])/(2*dz);
-				Dzz_div_dzSq=static_cast<float>((1-exp(-3.314/pow((dIdz/az),4)))*DivPowDzSqu);
-				Va[z+1]=(dTau/4.)*Dzz_div_dzSq;
-				Vb[z+1]=-1-2*(dTau/4.)*Dzz_div_dzSq;
-				Vc[z+1]=(dTau/4.)*Dzz_div_dzSq;
-				Vd[z+1]=imageE[t][z][y][x];
-			}
-			Va[1]=Va[3]; Va[0]=Va[4]; Va[NBZ]=Va[NBZ-2]; Va[NBZ+1]=Va[NBZ-3]; //to avoid boundary effects
-			Vb[1]=Vb[3]; Vb[0]=Vb[4]; Vb[NBZ]=Vb[NBZ-2]; Vb[NBZ+1]=Vb[NBZ-3]; //to avoid boundary effects
-			Vc[1]=Vc[3]; Vc[0]=Vc[4]; Vc[NBZ]=Vc[NBZ-2]; Vc[NBZ+1]=Vc[NBZ-3]; //to avoid boundary effects
-			Vd[1]=Vd[3]; Vd[0]=Vd[4]; Vd[NBZ]=Vd[NBZ-2]; Vd[NBZ+1]=Vd[NBZ-3]; //to avoid boundary effects
-			TridiagonalSolveFloat(Va,Vb,Vc,Vd,Vx,NBZ+2);
-			for (z = 1; z < NBZ-1; z++) imageO[t][z][y][x]=-Vx[z+1];
-		}
-		
-		//2.2.4) diffusion - t implicit / x,y,z explicit
-		//2.2.4.1) explicit part
-		for (t = 1; t < NBT-1; t++) for (z = 1; z < NBZ-1; z++) for (y = 1; y < NBY-1; y++) for (x = 1; x < NBX-1; x++) {
-			dIdx=(imageO[t][z][y][x+1]-imageO[t][z][y][x-1])/(2*dx);
-			Dxx_div_dxSq=static_cast<float>((1-exp(-3.314/pow((dIdx/ax),4)))*DivPowDxSqu);
-			dIdy=(imageO[t][z][y+1][x]-imageO[t][z][y-1][x])/(2*dy);
-			Dyy_div_dySq=static_cast<float>((1-exp(-3.314/pow((dIdy/ay),4)))*DivPowDySqu);
-			dIdz=(imageO[t][z+1][y][x]-imageO[t][z-1][y][x])/(2*dz);
-			Dzz_div_dzSq=static_cast<float>((1-exp(-3.314/pow((dIdz/az),4)))*DivPowDzSqu);
-			//new value of the voxel
-			DivDgradI=(imageO[t][z][y][x+1]-2*imageO[t][z][y][x]+imageO[t][z][y][x-1])*Dxx_div_dxSq+
-					(imageO[t][z][y+1][x]-2*imageO[t][z][y][x]+imageO[t][z][y-1][x])*Dyy_div_dySq+
-					(imageO[t][z+1][y][x]-2*imageO[t][z][y][x]+imageO[t][z-1][y][x])*Dzz_div_dzSq;
-	
-			imageE[t][z][y][x]=imageO[t][z][y][x]+(dTau/4.)*DivDgradI;
-		}
-		
-		//2.2.4.2) implicit part
-		for (z = 1; z < NBZ-1; z++) for (y = 1; y < NBY-1; y++) for (x = 1; x < NBX-1; x++) {
-			for (t = 1; t < NBT-1; t++){
-				dIdt=(imageO[t+1][z][y][x]-imageO[t-1][z][y][x])/(2*dt);
-				Dtt_div_dtSq=static_cast<float>((1-exp(-3.314/pow((dIdt/at),4)))*DivPowDzSqu);
-				Va[t+1]=(dTau/4.)*Dtt_div_dtSq;
-				Vb[t+1]=-1-2*(dTau/4.)*Dtt_div_dtSq;
-				Vc[t+1]=(dTau/4.)*Dtt_div_dtSq;
-				Vd[t+1]=imageO[t][z][y][x];
-			}
-			Va[1]=Va[3]; Va[0]=Va[4]; Va[NBT]=Va[NBT-2]; Va[NBT+1]=Va[NBT-3]; //to avoid boundary effects
-			Vb[1]=Vb[3]; Vb[0]=Vb[4]; Vb[NBT]=Vb[NBT-2]; Vb[NBT+1]=Vb[NBT-3]; //to avoid boundary effects
-			Vc[1]=Vc[3]; Vc[0]=Vc[4]; Vc[NBT]=Vc[NBT-2]; Vc[NBT+1]=Vc[NBT-3]; //to avoid boundary effects
-			Vd[1]=Vd[3]; Vd[0]=Vd[4]; Vd[NBT]=Vd[NBT-2]; Vd[NBT+1]=Vd[NBT-3]; //to avoid boundary effects
-			TridiagonalSolveFloat(Va,Vb,Vc,Vd,Vx,NBT+2);
-			for (t = 1; t < NBT-1; t++) imageE[t][z][y][x]=-Vx[t+1];
-		}
-	}
-	
-	//2.3) save the filtered temporary 3D image in VoxelType in the  output image at time t
-	for (t = 0; t < NBT-2; t++) for (z = 0; z < NBZ-2; z++) for (y = 0; y < NBY-2; y++) for (x = 0; x < NBX-2; x++) 
-		this->_output->Put(x, y, z, t, static_cast<VoxelType>(imageE[t+1][z+1][y+1][x+1]));
+	contrast[0]=this->ax;
+	contrast[1]=this->ay;
+	contrast[2]=this->az;
+	contrast[3]=this->at;
+	spacing[0]=this->dx;
+	spacing[1]=this->dy;
+	spacing[2]=this->dz;
+	spacing[3]=this->dt;
+	cout << "Image size: " << this->_input->GetX() <<  " , "  <<  this->_input->GetY()  <<  " , "  << this->_input->GetZ()  <<  " , " << this->_input->GetT()  << "\n";
 	
+	//2) ANISOTROPIC DIFFUSION - ADI semi implicit scheme, including time
+	DiffuseSemiImplicit(this->_input, this->_output, 4, contrast, spacing, this->dTau, this->ITERATIONS_NB);
 	
 	//3) END OF THE FUNCTION
 	// Do the final cleaning up
-	this->Finalize();	
+	this->Finalize();
 }
 
 
@@ -0,0 +1,551 @@
+/* The Image Registration Toolkit (IRTK)
+ *
+ * Copyright 2008-2015 Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#include <irtkImage.h>
+#include <irtkConnectedComponents.h>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+
+// =============================================================================
+// Auxiliary functions and functors
+// =============================================================================
+
+namespace irtkConnectedComponentsUtils {
+
+// -----------------------------------------------------------------------------
+/// Offset of neighbouring voxel which precedes a voxel in raster order
+struct NeighbourOffset
+{
+  int _X, _Y, _Z;
+};
+
+// -----------------------------------------------------------------------------
+/// Neighbours preceding a voxel in raster order for given connectivity
+void PrecedingNeighbours(irtkConnectivityType connectivity, vector<NeighbourOffset> &offsets)
+{
+  int maxl1;
+  switch (connectivity) {
+    case CONNECTIVITY_04: maxl1 = 1; break;
+    case CONNECTIVITY_06: maxl1 = 1; break;
+    case CONNECTIVITY_18: maxl1 = 2; break;
+    case CONNECTIVITY_26: maxl1 = 3; break;
+    default:
+      cerr << "irtkConnectedComponents: Invalid connectivity: " << connectivity << endl;
+      exit(1);
+  }
+  offsets.clear();
+  NeighbourOffset offset;
+  for (offset._Z = -1; offset._Z <= 0; ++offset._Z)
+  for (offset._Y = -1; offset._Y <= 1; ++offset._Y)
+  for (offset._X = -1; offset._X <= 1; ++offset._X) {
+    if (offset._Z == 0 && (offset._Y > 0 || (offset._Y == 0 && offset._X >= 0))) continue;
+    if (connectivity == CONNECTIVITY_04 && offset._Z != 0) continue;
+    if (abs(offset._X) + abs(offset._Y) + abs(offset._Z) > maxl1) continue;
+    offsets.push_back(offset);
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Find root of disjoint set and compress path
+inline int Find(int *parent, int i)
+{
+  int root = i;
+  while (parent[root] != root) root = parent[root];
+  while (parent[i] != root) {
+    const int next = parent[i];
+    parent[i] = root;
+    i = next;
+  }
+  return root;
+}
+
+// -----------------------------------------------------------------------------
+/// Find root of disjoint set without modification
+inline int FindRoot(const int *parent, int i)
+{
+  while (parent[i] != i) i = parent[i];
+  return i;
+}
+
+// -----------------------------------------------------------------------------
+/// Unite disjoint sets, where the root with smaller index becomes the new root
+inline void Union(int *parent, int i, int j)
+{
+  i = Find(parent, i);
+  j = Find(parent, j);
+  if      (i < j) parent[j] = i;
+  else if (j < i) parent[i] = j;
+}
+
+// -----------------------------------------------------------------------------
+/// Statistics of component without any voxels
+inline irtkConnectedComponent EmptyComponent()
+{
+  irtkConnectedComponent c;
+  c._Size = 0;
+  c._X1 = c._Y1 = c._Z1 = numeric_limits<int>::max();
+  c._X2 = c._Y2 = c._Z2 = -1;
+  return c;
+}
+
+// -----------------------------------------------------------------------------
+/// Add voxel to statistics of component
+inline void AddVoxel(irtkConnectedComponent &c, int x, int y, int z)
+{
+  c._Size += 1;
+  if (x < c._X1) c._X1 = x;
+  if (y < c._Y1) c._Y1 = y;
+  if (z < c._Z1) c._Z1 = z;
+  if (x > c._X2) c._X2 = x;
+  if (y > c._Y2) c._Y2 = y;
+  if (z > c._Z2) c._Z2 = z;
+}
+
+// -----------------------------------------------------------------------------
+/// Merge statistics of part of a component
+inline void MergeComponent(irtkConnectedComponent &q, const irtkConnectedComponent &p)
+{
+  q._Size += p._Size;
+  q._X1 = min(q._X1, p._X1), q._Y1 = min(q._Y1, p._Y1), q._Z1 = min(q._Z1, p._Z1);
+  q._X2 = max(q._X2, p._X2), q._Y2 = max(q._Y2, p._Y2), q._Z2 = max(q._Z2, p._Z2);
+}
+
+// -----------------------------------------------------------------------------
+/// Connected component labelling of one chunk
+struct LabelChunk
+{
+  const char                     *_Mask;       ///< Foreground mask of all chunks
+  int                            *_Parent;     ///< Disjoint sets of all chunks
+  int                            *_Labels;     ///< Labels of all chunks
+  vector<vector<irtkConnectedComponent> > *_Components;
+  const vector<NeighbourOffset>  *_Offsets;
+  int                             _X, _Y, _Z;  ///< Size of chunk
+  int                             _ChunksPerFrame;
+
+  // ---------------------------------------------------------------------------
+  /// Attributes of one chunk shared by the slab functors
+  struct Chunk
+  {
+    const char                    *_Mask;
+    int                           *_Parent;
+    int                           *_Labels;
+    const vector<NeighbourOffset> *_Offsets;
+    int                            _X, _Y, _Z;
+    int                            _FirstSlice;        ///< Image z index of first slice
+    int                            _PlaneSize;         ///< Voxels per slab plane
+    int                            _NumberOfPlanes;    ///< Number of slab planes
+    int                            _NumberOfSlabs;
+    vector<int>                    _FirstLabel;        ///< First label of each slab
+    vector<irtkConnectedComponent> *_Components;       ///< Statistics of all components
+    vector<vector<int> >           _ForeignLabels;     ///< Labels of components rooted in preceding slabs
+    vector<vector<irtkConnectedComponent> > _Foreign;  ///< Partial statistics of these components
+
+    int Begin(int b) const
+    {
+      const int plane = static_cast<int>(static_cast<long>(_NumberOfPlanes) * b / _NumberOfSlabs);
+      return plane * _PlaneSize;
+    }
+
+    int End(int b) const
+    {
+      return Begin(b + 1);
+    }
+
+    /// Unite voxel with preceding foreground neighbours at index >= begin
+    void UniteWithNeighbours(int idx, int begin) const
+    {
+      const int x = idx % _X;
+      const int y = (idx / _X) % _Y;
+      const int z = idx / (_X * _Y);
+      for (size_t n = 0; n < _Offsets->size(); ++n) {
+        const NeighbourOffset &o = (*_Offsets)[n];
+        const int i = x + o._X, j = y + o._Y, k = z + o._Z;
+        if (i < 0 || i >= _X || j < 0 || j >= _Y || k < 0) continue;
+        const int nbr = (k * _Y + j) * _X + i;
+        if (nbr >= begin && _Mask[nbr]) Union(_Parent, idx, nbr);
+      }
+    }
+  };
+
+  // ---------------------------------------------------------------------------
+  /// First pass over each slab, uniting neighbours within the slab
+  struct ScanSlabs
+  {
+    Chunk *_Chunk;
+
+    void operator ()(const blocked_range<int> &re) const
+    {
+      for (int b = re.begin(); b != re.end(); ++b) {
+        const int begin = _Chunk->Begin(b), end = _Chunk->End(b);
+        for (int idx = begin; idx < end; ++idx) {
+          _Chunk->_Parent[idx] = idx;
+        }
+        for (int idx = begin; idx < end; ++idx) {
+          if (_Chunk->_Mask[idx]) _Chunk->UniteWithNeighbours(idx, begin);
+        }
+      }
+    }
+  };
+
+  // ---------------------------------------------------------------------------
+  /// Count roots of each slab
+  struct CountRoots
+  {
+    Chunk *_Chunk;
+
+    void operator ()(const blocked_range<int> &re) const
+    {
+      for (int b = re.begin(); b != re.end(); ++b) {
+        int n = 0;
+        for (int idx = _Chunk->Begin(b); idx < _Chunk->End(b); ++idx) {
+          if (_Chunk->_Mask[idx] && _Chunk->_Parent[idx] == idx) ++n;
+        }
+        _Chunk->_FirstLabel[b + 1] = n;
+      }
+    }
+  };
+
+  // ---------------------------------------------------------------------------
+  /// Number roots consecutively in raster order
+  struct LabelRoots
+  {
+    Chunk *_Chunk;
+
+    void operator ()(const blocked_range<int> &re) const
+    {
+      for (int b = re.begin(); b != re.end(); ++b) {
+        int label = _Chunk->_FirstLabel[b];
+        for (int idx = _Chunk->Begin(b); idx < _Chunk->End(b); ++idx) {
+          if (_Chunk->_Mask[idx] && _Chunk->_Parent[idx] == idx) _Chunk->_Labels[idx] = ++label;
+        }
+      }
+    }
+  };
+
+  // ---------------------------------------------------------------------------
+  /// Second pass assigning labels of roots and collecting statistics
+  ///
+  /// The statistics of components whose root lies within a slab are written
+  /// directly to the disjoint range of labels of this slab. Components rooted
+  /// in a preceding slab are accumulated sparsely and merged afterwards.
+  struct ResolveLabels
+  {
+    Chunk *_Chunk;
+
+    void operator ()(const blocked_range<int> &re) const
+    {
+      const int nx = _Chunk->_X, ny = _Chunk->_Y;
+      vector<irtkConnectedComponent> &all = *_Chunk->_Components;
+      irtkConnectedComponent *components = (all.empty() ? NULL : &all[0]);
+      for (int b = re.begin(); b != re.end(); ++b) {
+        const int first = _Chunk->_FirstLabel[b];
+        const int last  = _Chunk->_FirstLabel[b + 1];
+        for (int l = first; l < last; ++l) components[l] = EmptyComponent();
+        vector<int>                    &foreign_labels = _Chunk->_ForeignLabels[b];
+        vector<irtkConnectedComponent> &foreign        = _Chunk->_Foreign[b];
+        map<int, int>                   foreign_index;
+        int prev_label = 0, prev_index = -1;
+        foreign_labels.clear();
+        foreign       .clear();
+        for (int idx = _Chunk->Begin(b); idx < _Chunk->End(b); ++idx) {
+          if (!_Chunk->_Mask[idx]) {
+            _Chunk->_Labels[idx] = 0;
+            continue;
+          }
+          int label;
+          if (_Chunk->_Parent[idx] == idx) {
+            label = _Chunk->_Labels[idx];
+          } else {
+            // Roots are only written by LabelRoots
+            label = _Chunk->_Labels[FindRoot(_Chunk->_Parent, idx)];
+            _Chunk->_Labels[idx] = label;
+          }
+          const int x = idx % nx, y = (idx / nx) % ny, z = idx / (nx * ny) + _Chunk->_FirstSlice;
+          if (label > first) {
+            AddVoxel(components[label - 1], x, y, z);
+          } else {
+            if (label != prev_label) {
+              map<int, int>::iterator it = foreign_index.find(label);
+              if (it == foreign_index.end()) {
+                it = foreign_index.insert(make_pair(label, static_cast<int>(foreign.size()))).first;
+                foreign_labels.push_back(label);
+                foreign       .push_back(EmptyComponent());
+              }
+              prev_label = label;
+              prev_index = it->second;
+            }
+            AddVoxel(foreign[prev_index], x, y, z);
+          }
+        }
+      }
+    }
+  };
+
+  // ---------------------------------------------------------------------------
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int n = _X * _Y * _Z;
+    for (int c = re.begin(); c != re.end(); ++c) {
+      Chunk chunk;
+      chunk._Mask    = _Mask   + c * n;
+      chunk._Parent  = _Parent + c * n;
+      chunk._Labels  = _Labels + c * n;
+      chunk._Offsets = _Offsets;
+      chunk._X       = _X;
+      chunk._Y       = _Y;
+      chunk._Z       = _Z;
+      chunk._FirstSlice = (c % _ChunksPerFrame) * _Z;
+      if (_Z > 1) {
+        chunk._PlaneSize      = _X * _Y;
+        chunk._NumberOfPlanes = _Z;
+      } else {
+        chunk._PlaneSize      = _X;
+        chunk._NumberOfPlanes = _Y;
+      }
+      chunk._NumberOfSlabs = NumberOfThreads();
+      if (chunk._NumberOfSlabs > chunk._NumberOfPlanes) chunk._NumberOfSlabs = chunk._NumberOfPlanes;
+      const blocked_range<int> slabs(0, chunk._NumberOfSlabs, 1);
+
+      // First pass within slabs
+      ScanSlabs scan;
+      scan._Chunk = &chunk;
+      parallel_for(slabs, scan);
+
+      // Merge sets across slab boundaries
+      for (int b = 1; b < chunk._NumberOfSlabs; ++b) {
+        const int begin = chunk.Begin(b);
+        const int end   = min(begin + chunk._PlaneSize, chunk.End(b));
+        for (int idx = begin; idx < end; ++idx) {
+          if (chunk._Mask[idx]) chunk.UniteWithNeighbours(idx, 0);
+        }
+      }
+
+      // Number components in raster order of their first voxel
+      chunk._FirstLabel.resize(chunk._NumberOfSlabs + 1);
+      chunk._FirstLabel[0] = 0;
+      CountRoots count;
+      count._Chunk = &chunk;
+      parallel_for(slabs, count);
+      for (int b = 1; b <= chunk._NumberOfSlabs; ++b) {
+        chunk._FirstLabel[b] += chunk._FirstLabel[b - 1];
+      }
+      LabelRoots number;
+      number._Chunk = &chunk;
+      parallel_for(slabs, number);
+
+      // Second pass
+      vector<irtkConnectedComponent> &components = (*_Components)[c];
+      components.resize(chunk._FirstLabel[chunk._NumberOfSlabs]);
+      chunk._Components = &components;
+      chunk._ForeignLabels.resize(chunk._NumberOfSlabs);
+      chunk._Foreign      .resize(chunk._NumberOfSlabs);
+      ResolveLabels resolve;
+      resolve._Chunk = &chunk;
+      parallel_for(slabs, resolve);
+
+      // Merge statistics of components extending across slabs
+      for (int b = 1; b < chunk._NumberOfSlabs; ++b) {
+        const vector<int> &labels = chunk._ForeignLabels[b];
+        for (size_t i = 0; i < labels.size(); ++i) {
+          MergeComponent(components[labels[i] - 1], chunk._Foreign[b][i]);
+        }
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Select voxels of largest component of each chunk
+template <class VoxelType>
+struct SelectLargest
+{
+  const int       *_Labels;
+  const int       *_Largest;   ///< Label of largest component of each chunk
+  VoxelType       *_Output;
+  int              _ChunkSize; ///< Number of voxels per chunk
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int idx = re.begin(); idx != re.end(); ++idx) {
+      const int label = _Labels[idx];
+      _Output[idx] = (label != 0 && label == _Largest[idx / _ChunkSize] ? VoxelType(1) : VoxelType(0));
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Set voxels of small components to background
+template <class VoxelType>
+struct RemoveSmall
+{
+  const int                                     *_Labels;
+  const vector<vector<irtkConnectedComponent> > *_Components;
+  VoxelType                                     *_Output;
+  int                                            _ChunkSize;
+  int                                            _MinSize;
+  VoxelType                                      _Background;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int idx = re.begin(); idx != re.end(); ++idx) {
+      const int label = _Labels[idx];
+      if (label != 0 && (*_Components)[idx / _ChunkSize][label - 1]._Size < _MinSize) {
+        _Output[idx] = _Background;
+      }
+    }
+  }
+};
+
+
+} // namespace irtkConnectedComponentsUtils
+using namespace irtkConnectedComponentsUtils;
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+irtkConnectedComponents<VoxelType>::irtkConnectedComponents(irtkConnectivityType connectivity)
+:
+  _Connectivity(connectivity),
+  _Mode2D(false),
+  _ChunkSize(1)
+{
+}
+
+// =============================================================================
+// Labelling
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+void irtkConnectedComponents<VoxelType>::Run(const irtkGenericImage<VoxelType> *image)
+{
+  _Labels.Initialize(image->GetImageAttributes());
+  const VoxelType *ptr = image->GetPointerToVoxels();
+  vector<char> mask(image->GetNumberOfVoxels());
+  for (size_t idx = 0; idx < mask.size(); ++idx) mask[idx] = (ptr[idx] != VoxelType(0));
+  Label(mask);
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+void irtkConnectedComponents<VoxelType>::Run(const irtkGenericImage<VoxelType> *image, VoxelType value)
+{
+  _Labels.Initialize(image->GetImageAttributes());
+  const VoxelType *ptr = image->GetPointerToVoxels();
+  vector<char> mask(image->GetNumberOfVoxels());
+  for (size_t idx = 0; idx < mask.size(); ++idx) mask[idx] = (ptr[idx] == value);
+  Label(mask);
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+void irtkConnectedComponents<VoxelType>::Label(const vector<char> &mask)
+{
+  const int nx = _Labels.GetX();
+  const int ny = _Labels.GetY();
+  const int nz = _Labels.GetZ();
+  const int nt = _Labels.GetT();
+
+  _ChunkSize = (_Mode2D ? 1 : nz);
+  const int nchunks = nt * (nz / _ChunkSize);
+  _Components.clear();
+  _Components.resize(nchunks);
+  if (mask.empty()) return;
+
+  vector<NeighbourOffset> offsets;
+  PrecedingNeighbours(_Connectivity, offsets);
+  vector<int> parent(mask.size());
+
+  LabelChunk body;
+  body._Mask       = &mask[0];
+  body._Parent     = &parent[0];
+  body._Labels     = _Labels.GetPointerToVoxels();
+  body._Components = &_Components;
+  body._Offsets    = &offsets;
+  body._X          = nx;
+  body._Y          = ny;
+  body._Z          = _ChunkSize;
+  body._ChunksPerFrame = nz / _ChunkSize;
+  parallel_for(blocked_range<int>(0, nchunks, 1), body);
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+int irtkConnectedComponents<VoxelType>::LargestComponent(int chunk) const
+{
+  int largest = 0, size = 0;
+  const vector<irtkConnectedComponent> &components = _Components[chunk];
+  for (size_t l = 0; l < components.size(); ++l) {
+    if (components[l]._Size > size) {
+      size    = components[l]._Size;
+      largest = static_cast<int>(l) + 1;
+    }
+  }
+  return largest;
+}
+
+// =============================================================================
+// Selection
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+void irtkConnectedComponents<VoxelType>::ExtractLargestComponent(irtkGenericImage<VoxelType> *output) const
+{
+  output->Initialize(_Labels.GetImageAttributes());
+  const int nvox = _Labels.GetNumberOfVoxels();
+  if (nvox == 0) return;
+  vector<int> largest(_Components.size());
+  for (int c = 0; c < NumberOfChunks(); ++c) largest[c] = LargestComponent(c);
+  SelectLargest<VoxelType> select;
+  select._Labels    = _Labels.GetPointerToVoxels();
+  select._Largest   = &largest[0];
+  select._Output    = output->GetPointerToVoxels();
+  select._ChunkSize = _Labels.GetX() * _Labels.GetY() * _ChunkSize;
+  parallel_for(blocked_range<int>(0, nvox), select);
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+void irtkConnectedComponents<VoxelType>::RemoveSmallComponents(irtkGenericImage<VoxelType> *image,
+                                                               int minsize, VoxelType background) const
+{
+  if (image->GetNumberOfVoxels() != _Labels.GetNumberOfVoxels()) {
+    cerr << "irtkConnectedComponents::RemoveSmallComponents: Image size differs from labelled image" << endl;
+    exit(1);
+  }
+  RemoveSmall<VoxelType> remove;
+  remove._Labels     = _Labels.GetPointerToVoxels();
+  remove._Components = &_Components;
+  remove._Output     = image->GetPointerToVoxels();
+  remove._ChunkSize  = _Labels.GetX() * _Labels.GetY() * _ChunkSize;
+  remove._MinSize    = minsize;
+  remove._Background = background;
+  parallel_for(blocked_range<int>(0, _Labels.GetNumberOfVoxels()), remove);
+}
+
+// =============================================================================
+// Explicit instantiations
+// =============================================================================
+
+template class irtkConnectedComponents<irtkBytePixel>;
+template class irtkConnectedComponents<irtkGreyPixel>;
+template class irtkConnectedComponents<irtkRealPixel>;
@@ -19,6 +19,9 @@
 #include <irtkDilation.h>
 
 template <class VoxelType> irtkDilation<VoxelType>::irtkDilation()
+:
+  _Radius(0),
+  _StructuringElement(StructuringElement_Box)
 {
 	// Default connectivity.
 	this->_Connectivity = CONNECTIVITY_26;
@@ -45,6 +48,13 @@ template <class VoxelType> void irtkDilation<VoxelType>::Run()
   // Do the initial set up
   this->Initialize();
 
+  // Separable filtering by structuring element of given radius
+  if (_Radius > 0) {
+    irtkMorphology<VoxelType>::Dilate(this->_input, this->_output, _Radius, _StructuringElement);
+    this->Finalize();
+    return;
+  }
+
   maskSize = this->_offsets.GetSize();
 
   for (t = 0; t < this->_input->GetT(); t++) {
@@ -19,6 +19,9 @@
 #include <irtkErosion.h>
 
 template <class VoxelType> irtkErosion<VoxelType>::irtkErosion()
+:
+  _Radius(0),
+  _StructuringElement(StructuringElement_Box)
 {
 	// Default connectivity.
 	this->_Connectivity = CONNECTIVITY_26;
@@ -44,6 +47,13 @@ template <class VoxelType> void irtkErosion<VoxelType>::Run()
   // Do the initial set up
   this->Initialize();
 
+  // Separable filtering by structuring element of given radius
+  if (_Radius > 0) {
+    irtkMorphology<VoxelType>::Erode(this->_input, this->_output, _Radius, _StructuringElement);
+    this->Finalize();
+    return;
+  }
+
   maskSize = this->_offsets.GetSize();
 
   for (t = 0; t < this->_input->GetT(); t++) {
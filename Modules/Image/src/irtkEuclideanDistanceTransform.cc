@@ -18,9 +18,284 @@
 
 #include <irtkEuclideanDistanceTransform.h>
 
+
+// =============================================================================
+// Auxiliary functions and functors of multi-threaded distance transform
+// =============================================================================
+
+namespace irtkEuclideanDistanceTransformUtils {
+
+// -----------------------------------------------------------------------------
+/// Compute squared distance to closest feature voxel in row (x direction)
+///
+/// This is the simple forward-and-reverse distance propagation used for D_1.
+template <class VoxelType>
+void edtPropagateRow(VoxelType *p, long nX, double wX)
+{
+  VoxelType d;
+  long      i;
+  /* forward pass */
+  d = EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC;
+  for (i = 0; i < nX; i++, p++) {
+    /* set d = 0 when we encounter a feature voxel */
+    if (*p) {
+      *p = d = 0;
+    }
+    /* increment distance ... */
+    else if (d != EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC) {
+      *p = ++d;
+    }
+    /* ... unless we haven't encountered a feature voxel yet */
+    else {
+      *p = EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC;
+    }
+  }
+  /* reverse pass */
+  if (*(--p) != EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC) {
+    d = EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC;
+    for (i = nX - 1; i >= 0; i--, p--) {
+      /* set d = 0 when we encounter a feature voxel */
+      if (*p == 0) {
+        d = 0;
+      }
+      /* increment distance after encountering a feature voxel */
+      else if (d != EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC) {
+        /* compare forward and reverse distances */
+        if (++d < *p) {
+          *p = d;
+        }
+      }
+      /* square distance */
+      /* (we use squared distance in rest of algorithm) */
+      *p *= wX;
+      *p *= *p;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Procedure edtVornoiEDT() in tPAMI paper for anisotropic voxel sizes
+///
+/// \param[in,out] f Squared distances along line.
+/// \param[in]     n Number of voxels in line.
+/// \param[in]     w Voxel size along line.
+/// \param[in]     g Scratch buffer of size n.
+/// \param[in]     h Scratch buffer of size n.
+///
+/// \returns 1 if the diagram was queried, 0 if line contains no finite distance.
+template <class VoxelType>
+int edtVornoiEDT_anisotropic(VoxelType *f, long n, double w, float *g, float *h)
+{
+  long i, l, n_S;
+  float a, b, c, v, lhs, rhs;
+
+  /* construct partial Vornoi diagram */
+  /* this loop is lines 1-14 in Procedure edtVornoiEDT() in tPAMI paper */
+  /* note we use 0 indexing in this program whereas paper uses 1 indexing */
+  for (i = 0, l = -1; i < n; i++) {
+    /* line 4 */
+    if (f[i] != EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC) {
+      /* line 5 */
+      if (l < 1) {
+        /* line 6 */
+        g[++l] = f[i];
+        h[l] = w * i;
+      }
+      /* line 7 */
+      else {
+        /* line 8 */
+        while (l >= 1) {
+          /* compute removeEDT() in line 8 */
+          v = h[l];
+          a = v - h[l-1];
+          b = w * i - v;
+          c = a + b;
+          /* compute Eq. 2 */
+          if ((c*g[l] - b*g[l-1] - a*f[i] - a*b*c) > 0) {
+            /* line 9 */
+            l--;
+          } else {
+            break;
+          }
+        }
+        /* line 11 */
+        g[++l] = f[i];
+        h[l] = w * i;
+      }
+    }
+  }
+  /* query partial Vornoi diagram */
+  /* this is lines 15-25 in Procedure edtVornoiEDT() in tPAMI paper */
+  /* lines 15-17 */
+  if ((n_S = l + 1) == 0) {
+    return (0);
+  }
+  /* lines 18-19 */
+  for (i = 0, l = 0; i < n; i++) {
+    /* line 20 */
+    a = h[l] - w * i;
+    lhs = g[l] + a * a;
+    while (l < n_S - 1) {
+      a = h[l+1] - w * i;
+      rhs = g[l+1] + a * a;
+      if (lhs > rhs) {
+        /* line 21 */
+        l++;
+        lhs = rhs;
+      } else {
+        break;
+      }
+    }
+    /* line 23 */
+    f[i] = lhs;
+  }
+  /* line 25 */
+  return (1);
+}
+
+// -----------------------------------------------------------------------------
+/// Compute D_1 for each row of the image
+template <class VoxelType>
+struct edtComputeRows
+{
+  VoxelType *_EDT;
+  long       _nX;
+  double     _wX;
+
+  void operator ()(const blocked_range<long> &re) const
+  {
+    for (long j = re.begin(); j != re.end(); ++j) {
+      edtPropagateRow(_EDT + j * _nX, _nX, _wX);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Solve 1D problem for each line along the y or z axis
+///
+/// The lines are grouped into chunks of nX lines which start at consecutive
+/// voxels in x. Each task uses its own scratch buffers.
+template <class VoxelType>
+struct edtComputeLines
+{
+  VoxelType *_EDT;
+  long       _nX;          ///< Number of lines per chunk
+  long       _ChunkStride; ///< Offset between first voxels of chunks
+  long       _N;           ///< Number of voxels per line
+  long       _Stride;      ///< Offset between voxels of line
+  double     _W;           ///< Voxel size along line
+
+  void operator ()(const blocked_range<long> &re) const
+  {
+    vector<VoxelType> f(_N);
+    vector<float>     g(_N), h(_N);
+    VoxelType *p;
+    long       i, k;
+    for (long c = re.begin(); c != re.end(); ++c) {
+      for (i = 0; i < _nX; i++) {
+        /* fill array f with distances in line */
+        p = _EDT + c * _ChunkStride + i;
+        for (k = 0; k < _N; k++, p += _Stride) f[k] = *p;
+        /* call edtVornoiEDT */
+        if (edtVornoiEDT_anisotropic(&f[0], _N, _W, &g[0], &h[0])) {
+          p = _EDT + c * _ChunkStride + i;
+          for (k = 0; k < _N; k++, p += _Stride) *p = f[k];
+        }
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Compute squared EDT of each slice (2D) or of the volume (3D)
+template <class VoxelType>
+void edtComputeEDT_anisotropic(const VoxelType *img, VoxelType *edt,
+                               long nX, long nY, long nZ,
+                               double wX, double wY, double wZ, bool volume)
+{
+  const long nXY = nX * nY;
+
+  /* if binary image is provided in the array img, copy it to the array edt */
+  /* this is effectively equivalent to computing D_0 */
+  if (img != NULL && img != edt) memcpy(edt, img, nXY * nZ * sizeof(VoxelType));
+
+  /* compute D_1 */
+  edtComputeRows<VoxelType> rows;
+  rows._EDT = edt;
+  rows._nX  = nX;
+  rows._wX  = wX;
+  parallel_for(blocked_range<long>(0, nY * nZ), rows);
+
+  /* compute D_2 */
+  /* solve 1D problem for each column (y direction) of each slice */
+  edtComputeLines<VoxelType> cols;
+  cols._EDT         = edt;
+  cols._nX          = nX;
+  cols._ChunkStride = nXY;
+  cols._N           = nY;
+  cols._Stride      = nX;
+  cols._W           = wY;
+  parallel_for(blocked_range<long>(0, nZ), cols);
+
+  /* compute D_3 */
+  /* solve 1D problem for each column (z direction) */
+  if (volume && nZ > 1) {
+    edtComputeLines<VoxelType> lines;
+    lines._EDT         = edt;
+    lines._nX          = nX;
+    lines._ChunkStride = nX;
+    lines._N           = nZ;
+    lines._Stride      = nXY;
+    lines._W           = wZ;
+    parallel_for(blocked_range<long>(0, nY), lines);
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Binary mask of background, i.e., feature voxels of inside distance
+template <class VoxelType>
+struct edtComplement
+{
+  const VoxelType *_Input;
+  VoxelType       *_Output;
+
+  void operator ()(const blocked_range<long> &re) const
+  {
+    for (long i = re.begin(); i != re.end(); ++i) {
+      _Output[i] = (_Input[i] ? VoxelType(0) : VoxelType(1));
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Combine squared outside and inside distances to signed distance
+template <class VoxelType>
+struct edtSignedDistance
+{
+  VoxelType       *_Outside;
+  const VoxelType *_Inside;
+
+  void operator ()(const blocked_range<long> &re) const
+  {
+    for (long i = re.begin(); i != re.end(); ++i) {
+      _Outside[i] = static_cast<VoxelType>(sqrt(static_cast<double>(_Outside[i]))
+                                         - sqrt(static_cast<double>(_Inside [i])));
+    }
+  }
+};
+
+
+} // namespace irtkEuclideanDistanceTransformUtils
+using namespace irtkEuclideanDistanceTransformUtils;
+
+// =============================================================================
+// irtkEuclideanDistanceTransform
+// =============================================================================
+
 template <class VoxelType> irtkEuclideanDistanceTransform<VoxelType>::irtkEuclideanDistanceTransform(irtkDistanceTransformMode distanceTransformMode) : irtkImageToImage<VoxelType>()
 {
   _distanceTransformMode = distanceTransformMode;
+  _SignedDistance        = false;
 }
 
 /*
@@ -311,213 +586,16 @@ template <class VoxelType> int irtkEuclideanDistanceTransform<VoxelType>::edtVor
 } /* edtVornoiEDT */
 
 
-template <class VoxelType> int irtkEuclideanDistanceTransform<VoxelType>::edtVornoiEDT_anisotropic(VoxelType *f, long n, double w)
-/*
- * This is Procedure edtVornoiEDT() in tPAMI paper.
- */
-{
-  long i, l, n_S;
-  float a, b, c, v, lhs, rhs;
-  static int firstCall = 1;
-  static long size_gh = 0;
-  static float *g, *h;
-
-  /* this procedure is called often */
-  /* we keep static arrays to avoid frequent calls to malloc() */
-  /* the downside is that this memory is never freed, */
-  /* but it is not so much memory: max(nX,nY,nZ)*sizeof(long) */
-  /* need to check if arrays are sufficiently large */
-  if (n > size_gh && !firstCall) {
-    free(g);
-    free(h);
-    firstCall = 1;
-  }
-  /* malloc arrays if this is first call to procedure, or if arrays */
-  /* are too small and need to be reallocated */
-  if (firstCall) {
-    g = (float *)malloc(n * sizeof(float));
-    if (g == NULL) {
-      fprintf(stderr, "Error in edtVornoiEDT()\n");
-      fprintf(stderr, "Cannot malloc g\n");
-      exit(EXIT_FAILURE);
-    }
-    h = (float *)malloc(n * sizeof(float));
-    if (h == NULL) {
-      fprintf(stderr, "Error in edtVornoiEDT()\n");
-      fprintf(stderr, "Cannot malloc h\n");
-      exit(EXIT_FAILURE);
-    }
-    size_gh = n;
-    firstCall = 0;
-  }
-
-  /* construct partial Vornoi diagram */
-  /* this loop is lines 1-14 in Procedure edtVornoiEDT() in tPAMI paper */
-  /* note we use 0 indexing in this program whereas paper uses 1 indexing */
-  for (i = 0, l = -1; i < n; i++) {
-    /* line 4 */
-    if (f[i] != EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC) {
-      /* line 5 */
-      if (l < 1) {
-        /* line 6 */
-        g[++l] = f[i];
-        h[l] = w * i;
-      }
-      /* line 7 */
-      else {
-        /* line 8 */
-        while (l >= 1) {
-          /* compute removeEDT() in line 8 */
-          v = h[l];
-          a = v - h[l-1];
-          b = w * i - v;
-          c = a + b;
-          /* compute Eq. 2 */
-          if ((c*g[l] - b*g[l-1] - a*f[i] - a*b*c) > 0) {
-            /* line 9 */
-            l--;
-          } else {
-            break;
-          }
-        }
-        /* line 11 */
-        g[++l] = f[i];
-        h[l] = w * i;
-      }
-    }
-  }
-  /* query partial Vornoi diagram */
-  /* this is lines 15-25 in Procedure edtVornoiEDT() in tPAMI paper */
-  /* lines 15-17 */
-  if ((n_S = l + 1) == 0) {
-    return (0);
-  }
-  /* lines 18-19 */
-  for (i = 0, l = 0; i < n; i++) {
-    /* line 20 */
-    /* we reduce number of arithmetic operations by taking advantage of */
-    /* similarities in successive computations instead of treating them as */
-    /* independent ones */
-    a = h[l] - w * i;
-    lhs = g[l] + a * a;
-    while (l < n_S - 1) {
-      a = h[l+1] - w * i;
-      rhs = g[l+1] + a * a;
-      if (lhs > rhs) {
-        /* line 21 */
-        l++;
-        lhs = rhs;
-      } else {
-        break;
-      }
-    }
-    /* line 23 */
-    /* we put distance into the 1D array that was passed; */
-    /* must copy into EDT in calling procedure */
-    f[i] = lhs;
-  }
-  /* line 25 */
-  /* return 1 if we queried diagram, 0 if we returned because n_S = 0 */
-  return (1);
-} /* edtVornoiEDT_anisotropic */
-
-template <class VoxelType> void irtkEuclideanDistanceTransform<VoxelType>::edtComputeEDT_2D_anisotropic(VoxelType *img, VoxelType *edt, long nX, long nY, double wX, double wY)
+template <class VoxelType> void irtkEuclideanDistanceTransform<VoxelType>::edtComputeEDT_2D_anisotropic(const VoxelType *img, VoxelType *edt, long nX, long nY, double wX, double wY)
 /*
  * This procedure computes the squared EDT of a 2D binary image with anisotropic
  * voxels. See notes for edtComputeEDT_2D. The difference relative to edtComputeEDT_2D
- * is that the edt is a float array instead of a long array, and there are
- * additional parameters for the image voxel dimensions wX and wY.
+ * is that the edt is an array of VoxelType instead of a long array, there are
+ * additional parameters for the image voxel dimensions wX and wY, and the rows
+ * and columns are processed in parallel.
  */
 {
-  VoxelType *c;
-  long i, j, nXY;
-  VoxelType d, *p, *q, *f;
-
-  /* nXY is number of voxels in 2D image */
-  nXY = nX * nY;
-
-  /* if binary image is provided in the array img, copy it to the arry edt */
-  /* this is effectively equivalent to computing D_0 */
-  if (img != NULL) {
-    c = img;
-    p = edt;
-    for (i = 0; i < nXY; i++, c++, p++) {
-      *p = *c;
-    }
-  }
-
-  /* compute D_1 as simple forward-and-reverse distance propagation */
-  /* (instead of calling edtVornoiEDT) */
-  /* D_1 is distance to closest feature voxel in row (x direction) */
-  /* it is possible to use a simple distance propagation for D_1  because */
-  /* L_1 and L_2 norms are equivalent for 1D case */
-  for (j = 0; j < nY; j++) {
-    /* forward pass */
-    p = edt + j * nX;
-    d = EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC;
-    for (i = 0; i < nX; i++, p++) {
-      /* set d = 0 when we encounter a feature voxel */
-      if (*p) {
-        *p = d = 0;
-      }
-      /* increment distance ... */
-      else if (d != EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC) {
-        *p = ++d;
-      }
-      /* ... unless we haven't encountered a feature voxel yet */
-      else {
-        *p = EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC;
-      }
-    }
-    /* reverse pass */
-    if (*(--p) != EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC) {
-      d = EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC;
-      for (i = nX - 1; i >= 0; i--, p--) {
-        /* set d = 0 when we encounter a feature voxel */
-        if (*p == 0) {
-          d = 0;
-        }
-        /* increment distance after encountering a feature voxel */
-        else if (d != EDT_MAX_DISTANCE_SQUARED_ANISOTROPIC) {
-          /* compare forward and reverse distances */
-          if (++d < *p) {
-            *p = d;
-          }
-        }
-        /* square distance */
-        /* (we use squared distance in rest of algorithm) */
-        *p *= wX;
-        *p *= *p;
-      }
-    }
-  }
-
-  /* compute D_2 = squared EDT */
-  /* solve 1D problem for each column (y direction) */
-  f = (VoxelType *)malloc(nY * sizeof(VoxelType));
-  if (f == NULL) {
-    fprintf(stderr, "Error in edtComputeEDT_2D()\n");
-    fprintf(stderr, "Cannot malloc f\n");
-    exit(EXIT_FAILURE);
-  }
-  for (i = 0; i < nX; i++) {
-    /* fill array f with D_1 distances in column */
-    /* this is essentially line 4 in Procedure VoronoiEDT() in tPAMI paper */
-    p = edt + i;
-    q = f;
-    for (j = 0; j < nY; j++, p += nX, q++) {
-      *q = *p;
-    }
-    /* call edtVornoiEDT */
-    if (edtVornoiEDT_anisotropic(f, nY, wY)) {
-      p = edt + i;
-      q = f;
-      for (j = 0; j < nY; j++, p += nX, q++) {
-        *p = *q;
-      }
-    }
-  }
-  free(f);
+  edtComputeEDT_anisotropic(img, edt, nX, nY, 1L, wX, wY, 1.0, false);
 } /* edtComputeEDT_2D_anisotropic */
 
 
@@ -526,65 +604,14 @@ template <class VoxelType> void irtkEuclideanDistanceTransform<VoxelType>::edtCo
  * voxels. See notes for edtComputeEDT_2D_anisotropic.
  */
 
-template <class VoxelType> void irtkEuclideanDistanceTransform<VoxelType>::edtComputeEDT_3D_anisotropic(VoxelType *img, VoxelType *edt, long nX, long nY, long nZ, double wX, double wY, double wZ)
+template <class VoxelType> void irtkEuclideanDistanceTransform<VoxelType>::edtComputeEDT_3D_anisotropic(const VoxelType *img, VoxelType *edt, long nX, long nY, long nZ, double wX, double wY, double wZ)
 {
-  VoxelType *c;
-  long i, k, nXY, nXYZ;
-  VoxelType *p, *q, *f;
-
-  /* nXY is number of voxels in each plane (xy) */
-  /* nXYZ is number of voxels in 3D image */
-  nXY = nX * nY;
-  nXYZ = nX * nY * nZ;
-
-  /* if binary image is provided in the array img, copy it to the arry edt */
-  /* this is effectively equivalent to computing D_0 */
-  if (img != NULL) {
-    c = img;
-    p = edt;
-    for (i = 0; i < nXYZ; i++, c++, p++) {
-      *p = *c;
-    }
-  }
-
-  /* compute D_2 */
-  /* call edtComputeEDT_2D for each plane */
-  p = edt;
-  for (k = 0; k < nZ; k++, p += nXY) {
-    edtComputeEDT_2D_anisotropic(NULL, p, nX, nY, wX, wY);
-  }
-
-  /* compute D_3 */
-  /* solve 1D problem for each column (z direction) */
-  f = (VoxelType *)malloc(nZ * sizeof(VoxelType));
-  if (f == NULL) {
-    fprintf(stderr, "Error in edtComputeEDT_3D()\n");
-    fprintf(stderr, "Cannot malloc f\n");
-    exit(EXIT_FAILURE);
-  }
-  for (i = 0; i < nXY; i++) {
-    /* fill array f with D_2 distances in column */
-    /* this is essentially line 4 in Procedure VoronoiEDT() in tPAMI paper */
-    p = edt + i;
-    q = f;
-    for (k = 0; k < nZ; k++, p += nXY, q++) {
-      *q = *p;
-    }
-    /* call edtVornoiEDT */
-    if (edtVornoiEDT_anisotropic(f, nZ, wZ)) {
-      p = edt + i;
-      q = f;
-      for (k = 0; k < nZ; k++, p += nXY, q++) {
-	*p = *q;
-      }
-    }
-  }
-  free(f);
+  edtComputeEDT_anisotropic(img, edt, nX, nY, nZ, wX, wY, wZ, true);
 } /* edtComputeEDT_3D_anisotropic */
 
 template <class VoxelType> void irtkEuclideanDistanceTransform<VoxelType>::Run()
 {
-  int nx, ny, nz, nt, z, t;
+  long nx, ny, nz, nt, nvox, t;
   double wx, wy, wz;
 
   // Do the initial set up
@@ -595,23 +622,33 @@ template <class VoxelType> void irtkEuclideanDistanceTransform<VoxelType>::Run()
   ny = this->_input->GetY();
   nz = this->_input->GetZ();
   nt = this->_input->GetT();
+  nvox = nx * ny * nz;
 
   // Calculate voxel size
   this->_input->GetPixelSize(&wx, &wy, &wz);
-  for ( t = 0; t < nt; t++){
-	  if (this->_distanceTransformMode == irtkEuclideanDistanceTransform::irtkDistanceTransform3D) {
-		  // Calculate 3D distance transform
-		  edtComputeEDT_3D_anisotropic( this->_input->GetPointerToVoxels(0,0,0,t),
-			  this->_output->GetPointerToVoxels(0,0,0,t),
-			  nx, ny, nz, wx, wy, wz);
-	  } else {
-		  for (z = 0; z < nz; z++) {
-			  // Calculate 2D distance transform slice by slice
-			  edtComputeEDT_2D_anisotropic( this->_input->GetPointerToVoxels(0, 0, z, t),
-				  this->_output->GetPointerToVoxels(0, 0, z, t),
-				  nx, ny, wx, wy);
-		  }
-	  }
+
+  // Compute distance transform of each frame
+  const bool volume = (this->_distanceTransformMode == irtkEuclideanDistanceTransform::irtkDistanceTransform3D);
+  vector<VoxelType> inside(_SignedDistance ? nvox : 0);
+  for (t = 0; t < nt; t++) {
+    const VoxelType *input  = this->_input ->GetPointerToVoxels(0, 0, 0, t);
+    VoxelType       *output = this->_output->GetPointerToVoxels(0, 0, 0, t);
+    if (_SignedDistance) {
+      // Background mask before input is overwritten by in-place filter
+      edtComplement<VoxelType> complement;
+      complement._Input  = input;
+      complement._Output = &inside[0];
+      parallel_for(blocked_range<long>(0, nvox), complement);
+      // Squared distances outside and inside of foreground
+      edtComputeEDT_anisotropic(input,  output,     nx, ny, nz, wx, wy, wz, volume);
+      edtComputeEDT_anisotropic<VoxelType>(NULL, &inside[0], nx, ny, nz, wx, wy, wz, volume);
+      edtSignedDistance<VoxelType> combine;
+      combine._Outside = output;
+      combine._Inside  = &inside[0];
+      parallel_for(blocked_range<long>(0, nvox), combine);
+    } else {
+      edtComputeEDT_anisotropic(input, output, nx, ny, nz, wx, wy, wz, volume);
+    }
   }
 
   // Do the final cleaning up
@@ -33,7 +33,7 @@ void irtkGenericImage<VoxelType>::AllocateImage(VoxelType *data)
   if (_maskOwner) Delete(_mask);
   // Free previously allocated memory
   Deallocate(_matrix, _data);
-  if (_dataOwner) Deallocate(_data);
+  if (_dataOwner) PoolDeallocate(_data);
   _dataOwner = false;
   // Initialize memory
   const int nvox = _attr.NumberOfLatticePoints();
@@ -42,7 +42,7 @@ void irtkGenericImage<VoxelType>::AllocateImage(VoxelType *data)
       _data      = data;
       _dataOwner = false;
     } else {
-      _data      = CAllocate<VoxelType>(nvox);
+      _data      = PoolAllocate<VoxelType>(nvox);
       _dataOwner = true;
     }
     Allocate(_matrix, _attr._x, _attr._y, _attr._z, _attr._t, _data);
@@ -190,7 +190,7 @@ template <class VoxelType>
 irtkGenericImage<VoxelType>::~irtkGenericImage()
 {
   Deallocate(_matrix, _data);
-  if (_dataOwner) Deallocate(_data);
+  if (_dataOwner) PoolDeallocate(_data);
   if (_maskOwner) Delete(_mask);
 }
 
@@ -351,7 +351,7 @@ irtkGenericImage<VoxelType>& irtkGenericImage<VoxelType>::operator=(const irtkGe
 template <class VoxelType> void irtkGenericImage<VoxelType>::Clear()
 {
   Deallocate(_matrix, _data);
-  if (_dataOwner) Deallocate(_data);
+  if (_dataOwner) PoolDeallocate(_data);
   if (_maskOwner) Delete(_mask);
   _attr = irtkImageAttributes();
 }
@@ -23,58 +23,75 @@ template <class VoxelType> irtkGradientImage<VoxelType>::irtkGradientImage()
   _Padding = MIN_GREY;
 }
 
-template <class VoxelType> double irtkGradientImage<VoxelType>::Run(int x, int y, int z, int t)
+template <class VoxelType> void irtkGradientImage<VoxelType>::Initialize()
 {
-  double dx, dy, dz;
+  // Do the initial set up
+  irtkImageRowFilter<VoxelType>::Initialize();
 
-  if ((x > 0) && (x < this->_input->GetX()-1)
-      && this->_input->Get(x-1, y, z, t) > _Padding
-      && this->_input->Get(x+1, y, z, t) > _Padding
-     ) {
-    dx = this->_input->Get(x-1, y, z, t) - this->_input->Get(x+1, y, z, t);
-  } else {
-    dx = 0;
-  }
+  // Central differences along axes of size one are zero
+  this->SetMargin(1, (this->_input->GetY() > 1) ? 1 : 0,
+                     (this->_input->GetZ() > 1) ? 1 : 0);
+}
 
-  if ((y > 0) && (y < this->_input->GetY()-1)
-      && this->_input->Get(x, y-1, z, t) > _Padding
-      && this->_input->Get(x, y+1, z, t) > _Padding
-     ) {
-    dy = this->_input->Get(x, y-1, z, t) - this->_input->Get(x, y+1, z, t);
-  } else {
-    dy = 0;
-  }
+template <class VoxelType> void irtkGradientImage<VoxelType>
+::FilterInterior(irtkNoRowFilterState &, const irtkImageRowSegment<VoxelType> &row) const
+{
+  const int sy = (this->_MarginY > 0) ? row._StrideY : 0;
+  const int sz = (this->_MarginZ > 0) ? row._StrideZ : 0;
+  const VoxelType *in  = row._Input  + row._X1;
+  VoxelType       *out = row._Output + row._X1;
+  double dx, dy, dz;
 
-  if ((z > 0) && (z < this->_input->GetZ()-1)
-      && this->_input->Get(x, y, z-1, t) > _Padding
-      && this->_input->Get(x, y, z+1, t) > _Padding
-     ) {
-    dz = this->_input->Get(x, y, z-1, t) - this->_input->Get(x, y, z+1, t);
-  } else {
-    dz = 0;
+  for (int x = row._X1; x < row._X2; ++x, ++in, ++out) {
+    if (in[-1] > _Padding && in[+1] > _Padding) {
+      dx = in[-1] - in[+1];
+    } else {
+      dx = 0;
+    }
+    if (sy != 0 && in[-sy] > _Padding && in[+sy] > _Padding) {
+      dy = in[-sy] - in[+sy];
+    } else {
+      dy = 0;
+    }
+    if (sz != 0 && in[-sz] > _Padding && in[+sz] > _Padding) {
+      dz = in[-sz] - in[+sz];
+    } else {
+      dz = 0;
+    }
+    *out = voxel_cast<VoxelType>(sqrt(dx*dx + dy*dy + dz*dz));
   }
-
-  return sqrt(dx*dx + dy*dy + dz*dz);
 }
 
-template <class VoxelType> void irtkGradientImage<VoxelType>::Run()
+template <class VoxelType> void irtkGradientImage<VoxelType>
+::FilterBoundary(irtkNoRowFilterState &, const irtkImageRowSegment<VoxelType> &row) const
 {
-  int x, y, z, t;
-
-  // Do the initial set up
-  this->Initialize();
+  const int  sy = row._StrideY;
+  const int  sz = row._StrideZ;
+  const bool by = (row._Y > 0) && (row._Y < this->_input->GetY()-1);
+  const bool bz = (row._Z > 0) && (row._Z < this->_input->GetZ()-1);
+  const VoxelType *in  = row._Input  + row._X1;
+  VoxelType       *out = row._Output + row._X1;
+  double dx, dy, dz;
 
-  for (t = 0; t < this->_input->GetT(); ++t) {
-    for (z = 0; z < this->_input->GetZ(); ++z) {
-      for (y = 0; y < this->_input->GetY(); ++y) {
-        for (x = 0; x < this->_input->GetX(); ++x) {
-          this->_output->PutAsDouble(x, y, z, t, this->Run(x, y, z, t));
-        }
-      }
+  for (int x = row._X1; x < row._X2; ++x, ++in, ++out) {
+    if ((x > 0) && (x < this->_input->GetX()-1)
+        && in[-1] > _Padding && in[+1] > _Padding) {
+      dx = in[-1] - in[+1];
+    } else {
+      dx = 0;
+    }
+    if (by && in[-sy] > _Padding && in[+sy] > _Padding) {
+      dy = in[-sy] - in[+sy];
+    } else {
+      dy = 0;
+    }
+    if (bz && in[-sz] > _Padding && in[+sz] > _Padding) {
+      dz = in[-sz] - in[+sz];
+    } else {
+      dz = 0;
     }
+    *out = voxel_cast<VoxelType>(sqrt(dx*dx + dy*dy + dz*dz));
   }
-  // Do the final cleaning up
-  this->Finalize();
 }
 
 template class irtkGradientImage<unsigned char>;
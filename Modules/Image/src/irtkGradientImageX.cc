@@ -19,45 +19,52 @@
 #include <irtkGradientImage.h>
 
 
-template <class VoxelType> double irtkGradientImageX<VoxelType>::Run(int x, int y, int z, int t)
+template <class VoxelType> void irtkGradientImageX<VoxelType>::Initialize()
 {
+  // Do the initial set up
+  irtkImageRowFilter<VoxelType>::Initialize();
 
-  double previous = this->_input->Get(x-1, y, z, t);
-  double next     = this->_input->Get(x+1, y, z, t);
-
-  double gradient = previous - next;
+  // Check image dimensions....
+  if (this->_input->GetX() < 2) {
+    cerr<<" irtkGradientImageX: Dimensions of input image are wrong"<<endl;
+    exit(1);
+  }
 
-  return gradient;
+  this->SetMargin(1, 0, 0);
 }
 
 
-template <class VoxelType> void irtkGradientImageX<VoxelType>::Run()
+template <class VoxelType> void irtkGradientImageX<VoxelType>
+::FilterInterior(irtkNoRowFilterState &, const irtkImageRowSegment<VoxelType> &row) const
 {
-  int x, y, z, t;
-
-  // Do the initial set up
-  this->Initialize();
+  const int s = 1;
+  const VoxelType *in  = row._Input;
+  VoxelType       *out = row._Output;
 
-  if (this->_input->GetX() < 2) {
-    cerr<<" irtkGradientImageX: Dimensions of input image are wrong"<<endl;
-    exit(1);
+  for (int x = row._X1; x < row._X2; ++x) {
+    double previous = in[x-s];
+    double next     = in[x+s];
+    out[x] = voxel_cast<VoxelType>(previous - next);
   }
+}
 
-  for ( t = 0; t < this->_input->GetT(); ++t) {
-    for ( z = 0; z < this->_input->GetZ(); ++z) {
-      for ( y = 0; y < this->_input->GetY(); ++y) {
-        this->_output->Put(0, y, z, t, 0);
-        for ( x = 1; x < this->_input->GetX()-1; ++x) {
-          this->_output->PutAsDouble(x, y, z, t, this->Run(x, y, z, t));
-        }
-        this->_output->Put(x, y, z, t, 0);
-      }
-    }
-  }
 
-  // Do the final cleaning up
-  this->Finalize();
+template <class VoxelType> void irtkGradientImageX<VoxelType>
+::FilterBoundary(irtkNoRowFilterState &, const irtkImageRowSegment<VoxelType> &row) const
+{
+  const int nx = this->_input->GetX();
+  const VoxelType *in  = row._Input;
+  VoxelType       *out = row._Output;
 
+  for (int x = row._X1; x < row._X2; ++x) {
+    if (x > 0 && x < nx-1) {
+      double previous = in[x-1];
+      double next     = in[x+1];
+      out[x] = voxel_cast<VoxelType>(previous - next);
+    } else {
+      out[x] = 0;
+    }
+  }
 }
 
 template class  irtkGradientImageX<irtkBytePixel>;
@@ -18,24 +18,10 @@
 
 #include <irtkGradientImage.h>
 
-template <class VoxelType> double irtkGradientImageY<VoxelType>::Run(int x, int y, int z, int t)
+template <class VoxelType> void irtkGradientImageY<VoxelType>::Initialize()
 {
-
-  double previous = this->_input->Get(x, y-1, z, t);
-  double next     = this->_input->Get(x, y+1, z, t);
-
-  double gradient = previous - next;
-
-  return gradient;
-}
-
-
-template <class VoxelType> void irtkGradientImageY<VoxelType>::Run()
-{
-  int x, y, z, t;
-
   // Do the initial set up
-  this->Initialize();
+  irtkImageRowFilter<VoxelType>::Initialize();
 
   // Check image dimensions....
   if (this->_input->GetY() < 2) {
@@ -43,24 +29,38 @@ template <class VoxelType> void irtkGradientImageY<VoxelType>::Run()
     exit(1);
   }
 
-  for ( t = 0; t < this->_input->GetT(); ++t) {
-    for ( z = 0; z < this->_input->GetZ(); ++z) {
-      for ( x = 0; x < this->_input->GetX(); ++x) {
-        this->_output->Put(x, 0, z, t, 0);
-        for ( y = 1; y < this->_input->GetY()-1; ++y) {
-          this->_output->PutAsDouble(x, y, z, t, this->Run(x, y, z, t));
-        }
-        this->_output->Put(x, y, z, t, 0);
-      }
-    }
-  }
+  this->SetMargin(0, 1, 0);
+}
+
 
-  // Do the final cleaning up
-  this->Finalize();
+template <class VoxelType> void irtkGradientImageY<VoxelType>
+::FilterInterior(irtkNoRowFilterState &, const irtkImageRowSegment<VoxelType> &row) const
+{
+  const int s = row._StrideY;
+  const VoxelType *in  = row._Input;
+  VoxelType       *out = row._Output;
 
+  for (int x = row._X1; x < row._X2; ++x) {
+    double previous = in[x-s];
+    double next     = in[x+s];
+    out[x] = voxel_cast<VoxelType>(previous - next);
+  }
 }
 
 
+template <class VoxelType> void irtkGradientImageY<VoxelType>
+::FilterBoundary(irtkNoRowFilterState &state, const irtkImageRowSegment<VoxelType> &row) const
+{
+  const int n = this->_input->GetY();
+  VoxelType *out = row._Output;
+
+  if (row._Y > 0 && row._Y < n-1) {
+    this->FilterInterior(state, row);
+  } else {
+    for (int x = row._X1; x < row._X2; ++x) out[x] = 0;
+  }
+}
+
 template class  irtkGradientImageY<irtkBytePixel>;
 template class  irtkGradientImageY<irtkGreyPixel>;
 template class  irtkGradientImageY<irtkRealPixel>;
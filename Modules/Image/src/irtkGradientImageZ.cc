@@ -18,24 +18,10 @@
 
 #include <irtkGradientImage.h>
 
-template <class VoxelType> double irtkGradientImageZ<VoxelType>::Run(int x, int y, int z, int t)
+template <class VoxelType> void irtkGradientImageZ<VoxelType>::Initialize()
 {
-
-  double previous = this->_input->Get(x, y, z-1, t);
-  double next     = this->_input->Get(x, y, z+1, t);
-
-  double gradient = previous - next;
-
-  return gradient;
-}
-
-
-template <class VoxelType> void irtkGradientImageZ<VoxelType>::Run()
-{
-  int x, y, z, t;
-
   // Do the initial set up
-  this->Initialize();
+  irtkImageRowFilter<VoxelType>::Initialize();
 
   // Check image dimensions....
   if (this->_input->GetZ() < 2) {
@@ -43,23 +29,38 @@ template <class VoxelType> void irtkGradientImageZ<VoxelType>::Run()
     exit(1);
   }
 
-  for ( t = 0; t < this->_input->GetT(); ++t) {
-    for ( x = 0; x < this->_input->GetX(); ++x) {
-      for ( y = 0; y < this->_input->GetY(); ++y) {
-        this->_output->Put(x, y, 0, t, 0);
-        for ( z = 1; z < this->_input->GetZ()-1; ++z) {
-          this->_output->PutAsDouble(x, y, z, t, this->Run(x, y, z, t));
-        }
-        this->_output->Put(x, y, z, t, 0);
-      }
-    }
-  }
+  this->SetMargin(0, 0, 1);
+}
 
-  // Do the final cleaning up
-  this->Finalize();
+
+template <class VoxelType> void irtkGradientImageZ<VoxelType>
+::FilterInterior(irtkNoRowFilterState &, const irtkImageRowSegment<VoxelType> &row) const
+{
+  const int s = row._StrideZ;
+  const VoxelType *in  = row._Input;
+  VoxelType       *out = row._Output;
+
+  for (int x = row._X1; x < row._X2; ++x) {
+    double previous = in[x-s];
+    double next     = in[x+s];
+    out[x] = voxel_cast<VoxelType>(previous - next);
+  }
 }
 
 
+template <class VoxelType> void irtkGradientImageZ<VoxelType>
+::FilterBoundary(irtkNoRowFilterState &state, const irtkImageRowSegment<VoxelType> &row) const
+{
+  const int n = this->_input->GetZ();
+  VoxelType *out = row._Output;
+
+  if (row._Z > 0 && row._Z < n-1) {
+    this->FilterInterior(state, row);
+  } else {
+    for (int x = row._X1; x < row._X2; ++x) out[x] = 0;
+  }
+}
+
 template class  irtkGradientImageZ<irtkBytePixel>;
 template class  irtkGradientImageZ<irtkGreyPixel>;
 template class  irtkGradientImageZ<irtkRealPixel>;
@@ -17,26 +17,34 @@
 #include <irtkImage.h>
 
 #include <irtkHistogram.h>
+#include <irtkImageHistogram_1D.h>
+#include <irtkPartialHistograms.h>
+
+template <class VoxelType> struct irtkImageHistogramBin_1D
+{
+	const irtkHistogram_1D<double> *_Histogram;
+	const VoxelType                *_Data;
+	double                          _Padding;
+
+	int operator ()(int idx) const
+	{
+		const double value = static_cast<double>(_Data[idx]);
+		if (value <= _Padding) return -1;
+		return _Histogram->ValToBin(value);
+	}
+};
 
 template <class VoxelType> void irtkImageHistogram_1D<VoxelType>::Evaluate(irtkGenericImage<VoxelType> *image, double padding)
 {  
-	double value,min,max;
-	int i,j,k,l;
+	double min,max;
 	image->GetMinMaxAsDouble(&min,&max);
 	this->PutMin(min);
 	this->PutMax(max);
 	this->PutNumberOfBins(512);
-	for (l = 0; l < image->GetT(); l++){
-		for (k = 0; k < image->GetZ(); k++){
-			for (j = 0; j < image->GetY(); j++){
-				for (i = 0; i < image->GetX(); i++){
-					value = image->GetAsDouble(i, j, k, l);
-					if(value > padding)
-						this->AddSample(value);
-				}
-			}
-		}
-	}
+	irtkImageHistogramBin_1D<VoxelType> bin = {this, image->Data(), padding};
+	irtkPartialHistograms counts;
+	counts.Count(this->_nbins, image->NumberOfVoxels(), bin);
+	this->_nsamp += counts.AddTo(this->_bins);
 }
 
 template <class VoxelType> void irtkImageHistogram_1D<VoxelType>::BackProject(irtkGenericImage<VoxelType> *image)
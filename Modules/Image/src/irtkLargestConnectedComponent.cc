@@ -20,7 +20,6 @@
 
 template <class VoxelType> irtkLargestConnectedComponent<VoxelType>::irtkLargestConnectedComponent(VoxelType ClusterLabel)
 {
-  _currentClusterSize = 0;
   _largestClusterSize = 0;
   _Mode2D = false;
   _ClusterLabel = ClusterLabel;
@@ -29,120 +28,25 @@ template <class VoxelType> irtkLargestConnectedComponent<VoxelType>::irtkLargest
 template <class VoxelType> irtkLargestConnectedComponent<VoxelType>::~irtkLargestConnectedComponent(void)
 {}
 
-template <class VoxelType> void irtkLargestConnectedComponent<VoxelType>::Grow2D(int x, int y, int z, int t)
-{
-  if ((x >= 0) && (x < this->_input->GetX()) && (y >= 0) && (y < this->_input->GetY()) &&
-      (z >= 0) && (z < this->_input->GetZ()) && (t >= 0) && (t < this->_input->GetT())) {
-    if ((this->_input->Get(x, y, z, t) == this->_ClusterLabel) && (this->_output->Get(x, y, z, t) == 0)) {
-      this->_output->Put(x, y, z, t, 1);
-      this->_currentClusterSize++;
-      this->Grow2D(x-1, y  , z, t);
-      this->Grow2D(x+1, y  , z, t);
-      this->Grow2D(x  , y-1, z, t);
-      this->Grow2D(x  , y+1, z, t);
-    }
-  }
-}
-
-template <class VoxelType> void irtkLargestConnectedComponent<VoxelType>::Grow3D(int x, int y, int z, int t)
-{
-  if ((x >= 0) && (x < this->_input->GetX()) && (y >= 0) && (y < this->_input->GetY()) &&
-      (z >= 0) && (z < this->_input->GetZ()) && (t >= 0) && (t < this->_input->GetT())) {
-    if ((this->_input->Get(x, y, z, t) == this->_ClusterLabel) && (this->_output->Get(x, y, z, t) == 0)) {
-      this->_output->Put(x, y, z, t, 1);
-      this->_currentClusterSize++;
-      this->Grow3D(x-1, y  , z  , t);
-      this->Grow3D(x+1, y  , z  , t);
-      this->Grow3D(x  , y-1, z  , t);
-      this->Grow3D(x  , y+1, z  , t);
-      this->Grow3D(x  , y  , z-1, t);
-      this->Grow3D(x  , y  , z+1, t);
-    }
-  }
-}
-
 template <class VoxelType> void irtkLargestConnectedComponent<VoxelType>::Run()
 {
-  int x, y, z, t = 0, largestClusterSeed_x, largestClusterSeed_y, largestClusterSeed_z;
-
   // Do the initial set up
   this->Initialize();
 
-  // Check if the input is 4D
-  if (this->_input->GetT() > 1) {
-    cerr << "irtkLargestConnectedComponent<VoxelType>::Run(): 4D images not yet supported\n" << endl;
-    exit(1);
-  }
-
-  // Do conneted component analysis
-  for (z = 0; z < this->_input->GetZ(); z++) {
-    for (y = 0; y < this->_input->GetY(); y++) {
-      for (x = 0; x < this->_input->GetX(); x++) {
-        this->_output->Put(x, y, z, t, 0);
-      }
+  // Do connected component analysis
+  irtkConnectedComponents<VoxelType> components(_Mode2D ? CONNECTIVITY_04 : CONNECTIVITY_06);
+  components.Mode2D(_Mode2D);
+  components.Run(this->_input, _ClusterLabel);
+  components.ExtractLargestComponent(this->_output);
+
+  this->_largestClusterSize = 0;
+  for (int c = 0; c < components.NumberOfChunks(); c++) {
+    const int label = components.LargestComponent(c);
+    if (label > 0 && components.Component(label, c)._Size > this->_largestClusterSize) {
+      this->_largestClusterSize = components.Component(label, c)._Size;
     }
   }
 
-  if (this->_Mode2D == true) {
-
-    for (z = 0; z < this->_input->GetZ(); z++) {
-      largestClusterSeed_x = 0;
-      largestClusterSeed_y = 0;
-      largestClusterSeed_z = z;
-
-      for (y = 0; y < this->_input->GetY(); y++) {
-        for (x = 0; x < this->_input->GetX(); x++) {
-          this->_currentClusterSize = 0;
-          this->Grow2D(x, y, z, t);
-          if (this->_currentClusterSize > this->_largestClusterSize) {
-            this->_largestClusterSize   = this->_currentClusterSize;
-            largestClusterSeed_x = x;
-            largestClusterSeed_y = y;
-            largestClusterSeed_z = z;
-          }
-        }
-      }
-
-      for (y = 0; y < this->_input->GetY(); y++) {
-        for (x = 0; x < this->_input->GetX(); x++) {
-          this->_output->Put(x, y, z, t, 0);
-        }
-      }
-
-      this->Grow2D(largestClusterSeed_x, largestClusterSeed_y, largestClusterSeed_z, t);
-    }
-  } else {
-
-    largestClusterSeed_x = 0;
-    largestClusterSeed_y = 0;
-    largestClusterSeed_z = 0;
-
-    for (z = 0; z < this->_input->GetZ(); z++) {
-      for (y = 0; y < this->_input->GetY(); y++) {
-        for (x = 0; x < this->_input->GetX(); x++) {
-          this->_currentClusterSize = 0;
-          this->Grow3D(x, y, z, t);
-          if (this->_currentClusterSize > this->_largestClusterSize) {
-            this->_largestClusterSize   = this->_currentClusterSize;
-            largestClusterSeed_x = x;
-            largestClusterSeed_y = y;
-            largestClusterSeed_z = z;
-          }
-        }
-      }
-    }
-
-    for (z = 0; z < this->_input->GetZ(); z++) {
-      for (y = 0; y < this->_input->GetY(); y++) {
-        for (x = 0; x < this->_input->GetX(); x++) {
-          this->_output->Put(x, y, z, t, 0);
-        }
-      }
-    }
-
-    this->Grow3D(largestClusterSeed_x, largestClusterSeed_y, largestClusterSeed_z, t);
-  }
-
   // Do the final cleaning up
   this->Finalize();
 }
@@ -18,7 +18,155 @@
 #include <irtkMedianFilter.h>
 #include <vector>
 #include <algorithm>
-#include <set>
+
+
+// =============================================================================
+// Auxiliary functors
+// =============================================================================
+
+namespace irtkMedianFilterUtils {
+
+// -----------------------------------------------------------------------------
+/// Maximum number of histogram bins used by sliding window median filter
+const double MaxNumberOfBins = 65536;
+
+// -----------------------------------------------------------------------------
+/// Common attributes of median filter bodies
+template <class VoxelType>
+struct MedianFilterBody
+{
+  const VoxelType     *_Input;  ///< Input frame
+  VoxelType           *_Output; ///< Output frame
+  const irtkRealPixel *_Mask;   ///< Mask frame or NULL
+  int                  _X, _Y, _Z;
+  int                  _Radius;
+
+  /// Whether voxel at given index is included in the neighbourhood
+  bool IsInside(int idx) const
+  {
+    return _Mask == NULL || _Mask[idx] != .0;
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Median of sliding window histogram with incremental update
+///
+/// The histogram of the window is computed once for the first voxel of each
+/// slab of slices. The window is then moved along a serpentine path through
+/// the slab, i.e., back and forth along the rows and the columns, such that
+/// each move only removes the samples of the leaving plane from and adds the
+/// samples of the entering plane to the histogram. The median bin is tracked
+/// following Huang's algorithm, i.e., the number of samples below the current
+/// median bin is updated with each sample and the median bin is then moved
+/// from the previous median by as many bins as needed.
+template <class VoxelType>
+struct HistogramMedian : public MedianFilterBody<VoxelType>
+{
+  double _Min;          ///< Minimum intensity, i.e., value of first bin
+  int    _NumberOfBins; ///< Number of integer bins
+
+  int Bin(const VoxelType &value) const
+  {
+    return static_cast<int>(static_cast<double>(value) - _Min);
+  }
+
+  void Add(vector<int> &hist, int x1, int x2, int y1, int y2, int z1, int z2,
+           int med, int &lt, int &n, int inc) const
+  {
+    int idx, bin;
+    for (int z = z1; z <= z2; ++z)
+    for (int y = y1; y <= y2; ++y)
+    for (int x = x1; x <= x2; ++x) {
+      idx = (z * this->_Y + y) * this->_X + x;
+      if (this->IsInside(idx)) {
+        bin = Bin(this->_Input[idx]);
+        hist[bin] += inc;
+        if (bin < med) lt += inc;
+        n += inc;
+      }
+    }
+  }
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int r = this->_Radius;
+    vector<int> hist(_NumberOfBins, 0);
+    int med = 0, lt = 0, n = 0, k, idx;
+    // Histogram of window at first voxel of slab
+    int x = r, y = r, z = re.begin(), dx = 1, dy = 1;
+    Add(hist, x - r, x + r, y - r, y + r, z - r, z + r, med, lt, n, +1);
+    while (true) {
+      idx = (z * this->_Y + y) * this->_X + x;
+      if (n == 0) {
+        this->_Output[idx] = this->_Input[idx];
+      } else {
+        // Move median bin such that lt <= k < lt + hist[med]
+        k = n / 2;
+        while (lt > k) lt -= hist[--med];
+        while (lt + hist[med] <= k) lt += hist[med++];
+        this->_Output[idx] = static_cast<VoxelType>(_Min + med);
+      }
+      // Move window to next voxel along serpentine path
+      if (r <= x + dx && x + dx < this->_X - r) {
+        Add(hist, x - dx * r,       x - dx * r,       y - r, y + r, z - r, z + r, med, lt, n, -1);
+        Add(hist, x + dx * (r + 1), x + dx * (r + 1), y - r, y + r, z - r, z + r, med, lt, n, +1);
+        x += dx;
+      } else if (r <= y + dy && y + dy < this->_Y - r) {
+        Add(hist, x - r, x + r, y - dy * r,       y - dy * r,       z - r, z + r, med, lt, n, -1);
+        Add(hist, x - r, x + r, y + dy * (r + 1), y + dy * (r + 1), z - r, z + r, med, lt, n, +1);
+        y += dy, dx = -dx;
+      } else if (z + 1 < re.end()) {
+        Add(hist, x - r, x + r, y - r, y + r, z - r,     z - r,     med, lt, n, -1);
+        Add(hist, x - r, x + r, y - r, y + r, z + r + 1, z + r + 1, med, lt, n, +1);
+        z += 1, dx = -dx, dy = -dy;
+      } else {
+        break;
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Median of window determined by partial sorting of reused buffer
+template <class VoxelType>
+struct SelectMedian : public MedianFilterBody<VoxelType>
+{
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int r = this->_Radius;
+    vector<VoxelType> values;
+    values.reserve((2 * r + 1) * (2 * r + 1) * (2 * r + 1));
+    typename vector<VoxelType>::iterator nth;
+    int idx;
+    for (int z = re.begin(); z != re.end(); ++z)
+    for (int y = r; y < this->_Y - r; ++y)
+    for (int x = r; x < this->_X - r; ++x) {
+      values.clear();
+      for (int zz = z - r; zz <= z + r; ++zz)
+      for (int yy = y - r; yy <= y + r; ++yy)
+      for (int xx = x - r; xx <= x + r; ++xx) {
+        idx = (zz * this->_Y + yy) * this->_X + xx;
+        if (this->IsInside(idx)) values.push_back(this->_Input[idx]);
+      }
+      idx = (z * this->_Y + y) * this->_X + x;
+      if (values.empty()) {
+        this->_Output[idx] = this->_Input[idx];
+      } else {
+        nth = values.begin() + values.size() / 2;
+        nth_element(values.begin(), nth, values.end());
+        this->_Output[idx] = *nth;
+      }
+    }
+  }
+};
+
+
+} // namespace irtkMedianFilterUtils
+using namespace irtkMedianFilterUtils;
+
+// =============================================================================
+// irtkMedianFilter
+// =============================================================================
 
 template <class VoxelType> irtkMedianFilter<VoxelType>::irtkMedianFilter()
 {
@@ -51,46 +199,68 @@ template <class VoxelType> void irtkMedianFilter<VoxelType>::SetMask(irtkRealIma
 
 template <class VoxelType> void irtkMedianFilter<VoxelType>::Run()
 {
-  int x, y, z, t;
-
-  //int dim = 2*_kernelRadius + 1;
-
   // Do the initial set up
   this->Initialize();
 
-  multiset<VoxelType> voxels;
-
-  for (t = 0; t < this->_input->GetT(); t++) {
-    for (z = 0; z < this->_input->GetZ(); z++) {
-      for (y = 0; y < this->_input->GetY(); y++) {
-        for (x = 0; x < this->_input->GetX(); x++) {
-          if ((x < _kernelRadius) || (x > this->_input->GetX() - 1 - _kernelRadius) ||
-              (y < _kernelRadius) || (y > this->_input->GetY() - 1 - _kernelRadius) ||
-              (z < _kernelRadius) || (z > this->_input->GetZ() - 1 - _kernelRadius)) {
-            this->_output->Put(x, y, z, t, this->_input->Get(x, y, z, t));
-          } else {
-        	  vector<VoxelType> voxels;
-        	  for( int zz = z - _kernelRadius; zz <= z + _kernelRadius; ++zz )
-        	  {
-        		  for( int yy = y - _kernelRadius; yy <= y + _kernelRadius; ++yy )
-        		  {
-        			  for( int xx = x - _kernelRadius; xx <= x + _kernelRadius; ++xx )
-        			  {
-        				  if( this->_mask->Get(xx,yy,zz,t) ) {
-        					  voxels.push_back( this->_input->Get(xx,yy,zz,t) );
-        				  }
-        			  }
-        		  }
-        	  }
-        	  if( voxels.size() )
-        	  {
-        		  sort(voxels.begin(), voxels.end());
-        		  this->_output->Put(x, y, z, t, voxels[voxels.size()/2]);
-        	  }
-          }
-        }
+  const int X = this->_input->GetX();
+  const int Y = this->_input->GetY();
+  const int Z = this->_input->GetZ();
+  const int r = _kernelRadius;
+  const int n = X * Y * Z;
+
+  if (_mask && (_mask->GetX() != X || _mask->GetY() != Y || _mask->GetZ() != Z)) {
+    cerr << "irtkMedianFilter::Run: Mask must have same size as input image" << endl;
+    exit(1);
+  }
+
+  for (int t = 0; t < this->_input->GetT(); t++) {
+    const VoxelType     *input  = this->_input ->GetPointerToVoxels(0, 0, 0, t);
+    VoxelType           *output = this->_output->GetPointerToVoxels(0, 0, 0, t);
+    const irtkRealPixel *mask   = NULL;
+    if (_mask) mask = _mask->GetPointerToVoxels(0, 0, 0, t < _mask->GetT() ? t : 0);
+
+    // Copy input values near the image boundary
+    memcpy(output, input, n * sizeof(VoxelType));
+    if (X <= 2 * r || Y <= 2 * r || Z <= 2 * r) continue;
+
+    // Use sliding window histogram if input has only few integer values
+    double min = input[0], max = input[0];
+    bool   integral = true;
+    for (int idx = 0; idx < n; ++idx) {
+      const double value = static_cast<double>(input[idx]);
+      if      (value < min) min = value;
+      else if (value > max) max = value;
+      if (value != floor(value)) {
+        integral = false;
+        break;
       }
     }
+
+    // Slabs of slices are filtered in parallel
+    blocked_range<int> slices(r, Z - r);
+    if (integral && max - min < MaxNumberOfBins) {
+      HistogramMedian<VoxelType> body;
+      body._Input        = input;
+      body._Output       = output;
+      body._Mask         = mask;
+      body._X            = X;
+      body._Y            = Y;
+      body._Z            = Z;
+      body._Radius       = r;
+      body._Min          = min;
+      body._NumberOfBins = static_cast<int>(max - min) + 1;
+      parallel_for(slices, body);
+    } else {
+      SelectMedian<VoxelType> body;
+      body._Input  = input;
+      body._Output = output;
+      body._Mask   = mask;
+      body._X      = X;
+      body._Y      = Y;
+      body._Z      = Z;
+      body._Radius = r;
+      parallel_for(slices, body);
+    }
   }
 
   // Do the final cleaning up
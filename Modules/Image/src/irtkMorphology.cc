@@ -0,0 +1,379 @@
+/* The Image Registration Toolkit (IRTK)
+ *
+ * Copyright 2008-2015 Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#include <irtkImage.h>
+#include <irtkMorphology.h>
+#include <irtkEuclideanDistanceTransform.h>
+#include <limits>
+#include <vector>
+
+
+// =============================================================================
+// Auxiliary functors
+// =============================================================================
+
+namespace irtkMorphologyUtils {
+
+// -----------------------------------------------------------------------------
+/// Maximum of two values, i.e., dilation
+template <class VoxelType>
+struct Maximum
+{
+  static const bool IsDilation = true;
+
+  static VoxelType Identity()
+  {
+    return numeric_limits<VoxelType>::is_integer ? numeric_limits<VoxelType>::min()
+                                                 : -numeric_limits<VoxelType>::max();
+  }
+
+  VoxelType operator ()(VoxelType a, VoxelType b) const
+  {
+    return (a < b ? b : a);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Minimum of two values, i.e., erosion
+template <class VoxelType>
+struct Minimum
+{
+  static const bool IsDilation = false;
+
+  static VoxelType Identity()
+  {
+    return numeric_limits<VoxelType>::max();
+  }
+
+  VoxelType operator ()(VoxelType a, VoxelType b) const
+  {
+    return (b < a ? b : a);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// van Herk/Gil-Werman running maximum/minimum over windows of size 2r+1
+///
+/// The line is padded by r identity elements on both sides and up to a
+/// multiple of the window size. Within each block of the padded line, the
+/// prefix extrema are stored in g and the suffix extrema in h. A window which
+/// starts at padded index i covers the end of one block and the beginning of
+/// the next, and its extremum is thus op(h[i], g[i + 2r]).
+template <class VoxelType, class Op>
+void RunningExtremum(VoxelType *line, int n, int r, const Op &op,
+                     vector<VoxelType> &f, vector<VoxelType> &g, vector<VoxelType> &h)
+{
+  const int w = 2 * r + 1;
+  const int m = ((n + 2 * r + w - 1) / w) * w;
+  const VoxelType id = Op::Identity();
+  f.resize(m), g.resize(m), h.resize(m);
+  for (int i = 0;     i < r;     ++i) f[i] = id;
+  for (int i = 0;     i < n;     ++i) f[r + i] = line[i];
+  for (int i = r + n; i < m;     ++i) f[i] = id;
+  for (int i = 0;     i < m;     ++i) g[i] = (i % w == 0     ? f[i] : op(g[i-1], f[i]));
+  for (int i = m - 1; i >= 0;    --i) h[i] = (i % w == w - 1 ? f[i] : op(h[i+1], f[i]));
+  for (int i = 0;     i < n;     ++i) line[i] = op(h[i], g[i + 2 * r]);
+}
+
+// -----------------------------------------------------------------------------
+/// Indices of first voxels of all discrete lines along direction d
+void LineStarts(int nx, int ny, int nz, int dx, int dy, int dz, vector<int> &starts)
+{
+  starts.clear();
+  for (int k = 0; k < nz; ++k)
+  for (int j = 0; j < ny; ++j) {
+    const int idx = (k * ny + j) * nx;
+    if (j - dy < 0 || j - dy >= ny || k - dz < 0 || k - dz >= nz) {
+      for (int i = 0; i < nx; ++i) starts.push_back(idx + i);
+    } else if (dx > 0) {
+      starts.push_back(idx);
+    } else if (dx < 0) {
+      starts.push_back(idx + nx - 1);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Filter lines along direction d in place by running maximum/minimum
+///
+/// Each task uses its own line and scratch buffers. The lines are disjoint,
+/// and no voxel is thus read or written by more than one task.
+template <class VoxelType, class Op>
+struct FilterLines
+{
+  VoxelType        *_Image;
+  const int        *_Starts;
+  int               _X, _Y, _Z;
+  int               _DX, _DY, _DZ;
+  int               _Radius;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    Op op;
+    vector<VoxelType> line, f, g, h;
+    vector<int>       index;
+    const int offset = (_DZ * _Y + _DY) * _X + _DX;
+    for (int l = re.begin(); l != re.end(); ++l) {
+      int idx = _Starts[l];
+      int i   = idx % _X;
+      int j   = (idx / _X) % _Y;
+      int k   = idx / (_X * _Y);
+      index.clear();
+      while (0 <= i && i < _X && 0 <= j && j < _Y && 0 <= k && k < _Z) {
+        index.push_back(idx);
+        idx += offset, i += _DX, j += _DY, k += _DZ;
+      }
+      const int n = static_cast<int>(index.size());
+      if (n < 2) continue;
+      line.resize(n);
+      for (int s = 0; s < n; ++s) line[s] = _Image[index[s]];
+      RunningExtremum(&line[0], n, _Radius, op, f, g, h);
+      for (int s = 0; s < n; ++s) _Image[index[s]] = line[s];
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Filter image frame in place along one direction
+template <class VoxelType, class Op>
+void FilterDirection(VoxelType *image, int nx, int ny, int nz,
+                     int dx, int dy, int dz, int r, vector<int> &starts)
+{
+  if (r <= 0) return;
+  if (nz == 1 && dz != 0) return;
+  LineStarts(nx, ny, nz, dx, dy, dz, starts);
+  FilterLines<VoxelType, Op> body;
+  body._Image  = image;
+  body._Starts = &starts[0];
+  body._X      = nx;
+  body._Y      = ny;
+  body._Z      = nz;
+  body._DX     = dx;
+  body._DY     = dy;
+  body._DZ     = dz;
+  body._Radius = r;
+  parallel_for(blocked_range<int>(0, static_cast<int>(starts.size())), body);
+}
+
+// -----------------------------------------------------------------------------
+/// Binary mask of foreground or background of image frame
+template <class VoxelType>
+struct BinaryMask
+{
+  const VoxelType *_Input;
+  irtkRealPixel   *_Mask;
+  bool             _Foreground;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int idx = re.begin(); idx != re.end(); ++idx) {
+      _Mask[idx] = ((_Input[idx] != VoxelType(0)) == _Foreground ? 1 : 0);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Threshold squared distances to obtain binary dilation or erosion
+template <class VoxelType>
+struct ThresholdDistance
+{
+  const irtkRealPixel *_Distance;
+  VoxelType           *_Output;
+  double               _Threshold;
+  bool                 _Dilate;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int idx = re.begin(); idx != re.end(); ++idx) {
+      const bool inside = (_Distance[idx] <= _Threshold);
+      _Output[idx] = (inside == _Dilate ? VoxelType(1) : VoxelType(0));
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Dilate or erode binary image by exact ball using distance transform
+template <class VoxelType>
+void FilterBall(const irtkGenericImage<VoxelType> *input,
+                irtkGenericImage<VoxelType> *output, int r, bool dilate)
+{
+  // Distances are measured in voxel units
+  irtkImageAttributes attr = input->GetImageAttributes();
+  attr._t  = 1;
+  attr._dx = attr._dy = attr._dz = 1.0;
+  irtkGenericImage<irtkRealPixel> mask(attr), dist(attr);
+  const int nvox = input->GetX() * input->GetY() * input->GetZ();
+
+  irtkEuclideanDistanceTransform<irtkRealPixel> edt;
+  edt.SetInput (&mask);
+  edt.SetOutput(&dist);
+
+  for (int t = 0; t < input->GetT(); ++t) {
+    // Distance of voxels to foreground (dilation) or background (erosion)
+    BinaryMask<VoxelType> binarize;
+    binarize._Input      = input->GetPointerToVoxels(0, 0, 0, t);
+    binarize._Mask       = mask.GetPointerToVoxels();
+    binarize._Foreground = dilate;
+    parallel_for(blocked_range<int>(0, nvox), binarize);
+    edt.Run();
+    // Voxels within ball of radius r
+    ThresholdDistance<VoxelType> threshold;
+    threshold._Distance  = dist.GetPointerToVoxels();
+    threshold._Output    = output->GetPointerToVoxels(0, 0, 0, t);
+    threshold._Threshold = static_cast<double>(r) * static_cast<double>(r);
+    threshold._Dilate    = dilate;
+    parallel_for(blocked_range<int>(0, nvox), threshold);
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Dilate or erode image by structuring element
+template <class VoxelType, class Op>
+void Filter(const irtkGenericImage<VoxelType> *input, irtkGenericImage<VoxelType> *output,
+            int r, irtkStructuringElement element, const char *name)
+{
+  if (r < 0) {
+    cerr << name << ": Radius must be non-negative" << endl;
+    exit(1);
+  }
+  if (output != input) *output = *input;
+
+  const int  nx     = input->GetX();
+  const int  ny     = input->GetY();
+  const int  nz     = input->GetZ();
+  const bool volume = (nz > 1);
+
+  if (element == StructuringElement_Ball) {
+    if (r > 0) FilterBall(input, output, r, Op::IsDilation);
+    return;
+  }
+
+  int a = r, b = 0, c = 0;
+  if (element == StructuringElement_Sphere) {
+    irtkMorphology<VoxelType>::SphereDecomposition(r, volume, a, b, c);
+  } else if (element != StructuringElement_Box) {
+    cerr << name << ": Unknown structuring element: " << element << endl;
+    exit(1);
+  }
+
+  // Lines along diagonals would be clipped by the image boundary individually,
+  // which differs from clipping their Minkowski sum. The frame is therefore
+  // padded by identity elements up to the extent of the structuring element.
+  const int p  = (b > 0 || c > 0 ? r : 0);
+  const int px = nx + 2 * p;
+  const int py = ny + 2 * p;
+  const int pz = (volume ? nz + 2 * p : 1);
+  const int pk = (volume ? p : 0);
+  vector<VoxelType> padded(p > 0 ? px * py * pz : 0, Op::Identity());
+
+  vector<int> starts;
+  for (int t = 0; t < input->GetT(); ++t) {
+    VoxelType *frame = output->GetPointerToVoxels(0, 0, 0, t);
+    VoxelType *image = frame;
+    if (p > 0) {
+      image = &padded[0];
+      for (int k = 0; k < nz; ++k)
+      for (int j = 0; j < ny; ++j) {
+        memcpy(image + ((k + pk) * py + j + p) * px + p, frame + (k * ny + j) * nx, nx * sizeof(VoxelType));
+      }
+    }
+    // Axes
+    FilterDirection<VoxelType, Op>(image, px, py, pz, 1, 0, 0, a, starts);
+    FilterDirection<VoxelType, Op>(image, px, py, pz, 0, 1, 0, a, starts);
+    FilterDirection<VoxelType, Op>(image, px, py, pz, 0, 0, 1, a, starts);
+    // Face diagonals
+    FilterDirection<VoxelType, Op>(image, px, py, pz, 1,  1,  0, b, starts);
+    FilterDirection<VoxelType, Op>(image, px, py, pz, 1, -1,  0, b, starts);
+    FilterDirection<VoxelType, Op>(image, px, py, pz, 1,  0,  1, b, starts);
+    FilterDirection<VoxelType, Op>(image, px, py, pz, 1,  0, -1, b, starts);
+    FilterDirection<VoxelType, Op>(image, px, py, pz, 0,  1,  1, b, starts);
+    FilterDirection<VoxelType, Op>(image, px, py, pz, 0,  1, -1, b, starts);
+    // Body diagonals
+    FilterDirection<VoxelType, Op>(image, px, py, pz, 1,  1,  1, c, starts);
+    FilterDirection<VoxelType, Op>(image, px, py, pz, 1,  1, -1, c, starts);
+    FilterDirection<VoxelType, Op>(image, px, py, pz, 1, -1,  1, c, starts);
+    FilterDirection<VoxelType, Op>(image, px, py, pz, 1, -1, -1, c, starts);
+    if (p > 0) {
+      for (int k = 0; k < nz; ++k)
+      for (int j = 0; j < ny; ++j) {
+        memcpy(frame + (k * ny + j) * nx, image + ((k + pk) * py + j + p) * px + p, nx * sizeof(VoxelType));
+      }
+      fill(padded.begin(), padded.end(), Op::Identity());
+    }
+  }
+}
+
+
+} // namespace irtkMorphologyUtils
+using namespace irtkMorphologyUtils;
+
+// =============================================================================
+// irtkMorphology
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+void irtkMorphology<VoxelType>::Dilate(const irtkGenericImage<VoxelType> *input,
+                                       irtkGenericImage<VoxelType>       *output,
+                                       int radius, irtkStructuringElement element)
+{
+  Filter<VoxelType, Maximum<VoxelType> >(input, output, radius, element, "irtkMorphology::Dilate");
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+void irtkMorphology<VoxelType>::Erode(const irtkGenericImage<VoxelType> *input,
+                                      irtkGenericImage<VoxelType>       *output,
+                                      int radius, irtkStructuringElement element)
+{
+  Filter<VoxelType, Minimum<VoxelType> >(input, output, radius, element, "irtkMorphology::Erode");
+}
+
+// -----------------------------------------------------------------------------
+template <class VoxelType>
+void irtkMorphology<VoxelType>::SphereDecomposition(int r, bool volume, int &a, int &b, int &c)
+{
+  // The extent of the Minkowski sum along an axis is a + 4b + 4c in 3D and
+  // a + 2b in 2D, respectively, which is made equal to the radius. The
+  // remaining degrees of freedom minimize the deviation of the extents
+  // along the diagonals, i.e., sqrt(2) (a + 3b + 2c) and sqrt(3) (a + 2b + 2c)
+  // in 3D and sqrt(2) (a + b) in 2D, from the radius.
+  a = r, b = c = 0;
+  double error, min_error = numeric_limits<double>::infinity();
+  if (volume) {
+    for (int j = 0; 4 * j <= r; ++j)
+    for (int k = 0; 4 * (j + k) <= r; ++k) {
+      const int i = r - 4 * (j + k);
+      error = max(fabs(sqrt(2.0) * (i + 3 * j + 2 * k) - r),
+                  fabs(sqrt(3.0) * (i + 2 * j + 2 * k) - r));
+      if (error < min_error) a = i, b = j, c = k, min_error = error;
+    }
+  } else {
+    for (int j = 0; 2 * j <= r; ++j) {
+      const int i = r - 2 * j;
+      error = fabs(sqrt(2.0) * (i + j) - r);
+      if (error < min_error) a = i, b = j, min_error = error;
+    }
+  }
+}
+
+// =============================================================================
+// Explicit instantiations
+// =============================================================================
+
+template class irtkMorphology<irtkBytePixel>;
+template class irtkMorphology<irtkGreyPixel>;
+template class irtkMorphology<irtkRealPixel>;
@@ -20,14 +20,247 @@
 
 #include <irtkGradientImage.h>
 
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+
+// =============================================================================
+// Auxiliary functors
+// =============================================================================
+
+namespace irtkNonLocalMedianFilterUtils {
+
+// -----------------------------------------------------------------------------
+/// Size of image and of its copy padded by mirroring at the boundary
+struct Padding
+{
+    int _X, _Y, _Z;
+    int _PX, _PY, _PZ;
+    int _PadXY, _PadZ;
+
+    /// Mirror index around boundary or -1 if outside even after mirroring
+    static int Mirror(int i, int n)
+    {
+        if      (i <  0) i = -i;
+        else if (i >= n) i = 2 * n - i - 2;
+        return (0 <= i && i < n ? i : -1);
+    }
+};
+
+// -----------------------------------------------------------------------------
+/// Copy image into padded image with mirrored boundary
+template <class TIn, class TOut>
+struct PadImage
+{
+    const TIn *_Input;
+    TOut      *_Output;
+    Padding    _Padding;
+    TOut       _Outside; ///< Value of voxels outside the mirrored image
+
+    void operator ()(const blocked_range<int> &re) const
+    {
+        const Padding &p = _Padding;
+        for (int row = re.begin(); row != re.end(); ++row) {
+            const int j = Padding::Mirror(row % p._PY - p._PadXY, p._Y);
+            const int k = Padding::Mirror(row / p._PY - p._PadZ,  p._Z);
+            TOut *out = _Output + row * p._PX;
+            for (int pi = 0; pi < p._PX; ++pi) {
+                const int i = Padding::Mirror(pi - p._PadXY, p._X);
+                if (i < 0 || j < 0 || k < 0) out[pi] = _Outside;
+                else out[pi] = static_cast<TOut>(_Input[(k * p._Y + j) * p._X + i]);
+            }
+        }
+    }
+};
+
+// -----------------------------------------------------------------------------
+/// Offsets of neighbours in padded image and their spatial weights
+struct Window
+{
+    vector<int>    _Offset;
+    vector<double> _Weight;
+};
+
+// -----------------------------------------------------------------------------
+/// Neighbour value and its non-local weight
+struct Sample
+{
+    float _Value;
+    float _Weight;
+};
+
+// -----------------------------------------------------------------------------
+/// Order samples by value
+struct CompareValues
+{
+    bool operator ()(const Sample &a, const Sample &b) const
+    {
+        return a._Value < b._Value;
+    }
+};
+
+// -----------------------------------------------------------------------------
+/// Weighted median of sorted samples following weightedmedian for lambda = 0
+///
+/// Of the cumulative weights W_k, k = 0, ..., n, before each sample, those
+/// below one half are counted positively and those above negatively. When
+/// W_k equals one half for several k, the median is thus the middle one of
+/// the samples with zero weight following the sample which completes half
+/// of the total weight.
+float SortedWeightedMedian(Sample *s, int n)
+{
+    sort(s, s + n, CompareValues());
+    double csum = 1.0;
+    int    pos  = 0;
+    for (int i = 0; i <= n; ++i) {
+        if (csum > 0) ++pos;
+        if (csum < 0) --pos;
+        if (i < n) csum -= 2.0 * s[i]._Weight;
+    }
+    return s[(n + 1 + pos) / 2 - 1]._Value;
+}
+
+// -----------------------------------------------------------------------------
+/// Weighted median of samples with normalized weights, i.e., the smallest
+/// sample value at which the cumulative weight reaches one half
+///
+/// This is the value of weightedmedian for lambda = 0, which is here selected
+/// in expected linear time by quickselect with three-way partitioning. Only
+/// when a cumulative weight equals one half exactly, the samples are sorted.
+float WeightedMedian(Sample *s, int n)
+{
+    double acc = .0;
+    int lo = 0, hi = n;
+    while (true) {
+        const float pivot = s[lo + (hi - lo) / 2]._Value;
+        int lt = lo, i = lo, gt = hi;
+        double wl = .0, we = .0;
+        while (i < gt) {
+            if (s[i]._Value < pivot) {
+                wl += s[i]._Weight;
+                swap(s[lt++], s[i++]);
+            } else if (pivot < s[i]._Value) {
+                swap(s[i], s[--gt]);
+            } else {
+                we += s[i]._Weight;
+                ++i;
+            }
+        }
+        if (acc + wl == .5 || acc + wl + we == .5) {
+            return SortedWeightedMedian(s, n);
+        } else if (acc + wl > .5) {
+            hi = lt;
+        } else if (acc + wl + we > .5 || gt == hi) {
+            return pivot;
+        } else {
+            acc += wl + we;
+            lo   = gt;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+/// Non-local median of rows of voxels
+template <class VoxelType>
+struct NonLocalMedian
+{
+    const float         *_Values;      ///< Padded frame, NaN outside mirrored image
+    const irtkGreyPixel *_Scale;       ///< Padded scale image or NULL
+    const float         *_Occlusion;   ///< Padded occlusion image or NULL
+    const double        *_ScaleWeight; ///< Weight of absolute scale difference
+    const Window        *_Window[2];   ///< Window elsewhere and at edges
+    const VoxelType     *_Edge;
+    const VoxelType     *_Input;
+    const VoxelType     *_Constrain;   ///< Constrain frame or NULL
+    VoxelType           *_Output;
+    Padding              _Padding;
+    double               _Lambda;
+
+    void operator ()(const blocked_range<int> &re) const
+    {
+        const Padding &p = _Padding;
+        vector<Sample> samples;
+        vector<float>  neighbors, weights;
+        for (int row = re.begin(); row != re.end(); ++row) {
+            const int y = row % p._Y;
+            const int z = row / p._Y;
+            for (int x = 0; x < p._X; ++x) {
+                const int idx    = row * p._X + x;
+                const int center = ((z + p._PadZ) * p._PY + y + p._PadXY) * p._PX + x + p._PadXY;
+                const Window &window = *_Window[_Edge[idx] > 0 ? 1 : 0];
+                const int    *offset = &window._Offset[0];
+                const double *weight = &window._Weight[0];
+                const int     m      = static_cast<int>(window._Offset.size());
+
+                // Collect neighbours with non-zero weight
+                samples.resize(m);
+                double sumofweight = .0;
+                int    n           = 0;
+                for (int s = 0; s < m; ++s) {
+                    const int nbr = center + offset[s];
+                    const float value = _Values[nbr];
+                    if (value != value) continue;
+                    double w = weight[s];
+                    if (_Scale) {
+                        w *= _ScaleWeight[abs(static_cast<int>(_Scale[nbr]) - static_cast<int>(_Scale[center]))];
+                        if (!(w > 0 && w < 1)) continue;
+                    }
+                    Sample &sample = samples[n++];
+                    sample._Value  = value;
+                    sample._Weight = static_cast<float>(w);
+                    if (_Occlusion) sample._Weight *= _Occlusion[nbr];
+                    sumofweight += sample._Weight;
+                }
+
+                // Weighted median
+                double median;
+                if (n == 0) {
+                    median = static_cast<double>(_Input[idx]);
+                } else if (_Lambda > 0) {
+                    neighbors.resize(n + 1);
+                    weights  .resize(n + 1);
+                    for (int s = 0; s < n; ++s) {
+                        neighbors[s+1] = samples[s]._Value;
+                        weights  [s+1] = samples[s]._Weight / sumofweight;
+                    }
+                    const double currentv = static_cast<double>(_Constrain ? _Constrain[idx] : _Input[idx]);
+                    median = weightedmedian(n + 1, _Lambda, currentv, &neighbors[0], &weights[0]);
+                } else if (!(sumofweight > .0)) {
+                    // Undefined normalized weights, for which weightedmedian returns
+                    // the upper median of the neighbours: all comparisons with the
+                    // NaN cumulative weight fail after the first sample, so that
+                    // pos = 1 and it returns element (n+2)/2 of its one-based array
+                    // of sorted values, i.e., neighbors[n/2] here
+                    neighbors.resize(n);
+                    for (int s = 0; s < n; ++s) neighbors[s] = samples[s]._Value;
+                    nth_element(neighbors.begin(), neighbors.begin() + n / 2, neighbors.end());
+                    median = neighbors[n / 2];
+                } else {
+                    for (int s = 0; s < n; ++s) samples[s]._Weight /= sumofweight;
+                    median = WeightedMedian(&samples[0], n);
+                }
+                _Output[idx] = voxel_cast<VoxelType>(median);
+            }
+        }
+    }
+};
+
+
+} // namespace irtkNonLocalMedianFilterUtils
+using namespace irtkNonLocalMedianFilterUtils;
+
+// =============================================================================
+// irtkNonLocalMedianFilter
+// =============================================================================
+
 
 template <class VoxelType> irtkNonLocalMedianFilter<VoxelType>::irtkNonLocalMedianFilter(
     int Sigma, irtkGenericImage<irtkGreyPixel>* input2, irtkGenericImage<irtkRealPixel>* input3
     , irtkGenericImage<VoxelType>* input4)
 {
     _Sigma = Sigma;
-    _localweight = NULL;
-    _localneighbor = NULL;
+    _edge = NULL;
 
     if(input2 != NULL)
         this->_input2 = input2;
@@ -51,105 +284,6 @@ template <class VoxelType> irtkNonLocalMedianFilter<VoxelType>::~irtkNonLocalMed
 {
 }
 
-template <class VoxelType> double irtkNonLocalMedianFilter<VoxelType>::Run(int x, int y, int z, int t){
-    double distancev,currentv,sumofweight;
-    int x1,y1,z1,x2,y2,z2,i,j,k,i1,j1,k1,index;
-
-    // if edge use orignal size or use smaller window size
-    if(_edge->Get(x,y,z,t) > 0){
-        // intialize range
-        x1 = x - _Sigma/2;
-        x2 = x + _Sigma/2;
-        y1 = y - _Sigma/2;
-        y2 = y + _Sigma/2;
-        z1 = z - _Sigma/2;
-        z2 = z + _Sigma/2;
-    }else{
-        // intialize range
-        x1 = x - _Sigma/4;
-        x2 = x + _Sigma/4;
-        y1 = y - _Sigma/4;
-        y2 = y + _Sigma/4;
-        z1 = z - _Sigma/4;
-        z2 = z + _Sigma/4;
-    }
-
-    if(this->_input->GetZ() == 1){
-        z1 = z;
-        z2 = z;
-    }
-
-    if(this->_input4 == NULL)
-       currentv = this->_input->GetAsDouble(x,y,z,t);
-    else
-       currentv = this->_input4->GetAsDouble(x,y,z,t);
-
-    index = 1;
-    sumofweight = 0;
-    // do the job find neighbor and weight
-    for(k = z1; k <= z2; k++){
-        for(j = y1; j <= y2; j++){
-            for(i = x1; i<= x2; i++){
-                // check if within image
-                // mirror the image around boundary according to Deqing Sun's matlab code;
-                i1 = i; j1 = j; k1 = k;
-                if(i < 0) 
-                    i1 = abs(i);
-                else if(i>=this->_input->GetX())
-                    i1 = 2*this->_input->GetX() - i - 2;
-
-                if(j < 0)
-                    j1 = abs(j);
-                else if(j>=this->_input->GetY())
-                    j1 = 2*this->_input->GetY() - j - 2;
-
-                if(k < 0)
-                    k1 = abs(k);
-                else if(k>=this->_input->GetZ())
-                    k1 = 2*this->_input->GetZ() - k - 2;
-
-                if(i1>=0 && i1 < this->_input->GetX()
-                    && j1>=0 && j1 < this->_input->GetY()
-                    && k1>=0 && k1 < this->_input->GetZ()){
-                        // Now down to business
-                        distancev = (i-x)*(i-x)*_dx*_dx
-                            + (j-y)*(j-y)*_dy*_dy + (k-z)*(k-z)*_dz*_dz;
-                        if(this->_input2 != NULL)
-                            distancev += (this->_input2->GetAsDouble(i1,j1,k1)-this->_input2->GetAsDouble(x,y,z))
-                            * (this->_input2->GetAsDouble(i1,j1,k1)-this->_input2->GetAsDouble(x,y,z))*_ds;
-
-                        distancev = this->EvaluateWeight(distancev);
-
-                        if(distancev > 0 && distancev < 1){
-                            _localneighbor[index] = this->_input->GetAsDouble(i1,j1,k1,t);
-
-                            _localweight[index] = distancev;
-
-                            if(this->_input3 != NULL)
-                                _localweight[index] = _localweight[index]*this->_input3->GetAsDouble(i1,j1,k1);
-
-                            //accumulate sum of weight
-                            sumofweight += _localweight[index];
-                            //index
-                            index++;
-                        }
-                }
-            }
-        }
-    }
-
-    // normalize weight
-    for(i = 1; i < index; i++){
-        _localweight[i] /= sumofweight;
-    }
-
-    if(index > 1)
-        return weightedmedian(index,_Lambda,currentv,_localneighbor,_localweight);
-    else
-        return this->_input->GetAsDouble(x,y,z,t);
-
-}
-
 template <class VoxelType> void irtkNonLocalMedianFilter<VoxelType>::Initialize()
 {
 
@@ -161,8 +295,6 @@ template <class VoxelType> void irtkNonLocalMedianFilter<VoxelType>::Initialize(
 
     if(_Sigma%2 == 0) _Sigma ++;
     // the neighborhood box must be odd
-    _localweight = new float[_Sigma*_Sigma*_Sigma+1];
-    _localneighbor = new float[_Sigma*_Sigma*_Sigma*2+2];
 
     if(this->_input2 != NULL){
         if(this->_input2->GetX() != this->_input->GetX() || this->_input2->GetY() != this->_input->GetY()
@@ -224,9 +356,100 @@ template <class VoxelType> void irtkNonLocalMedianFilter<VoxelType>::Initialize(
 
 template <class VoxelType> void irtkNonLocalMedianFilter<VoxelType>::Run()
 {
-    //Finalize
-    this->irtkImageToImage<VoxelType>::Run();
+    // Do the initial set up
+    this->Initialize();
+
+    const int nx = this->_input->GetX();
+    const int ny = this->_input->GetY();
+    const int nz = this->_input->GetZ();
+
+    // Padded image domain
+    Padding padding;
+    padding._X   = nx;
+    padding._Y   = ny;
+    padding._Z   = nz;
+    padding._PX  = nx + 2 * (_Sigma/2);
+    padding._PY  = ny + 2 * (_Sigma/2);
+    padding._PZ  = (nz == 1 ? 1 : nz + 2 * (_Sigma/2));
+    padding._PadXY = _Sigma/2;
+    padding._PadZ  = (padding._PZ - nz) / 2;
+    const int npad = padding._PX * padding._PY * padding._PZ;
+    const blocked_range<int> padded_rows(0, padding._PY * padding._PZ);
+
+    // Spatial weights of window at edges and elsewhere
+    Window window[2];
+    for (int edge = 0; edge < 2; edge++) {
+        const int r  = (edge ? _Sigma/2 : _Sigma/4);
+        const int rz = (nz == 1 ? 0 : r);
+        for (int k = -rz; k <= rz; k++)
+        for (int j = -r;  j <= r;  j++)
+        for (int i = -r;  i <= r;  i++) {
+            const double distancev = i*i*_dx*_dx + j*j*_dy*_dy + k*k*_dz*_dz;
+            const double weight    = this->EvaluateWeight(distancev);
+            if (weight > 0 && (weight < 1 || this->_input2 != NULL) && (i != 0 || j != 0 || k != 0)) {
+                window[edge]._Offset.push_back((k * padding._PY + j) * padding._PX + i);
+                window[edge]._Weight.push_back(weight);
+            }
+        }
+    }
+
+    // Padded copies of scale and occlusion images and intensity weights
+    vector<irtkGreyPixel> scale;
+    vector<float>         occlusion;
+    vector<double>        scale_weight;
+    if (this->_input2 != NULL) {
+        irtkGreyPixel min, max;
+        this->_input2->GetMinMax(&min, &max);
+        scale_weight.resize(static_cast<int>(max) - static_cast<int>(min) + 1);
+        for (size_t d = 0; d < scale_weight.size(); d++) {
+            scale_weight[d] = this->EvaluateWeight(static_cast<double>(d) * static_cast<double>(d) * _ds);
+        }
+        scale.resize(npad);
+        PadImage<irtkGreyPixel, irtkGreyPixel> pad;
+        pad._Input   = this->_input2->GetPointerToVoxels();
+        pad._Output  = &scale[0];
+        pad._Padding = padding;
+        pad._Outside = 0;
+        parallel_for(padded_rows, pad);
+    }
+    if (this->_input3 != NULL) {
+        occlusion.resize(npad);
+        PadImage<irtkRealPixel, float> pad;
+        pad._Input   = this->_input3->GetPointerToVoxels();
+        pad._Output  = &occlusion[0];
+        pad._Padding = padding;
+        pad._Outside = 0;
+        parallel_for(padded_rows, pad);
+    }
+
+    // Filter each frame
+    vector<float> values(npad);
+    for (int t = 0; t < this->_input->GetT(); t++) {
+        PadImage<VoxelType, float> pad;
+        pad._Input   = this->_input->GetPointerToVoxels(0, 0, 0, t);
+        pad._Output  = &values[0];
+        pad._Padding = padding;
+        pad._Outside = numeric_limits<float>::quiet_NaN();
+        parallel_for(padded_rows, pad);
+
+        NonLocalMedian<VoxelType> filter;
+        filter._Values      = &values[0];
+        filter._Scale       = (scale.empty()     ? NULL : &scale[0]);
+        filter._Occlusion   = (occlusion.empty() ? NULL : &occlusion[0]);
+        filter._ScaleWeight = (scale_weight.empty() ? NULL : &scale_weight[0]);
+        filter._Window[0]   = &window[0];
+        filter._Window[1]   = &window[1];
+        filter._Edge        = _edge->GetPointerToVoxels(0, 0, 0, t);
+        filter._Input       = this->_input->GetPointerToVoxels(0, 0, 0, t);
+        filter._Constrain   = (this->_input4 ? this->_input4->GetPointerToVoxels(0, 0, 0, t) : NULL);
+        filter._Output      = this->_output->GetPointerToVoxels(0, 0, 0, t);
+        filter._Padding     = padding;
+        filter._Lambda      = _Lambda;
+        parallel_for(blocked_range<int>(0, ny * nz), filter);
+    }
 
+    // Do the final cleaning up
+    this->Finalize();
 }
 
 template <class VoxelType> void irtkNonLocalMedianFilter<VoxelType>::Finalize()
@@ -234,12 +457,8 @@ template <class VoxelType> void irtkNonLocalMedianFilter<VoxelType>::Finalize()
     //Finalize
     this->irtkImageToImage<VoxelType>::Finalize();
 
-    delete []_localweight;
-    delete []_localneighbor;
-    _localweight = NULL;
-    _localneighbor = NULL;
-
     delete _edge;
+    _edge = NULL;
 }
 
 template class irtkNonLocalMedianFilter<unsigned char>;
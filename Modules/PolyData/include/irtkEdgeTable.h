@@ -58,8 +58,26 @@ public:
   virtual ~irtkEdgeTable();
 
   /// Initialize edge table from given dataset
+  ///
+  /// When the dataset consists of only triangles or only tetrahedra, the edge
+  /// table is built directly from the point IDs of the cells using
+  /// InitializeSimplices. Otherwise, the edges of each generic cell are added.
   void Initialize(vtkDataSet *);
 
+  /// Initialize edge table from point IDs of simplicial cells
+  ///
+  /// The vertex pairs of all cell edges are emitted in parallel, sorted by
+  /// a parallel radix sort, and deduplicated in parallel blocks. The adjacent
+  /// points of each point are counted per block of sorted edges and the
+  /// symmetric sparse matrix and edge IDs are filled in parallel at the
+  /// positions given by prefix sums of these counts.
+  ///
+  /// \param[in] numPts Number of points.
+  /// \param[in] cells  Point IDs of cells, i.e., \p npts consecutive IDs per cell.
+  /// \param[in] ncells Number of cells.
+  /// \param[in] npts   Number of points per cell, i.e., 3 for triangles and 4 for tetrahedra.
+  void InitializeSimplices(int numPts, const vtkIdType *cells, vtkIdType ncells, int npts);
+
   /// Number of nodes
   int NumberOfPoints() const;
 
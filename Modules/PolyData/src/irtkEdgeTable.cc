@@ -18,11 +18,503 @@
 
 #include <vtkSmartPointer.h>
 #include <vtkGenericCell.h>
+#include <vtkCellArray.h>
+#include <vtkIdList.h>
+#include <vtkCellType.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkUnstructuredGrid.h>
+#include <vtkVersionMacros.h>
+#if VTK_MAJOR_VERSION >= 9
+#  include <vtkTypeInt32Array.h>
+#  include <vtkTypeInt64Array.h>
+#endif
 
 
 namespace irtk { namespace polydata {
 
 
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+namespace irtkEdgeTableUtils {
+
+// -----------------------------------------------------------------------------
+/// Type of edge key, i.e., ptId2 * numPts + ptId1 with ptId1 < ptId2
+typedef unsigned long long EdgeKey;
+
+// -----------------------------------------------------------------------------
+/// Number of blocks into which n items are split for parallel processing
+int NumberOfBlocks(size_t n)
+{
+  int nblocks = NumberOfThreads();
+  if (static_cast<size_t>(nblocks) > n / 4096) nblocks = static_cast<int>(n / 4096);
+  return (nblocks < 1 ? 1 : nblocks);
+}
+
+// -----------------------------------------------------------------------------
+/// Copy point IDs of cells with the same number of points from the arrays
+/// of a vtkCellArray
+///
+/// With VTK 9, the cells are given by the offsets and connectivity arrays.
+/// Otherwise, \c _Offsets is NULL and the legacy array stores the number of
+/// points of each cell followed by its point IDs.
+template <class TId>
+struct CopySimplexCells
+{
+  const TId *_Offsets;
+  const TId *_Connectivity;
+  int        _NumberOfCellPoints;
+  vtkIdType *_Cells;
+  bool       _Valid;
+
+  CopySimplexCells(const TId *offsets, const TId *connectivity, int npts, vtkIdType *cells)
+  :
+    _Offsets(offsets), _Connectivity(connectivity),
+    _NumberOfCellPoints(npts), _Cells(cells), _Valid(true)
+  {}
+
+  CopySimplexCells(const CopySimplexCells &lhs, split)
+  :
+    _Offsets(lhs._Offsets), _Connectivity(lhs._Connectivity),
+    _NumberOfCellPoints(lhs._NumberOfCellPoints), _Cells(lhs._Cells), _Valid(true)
+  {}
+
+  void join(const CopySimplexCells &rhs)
+  {
+    _Valid = _Valid && rhs._Valid;
+  }
+
+  void operator ()(const blocked_range<vtkIdType> &re)
+  {
+    const TId *pts;
+    vtkIdType *ids = _Cells + re.begin() * _NumberOfCellPoints;
+    for (vtkIdType cellId = re.begin(); cellId != re.end(); ++cellId) {
+      if (_Offsets) {
+        if (_Offsets[cellId + 1] - _Offsets[cellId] != _NumberOfCellPoints) {
+          _Valid = false;
+          return;
+        }
+        pts = _Connectivity + _Offsets[cellId];
+      } else {
+        pts = _Connectivity + cellId * (_NumberOfCellPoints + 1);
+        if (*pts++ != _NumberOfCellPoints) {
+          _Valid = false;
+          return;
+        }
+      }
+      for (int i = 0; i < _NumberOfCellPoints; ++i) *ids++ = static_cast<vtkIdType>(pts[i]);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Copy point IDs of cells in parallel
+template <class TId>
+bool CopyCells(const TId *offsets, const TId *connectivity, vtkIdType ncells, int npts, vtkIdType *cells)
+{
+  CopySimplexCells<TId> copy(offsets, connectivity, npts, cells);
+  parallel_reduce(blocked_range<vtkIdType>(0, ncells), copy);
+  return copy._Valid;
+}
+
+// -----------------------------------------------------------------------------
+/// Get point IDs of cells of mesh made up of cells of one simplex type
+///
+/// The point IDs are read directly from the arrays of the vtkCellArray
+/// in parallel, i.e., the offsets and connectivity arrays of VTK 9 or
+/// the legacy array of earlier VTK versions.
+///
+/// \param[in]  mesh    Dataset.
+/// \param[out] cells   Point IDs of cells, i.e., \p npts consecutive IDs per cell.
+/// \param[out] ncells  Number of cells.
+/// \param[out] npts    Number of points of each cell, i.e., 3 or 4.
+///
+/// \returns Whether all cells are triangles or all are tetrahedra.
+bool GetSimplexCells(vtkDataSet *mesh, vector<vtkIdType> &cells, vtkIdType &ncells, int &npts)
+{
+  vtkCellArray *array = NULL;
+  if (mesh->IsA("vtkPolyData")) {
+    vtkPolyData *surface = vtkPolyData::SafeDownCast(mesh);
+    if (surface->GetNumberOfVerts () > 0 ||
+        surface->GetNumberOfLines () > 0 ||
+        surface->GetNumberOfStrips() > 0) return false;
+    array = surface->GetPolys();
+    npts  = 3;
+  } else if (mesh->IsA("vtkUnstructuredGrid")) {
+    vtkUnstructuredGrid  *grid  = vtkUnstructuredGrid::SafeDownCast(mesh);
+    vtkUnsignedCharArray *types = grid->GetCellTypesArray();
+    if (types == NULL || types->GetNumberOfTuples() == 0) return false;
+    const unsigned char  type   = types->GetValue(0);
+    if      (type == VTK_TRIANGLE) npts = 3;
+    else if (type == VTK_TETRA)    npts = 4;
+    else return false;
+    for (vtkIdType i = 1; i < types->GetNumberOfTuples(); ++i) {
+      if (types->GetValue(i) != type) return false;
+    }
+    array = grid->GetCells();
+  }
+  if (array == NULL) return false;
+  ncells = array->GetNumberOfCells();
+  if (ncells == 0) return false;
+  cells.resize(static_cast<size_t>(ncells) * npts);
+#if VTK_MAJOR_VERSION >= 9
+  if (array->IsStorage64Bit()) {
+    return CopyCells(array->GetOffsetsArray64     ()->GetPointer(0),
+                     array->GetConnectivityArray64()->GetPointer(0), ncells, npts, &cells[0]);
+  } else {
+    return CopyCells(array->GetOffsetsArray32     ()->GetPointer(0),
+                     array->GetConnectivityArray32()->GetPointer(0), ncells, npts, &cells[0]);
+  }
+#else
+  if (array->GetNumberOfConnectivityEntries() != ncells * (npts + 1)) return false;
+  const vtkIdType *connectivity = array->GetPointer();
+  return CopyCells<vtkIdType>(NULL, connectivity, ncells, npts, &cells[0]);
+#endif
+}
+
+// -----------------------------------------------------------------------------
+/// Emit keys of all cell edges, including duplicates of shared edges
+struct EmitEdgeKeys
+{
+  const vtkIdType *_Cells;
+  int              _NumberOfCellPoints;
+  EdgeKey          _NumberOfPoints;
+  EdgeKey         *_Keys;
+
+  void operator ()(const blocked_range<vtkIdType> &re) const
+  {
+    const int nedges = _NumberOfCellPoints * (_NumberOfCellPoints - 1) / 2;
+    EdgeKey   a, b, *key;
+    for (vtkIdType cellId = re.begin(); cellId != re.end(); ++cellId) {
+      const vtkIdType *pts = _Cells + cellId * _NumberOfCellPoints;
+      key = _Keys + cellId * nedges;
+      for (int i = 0; i < _NumberOfCellPoints; ++i)
+      for (int j = i + 1; j < _NumberOfCellPoints; ++j) {
+        a = static_cast<EdgeKey>(pts[i]);
+        b = static_cast<EdgeKey>(pts[j]);
+        if (a > b) swap(a, b);
+        *key++ = b * _NumberOfPoints + a;
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Count digits of keys in blocks of one radix sort pass
+struct CountDigits
+{
+  const EdgeKey *_Keys;
+  size_t         _NumberOfKeys;
+  int            _NumberOfBlocks;
+  int            _Shift;
+  size_t        *_Counts;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int b = re.begin(); b != re.end(); ++b) {
+      size_t *counts = _Counts + b * 256;
+      memset(counts, 0, 256 * sizeof(size_t));
+      const size_t i1 = _NumberOfKeys *  b      / _NumberOfBlocks;
+      const size_t i2 = _NumberOfKeys * (b + 1) / _NumberOfBlocks;
+      for (size_t i = i1; i < i2; ++i) ++counts[(_Keys[i] >> _Shift) & 0xff];
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Stable scatter of keys in blocks of one radix sort pass
+struct ScatterKeys
+{
+  const EdgeKey *_Keys;
+  EdgeKey       *_Output;
+  size_t         _NumberOfKeys;
+  int            _NumberOfBlocks;
+  int            _Shift;
+  const size_t  *_Offsets;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    size_t offset[256];
+    for (int b = re.begin(); b != re.end(); ++b) {
+      memcpy(offset, _Offsets + b * 256, 256 * sizeof(size_t));
+      const size_t i1 = _NumberOfKeys *  b      / _NumberOfBlocks;
+      const size_t i2 = _NumberOfKeys * (b + 1) / _NumberOfBlocks;
+      for (size_t i = i1; i < i2; ++i) {
+        _Output[offset[(_Keys[i] >> _Shift) & 0xff]++] = _Keys[i];
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Parallel least significant digit radix sort of keys less than max_key
+void RadixSort(vector<EdgeKey> &keys, EdgeKey max_key)
+{
+  const size_t n       = keys.size();
+  const int    nblocks = NumberOfBlocks(n);
+
+  vector<EdgeKey> tmp(n);
+  vector<size_t>  counts(256 * nblocks);
+
+  CountDigits count;
+  count._NumberOfKeys   = n;
+  count._NumberOfBlocks = nblocks;
+  count._Counts         = &counts[0];
+
+  ScatterKeys scatter;
+  scatter._NumberOfKeys   = n;
+  scatter._NumberOfBlocks = nblocks;
+  scatter._Offsets        = &counts[0];
+
+  for (int shift = 0; shift < 64 && (max_key >> shift) != 0; shift += 8) {
+    count._Keys  = &keys[0];
+    count._Shift = shift;
+    parallel_for(blocked_range<int>(0, nblocks, 1), count);
+    // Offsets of digits in output ordered by digit first and block second
+    size_t offset = 0, c;
+    for (int d = 0; d < 256; ++d)
+    for (int b = 0; b < nblocks; ++b) {
+      c = counts[b * 256 + d];
+      counts[b * 256 + d] = offset;
+      offset += c;
+    }
+    scatter._Keys   = &keys[0];
+    scatter._Output = &tmp[0];
+    scatter._Shift  = shift;
+    parallel_for(blocked_range<int>(0, nblocks, 1), scatter);
+    keys.swap(tmp);
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Whether sorted key i is the first of an edge which is not collapsed
+inline bool IsUniqueEdge(const EdgeKey *keys, size_t i, EdgeKey n)
+{
+  return (i == 0 || keys[i] != keys[i-1]) && keys[i] / n != keys[i] % n;
+}
+
+// -----------------------------------------------------------------------------
+/// Count unique edges in blocks of sorted keys
+struct CountUniqueEdges
+{
+  const EdgeKey *_Keys;
+  size_t         _NumberOfKeys;
+  int            _NumberOfBlocks;
+  EdgeKey        _NumberOfPoints;
+  size_t        *_Counts;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int b = re.begin(); b != re.end(); ++b) {
+      const size_t i1 = _NumberOfKeys *  b      / _NumberOfBlocks;
+      const size_t i2 = _NumberOfKeys * (b + 1) / _NumberOfBlocks;
+      size_t count = 0;
+      for (size_t i = i1; i < i2; ++i) {
+        if (IsUniqueEdge(_Keys, i, _NumberOfPoints)) ++count;
+      }
+      _Counts[b] = count;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Copy unique edges in blocks of sorted keys to the given block offsets
+struct CopyUniqueEdges
+{
+  const EdgeKey *_Keys;
+  size_t         _NumberOfKeys;
+  int            _NumberOfBlocks;
+  EdgeKey        _NumberOfPoints;
+  const size_t  *_Offsets;
+  EdgeKey       *_Output;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int b = re.begin(); b != re.end(); ++b) {
+      const size_t i1 = _NumberOfKeys *  b      / _NumberOfBlocks;
+      const size_t i2 = _NumberOfKeys * (b + 1) / _NumberOfBlocks;
+      EdgeKey *out = _Output + _Offsets[b];
+      for (size_t i = i1; i < i2; ++i) {
+        if (IsUniqueEdge(_Keys, i, _NumberOfPoints)) *out++ = _Keys[i];
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Find first edge whose second point is the respective point
+struct FindFirstLowerEdge
+{
+  const EdgeKey *_Keys;
+  int            _NumberOfEdges;
+  EdgeKey        _NumberOfPoints;
+  int           *_First;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const EdgeKey *end = _Keys + _NumberOfEdges;
+    for (int ptId = re.begin(); ptId != re.end(); ++ptId) {
+      const EdgeKey key = static_cast<EdgeKey>(ptId) * _NumberOfPoints;
+      _First[ptId] = static_cast<int>(lower_bound(_Keys, end, key) - _Keys);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Count adjacent points with higher ID in blocks of sorted edges,
+/// i.e., the edges whose first point is the respective point
+struct CountUpperAdjacency
+{
+  const EdgeKey *_Keys;
+  int            _NumberOfEdges;
+  int            _NumberOfBlocks;
+  EdgeKey        _NumberOfPoints;
+  int           *_Counts;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int numPts = static_cast<int>(_NumberOfPoints);
+    for (int b = re.begin(); b != re.end(); ++b) {
+      int *counts = _Counts + static_cast<size_t>(b) * numPts;
+      memset(counts, 0, numPts * sizeof(int));
+      const int i1 = static_cast<int>(static_cast<size_t>(_NumberOfEdges) *  b      / _NumberOfBlocks);
+      const int i2 = static_cast<int>(static_cast<size_t>(_NumberOfEdges) * (b + 1) / _NumberOfBlocks);
+      for (int edgeId = i1; edgeId < i2; ++edgeId) {
+        ++counts[static_cast<int>(_Keys[edgeId] % _NumberOfPoints)];
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Replace counts of adjacent points with higher ID of each edge block by
+/// their exclusive prefix sum over blocks and sum up the number of adjacent
+/// points of each point range
+struct SumAdjacency
+{
+  const int *_First;
+  int       *_Counts;
+  int       *_Upper;
+  int        _NumberOfPoints;
+  int        _NumberOfBlocks;
+  int        _NumberOfRanges;
+  int       *_RangeSize;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int r = re.begin(); r != re.end(); ++r) {
+      const int ptId1 = static_cast<int>(static_cast<size_t>(_NumberOfPoints) *  r      / _NumberOfRanges);
+      const int ptId2 = static_cast<int>(static_cast<size_t>(_NumberOfPoints) * (r + 1) / _NumberOfRanges);
+      int size = 0;
+      for (int ptId = ptId1; ptId < ptId2; ++ptId) {
+        int sum = 0, c;
+        for (int b = 0; b < _NumberOfBlocks; ++b) {
+          int &count = _Counts[static_cast<size_t>(b) * _NumberOfPoints + ptId];
+          c = count, count = sum, sum += c;
+        }
+        _Upper[ptId] = sum;
+        size += (_First[ptId + 1] - _First[ptId]) + sum;
+      }
+      _RangeSize[r] = size;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Compute start of adjacency lists within each point range given the
+/// start of the range, and turn the prefix sums of the adjacent points with
+/// higher ID of each edge block into the output positions of this block
+struct StartAdjacency
+{
+  const int *_First;
+  const int *_Upper;
+  const int *_RangeStart;
+  int       *_Counts;
+  int       *_Start;
+  int        _NumberOfPoints;
+  int        _NumberOfBlocks;
+  int        _NumberOfRanges;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int r = re.begin(); r != re.end(); ++r) {
+      const int ptId1 = static_cast<int>(static_cast<size_t>(_NumberOfPoints) *  r      / _NumberOfRanges);
+      const int ptId2 = static_cast<int>(static_cast<size_t>(_NumberOfPoints) * (r + 1) / _NumberOfRanges);
+      int start = _RangeStart[r];
+      for (int ptId = ptId1; ptId < ptId2; ++ptId) {
+        const int nlower = _First[ptId + 1] - _First[ptId];
+        _Start[ptId] = start;
+        for (int b = 0; b < _NumberOfBlocks; ++b) {
+          _Counts[static_cast<size_t>(b) * _NumberOfPoints + ptId] += start + nlower;
+        }
+        start += nlower + _Upper[ptId];
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Fill adjacency lists of points with the adjacent points of lower ID,
+/// i.e., the edges whose second point is the respective point
+struct FillLowerAdjacency
+{
+  const EdgeKey *_Keys;
+  const int     *_First;
+  const int     *_Start;
+  int           *_Index;
+  int           *_Data;
+  EdgeKey        _NumberOfPoints;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int ptId = re.begin(); ptId != re.end(); ++ptId) {
+      int i = _Start[ptId];
+      for (int edgeId = _First[ptId]; edgeId < _First[ptId + 1]; ++edgeId, ++i) {
+        _Index[i] = static_cast<int>(_Keys[edgeId] % _NumberOfPoints);
+        _Data [i] = edgeId + 1;
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Append adjacent points with higher ID to the adjacency lists in blocks of
+/// sorted edges, where each block starts at its own offsets of each point
+struct FillUpperAdjacency
+{
+  const EdgeKey *_Keys;
+  int            _NumberOfEdges;
+  int            _NumberOfBlocks;
+  EdgeKey        _NumberOfPoints;
+  int           *_Offsets;
+  int           *_Index;
+  int           *_Data;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int numPts = static_cast<int>(_NumberOfPoints);
+    for (int b = re.begin(); b != re.end(); ++b) {
+      int *next = _Offsets + static_cast<size_t>(b) * numPts;
+      const int i1 = static_cast<int>(static_cast<size_t>(_NumberOfEdges) *  b      / _NumberOfBlocks);
+      const int i2 = static_cast<int>(static_cast<size_t>(_NumberOfEdges) * (b + 1) / _NumberOfBlocks);
+      for (int edgeId = i1; edgeId < i2; ++edgeId) {
+        const int i = next[static_cast<int>(_Keys[edgeId] % _NumberOfPoints)]++;
+        _Index[i] = static_cast<int>(_Keys[edgeId] / _NumberOfPoints);
+        _Data [i] = edgeId + 1;
+      }
+    }
+  }
+};
+
+
+} // namespace irtkEdgeTableUtils
+using namespace irtkEdgeTableUtils;
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
 // -----------------------------------------------------------------------------
 irtkEdgeTable::irtkEdgeTable(vtkDataSet *mesh)
 {
@@ -51,6 +543,14 @@ irtkEdgeTable::~irtkEdgeTable()
 // -----------------------------------------------------------------------------
 void irtkEdgeTable::Initialize(vtkDataSet *mesh)
 {
+  vector<vtkIdType> cells;
+  vtkIdType         ncells;
+  int               npts;
+  if (GetSimplexCells(mesh, cells, ncells, npts)) {
+    InitializeSimplices(static_cast<int>(mesh->GetNumberOfPoints()), &cells[0], ncells, npts);
+    return;
+  }
+
   IRTK_START_TIMING();
 
   _NumberOfEdges = 0;
@@ -132,6 +632,134 @@ void irtkEdgeTable::Initialize(vtkDataSet *mesh)
   IRTK_DEBUG_TIMING(5, "initialization of edge table");
 }
 
+// -----------------------------------------------------------------------------
+void irtkEdgeTable::InitializeSimplices(int numPts, const vtkIdType *cells, vtkIdType ncells, int npts)
+{
+  IRTK_START_TIMING();
+
+  // Emit keys of (ptId1, ptId2) pairs of all cell edges
+  const EdgeKey n = static_cast<EdgeKey>(numPts);
+  vector<EdgeKey> keys(static_cast<size_t>(ncells) * npts * (npts - 1) / 2);
+  EmitEdgeKeys emit;
+  emit._Cells              = cells;
+  emit._NumberOfCellPoints = npts;
+  emit._NumberOfPoints     = n;
+  emit._Keys               = &keys[0];
+  parallel_for(blocked_range<vtkIdType>(0, ncells), emit);
+
+  // Sort keys by second point ID first and first point ID second, i.e., in
+  // the order in which the edges are visited by irtkEdgeIterator, and
+  // remove duplicate keys of edges shared by adjacent cells as well as
+  // those of collapsed edges of degenerate cells
+  RadixSort(keys, n * n);
+  int nblocks = NumberOfBlocks(keys.size());
+  vector<size_t> offsets(nblocks + 1);
+  CountUniqueEdges count;
+  count._Keys           = &keys[0];
+  count._NumberOfKeys   = keys.size();
+  count._NumberOfBlocks = nblocks;
+  count._NumberOfPoints = n;
+  count._Counts         = &offsets[1];
+  parallel_for(blocked_range<int>(0, nblocks, 1), count);
+  offsets[0] = 0;
+  for (int b = 0; b < nblocks; ++b) offsets[b + 1] += offsets[b];
+  vector<EdgeKey> edges(offsets[nblocks]);
+  if (!edges.empty()) {
+    CopyUniqueEdges copy;
+    copy._Keys           = &keys[0];
+    copy._NumberOfKeys   = keys.size();
+    copy._NumberOfBlocks = nblocks;
+    copy._NumberOfPoints = n;
+    copy._Offsets        = &offsets[0];
+    copy._Output         = &edges[0];
+    parallel_for(blocked_range<int>(0, nblocks, 1), copy);
+  }
+  keys.swap(edges);
+  _NumberOfEdges = static_cast<int>(keys.size());
+
+  // Allocate symmetric sparse matrix, where CCS and CRS are identical
+  irtkGenericSparseMatrix::Initialize(numPts, numPts, 2 * _NumberOfEdges);
+  _NNZ = 2 * _NumberOfEdges;
+  int *start = (_Layout == CCS ? _Col : _Row);
+  int *index = (_Layout == CCS ? _Row : _Col);
+  if (_NumberOfEdges == 0) {
+    memset(start, 0, (numPts + 1) * sizeof(int));
+    return;
+  }
+
+  // Edges with given second point are stored consecutively in sorted keys
+  vector<int> first(numPts + 1);
+  FindFirstLowerEdge find;
+  find._Keys           = &keys[0];
+  find._NumberOfEdges  = _NumberOfEdges;
+  find._NumberOfPoints = n;
+  find._First          = &first[0];
+  parallel_for(blocked_range<int>(0, numPts), find);
+  first[numPts] = _NumberOfEdges;
+
+  // Count adjacent points with higher ID of each point in blocks of edges,
+  // where the adjacent points of each point are in ascending order over blocks
+  nblocks = NumberOfBlocks(static_cast<size_t>(_NumberOfEdges));
+  vector<int> counts(static_cast<size_t>(nblocks) * numPts);
+  CountUpperAdjacency upper_count;
+  upper_count._Keys           = &keys[0];
+  upper_count._NumberOfEdges  = _NumberOfEdges;
+  upper_count._NumberOfBlocks = nblocks;
+  upper_count._NumberOfPoints = n;
+  upper_count._Counts         = &counts[0];
+  parallel_for(blocked_range<int>(0, nblocks, 1), upper_count);
+
+  // Start of adjacency lists using prefix sums within and over point ranges
+  const int nranges = max(1, min(NumberOfThreads(), numPts / 4096));
+  vector<int> nupper(numPts), range(nranges + 1);
+  SumAdjacency sum;
+  sum._First          = &first[0];
+  sum._Counts         = &counts[0];
+  sum._Upper          = &nupper[0];
+  sum._NumberOfPoints = numPts;
+  sum._NumberOfBlocks = nblocks;
+  sum._NumberOfRanges = nranges;
+  sum._RangeSize      = &range[1];
+  parallel_for(blocked_range<int>(0, nranges, 1), sum);
+  range[0] = 0;
+  for (int r = 0; r < nranges; ++r) range[r + 1] += range[r];
+  StartAdjacency init;
+  init._First          = &first[0];
+  init._Upper          = &nupper[0];
+  init._RangeStart     = &range[0];
+  init._Counts         = &counts[0];
+  init._Start          = start;
+  init._NumberOfPoints = numPts;
+  init._NumberOfBlocks = nblocks;
+  init._NumberOfRanges = nranges;
+  parallel_for(blocked_range<int>(0, nranges, 1), init);
+  start[numPts] = range[nranges];
+
+  // Adjacent points with lower ID are stored consecutively in sorted keys
+  FillLowerAdjacency lower;
+  lower._Keys           = &keys[0];
+  lower._First          = &first[0];
+  lower._Start          = start;
+  lower._Index          = index;
+  lower._Data           = _Data;
+  lower._NumberOfPoints = n;
+  parallel_for(blocked_range<int>(0, numPts), lower);
+
+  // Append adjacent points with higher ID in ascending order
+  FillUpperAdjacency upper;
+  upper._Keys           = &keys[0];
+  upper._NumberOfEdges  = _NumberOfEdges;
+  upper._NumberOfBlocks = nblocks;
+  upper._NumberOfPoints = n;
+  upper._Offsets        = &counts[0];
+  upper._Index          = index;
+  upper._Data           = _Data;
+  parallel_for(blocked_range<int>(0, nblocks, 1), upper);
+
+  IRTK_DEBUG_TIMING(5, "initialization of edge table from " << ncells
+                       << (npts == 3 ? " triangles" : " tetrahedra"));
+}
+
 // -----------------------------------------------------------------------------
 void irtkEdgeTable::GetAdjacentPoints(vtkPolyData *mesh, int ptId, vtkIdList *ids)
 {
@@ -132,6 +132,50 @@ public:
   /// Update energy term after convergence
   virtual bool Upgrade();
 
+  /// Cache internal state at the start of a line search
+  ///
+  /// Called by irtkRegistrationEnergy::BeginLineSearch if the displacements of
+  /// the transformation are an affine function of its parameters. Terms whose
+  /// transformed inputs are expensive to update may cache their displacements.
+  virtual void BeginLineSearch();
+
+  /// Cache change of internal state along the line search direction
+  ///
+  /// Called after BeginLineSearch with the transformation parameters set to
+  /// the initial parameters of the line search plus the search direction.
+  virtual void CacheLineSearchDirection();
+
+  /// Set multiple of search direction to use by subsequent Update calls
+  virtual void LineSearchStep(double);
+
+  /// Discard internal state cached for the line search
+  virtual void EndLineSearch();
+
+  /// Prepare Gauss-Newton approximation of Hessian at current parameters
+  ///
+  /// Called by irtkRegistrationEnergy::BeginGaussNewton after the energy term
+  /// was updated for the evaluation of its gradient. Terms which are sums of
+  /// squared residuals cache the current value of their transformed inputs.
+  ///
+  /// \returns Whether the energy term provides an approximation of its Hessian.
+  virtual bool BeginGaussNewton();
+
+  /// Cache change of transformed inputs along direction of Hessian product
+  ///
+  /// Called with the transformation parameters set to the parameters at
+  /// BeginGaussNewton plus the direction multiplied by the given step.
+  virtual void CacheGaussNewtonDirection(double);
+
+  /// Add weighted approximation of the diagonal of the Hessian
+  void GaussNewtonDiagonal(double *);
+
+  /// Add weighted product of approximate Hessian and direction passed
+  /// to the preceding CacheGaussNewtonDirection call
+  void GaussNewtonProduct(double *);
+
+  /// Discard internal state cached for the Gauss-Newton approximation
+  virtual void EndGaussNewton();
+
   /// Reset initial value of energy term
   void ResetInitialValue();
 
@@ -175,6 +219,23 @@ protected:
   /// \param[in]     weight   Weight to use when adding the gradient.
   virtual void EvaluateGradient(double *gradient, double step, double weight) = 0;
 
+  /// Weight of energy term gradient incl. normalization by initial value
+  double GradientWeight();
+
+  /// Evaluate and add approximation of the diagonal of the Hessian
+  ///
+  /// \param[in,out] diag   Diagonal to which the computed diagonal of the
+  ///                       Gauss-Newton Hessian of the term should be added to.
+  /// \param[in]     weight Weight to use when adding the diagonal.
+  virtual void EvaluateGaussNewtonDiagonal(double *diag, double weight);
+
+  /// Evaluate and add product of approximate Hessian and cached direction
+  ///
+  /// \param[in,out] Hv     Product to which the product of the Gauss-Newton
+  ///                       Hessian of the term should be added to.
+  /// \param[in]     weight Weight to use when adding the product.
+  virtual void EvaluateGaussNewtonProduct(double *Hv, double weight);
+
   // ---------------------------------------------------------------------------
   // Debugging
 
@@ -0,0 +1,157 @@
+/* The Image Registration Toolkit (IRTK)
+ *
+ * Copyright 2008-2015 Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#ifndef _IRTKGAUSSNEWTONDESCENT_H
+#define _IRTKGAUSSNEWTONDESCENT_H
+
+#include <irtkLocalOptimizer.h>
+
+
+/**
+ * Minimizes sum of squares objective function using Levenberg-Marquardt
+ *
+ * Each iteration solves the damped Gauss-Newton equations (H + lambda D) dx = -g,
+ * where g is the gradient of the objective function, H the Gauss-Newton
+ * approximation of its Hessian, and D an approximation of the diagonal of H.
+ * The Hessian is never assembled. Instead, the linear system is solved
+ * by preconditioned conjugate gradients using Hessian-vector products
+ * provided by irtkObjectiveFunction::GaussNewtonProduct and the diagonal
+ * (1 + lambda) D as preconditioner. A step is accepted when it decreases
+ * the objective function value, and the damping lambda is updated based on
+ * the ratio of actual to predicted decrease as proposed by Nielsen (1999).
+ *
+ * The damping factor of each trial step is reported as step length of the
+ * AcceptedStepEvent and RejectedStepEvent, respectively.
+ */
+class irtkGaussNewtonDescent : public irtkLocalOptimizer
+{
+  irtkOptimizerMacro(irtkGaussNewtonDescent, GaussNewton);
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+
+  /// Maximum number of Gauss-Newton steps
+  irtkPublicAttributeMacro(int, NumberOfSteps);
+
+  /// Maximum number of restarts after upgrade of energy function
+  irtkPublicAttributeMacro(int, NumberOfRestarts);
+
+  /// Maximum streak of unsuccessful restarts without improvement
+  irtkPublicAttributeMacro(int, NumberOfFailedRestarts);
+
+  /// Maximum streak of rejected steps with increasing damping
+  irtkPublicAttributeMacro(int, MaxRejectedStreak);
+
+  /// Maximum number of conjugate gradient iterations per step
+  irtkPublicAttributeMacro(int, NumberOfConjugateGradientIterations);
+
+  /// Relative residual at which conjugate gradient iterations stop
+  irtkPublicAttributeMacro(double, ConjugateGradientTolerance);
+
+  /// Initial damping factor
+  irtkPublicAttributeMacro(double, Damping);
+
+protected:
+
+  /// Gradient of objective function
+  irtkComponentMacro(double, Gradient);
+
+  /// Approximate diagonal of Gauss-Newton Hessian
+  irtkComponentMacro(double, Diagonal);
+
+  /// Step computed by conjugate gradient iterations
+  irtkComponentMacro(double, Direction);
+
+  /// Residual of damped Gauss-Newton equations
+  irtkComponentMacro(double, Residual);
+
+  /// Preconditioned residual
+  irtkComponentMacro(double, Preconditioned);
+
+  /// Conjugate direction of conjugate gradient iterations
+  irtkComponentMacro(double, Conjugate);
+
+  /// Product of damped Gauss-Newton Hessian and conjugate direction
+  irtkComponentMacro(double, Product);
+
+  /// Function parameters before step
+  irtkComponentMacro(double, Origin);
+
+  // ---------------------------------------------------------------------------
+  // Construction/Destruction
+public:
+
+  /// Constructor
+  irtkGaussNewtonDescent(irtkObjectiveFunction * = NULL);
+
+  /// Copy constructor
+  irtkGaussNewtonDescent(const irtkGaussNewtonDescent &);
+
+  /// Assignment operator
+  irtkGaussNewtonDescent &operator =(const irtkGaussNewtonDescent &);
+
+  /// Destructor
+  virtual ~irtkGaussNewtonDescent();
+
+  // Import overloads from base class
+  using irtkLocalOptimizer::Function;
+
+  /// Set objective function
+  virtual void Function(irtkObjectiveFunction *);
+
+  // ---------------------------------------------------------------------------
+  // Parameters
+  using irtkLocalOptimizer::Parameter;
+
+  /// Set parameter value from string
+  virtual bool Set(const char *, const char *);
+
+  /// Get parameters as key/value as string map
+  virtual irtkParameterList Parameter() const;
+
+  // ---------------------------------------------------------------------------
+  // Execution
+
+  /// Initialize optimization
+  ///
+  /// This member funtion is implicitly called by Run.
+  virtual void Initialize();
+
+  /// Optimize objective function using Levenberg-Marquardt steps
+  virtual double Run();
+
+protected:
+
+  /// Finalize optimization
+  virtual void Finalize();
+
+  /// Free memory of vectors
+  void DeallocateVectors();
+
+  /// Compute approximate diagonal of Gauss-Newton Hessian
+  virtual void ComputeDiagonal();
+
+  /// Solve damped Gauss-Newton equations for step
+  ///
+  /// \param[in] lambda Damping factor.
+  ///
+  /// \returns Number of conjugate gradient iterations.
+  virtual int ComputeStep(double lambda);
+
+};
+
+
+#endif
@@ -58,7 +58,7 @@ public:
   typedef ResampledImageType::VoxelType               VoxelType;
 
   /// Type of cached displacement field
-  typedef irtkGenericImage<double>                    DisplacementImageType;
+  typedef irtkRegisteredImage::DisplacementImageType  DisplacementImageType;
 
   /// Structure storing information about transformation instance
   struct TransformationInfo
@@ -190,6 +190,25 @@ public:
     TransformationInfo _Transformation;
   };
 
+  /// Structure storing resolution pyramid of input image kept for next run
+  struct KeptPyramid
+  {
+    const irtkBaseImage          *_Input;          ///< Kept input image or domain mask
+    int                           _NumberOfLevels; ///< Number of levels or 0 if not computed yet
+    int                           _UseGaussianResolutionPyramid;
+    bool                          _DownsampleWithPadding;
+    bool                          _CropPadImages;
+    double                        _Background;     ///< Background value set by user
+    double                        _UserPadding;    ///< Padding value set by user
+    double                        _Padding;        ///< Padding value used
+    vector<double>                _Blurring;       ///< Blurring at each level
+    vector<irtkVector3D<double> > _Resolution;     ///< Resolution at each level
+    bool                          _HasCentroid;    ///< Whether centroid was computed
+    irtkPoint                     _Centroid;       ///< Centroid of foreground
+    ResampledImageList            _Image;          ///< Copy of image at each level
+    vector<irtkBinaryImage>       _Mask;           ///< Copy of domain mask at each level
+  };
+
   // ---------------------------------------------------------------------------
   // Attributes
 
@@ -244,6 +263,13 @@ public:
   /// Whether to adaptively remesh surfaces before each gradient step
   irtkPublicAttributeMacro(bool, AdaptiveRemeshing);
 
+  /// Name of file to which the state of the registration is written after
+  /// each resolution level such that an interrupted run can be resumed
+  irtkPublicAttributeMacro(string, CheckpointFile);
+
+  /// Name of checkpoint file from which to resume an interrupted registration
+  irtkPublicAttributeMacro(string, ResumeFile);
+
 protected:
 
   /// Common attributes of (untransformed) input target data sets
@@ -269,6 +295,8 @@ protected:
   irtkLocalOptimizer              *_Optimizer;                      ///< Used optimizer
   irtkTransformationModel          _CurrentModel;                   ///< Current transformation model
   int                              _CurrentLevel;                   ///< Current resolution level
+  int                              _CurrentModelIndex;              ///< Index of current transformation model
+  int                              _ResumeLevel;                    ///< Last completed level of resumed model
   irtkEventDelegate                _EventDelegate;                  ///< Forwards optimization events to observers
   string                           _EnergyFormula;                  ///< Registration energy formula as string
   vector<ImageSimilarityInfo>      _ImageSimilarityInfo;            ///< Parsed similarity measure(s)
@@ -325,6 +353,9 @@ protected:
   vector<DisplacementInfo>        _DisplacementInfo;
   vector<DisplacementImageType *> _DisplacementField;
 
+  /// Resolution pyramids kept for subsequent runs
+  vector<KeptPyramid> _KeptPyramid;
+
   // ---------------------------------------------------------------------------
   // Access to managed data objects and their attributes
 
@@ -421,6 +452,19 @@ public:
   /// Determine whether the specified input image will be transformed.
   bool IsMovingImage(int) const;
 
+  /// Keep resolution pyramid of input image or domain mask for subsequent runs
+  ///
+  /// A copy of the downsampled images (resampled masks) computed by the next
+  /// Run is kept and reused by following runs with unchanged padding, blurring,
+  /// and resolution settings for this input, also after Reset. This avoids repeating
+  /// the same pre-processing in a batch of registrations with a common
+  /// target (or source) image. The image must not be modified or destroyed
+  /// before its pyramid is released again.
+  void KeepPyramid(const irtkBaseImage *);
+
+  /// Release resolution pyramid of input image or all kept pyramids
+  void ReleasePyramid(const irtkBaseImage * = NULL);
+
   // ---------------------------------------------------------------------------
   // Input simplicial complexes (points, curves, surfaces, tetrahedral meshes)
 #ifdef HAS_VTK
@@ -520,6 +564,9 @@ protected:
   void InitializePyramid_v20_or_v21(); // emulates original registration2++ implementation
   void InitializePyramid_v22();        // emulates current  registration2++ implementation
 
+  /// Get kept pyramid of input image or NULL
+  KeptPyramid *FindKeptPyramid(const irtkBaseImage *);
+
   /// Remesh/-sample input point sets
   virtual void InitializePointSets();
 
@@ -572,6 +619,17 @@ protected:
   /// Finalize registration at current resolution
   virtual void Finalize();
 
+  /// Write state of registration after current level to checkpoint file
+  virtual void WriteCheckpoint() const;
+
+  /// Read state of interrupted registration from checkpoint file
+  ///
+  /// \param[out] model Index of transformation model of last completed level.
+  /// \param[out] level Last completed resolution level.
+  ///
+  /// \returns Transformation estimate after last completed level.
+  virtual irtkTransformation *ReadCheckpoint(int &model, int &level);
+
   /// Callback function called by _Energy->Update(bool)
   void PreUpdateCallback(bool);
 
@@ -73,6 +73,13 @@ public:
   /// Get parameter name/value map
   virtual irtkParameterList Parameter() const;
 
+  // ---------------------------------------------------------------------------
+  // Evaluation
+
+  /// Whether the similarity depends on the registered images at neighboring
+  /// voxels, which is the case for the finite differences of the image gradient
+  virtual bool IsNeighborhoodBased() const;
+
 protected:
 
   // ---------------------------------------------------------------------------
@@ -112,6 +112,26 @@ public:
   /// Scheme for Difference Measures in Deformable Registration. In ICCV 2011.
   irtkPublicAttributeMacro(double, NodeBasedPreconditioning);
 
+  /// Fraction of foreground voxels at which similarity is evaluated
+  irtkPublicAttributeMacro(double, SamplingFraction);
+
+  /// Number of voxels at which similarity is evaluated
+  /// A non-positive value means that the SamplingFraction is used instead.
+  irtkPublicAttributeMacro(int, NumberOfSamples);
+
+  /// Whether to draw one random sample per cell of a regular grid
+  /// instead of drawing samples uniformly at random without replacement
+  irtkPublicAttributeMacro(bool, JitteredGridSampling);
+
+  /// Seed of pseudo-random number generator used to draw samples
+  irtkPublicAttributeMacro(int, SamplingSeed);
+
+  /// Indices of sampled voxels in ascending order (see IsSubsampled)
+  irtkReadOnlyAttributeMacro(vector<int>, SampledVoxels);
+
+  /// Mask of sampled voxels or NULL if all voxels are used
+  irtkComponentMacro(irtkBinaryImage, SampleMask);
+
   /// Whether Update has not been called since initialization
   irtkAttributeMacro(bool, InitialUpdate);
 
@@ -145,6 +165,9 @@ protected:
   /// \param[in] domain Image domain on which the similarity is evaluated.
   virtual void InitializeInput(const irtkImageAttributes &domain);
 
+  /// Draw voxel samples at which similarity is evaluated if subsampling is enabled
+  void InitializeSamples();
+
 public:
 
   /// Initialize similarity measure once input and parameters have been set
@@ -168,6 +191,39 @@ public:
   /// Update moving input image(s) and internal state of similarity measure
   virtual void Update(bool = true);
 
+  /// Cache displacements of moving input image(s) at start of line search
+  virtual void BeginLineSearch();
+
+  /// Cache change of displacements along line search direction
+  virtual void CacheLineSearchDirection();
+
+  /// Set multiple of search direction used to update moving input image(s)
+  virtual void LineSearchStep(double);
+
+  /// Discard displacements cached for the line search
+  virtual void EndLineSearch();
+
+  /// Whether similarity is only evaluated at the SampledVoxels
+  bool IsSubsampled() const;
+
+  /// Number of voxels at which similarity is evaluated, i.e., number of
+  /// SampledVoxels if subsampled and NumberOfVoxels otherwise
+  int NumberOfSampledVoxels() const;
+
+  /// Index of n-th voxel at which similarity is evaluated
+  ///
+  /// Value, gradient, and parametric gradient computations loop over
+  /// n = 0, ..., NumberOfSampledVoxels() - 1 using this index such that
+  /// only the sampled voxels are visited when the similarity is subsampled.
+  int SampledVoxel(int) const;
+
+  /// Whether the similarity at a voxel depends on the registered images at
+  /// neighboring voxels, e.g., within a local window or via finite differences
+  ///
+  /// Such similarity measures cannot be evaluated at a subset of voxels only,
+  /// because the registered images are then only updated at the sampled voxels.
+  virtual bool IsNeighborhoodBased() const;
+
   /// Whether to evaluate similarity at specified voxel
   bool IsForeground(int) const;
 
@@ -387,11 +443,38 @@ public:
 // Inline definitions
 ////////////////////////////////////////////////////////////////////////////////
 
+// -----------------------------------------------------------------------------
+inline bool irtkImageSimilarity::IsSubsampled() const
+{
+  return (_SampleMask != NULL);
+}
+
+// -----------------------------------------------------------------------------
+inline int irtkImageSimilarity::NumberOfSampledVoxels() const
+{
+  return (_SampleMask ? static_cast<int>(_SampledVoxels.size()) : _NumberOfVoxels);
+}
+
+// -----------------------------------------------------------------------------
+inline int irtkImageSimilarity::SampledVoxel(int n) const
+{
+  return (_SampleMask ? _SampledVoxels[n] : n);
+}
+
+// -----------------------------------------------------------------------------
+inline bool irtkImageSimilarity::IsNeighborhoodBased() const
+{
+  return false;
+}
+
 // -----------------------------------------------------------------------------
 inline bool irtkImageSimilarity::IsForeground(int idx) const
 {
   // Never evaluate similarity outside explicitly specified domain
-  if (_Mask && !_Mask->Get(idx)) return false;
+  // (the subsampled voxels are only drawn from within this domain)
+  if (_SampleMask) {
+    if (!_SampleMask->Get(idx)) return false;
+  } else if (_Mask && !_Mask->Get(idx)) return false;
   // If both images are transformed (symmetric registration)...
   if (_Target->Transformation() && _Source->Transformation()) {
     // ... evaluate within union of foreground regions
@@ -415,7 +498,10 @@ inline bool irtkImageSimilarity::IsForeground(int idx) const
 inline bool irtkImageSimilarity::IsForeground(int i, int j, int k) const
 {
   // Never evaluate similarity outside explicitly specified domain
-  if (_Mask && !_Mask->Get(i, j, k)) return false;
+  // (the subsampled voxels are only drawn from within this domain)
+  if (_SampleMask) {
+    if (!_SampleMask->Get(i, j, k)) return false;
+  } else if (_Mask && !_Mask->Get(i, j, k)) return false;
   // If both images are transformed (symmetric registration)...
   if (_Target->Transformation() && _Source->Transformation()) {
     // ... evaluate within union of foreground regions
@@ -61,6 +61,15 @@ class irtkInexactLineSearch : public irtkLineSearch
   /// Line search direction scaled by current step length
   irtkComponentMacro(double, ScaledDirection);
 
+  /// Whether objective function is evaluated along direction using cached state
+  bool _CachedLineSearch;
+
+  /// Current multiple of search direction added to initial parameters
+  double _LineSearchStep;
+
+  /// Previous multiple of search direction added to initial parameters
+  double _PreviousLineSearchStep;
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 public:
@@ -95,6 +104,18 @@ public:
   // Optimization
 protected:
 
+  /// Prepare evaluation of objective function along search direction
+  ///
+  /// Subclasses call this function at the start of Run after the current
+  /// value of the objective function was evaluated. If the objective function
+  /// supports it and sign changes of the parameters are not restricted, the
+  /// trial steps are evaluated using irtkObjectiveFunction::LineSearchStep.
+  /// In this case, the current value is re-evaluated the same way.
+  void BeginLineSearch();
+
+  /// Discard cached state of objective function at the end of Run
+  void EndLineSearch();
+
   /// Take step in search direction
   ///
   /// \returns Maximum change of DoF
@@ -22,25 +22,57 @@
 
 /**
  * Base class of soft transformation constraints penalizing the Jacobian determinant
+ *
+ * The Jacobian determinant and adjugate are evaluated by Update in a single
+ * pass at each control point or, if SampleCellCenters is true, at the center
+ * of each lattice cell. When the Jacobian evaluated by a subclass is the one
+ * of the cubic B-spline function of a 3D FFD (see IsSplineJacobian), it is
+ * computed directly from the control point coefficients in the support of the
+ * sample point and a precomputed table of the B-spline derivative weights.
+ * These weights are the same for all sample points of a lattice.
  */
 class irtkJacobianConstraint : public irtkTransformationConstraint
 {
   irtkAbstractMacro(irtkJacobianConstraint);
 
+public:
+
+  /// Fixed-size 3x3 matrix used to store the Jacobian and its adjugate
+  struct Matrix3x3
+  {
+    double _m[3][3];
+
+    double &operator ()(int r, int c)       { return _m[r][c]; }
+    double  operator ()(int r, int c) const { return _m[r][c]; }
+
+    Matrix3x3 &operator =(const irtkMatrix &m)
+    {
+      for (int r = 0; r < 3; ++r)
+      for (int c = 0; c < 3; ++c) {
+        _m[r][c] = m(r, c);
+      }
+      return *this;
+    }
+  };
+
   // ---------------------------------------------------------------------------
   // Attributes
 
+  /// Whether the Jacobian is evaluated at the centers of the lattice cells
+  /// instead of at the control points
+  irtkReadOnlyAttributeMacro(bool, SampleCellCenters);
+
 protected:
 
-  double     *_DetJacobian; ///< Determinant of Jacobian at each control point
-  irtkMatrix *_AdjJacobian; ///< Adjugate of Jacobian at each control point
-  int         _NumberOfCPs; ///< Number of control points
+  double    *_DetJacobian;     ///< Determinant of Jacobian at each sample point
+  Matrix3x3 *_AdjJacobian;     ///< Adjugate of Jacobian at each sample point
+  int        _NumberOfSamples; ///< Number of sample points
 
   // ---------------------------------------------------------------------------
   // Construction/destruction
 
   /// Constructor
-  irtkJacobianConstraint(const char * = "");
+  irtkJacobianConstraint(const char * = "", bool = false);
 
 public:
 
@@ -53,23 +85,53 @@ public:
   /// Update internal state upon change of input
   virtual void Update(bool = true);
 
-  /// Compute determinant and adjugate of Jacobian of transformation
+  /// Compute Jacobian of transformation
   ///
-  /// This function is called by Update for each (control) point at which the
-  /// Jacobian determinant is evaluated. Can be overridden in subclasses to
-  /// either compute a different Jacobian or to threshold the determinant value.
-  virtual double Jacobian(const irtkFreeFormTransformation *ffd,
-                          double x, double y, double z, double t,
-                          irtkMatrix &adj) const
+  /// This function is called by Update for each point at which the Jacobian
+  /// determinant is evaluated, unless IsSplineJacobian returns true for the
+  /// given FFD. Can be overridden in subclasses to compute a different Jacobian.
+  virtual void Jacobian(const irtkFreeFormTransformation *ffd,
+                        double x, double y, double z, double t,
+                        Matrix3x3 &jac) const;
+
+  /// Whether the Jacobian computed by the Jacobian function is the one of the
+  /// B-spline function of the given FFD, which is then evaluated using the
+  /// precomputed table of B-spline derivative weights instead
+  virtual bool IsSplineJacobian(const irtkFreeFormTransformation *ffd) const;
+
+  /// Threshold Jacobian determinant
+  ///
+  /// This function is called by Update for each computed determinant value.
+  /// Can be overridden in subclasses to threshold the determinant value.
+  virtual double ThresholdDeterminant(double det) const
   {
-    double det;
-    ffd->Jacobian(adj, x, y, z, t, t);
-    adj.Adjugate(det);
     return det;
   }
 
+  /// Number of points at which the Jacobian of the given FFD is evaluated
+  int NumberOfSamples(const irtkFreeFormTransformation *) const;
+
+  /// Get lattice indices of sample point
+  ///
+  /// The indices of the center of a lattice cell are those of the control
+  /// point at its lower left corner, starting at -1 for the outer cells.
+  void SampleToLattice(const irtkFreeFormTransformation *, int,
+                       int &, int &, int &, int &) const;
+
+  /// Compute derivatives of the Jacobian of a 3D B-spline FFD at a control
+  /// point w.r.t. the parameters of the control points in its neighbourhood
+  ///
+  /// \param[in]  ffd 3D B-spline FFD.
+  /// \param[out] drv Non-zero row of the derivative of the Jacobian w.r.t. world
+  ///                 coordinates for each lattice offset (a, b, c) in [-1, 1]^3
+  ///                 of the control point, stored at index
+  ///                 (a + 1) + 3 * ((b + 1) + 3 * (c + 1)).
+  static void JacobianDetDerivative(const irtkFreeFormTransformation *ffd,
+                                    double drv[27][3]);
+
   // ---------------------------------------------------------------------------
   // Debugging
+public:
 
   /// Write Jacobian determinant
   virtual void WriteDataSets(const char *, const char *, bool = true) const;
@@ -48,16 +48,28 @@ public:
   /// Destructor
   virtual ~irtkLogJacobianConstraint();
 
-  /// Compute determinant and adjugate of Jacobian of transformation
-  virtual double Jacobian(const irtkFreeFormTransformation *ffd,
-                          double x, double y, double z, double t,
-                          irtkMatrix &adj) const
+  /// Compute Jacobian of FFD parameterization
+  virtual void Jacobian(const irtkFreeFormTransformation *ffd,
+                        double x, double y, double z, double t,
+                        Matrix3x3 &jac) const
   {
-    double det;
-    ffd->FFDJacobianWorld(adj, x, y, z, t, t);
-    adj.Adjugate(det);
-    if (det < 1e-7) det = 1e-7;
-    return det;
+    irtkMatrix m;
+    ffd->FFDJacobianWorld(m, x, y, z, t, t);
+    jac = m;
+  }
+
+  /// Whether the Jacobian of the FFD parameterization is the one of the
+  /// B-spline function of the given FFD
+  virtual bool IsSplineJacobian(const irtkFreeFormTransformation *ffd) const
+  {
+    return dynamic_cast<const irtkBSplineFreeFormTransformation3D *>(ffd) != NULL &&
+           ffd->Z() > 1 && ffd->T() == 1;
+  }
+
+  /// Threshold Jacobian determinant
+  virtual double ThresholdDeterminant(double det) const
+  {
+    return (det < 1e-7 ? 1e-7 : det);
   }
 
 protected:
@@ -97,7 +97,7 @@ private:
   // Construction/Destruction
 
   /// Create 1D Gaussian kernel with given standard deviation
-  static RealImage *CreateGaussianKernel(double);
+  static KernelImage *CreateGaussianKernel(double);
 
   /// Reset local window kernel
   virtual void ClearKernel();
@@ -143,6 +143,10 @@ public:
   // ---------------------------------------------------------------------------
   // Evaluation
 
+  /// Whether the similarity depends on the registered images at neighboring
+  /// voxels, which is the case for the local correlation window
+  virtual bool IsNeighborhoodBased() const;
+
   /// Update moving image and internal state of similarity measure
   virtual void Update(bool = true);
 
@@ -106,6 +106,66 @@ public:
   /// \returns Whether the objective function has changed.
   virtual bool Upgrade();
 
+  // ---------------------------------------------------------------------------
+  // Line search
+
+  /// Prepare evaluation of objective function along line search direction
+  ///
+  /// Objective functions whose internal state changes linearly along the
+  /// search direction can cache this change such that the evaluation after
+  /// LineSearchStep is cheaper than after Step or Put. The parameters must
+  /// only be modified using LineSearchStep until EndLineSearch is called.
+  ///
+  /// \param[in] dir Line search direction.
+  ///
+  /// \returns Whether LineSearchStep is supported for this search direction.
+  virtual bool BeginLineSearch(const double *dir);
+
+  /// Set parameters to the initial parameters of the line search plus the
+  /// given multiple of the search direction
+  ///
+  /// \param[in] alpha Multiple of search direction passed to BeginLineSearch.
+  ///
+  /// \returns Maximum change of function parameter.
+  virtual double LineSearchStep(double alpha);
+
+  /// Discard state cached for the evaluation along line search direction
+  virtual void EndLineSearch();
+
+  // ---------------------------------------------------------------------------
+  // Gauss-Newton approximation
+
+  /// Prepare Gauss-Newton approximation of Hessian at current parameters
+  ///
+  /// Objective functions which are sums of squared residuals can approximate
+  /// their Hessian by 2 J^T J, where J is the Jacobian of the residuals w.r.t.
+  /// the parameters. This approximation is positive semi-definite and only
+  /// requires first derivatives. Products of the approximate Hessian with a
+  /// vector are evaluated by GaussNewtonProduct until EndGaussNewton is called.
+  /// The parameters may be modified in the meantime, e.g., to evaluate trial
+  /// steps, but must be restored and the function updated before the next
+  /// GaussNewtonDiagonal or GaussNewtonProduct call.
+  ///
+  /// \returns Whether the Gauss-Newton approximation is available.
+  virtual bool BeginGaussNewton();
+
+  /// Evaluate approximation of the diagonal of the Gauss-Newton Hessian
+  ///
+  /// The diagonal is used for preconditioning and damping only. It need
+  /// not be exact, but its entries should be of the same order of magnitude.
+  ///
+  /// \param[out] diag Approximate diagonal of Hessian.
+  virtual void GaussNewtonDiagonal(double *diag);
+
+  /// Multiply Gauss-Newton approximation of Hessian by vector
+  ///
+  /// \param[in]  v  Vector of length equal to the number of parameters.
+  /// \param[out] Hv Product of approximate Hessian and \p v.
+  virtual void GaussNewtonProduct(const double *v, double *Hv);
+
+  /// Discard state cached for the Gauss-Newton approximation
+  virtual void EndGaussNewton();
+
   // ---------------------------------------------------------------------------
   // Evaluation
 
@@ -185,6 +245,50 @@ inline bool irtkObjectiveFunction::Upgrade()
   return false;
 }
 
+// -----------------------------------------------------------------------------
+inline bool irtkObjectiveFunction::BeginLineSearch(const double *)
+{
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+inline double irtkObjectiveFunction::LineSearchStep(double)
+{
+  cerr << this->NameOfClass() << "::LineSearchStep: Not implemented" << endl;
+  exit(1);
+  return .0;
+}
+
+// -----------------------------------------------------------------------------
+inline void irtkObjectiveFunction::EndLineSearch()
+{
+}
+
+// -----------------------------------------------------------------------------
+inline bool irtkObjectiveFunction::BeginGaussNewton()
+{
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+inline void irtkObjectiveFunction::GaussNewtonDiagonal(double *)
+{
+  cerr << this->NameOfClass() << "::GaussNewtonDiagonal: Not implemented" << endl;
+  exit(1);
+}
+
+// -----------------------------------------------------------------------------
+inline void irtkObjectiveFunction::GaussNewtonProduct(const double *, double *)
+{
+  cerr << this->NameOfClass() << "::GaussNewtonProduct: Not implemented" << endl;
+  exit(1);
+}
+
+// -----------------------------------------------------------------------------
+inline void irtkObjectiveFunction::EndGaussNewton()
+{
+}
+
 // -----------------------------------------------------------------------------
 inline void irtkObjectiveFunction::GradientStep(const double *, double &, double &) const
 {
@@ -98,6 +98,12 @@ protected:
   /// Whether to evaluate error of source points and corresponding target points
   irtkPublicAttributeMacro(bool, EvaluateSourceError);
 
+  /// Transformed points at parameters of Gauss-Newton approximation
+  irtkPointSet _GaussNewtonOrigin;
+
+  /// Weights of point correspondences in Gauss-Newton approximation
+  vector<double> _GaussNewtonWeight;
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 
@@ -225,6 +231,40 @@ protected:
   /// Forward point correspondence map event
   void ForwardEvent(irtkObservable *, irtkEvent, const void *);
 
+  // ---------------------------------------------------------------------------
+  // Gauss-Newton approximation
+public:
+
+  /// Cache transformed points and weights of point correspondences
+  ///
+  /// The Hessian of the error function of each correspondence w.r.t. the
+  /// transformed point is approximated by the identity matrix multiplied by
+  /// the derivative of the radial error function, i.e., the correspondences
+  /// are reweighted as in iteratively reweighted least squares. It is only
+  /// available when either the target or the source points are transformed,
+  /// but not both, and the error is evaluated only for these points.
+  virtual bool BeginGaussNewton();
+
+  /// Cache change of transformed points
+  virtual void CacheGaussNewtonDirection(double);
+
+  /// Discard cached transformed points
+  virtual void EndGaussNewton();
+
+protected:
+
+  /// Transformed point set w.r.t. whose transformation the Hessian is approximated
+  irtkRegisteredPointSet *GaussNewtonPointSet() const;
+
+  /// Transform (sampled) input points of point set
+  void GaussNewtonPoints(const irtkRegisteredPointSet *, irtkPointSet &) const;
+
+  /// Add weighted approximation of the diagonal of the Hessian
+  virtual void EvaluateGaussNewtonDiagonal(double *, double);
+
+  /// Add weighted product of approximate Hessian and cached direction
+  virtual void EvaluateGaussNewtonProduct(double *, double);
+
   // ---------------------------------------------------------------------------
   // Debugging
 public:
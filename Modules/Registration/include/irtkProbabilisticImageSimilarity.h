@@ -21,6 +21,7 @@
 
 #include <irtkHistogram_1D.h>
 #include <irtkHistogram_2D.h>
+#include <irtkPartialHistograms.h>
 
 
 /**
@@ -30,6 +31,14 @@
  * from the joint and marginal probabilities of the intensities in the images.
  * An estimate of the probabilities is obtained using a joint histogram and
  * cubic B-spline Parzen Windows for a continuous representation.
+ *
+ * By default, the samples are added to the joint histogram using nearest
+ * neighbor binning and the resulting histogram is smoothed afterwards.
+ * When ParzenWindowEstimation is enabled, each sample instead contributes
+ * cubic B-spline weights to its 4x4 neighboring bins (cf. Mattes et al., 2003).
+ * The analytic derivative of the histogram w.r.t. the intensities of the
+ * transformed image is then exact, which makes the finite difference
+ * approximation of the similarity gradient obsolete.
  */
 
 class irtkProbabilisticImageSimilarity : public irtkImageSimilarity
@@ -58,6 +67,20 @@ public:
   /// Number of histogram bins for source image intensities
   irtkPublicAttributeMacro(int, NumberOfSourceBins);
 
+  /// Whether to add samples using cubic B-spline Parzen windows instead of
+  /// smoothing the histogram of nearest neighbor binned samples
+  irtkPublicAttributeMacro(bool, ParzenWindowEstimation);
+
+private:
+
+  /// Private integer histograms of worker threads used to count samples
+  irtkPartialHistograms _PartialHistograms;
+
+  /// Private histograms of worker threads used to add Parzen windows
+  irtkGenericPartialHistograms<double> _PartialParzenHistograms;
+
+public:
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 protected:
@@ -99,6 +122,28 @@ public:
   /// Update moving image and internal state of similarity measure
   virtual void Update(bool = true);
 
+protected:
+
+  /// Add (n > 0) or remove (n < 0) Parzen windows of samples within region
+  void AddParzenWindows(const blocked_range3d<int> &, double);
+
+  /// Compute derivative of entropy-based similarity w.r.t. transformed image
+  ///
+  /// Evaluates (dH(X) + dH(Y) - \p w * dH(X,Y)) / \p d at each foreground
+  /// voxel, where the derivatives of the entropies w.r.t. the intensity of the
+  /// transformed image are obtained from the derivative of the cubic B-spline
+  /// Parzen window of the sample. The result is stored in the x component of
+  /// \p gradient, to which MultiplyByImageGradient is applied subsequently.
+  ///
+  /// \param[in]  image    Transformed image.
+  /// \param[out] gradient Derivative of similarity w.r.t. intensities of \p image.
+  /// \param[in]  w        Weight of joint entropy derivative, i.e., 1 for MI and NMI for NMI.
+  /// \param[in]  d        Denominator of derivative.
+  void EntropyDerivative(const irtkRegisteredImage *image, GradientImageType *gradient,
+                         double w, double d);
+
+public:
+
   /// Exclude region from similarity evaluation
   ///
   /// Called by ApproximateGradient \b before the registered image region of
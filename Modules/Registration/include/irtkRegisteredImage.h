@@ -57,15 +57,27 @@
  * - t=7: Transformed 2nd order derivative w.r.t yy
  * - t=8: Transformed 2nd order derivative w.r.t yz
  * - t=9: Transformed 2nd order derivative w.r.t zz
+ *
+ * The registered channels and cached displacements are stored in double
+ * precision unless IRTK is built with USE_FLOAT_REGISTERED_IMAGE, in which
+ * case single precision is used to halve the memory footprint and bandwidth
+ * of the moving image pipeline. Interpolation and similarity computations
+ * are carried out in double precision in either case.
  */
-class irtkRegisteredImage : public irtkGenericImage<double>
+#if USE_FLOAT_REGISTERED_IMAGE
+typedef float  irtkRegisteredPixel;
+#else
+typedef double irtkRegisteredPixel;
+#endif
+
+class irtkRegisteredImage : public irtkGenericImage<irtkRegisteredPixel>
 {
   irtkObjectMacro(irtkRegisteredImage);
 
 public:
 
   // Do not override other base class overloads
-  using irtkGenericImage<double>::ImageToWorld;
+  using irtkGenericImage<irtkRegisteredPixel>::ImageToWorld;
 
   // ---------------------------------------------------------------------------
   // Types
@@ -84,7 +96,7 @@ public:
   typedef irtkGenericImage<double>   HessianImageType;
 
   /// Type of cached displacement fields
-  typedef irtkGenericImage<double>   DisplacementImageType;
+  typedef irtkGenericImage<irtkRegisteredPixel> DisplacementImageType;
 
   // ---------------------------------------------------------------------------
   // Attributes
@@ -122,6 +134,15 @@ public:
   /// Pre-computed displacements
   irtkComponentMacro(DisplacementImageType, Displacement);
 
+  /// Pre-computed displacements at start of line search
+  irtkComponentMacro(DisplacementImageType, LineSearchOrigin);
+
+  /// Pre-computed change of displacements along line search direction
+  irtkComponentMacro(DisplacementImageType, LineSearchDirection);
+
+  /// Multiple of line search direction used by Update during line search
+  irtkPublicAttributeMacro(double, LineSearchStep);
+
   /// Whether to use pre-computed world coordinates
   irtkAttributeMacro(bool, CacheWorldCoordinates);
 
@@ -153,6 +174,12 @@ public:
   /// false: Use derivative of interpolation kernel to evaluate image derivative
   irtkPublicAttributeMacro(bool, PrecomputeDerivatives);
 
+  /// Indices of sampled voxels in ascending order (optional)
+  ///
+  /// If set, an update of the entire image resamples the input image only at
+  /// the voxels in this list. The values of the other voxels are undefined.
+  irtkPublicAggregateMacro(const vector<int>, SampledVoxels);
+
 protected:
 
   /// Number of active levels
@@ -257,6 +284,29 @@ public:
   void Update(bool intensity = true, bool gradient = false, bool hessian = false,
               bool force     = false);
 
+  // ---------------------------------------------------------------------------
+  // Line search
+
+  /// Cache displacements at the start of a line search
+  ///
+  /// The displacements are only cached if the image is updated by itself
+  /// using a transformation whose displacements are an affine function of
+  /// its parameters. Otherwise, this function and the following line search
+  /// functions do nothing.
+  void BeginLineSearch();
+
+  /// Cache change of displacements along line search direction
+  ///
+  /// Must be called after BeginLineSearch once the transformation parameters
+  /// were advanced by the search direction. Until EndLineSearch is called,
+  /// Update resamples the input image at the displacements at the start of
+  /// the line search plus LineSearchStep times this change instead of
+  /// evaluating the transformation.
+  void CacheLineSearchDirection();
+
+  /// Discard displacements cached for the line search
+  void EndLineSearch();
+
 private:
 
   template <class>                      void Update1(const blocked_range3d<int> &, bool, bool, bool);
@@ -25,6 +25,7 @@ class vtkIdTypeArray;
 
 #include <irtkObject.h>
 #include <irtkTransformation.h>
+#include <irtkRegisteredImage.h>
 #include <irtkEdgeTable.h>
 
 
@@ -83,6 +84,9 @@ public:
   /// Adjacency matrix with edge IDs
   typedef irtk::polydata::irtkEdgeTable EdgeTable;
 
+  /// Type of cached displacement fields
+  typedef irtkRegisteredImage::DisplacementImageType DisplacementImageType;
+
   // ---------------------------------------------------------------------------
   // Attributes
 protected:
@@ -139,10 +143,10 @@ protected:
   irtkPublicAttributeMacro(irtkImageAttributes, Domain);
 
   /// Externally pre-computed displacements to use
-  irtkPublicAggregateMacro(irtkGenericImage<double>, ExternalDisplacement);
+  irtkPublicAggregateMacro(DisplacementImageType, ExternalDisplacement);
 
   /// Cached displacement field evaluated at each lattice point of _Domain
-  irtkComponentMacro(irtkGenericImage<double>, Displacement);
+  irtkComponentMacro(DisplacementImageType, Displacement);
 
   /// Copy attributes of this class from another instance
   void Copy(const irtkRegisteredPointSet &);
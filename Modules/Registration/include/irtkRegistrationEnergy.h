@@ -79,6 +79,21 @@ private:
   /// Forward events of energy terms to observers of the energy function
   irtkEventDelegate _EventDelegate;
 
+  /// Transformation parameters at start of line search
+  vector<double> _LineSearchOrigin;
+
+  /// Line search direction or empty if no line search is in progress
+  vector<double> _LineSearchDirection;
+
+  /// Maximum absolute value of line search direction
+  double _LineSearchNorm;
+
+  /// Current multiple of line search direction
+  double _LineSearchStep;
+
+  /// Transformation parameters at which Hessian is approximated or empty
+  vector<double> _GaussNewtonOrigin;
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 private:
@@ -201,6 +216,58 @@ public:
   /// \returns Whether the energy function has changed.
   virtual bool Upgrade();
 
+  // ---------------------------------------------------------------------------
+  // Line search
+
+  /// Prepare evaluation of registration energy along line search direction
+  ///
+  /// If the displacements of the transformation are an affine function of its
+  /// parameters, the energy terms cache the displacements of their transformed
+  /// inputs for the current parameters and the change of these displacements
+  /// along the search direction. The inputs are then updated for each trial
+  /// step of the line search without re-evaluating the transformation.
+  ///
+  /// \param[in] dir Line search direction.
+  ///
+  /// \returns Whether LineSearchStep is supported for this transformation.
+  virtual bool BeginLineSearch(const double *dir);
+
+  /// Set transformation parameters to the initial parameters of the line
+  /// search plus the given multiple of the search direction
+  ///
+  /// \returns Maximum change of transformation parameter.
+  virtual double LineSearchStep(double);
+
+  /// Discard displacements cached for the evaluation along search direction
+  virtual void EndLineSearch();
+
+  // ---------------------------------------------------------------------------
+  // Gauss-Newton approximation
+
+  /// Prepare Gauss-Newton approximation of Hessian at current parameters
+  ///
+  /// The approximation is available if all energy terms with non-zero weight
+  /// support it, i.e., image and point set distances which are sums of squared
+  /// residuals and transformation constraints. It is not available when the
+  /// energy gradient is normalized or preconditioned, because the gradient
+  /// is then no longer the derivative of the energy.
+  ///
+  /// \returns Whether the Gauss-Newton approximation is available.
+  virtual bool BeginGaussNewton();
+
+  /// Evaluate approximation of the diagonal of the Gauss-Newton Hessian
+  virtual void GaussNewtonDiagonal(double *);
+
+  /// Multiply Gauss-Newton approximation of Hessian by vector
+  ///
+  /// The change of the transformed inputs of the energy terms along the given
+  /// direction is obtained by evaluating the transformation with parameters
+  /// advanced by a small multiple of the direction.
+  virtual void GaussNewtonProduct(const double *, double *);
+
+  /// Discard state cached for the Gauss-Newton approximation
+  virtual void EndGaussNewton();
+
   // ---------------------------------------------------------------------------
   // Evaluation
 
@@ -50,6 +50,12 @@ public:
   /// \param[in,out] max      Maximum step length.
   virtual void GradientStep(const double *gradient, double &min, double &max) const;
 
+  /// Approximate Hessian of piecewise linear L1 norm by zero
+  virtual bool BeginGaussNewton();
+
+  /// Approximate Hessian of piecewise linear L1 norm by zero
+  virtual void CacheGaussNewtonDirection(double);
+
 protected:
 
   /// Compute penalty for current transformation estimate
@@ -39,6 +39,12 @@ class irtkSumOfSquaredIntensityDifferences : public irtkImageSimilarity
   /// Number of foreground voxels for which similarity is evaluated
   int _N;
 
+  /// Displacements of transformed image at parameters of Gauss-Newton approximation
+  irtkComponentMacro(GradientImageType, GaussNewtonOrigin);
+
+  /// Change of displacements along direction of Gauss-Newton Hessian product
+  irtkComponentMacro(GradientImageType, GaussNewtonDirection);
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 public:
@@ -86,6 +92,35 @@ protected:
   /// Evaluate non-parametric similarity gradient w.r.t the given image
   virtual bool NonParametricGradient(const irtkRegisteredImage *, GradientImageType *);
 
+  // ---------------------------------------------------------------------------
+  // Gauss-Newton approximation
+public:
+
+  /// Cache displacements of transformed image at current parameters
+  ///
+  /// The Gauss-Newton approximation of the Hessian of the sum of squared
+  /// differences w.r.t. the displacement at each voxel is the outer product
+  /// of the transformed image gradient. It is only available when either
+  /// the target or the source image is transformed, but not both.
+  virtual bool BeginGaussNewton();
+
+  /// Cache change of displacements of transformed image
+  virtual void CacheGaussNewtonDirection(double);
+
+  /// Discard cached displacements
+  virtual void EndGaussNewton();
+
+protected:
+
+  /// Transformed image w.r.t. whose transformation the Hessian is approximated
+  irtkRegisteredImage *GaussNewtonImage() const;
+
+  /// Add weighted approximation of the diagonal of the Hessian
+  virtual void EvaluateGaussNewtonDiagonal(double *, double);
+
+  /// Add weighted product of approximate Hessian and cached direction
+  virtual void EvaluateGaussNewtonProduct(double *, double);
+
 };
 
 
@@ -17,14 +17,16 @@
 #ifndef _IRTKTOPOLOGYPRESERVATIONCONSTRAINT_H
 #define _IRTKTOPOLOGYPRESERVATIONCONSTRAINT_H
 
-#include <irtkTransformationConstraint.h>
+#include <irtkJacobianConstraint.h>
 
 
 /**
  * Topology preservation constraint for deformable image registration
  *
+ * The Jacobian determinant is evaluated at the centers of the lattice cells
+ * by the same Update pass as used by the other Jacobian based constraints.
  */
-class irtkTopologyPreservationConstraint : public irtkTransformationConstraint
+class irtkTopologyPreservationConstraint : public irtkJacobianConstraint
 {
   irtkObjectMacro(irtkTopologyPreservationConstraint);
 
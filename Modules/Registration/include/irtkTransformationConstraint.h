@@ -37,6 +37,14 @@ class irtkTransformationConstraint : public irtkEnergyTerm
   /// Whether to apply constraint also at passive DoFs (control points)
   irtkPublicAttributeMacro(bool, ConstrainPassiveDoFs);
 
+protected:
+
+  /// Unweighted gradient at parameters of Gauss-Newton approximation
+  vector<double> _GaussNewtonGradient;
+
+  /// Finite difference of unweighted gradient along direction of Hessian product
+  vector<double> _GaussNewtonDirection;
+
   // ---------------------------------------------------------------------------
   // Construction/Destruction
 protected:
@@ -70,6 +78,30 @@ public:
   /// Get parameter name/value pairs
   virtual irtkParameterList Parameter() const;
 
+  // ---------------------------------------------------------------------------
+  // Gauss-Newton approximation
+
+  /// Cache gradient at current parameters
+  ///
+  /// The product of the Hessian of the constraint with a vector is approximated
+  /// by the finite difference of the gradient along this vector. This is exact
+  /// for constraints such as the bending energy whose gradient is linear in
+  /// the parameters of a linear transformation model.
+  virtual bool BeginGaussNewton();
+
+  /// Cache finite difference of gradient along direction of Hessian product
+  virtual void CacheGaussNewtonDirection(double);
+
+  /// Discard cached gradients
+  virtual void EndGaussNewton();
+
+protected:
+
+  /// Add weighted finite difference of gradient
+  virtual void EvaluateGaussNewtonProduct(double *, double);
+
+public:
+
   // ---------------------------------------------------------------------------
   // Subclass helper
 protected:
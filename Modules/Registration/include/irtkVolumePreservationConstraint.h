@@ -50,16 +50,21 @@ public:
   /// Destructor
   virtual ~irtkVolumePreservationConstraint() {}
 
-  /// Compute determinant and adjugate of Jacobian of transformation
-  virtual double Jacobian(const irtkFreeFormTransformation *ffd,
-                          double x, double y, double z, double t,
-                          irtkMatrix &adj) const
+  /// Compute Jacobian of transformation
+  virtual void Jacobian(const irtkFreeFormTransformation *ffd,
+                        double x, double y, double z, double t,
+                        Matrix3x3 &jac) const
   {
-    double det;
-    ffd->LocalJacobian(adj, x, y, z, t, t);
-    adj.Adjugate(det);
-    if (det < 1e-7) det = 1e-7;
-    return det;
+    irtkMatrix m;
+    ffd->LocalJacobian(m, x, y, z, t, t);
+    jac = m;
+  }
+
+  /// Whether the Jacobian of the transformation is the one of the B-spline
+  /// function of the given FFD
+  virtual bool IsSplineJacobian(const irtkFreeFormTransformation *ffd) const
+  {
+    return irtkJacobianConstraint::IsSplineJacobian(ffd);
   }
 
 };
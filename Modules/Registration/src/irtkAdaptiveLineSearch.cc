@@ -95,6 +95,9 @@ double irtkAdaptiveLineSearch::Run()
   // Get current value of objective function
   irtkLineSearch::Run();
 
+  // Cache state of objective function along search direction if possible
+  BeginLineSearch();
+
   // Define "aliases" for event data for prettier code below
   irtkLineSearchStep step;
   step._Info        = "incremental";
@@ -224,6 +227,9 @@ double irtkAdaptiveLineSearch::Run()
   // Notify observers about end of line search
   Broadcast(LineSearchEndEvent, &step);
 
+  // Discard cached state of objective function
+  EndLineSearch();
+
   // Re-use final step length upon next line search
   _StepLength = total;
 
@@ -24,11 +24,16 @@ namespace irtkCosineOfNormalizedGradientFieldUtils {
 
 
 // -----------------------------------------------------------------------------
-struct EvaluateCosineOfNormalizedGradientFieldSimilarity : public irtkVoxelReduction
+/// Sum the powers of the cosine of the normalized gradient fields at sampled voxels
+struct EvaluateCosineOfNormalizedGradientFieldSimilarity
 {
 private:
 
+  typedef irtkCosineOfNormalizedGradientField::VoxelType VoxelType;
+
   const irtkCosineOfNormalizedGradientField *_Similarity;
+  const VoxelType                           *_Target;
+  const VoxelType                           *_Source;
 
   int _dx; ///< Offset of 1st order derivative w.r.t x
   int _dy; ///< Offset of 1st order derivative w.r.t y
@@ -42,49 +47,48 @@ public:
   EvaluateCosineOfNormalizedGradientFieldSimilarity(const irtkCosineOfNormalizedGradientField *sim)
   :
     _Similarity(sim),
+    _Target(sim->Target()->Data()),
+    _Source(sim->Source()->Data()),
     _dx(sim->Target()->Offset(irtkRegisteredImage::Dx)),
     _dy(sim->Target()->Offset(irtkRegisteredImage::Dy)),
     _dz(sim->Target()->Offset(irtkRegisteredImage::Dz)),
     _Sum(.0), _Cnt(0)
   {}
 
-  EvaluateCosineOfNormalizedGradientFieldSimilarity(const EvaluateCosineOfNormalizedGradientFieldSimilarity &o)
+  EvaluateCosineOfNormalizedGradientFieldSimilarity(const EvaluateCosineOfNormalizedGradientFieldSimilarity &o, split)
   :
     _Similarity(o._Similarity),
+    _Target(o._Target), _Source(o._Source),
     _dx(o._dx), _dy(o._dy), _dz(o._dz),
-    _Sum(o._Sum), _Cnt(o._Cnt)
+    _Sum(.0), _Cnt(0)
   {}
 
-  void split(const EvaluateCosineOfNormalizedGradientFieldSimilarity &o)
-  {
-    _Similarity = o._Similarity;
-    _dx = o._dx, _dy = o._dy, _dz = o._dz;
-    _Sum = .0, _Cnt =  0;
-  }
-
   void join(const EvaluateCosineOfNormalizedGradientFieldSimilarity &rhs)
   {
     _Sum += rhs._Sum;
     _Cnt += rhs._Cnt;
   }
 
-  template <class T>
-  void operator()(int i, int j, int k, int, const T *dF, const T *dM)
+  void operator()(const blocked_range<int> &re)
   {
-
-    if (_Similarity->IsForeground(i, j, k)) {
-      const int    power = _Similarity->Power();
-      const double dF_dn = _Similarity->TargetNormalization();
-      const double dM_dn = _Similarity->SourceNormalization();
-      const double normt = sqrt(dF[_dx]*dF[_dx] + dF[_dy]*dF[_dy] + dF[_dz]*dF[_dz] + dF_dn*dF_dn);
-      const double norms = sqrt(dM[_dx]*dM[_dx] + dM[_dy]*dM[_dy] + dM[_dz]*dM[_dz] + dM_dn*dM_dn);
-      const double cos = (dF[_dx]*dM[_dx] + dF[_dy]*dM[_dy] + dF[_dz]*dM[_dz] + dF_dn*dM_dn) / (normt * norms);
-
-      _Sum += pow(cos, power);
-      ++_Cnt;
+    const int    power = _Similarity->Power();
+    const double dF_dn = _Similarity->TargetNormalization();
+    const double dM_dn = _Similarity->SourceNormalization();
+    for (int n = re.begin(); n != re.end(); ++n) {
+      const int idx = _Similarity->SampledVoxel(n);
+      if (_Similarity->IsForeground(idx)) {
+        const VoxelType *dF = _Target + idx;
+        const VoxelType *dM = _Source + idx;
+        const double normt = sqrt(dF[_dx]*dF[_dx] + dF[_dy]*dF[_dy] + dF[_dz]*dF[_dz] + dF_dn*dF_dn);
+        const double norms = sqrt(dM[_dx]*dM[_dx] + dM[_dy]*dM[_dy] + dM[_dz]*dM[_dz] + dM_dn*dM_dn);
+        const double cos = (dF[_dx]*dM[_dx] + dF[_dy]*dM[_dy] + dF[_dz]*dM[_dz] + dF_dn*dM_dn) / (normt * norms);
+
+        _Sum += pow(cos, power);
+        ++_Cnt;
+      }
     }
   }
-  
+
   double Value() const
   {
     return (_Cnt == 0 ? .0 : _Sum / _Cnt);
@@ -92,11 +96,18 @@ public:
 };
 
 // -----------------------------------------------------------------------------
-struct EvaluateCosineOfNormalizedGradientFieldSimilarityGradient : public irtkVoxelFunction
+/// Evaluate gradient of cosine of normalized gradient fields at sampled voxels
+struct EvaluateCosineOfNormalizedGradientFieldSimilarityGradient
 {
 private:
 
+  typedef irtkCosineOfNormalizedGradientField::VoxelType    VoxelType;
+  typedef irtkCosineOfNormalizedGradientField::GradientType GradientType;
+
   const irtkCosineOfNormalizedGradientField *_Similarity;
+  const VoxelType                           *_Fixed;
+  const VoxelType                           *_Moving;
+  GradientType                              *_Gradient;
 
   int _dx; ///< Offset of 1st order derivative w.r.t x
   int _dy; ///< Offset of 1st order derivative w.r.t y
@@ -107,9 +118,15 @@ private:
 
 public:
 
-  EvaluateCosineOfNormalizedGradientFieldSimilarityGradient(const irtkCosineOfNormalizedGradientField *sim)
+  EvaluateCosineOfNormalizedGradientFieldSimilarityGradient(const irtkCosineOfNormalizedGradientField *sim,
+                                                            const irtkRegisteredImage *fixed,
+                                                            const irtkRegisteredImage *moving,
+                                                            GradientType              *gradient)
   :
     _Similarity(sim),
+    _Fixed     (fixed ->Data()),
+    _Moving    (moving->Data()),
+    _Gradient  (gradient),
     _dx        (sim->Target()->Offset(irtkRegisteredImage::Dx)),
     _dy        (sim->Target()->Offset(irtkRegisteredImage::Dy)),
     _dz        (sim->Target()->Offset(irtkRegisteredImage::Dz)),
@@ -117,27 +134,32 @@ public:
     _z         (2 * _y)
   {}
 
-  template <class T>
-  void operator()(int i, int j, int k, int, const T *dF, const T *dM, T *g)
+  void operator()(const blocked_range<int> &re) const
   {
-    if (_Similarity->IsForeground(i, j, k)) {
-      const int    power = _Similarity->Power();
-      const double dF_dn = _Similarity->TargetNormalization();
-      const double dM_dn = _Similarity->SourceNormalization();
-      const double normt = sqrt(dF[_dx]*dF[_dx] + dF[_dy]*dF[_dy] + dF[_dz]*dF[_dz] + dF_dn*dF_dn);
-      const double norms = sqrt(dM[_dx]*dM[_dx] + dM[_dy]*dM[_dy] + dM[_dz]*dM[_dz] + dM_dn*dM_dn);
-      const double cos   = (dF[_dx]*dM[_dx] + dF[_dy]*dM[_dy] + dF[_dz]*dM[_dz] + dF_dn*dM_dn) / (normt * norms);
-      const double wt    = 1.0 / (normt * norms);
-      const double ws    = cos / (norms * norms);
-
-      g[0]  = wt * dF[_dx] - ws * dM[_dx];
-      g[_y] = wt * dF[_dy] - ws * dM[_dy];
-      g[_z] = wt * dF[_dz] - ws * dM[_dz];
-
-      // Apply chain rule
-      if (power > 1) {
-        const double factor = power * pow(cos, power - 1);
-        g[0] *= factor, g[_y] *= factor, g[_z] *= factor;
+    const int    power = _Similarity->Power();
+    const double dF_dn = _Similarity->TargetNormalization();
+    const double dM_dn = _Similarity->SourceNormalization();
+    for (int n = re.begin(); n != re.end(); ++n) {
+      const int idx = _Similarity->SampledVoxel(n);
+      if (_Similarity->IsForeground(idx)) {
+        const VoxelType *dF = _Fixed  + idx;
+        const VoxelType *dM = _Moving + idx;
+        GradientType    *g  = _Gradient + idx;
+        const double normt = sqrt(dF[_dx]*dF[_dx] + dF[_dy]*dF[_dy] + dF[_dz]*dF[_dz] + dF_dn*dF_dn);
+        const double norms = sqrt(dM[_dx]*dM[_dx] + dM[_dy]*dM[_dy] + dM[_dz]*dM[_dz] + dM_dn*dM_dn);
+        const double cos   = (dF[_dx]*dM[_dx] + dF[_dy]*dM[_dy] + dF[_dz]*dM[_dz] + dF_dn*dM_dn) / (normt * norms);
+        const double wt    = 1.0 / (normt * norms);
+        const double ws    = cos / (norms * norms);
+
+        g[0]  = wt * dF[_dx] - ws * dM[_dx];
+        g[_y] = wt * dF[_dy] - ws * dM[_dy];
+        g[_z] = wt * dF[_dz] - ws * dM[_dz];
+
+        // Apply chain rule
+        if (power > 1) {
+          const double factor = power * pow(cos, power - 1);
+          g[0] *= factor, g[_y] *= factor, g[_z] *= factor;
+        }
       }
     }
   }
@@ -208,7 +230,7 @@ irtkParameterList irtkCosineOfNormalizedGradientField::Parameter() const
 double irtkCosineOfNormalizedGradientField::Evaluate()
 {
   EvaluateCosineOfNormalizedGradientFieldSimilarity eval(this);
-  ParallelForEachVoxel(Domain(), Target(), Source(), eval);
+  parallel_reduce(blocked_range<int>(0, NumberOfSampledVoxels()), eval);
   if (version < irtkVersion(3, 1)) {
     return eval.Value();
   } else {
@@ -238,8 +260,9 @@ bool irtkCosineOfNormalizedGradientField
   const irtkRegisteredImage *fixed = ((image == Target()) ? Source() : Target());
 
   // Evaluate similarity gradient w.r.t gradient of given transformed image
-  EvaluateGradientFunc eval(this);
-  ParallelForEachVoxel(Domain(), fixed,  image, gradient, eval);
+  memset(gradient->Data(), 0, 3 * _NumberOfVoxels * sizeof(GradientType));
+  EvaluateGradientFunc eval(this, fixed, image, gradient->Data());
+  parallel_for(blocked_range<int>(0, NumberOfSampledVoxels()), eval);
   if (version >= irtkVersion(3, 1)) (*gradient) *= - (_Power % 2 == 0 ? 1.0 : 0.5);
 
   return true;
@@ -263,7 +286,7 @@ void irtkCosineOfNormalizedGradientField::WriteDataSets(const char *p, const cha
   attr._t = 1;
 
   irtkGenericImage<VoxelType> sim(attr);
-  VoxelType *ptr2vox = sim.GetPointerToVoxels(0, 0, 0);
+  VoxelType       *ptr2vox = sim.GetPointerToVoxels(0, 0, 0);
   const VoxelType *dtdx = Target()->GetPointerToVoxels(0, 0, 0, 1);
   const VoxelType *dtdy = Target()->GetPointerToVoxels(0, 0, 0, 2);
   const VoxelType *dtdz = Target()->GetPointerToVoxels(0, 0, 0, 3);
@@ -272,14 +295,15 @@ void irtkCosineOfNormalizedGradientField::WriteDataSets(const char *p, const cha
   const VoxelType *dsdz = Source()->GetPointerToVoxels(0, 0, 0, 3);
 
   sim += 1;
-  for (int idx = 0; idx < NumberOfVoxels(); ++idx, ++ptr2vox, ++dtdx, ++dtdy, ++dtdz, ++dsdx, ++dsdy, ++dsdz) {
+  for (int i = 0; i < NumberOfSampledVoxels(); ++i) {
+    const int idx = SampledVoxel(i);
     if (IsForeground(idx)) {
       const double dtdn = _TargetNormalization;
       const double dsdn = _SourceNormalization;
-      const double normt = sqrt((*dtdx)*(*dtdx) + (*dtdy)*(*dtdy) + (*dtdz)*(*dtdz) + dtdn*dtdn);
-      const double norms = sqrt((*dsdx)*(*dsdx) + (*dsdy)*(*dsdy) + (*dsdz)*(*dsdz) + dsdn*dsdn);
-      const double cos = ((*dtdx)*(*dsdx) + (*dtdy)*(*dsdy) + (*dtdz)*(*dsdz) + dtdn*dsdn) / (normt * norms);
-      *ptr2vox = pow(cos, _Power);
+      const double normt = sqrt(dtdx[idx]*dtdx[idx] + dtdy[idx]*dtdy[idx] + dtdz[idx]*dtdz[idx] + dtdn*dtdn);
+      const double norms = sqrt(dsdx[idx]*dsdx[idx] + dsdy[idx]*dsdy[idx] + dsdz[idx]*dsdz[idx] + dsdn*dsdn);
+      const double cos = (dtdx[idx]*dsdx[idx] + dtdy[idx]*dsdy[idx] + dtdz[idx]*dsdz[idx] + dtdn*dsdn) / (normt * norms);
+      ptr2vox[idx] = pow(cos, _Power);
     }
   }
 
@@ -186,6 +186,66 @@ void irtkEnergyTerm::Update(bool)
 {
 }
 
+// -----------------------------------------------------------------------------
+void irtkEnergyTerm::BeginLineSearch()
+{
+}
+
+// -----------------------------------------------------------------------------
+void irtkEnergyTerm::CacheLineSearchDirection()
+{
+}
+
+// -----------------------------------------------------------------------------
+void irtkEnergyTerm::LineSearchStep(double)
+{
+}
+
+// -----------------------------------------------------------------------------
+void irtkEnergyTerm::EndLineSearch()
+{
+}
+
+// -----------------------------------------------------------------------------
+bool irtkEnergyTerm::BeginGaussNewton()
+{
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+void irtkEnergyTerm::CacheGaussNewtonDirection(double)
+{
+}
+
+// -----------------------------------------------------------------------------
+void irtkEnergyTerm::GaussNewtonDiagonal(double *diag)
+{
+  const double weight = this->GradientWeight();
+  if (weight != .0) this->EvaluateGaussNewtonDiagonal(diag, weight);
+}
+
+// -----------------------------------------------------------------------------
+void irtkEnergyTerm::GaussNewtonProduct(double *Hv)
+{
+  const double weight = this->GradientWeight();
+  if (weight != .0) this->EvaluateGaussNewtonProduct(Hv, weight);
+}
+
+// -----------------------------------------------------------------------------
+void irtkEnergyTerm::EndGaussNewton()
+{
+}
+
+// -----------------------------------------------------------------------------
+void irtkEnergyTerm::EvaluateGaussNewtonDiagonal(double *, double)
+{
+}
+
+// -----------------------------------------------------------------------------
+void irtkEnergyTerm::EvaluateGaussNewtonProduct(double *, double)
+{
+}
+
 // -----------------------------------------------------------------------------
 bool irtkEnergyTerm::Upgrade()
 {
@@ -229,13 +289,20 @@ double irtkEnergyTerm::RawValue(double value) const
 }
 
 // -----------------------------------------------------------------------------
-void irtkEnergyTerm::Gradient(double *gradient, double step)
+double irtkEnergyTerm::GradientWeight()
 {
   double weight = _Weight;
   if (_DivideByInitialValue) {
     if (IsNaN(_InitialValue)) this->InitialValue();
     if (_InitialValue != .0) weight /= fabs(_InitialValue);
   }
+  return weight;
+}
+
+// -----------------------------------------------------------------------------
+void irtkEnergyTerm::Gradient(double *gradient, double step)
+{
+  const double weight = this->GradientWeight();
   if (weight != .0) this->EvaluateGradient(gradient, step, weight);
 }
 
@@ -0,0 +1,473 @@
+/* The Image Registration Toolkit (IRTK)
+ *
+ * Copyright 2008-2015 Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#include <irtkGaussNewtonDescent.h>
+
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+irtkGaussNewtonDescent::irtkGaussNewtonDescent(irtkObjectiveFunction *f)
+:
+  irtkLocalOptimizer(f),
+  _NumberOfSteps                      (-1),
+  _NumberOfRestarts                   (-1),
+  _NumberOfFailedRestarts             (-1),
+  _MaxRejectedStreak                  (-1),
+  _NumberOfConjugateGradientIterations(-1),
+  _ConjugateGradientTolerance         (.1),
+  _Damping                            (1e-3),
+  _Gradient                           (NULL),
+  _Diagonal                           (NULL),
+  _Direction                          (NULL),
+  _Residual                           (NULL),
+  _Preconditioned                     (NULL),
+  _Conjugate                          (NULL),
+  _Product                            (NULL),
+  _Origin                             (NULL)
+{
+  this->Epsilon(- this->Epsilon()); // relative to current best value
+}
+
+// -----------------------------------------------------------------------------
+irtkGaussNewtonDescent::irtkGaussNewtonDescent(const irtkGaussNewtonDescent &other)
+:
+  irtkLocalOptimizer(other),
+  _NumberOfSteps                      (other._NumberOfSteps),
+  _NumberOfRestarts                   (other._NumberOfRestarts),
+  _NumberOfFailedRestarts             (other._NumberOfFailedRestarts),
+  _MaxRejectedStreak                  (other._MaxRejectedStreak),
+  _NumberOfConjugateGradientIterations(other._NumberOfConjugateGradientIterations),
+  _ConjugateGradientTolerance         (other._ConjugateGradientTolerance),
+  _Damping                            (other._Damping),
+  _Gradient                           (NULL),
+  _Diagonal                           (NULL),
+  _Direction                          (NULL),
+  _Residual                           (NULL),
+  _Preconditioned                     (NULL),
+  _Conjugate                          (NULL),
+  _Product                            (NULL),
+  _Origin                             (NULL)
+{
+}
+
+// -----------------------------------------------------------------------------
+irtkGaussNewtonDescent &irtkGaussNewtonDescent::operator =(const irtkGaussNewtonDescent &other)
+{
+  irtkLocalOptimizer::operator =(other);
+  _NumberOfSteps                       = other._NumberOfSteps;
+  _NumberOfRestarts                    = other._NumberOfRestarts;
+  _NumberOfFailedRestarts              = other._NumberOfFailedRestarts;
+  _MaxRejectedStreak                   = other._MaxRejectedStreak;
+  _NumberOfConjugateGradientIterations = other._NumberOfConjugateGradientIterations;
+  _ConjugateGradientTolerance          = other._ConjugateGradientTolerance;
+  _Damping                             = other._Damping;
+  DeallocateVectors();
+  return *this;
+}
+
+// -----------------------------------------------------------------------------
+irtkGaussNewtonDescent::~irtkGaussNewtonDescent()
+{
+  DeallocateVectors();
+}
+
+// -----------------------------------------------------------------------------
+void irtkGaussNewtonDescent::DeallocateVectors()
+{
+  Deallocate(_Gradient);
+  Deallocate(_Diagonal);
+  Deallocate(_Direction);
+  Deallocate(_Residual);
+  Deallocate(_Preconditioned);
+  Deallocate(_Conjugate);
+  Deallocate(_Product);
+  Deallocate(_Origin);
+}
+
+// -----------------------------------------------------------------------------
+void irtkGaussNewtonDescent::Function(irtkObjectiveFunction *f)
+{
+  // Reallocation of possibly previously allocated vectors required
+  // if new function has differing number of DoFs
+  if (!f || !this->Function() || this->Function()->NumberOfDOFs() != f->NumberOfDOFs()) {
+    DeallocateVectors();
+  }
+  irtkLocalOptimizer::Function(f);
+}
+
+// =============================================================================
+// Parameters
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+bool irtkGaussNewtonDescent::Set(const char *name, const char *value)
+{
+  if (strcmp(name, "Maximum no. of iterations")        == 0 ||
+      strcmp(name, "Maximum number of iterations")     == 0 ||
+      strcmp(name, "Maximum no. of gradient steps")    == 0 ||
+      strcmp(name, "Maximum number of gradient steps") == 0 ||
+      strcmp(name,    "No. of iterations")             == 0 ||
+      strcmp(name, "Number of iterations")             == 0 ||
+      strcmp(name,    "No. of gradient steps")         == 0 ||
+      strcmp(name, "Number of gradient steps")         == 0) {
+    return FromString(value, _NumberOfSteps);
+  } else if (strcmp(name, "Maximum no. of restarts")    == 0 ||
+             strcmp(name, "Maximum number of restarts") == 0 ||
+             strcmp(name, "No. of restarts")            == 0 ||
+             strcmp(name, "Number of restarts")         == 0) {
+    return FromString(value, _NumberOfRestarts);
+  } else if (strcmp(name, "Maximum no. of failed restarts")          == 0 ||
+             strcmp(name, "Maximum number of failed restarts")       == 0 ||
+             strcmp(name, "No. of failed restarts")                  == 0 ||
+             strcmp(name, "Number of failed restarts")               == 0 ||
+             strcmp(name, "Maximum no. of unsuccessful restarts")    == 0 ||
+             strcmp(name, "Maximum number of unsuccessful restarts") == 0 ||
+             strcmp(name, "No. of unsuccessful restarts")            == 0 ||
+             strcmp(name, "Number of unsuccessful restarts")         == 0 ||
+             strcmp(name, "Maximum streak of failed restarts")       == 0 ||
+             strcmp(name, "Maximum streak of unsuccessful restarts") == 0 ||
+             strcmp(name, "Maximum streak of rejected restarts")     == 0) {
+    return FromString(value, _NumberOfFailedRestarts);
+  } else if (strcmp(name, "Maximum streak of rejected steps")     == 0 ||
+             strcmp(name, "Maximum streak of unsuccessful steps") == 0) {
+    return FromString(value, _MaxRejectedStreak);
+  } else if (strcmp(name, "Maximum no. of conjugate gradient iterations")    == 0 ||
+             strcmp(name, "Maximum number of conjugate gradient iterations") == 0 ||
+             strcmp(name, "No. of conjugate gradient iterations")            == 0 ||
+             strcmp(name, "Number of conjugate gradient iterations")         == 0) {
+    return FromString(value, _NumberOfConjugateGradientIterations);
+  } else if (strcmp(name, "Conjugate gradient tolerance") == 0) {
+    return FromString(value, _ConjugateGradientTolerance) && _ConjugateGradientTolerance > .0;
+  } else if (strcmp(name, "Damping")                     == 0 ||
+             strcmp(name, "Initial damping")             == 0 ||
+             strcmp(name, "Levenberg-Marquardt damping") == 0) {
+    return FromString(value, _Damping) && _Damping >= .0;
+  }
+  return irtkLocalOptimizer::Set(name, value);
+}
+
+// -----------------------------------------------------------------------------
+irtkParameterList irtkGaussNewtonDescent::Parameter() const
+{
+  irtkParameterList params = irtkLocalOptimizer::Parameter();
+  Insert(params, "Maximum no. of iterations",                    ToString(_NumberOfSteps));
+  Insert(params, "Maximum no. of restarts",                      ToString(_NumberOfRestarts));
+  Insert(params, "Maximum no. of failed restarts",               ToString(_NumberOfFailedRestarts));
+  Insert(params, "Maximum streak of rejected steps",             ToString(_MaxRejectedStreak));
+  Insert(params, "Maximum no. of conjugate gradient iterations", ToString(_NumberOfConjugateGradientIterations));
+  Insert(params, "Conjugate gradient tolerance",                 ToString(_ConjugateGradientTolerance));
+  Insert(params, "Initial damping",                              ToString(_Damping));
+  return params;
+}
+
+// =============================================================================
+// Optimization
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void irtkGaussNewtonDescent::Initialize()
+{
+  // Initialize base class -- checks that _Function is valid
+  irtkLocalOptimizer::Initialize();
+  // Default values
+  if (_NumberOfSteps                       <= 0) _NumberOfSteps                       = 100;
+  if (_NumberOfRestarts                    <  0) _NumberOfRestarts                    = 100;
+  if (_NumberOfFailedRestarts              <  0) _NumberOfFailedRestarts              =   5;
+  if (_MaxRejectedStreak                   <  0) _MaxRejectedStreak                   =  10;
+  if (_NumberOfConjugateGradientIterations <= 0) _NumberOfConjugateGradientIterations =  20;
+  // Allocate memory for vectors if not done before
+  const int ndofs = Function()->NumberOfDOFs();
+  if (!_Gradient)       Allocate(_Gradient,       ndofs);
+  if (!_Diagonal)       Allocate(_Diagonal,       ndofs);
+  if (!_Direction)      Allocate(_Direction,      ndofs);
+  if (!_Residual)       Allocate(_Residual,       ndofs);
+  if (!_Preconditioned) Allocate(_Preconditioned, ndofs);
+  if (!_Conjugate)      Allocate(_Conjugate,      ndofs);
+  if (!_Product)        Allocate(_Product,        ndofs);
+  if (!_Origin)         Allocate(_Origin,         ndofs);
+}
+
+// -----------------------------------------------------------------------------
+void irtkGaussNewtonDescent::Finalize()
+{
+  DeallocateVectors();
+}
+
+// -----------------------------------------------------------------------------
+void irtkGaussNewtonDescent::ComputeDiagonal()
+{
+  const int ndofs = Function()->NumberOfDOFs();
+  Function()->GaussNewtonDiagonal(_Diagonal);
+
+  // The diagonal of the transformation constraints is not approximated and
+  // parameters outside the foreground may have no curvature at all. Clamp the
+  // diagonal such that the damping and preconditioner remain well-defined.
+  double max = .0;
+  for (int dof = 0; dof < ndofs; ++dof) {
+    _Diagonal[dof] = fabs(_Diagonal[dof]);
+    if (_Diagonal[dof] > max) max = _Diagonal[dof];
+  }
+  const double min = (max > .0 ? 1e-3 * max : 1.0);
+  for (int dof = 0; dof < ndofs; ++dof) {
+    if (_Diagonal[dof] < min) _Diagonal[dof] = min;
+  }
+}
+
+// -----------------------------------------------------------------------------
+int irtkGaussNewtonDescent::ComputeStep(double lambda)
+{
+  const int ndofs = Function()->NumberOfDOFs();
+
+  double * const x = _Direction;
+  double * const r = _Residual;
+  double * const z = _Preconditioned;
+  double * const p = _Conjugate;
+  double * const q = _Product;
+
+  // Initial residual of (H + lambda D) x = -g at x = 0
+  double rr = .0, rz = .0;
+  for (int dof = 0; dof < ndofs; ++dof) {
+    x[dof] = .0;
+    r[dof] = - _Gradient[dof];
+    z[dof] = r[dof] / ((1.0 + lambda) * _Diagonal[dof]);
+    p[dof] = z[dof];
+    rr += r[dof] * r[dof];
+    rz += r[dof] * z[dof];
+  }
+  const double tol = _ConjugateGradientTolerance * sqrt(rr);
+  if (rr == .0) return 0;
+
+  // Preconditioned conjugate gradient iterations
+  int iter = 0;
+  while (iter < _NumberOfConjugateGradientIterations) {
+    Function()->GaussNewtonProduct(p, q);
+    double pq = .0;
+    for (int dof = 0; dof < ndofs; ++dof) {
+      q[dof] += lambda * _Diagonal[dof] * p[dof];
+      pq     += p[dof] * q[dof];
+    }
+    // Stop if direction of non-positive curvature, in which case the
+    // preconditioned gradient is used during the first iteration
+    if (pq <= .0) {
+      if (iter == 0) memcpy(x, z, ndofs * sizeof(double));
+      break;
+    }
+    ++iter;
+    const double alpha = rz / pq;
+    rr = .0;
+    for (int dof = 0; dof < ndofs; ++dof) {
+      x[dof] += alpha * p[dof];
+      r[dof] -= alpha * q[dof];
+      rr     += r[dof] * r[dof];
+    }
+    if (sqrt(rr) <= tol) break;
+    const double prev = rz;
+    rz = .0;
+    for (int dof = 0; dof < ndofs; ++dof) {
+      z[dof] = r[dof] / ((1.0 + lambda) * _Diagonal[dof]);
+      rz    += r[dof] * z[dof];
+    }
+    const double beta = rz / prev;
+    for (int dof = 0; dof < ndofs; ++dof) {
+      p[dof] = z[dof] + beta * p[dof];
+    }
+  }
+  return iter;
+}
+
+// -----------------------------------------------------------------------------
+double irtkGaussNewtonDescent::Run()
+{
+  double value     = numeric_limits<double>::max();
+  int    nrestarts = 0; // Number of restarts after convergence
+  int    nfailed   = 0; // Number of consecutive restarts without improvement
+
+  // Initialize
+  this->Initialize();
+
+  const int ndofs = Function()->NumberOfDOFs();
+
+  // Perform initial update of energy function before StartEvent because
+  // it may trigger some further delayed initialization with LogEvent's
+  Function()->Update(true);
+
+  // Notify observers about start of optimization
+  Broadcast(StartEvent);
+
+  // Total number of performed Gauss-Newton steps
+  irtkIteration step(0, _NumberOfSteps);
+
+  // Repeat optimization for each restart with modified energy function.
+  // If energy remains fixed, only one iteration is done.
+  while (true) {
+
+    // Get initial value of (modified) energy function
+    value = Function()->Value();
+    const double initial = value;
+
+    // Current number of iterations
+    const int iter = step.Iter();
+
+    // Damping factor and its growth upon rejection
+    double lambda = _Damping;
+    double nu     = 2.0;
+
+    while (step.Next()) {
+
+      // Notify observers about start of iteration
+      Broadcast(IterationEvent, &step);
+
+      // Compute gradient of objective function
+      if (step.Iter() > 1) Function()->Update(true);
+      Function()->Gradient(_Gradient);
+      Function()->Get(_Origin);
+
+      // Notify observers about start of damped Gauss-Newton steps
+      irtkLineSearchStep lstep;
+      lstep._Info        = "damped Gauss-Newton";
+      lstep._Direction   = _Direction;
+      lstep._Current     = value;
+      lstep._Value       = value;
+      lstep._MinLength   = lambda;
+      lstep._MaxLength   = lambda;
+      lstep._Unit        = 1.0;
+      Broadcast(LineSearchStartEvent, &lstep);
+
+      // Gauss-Newton approximation of Hessian at current parameters, which
+      // is reused by all trial steps as these only differ in the damping
+      if (!Function()->BeginGaussNewton()) {
+        cerr << "irtkGaussNewtonDescent::Run: Objective function does not"
+                " provide a Gauss-Newton approximation of its Hessian" << endl;
+        exit(1);
+      }
+      this->ComputeDiagonal();
+
+      // Increase damping until step decreases objective function value
+      bool accepted = false;
+      irtkIteration trial(0, _MaxRejectedStreak + 1);
+      while (trial.Next()) {
+
+        // Notify observers about start of trial step
+        Broadcast(LineSearchIterationStartEvent, &trial);
+
+        // Solve damped Gauss-Newton equations
+        this->ComputeStep(lambda);
+
+        // Check minimum maximum change of DoFs convergence criterium
+        lstep._Length = lambda;
+        lstep._Delta  = Function()->GradientNorm(_Direction);
+        if (lstep._Delta <= _Delta) {
+          Function()->Update(false);
+          break;
+        }
+
+        // Predicted decrease of quadratic model, i.e., 1/2 dx^T (lambda D dx - g)
+        double predicted = .0;
+        for (int dof = 0; dof < ndofs; ++dof) {
+          predicted += _Direction[dof] * (lambda * _Diagonal[dof] * _Direction[dof] - _Gradient[dof]);
+        }
+        predicted *= .5;
+
+        // Take step and evaluate objective function
+        Function()->Step(_Direction);
+        Function()->Update(false);
+        lstep._Value = Function()->Value();
+        if (IsNaN(lstep._Value)) {
+          cerr << "irtkGaussNewtonDescent::Run:" << __LINE__ << ": NaN objective function value!" << endl;
+          exit(1);
+        }
+
+        if (lstep._Value < value && predicted > .0) {
+
+          // Notify observers about progress
+          Broadcast(AcceptedStepEvent, &lstep);
+          lstep._TotalLength = lambda;
+
+          // Decrease damping depending on agreement of actual and predicted decrease
+          const double rho = (value - lstep._Value) / predicted;
+          lambda *= max(1.0 / 3.0, 1.0 - pow(2.0 * rho - 1.0, 3));
+          nu      = 2.0;
+          value   = lstep._Value;
+          accepted = true;
+
+        } else {
+
+          // Notify observers about progress
+          Broadcast(RejectedStepEvent, &lstep);
+
+          // Reject step and increase damping
+          Function()->Put(_Origin);
+          Function()->Update(true);
+          if (lambda == .0) lambda = _Damping > .0 ? _Damping : 1e-3;
+          else              lambda *= nu;
+          nu *= 2.0;
+        }
+
+        // Notify observers about end of trial step
+        Broadcast(LineSearchIterationEndEvent, &trial);
+
+        if (accepted) break;
+      }
+
+      // Discard Gauss-Newton approximation
+      Function()->EndGaussNewton();
+
+      // Notify observers about end of damped Gauss-Newton steps
+      Broadcast(LineSearchEndEvent, &lstep);
+
+      // Check convergence
+      if (!accepted) break;
+      const double epsilon = (_Epsilon < .0 ? fabs(_Epsilon * value) : _Epsilon);
+      if (lstep._Current - value <= epsilon) break;
+    }
+
+    // Stop if previous restart did not bring any improvement
+    if (step.Iter() == (iter + 1) && value == initial) {
+      ++nfailed;
+      if (nfailed >= _NumberOfFailedRestarts) break;
+    } else {
+      nfailed = 0;
+    }
+
+    // Stop if maximum number of iterations exceeded
+    if (step.End()) break;
+
+    // Stop if maximum number of allowed restarts exceeded
+    if (nrestarts >= _NumberOfRestarts) break;
+    ++nrestarts;
+
+    // Start another optimization of the amended objective if modified
+    if (!Function()->Upgrade()) break;
+
+    // Update energy function for initial value evaluation as well as for
+    // the first gradient computation
+    Function()->Update(true);
+
+    // Notify observers about restart
+    Broadcast(RestartEvent);
+  }
+
+  // Notify observers about end of optimization
+  Broadcast(EndEvent, &value);
+
+  // Finalize
+  this->Finalize();
+
+  return value;
+}
@@ -15,6 +15,7 @@
  * limitations under the License. */
 
 #include <cctype>
+#include <cstdio>
 
 #include <irtkGenericRegistrationFilter.h>
 
@@ -61,6 +62,9 @@ static const string MAXSTEP = "Maximum length of steps";
 // Tolerance used for voxel size comparisons
 static const double TOL     = 1.0e-6;
 
+// Magic number identifying registration checkpoint files
+static const unsigned int CHECKPOINT_MAGIC = 815008;
+
 // -----------------------------------------------------------------------------
 // Types
 // -----------------------------------------------------------------------------
@@ -600,8 +604,10 @@ using namespace irtkGenericRegistrationFilterUtils;
 // -----------------------------------------------------------------------------
 void irtkGenericRegistrationFilter::Reset()
 {
-  _CurrentModel = TM_Unknown;
-  _CurrentLevel = 0;
+  _CurrentModel      = TM_Unknown;
+  _CurrentLevel      = 0;
+  _CurrentModelIndex = 0;
+  _ResumeLevel       = 0;
   // Free memory allocated upon previous Run
   _Image .clear();
   _Energy.Clear();
@@ -650,6 +656,7 @@ void irtkGenericRegistrationFilter::Reset()
   _ImageSimilarityInfo.clear();
   _PointSetDistanceInfo.clear();
   _PointSetConstraintInfo.clear();
+  _Background.clear();
   _Padding.clear();
   memset(_MinControlPointSpacing, 0, 4 * MAX_NO_RESOLUTIONS * sizeof(double));
   memset(_MaxControlPointSpacing, 0, 4 * MAX_NO_RESOLUTIONS * sizeof(double));
@@ -677,6 +684,10 @@ void irtkGenericRegistrationFilter::Clear()
   // Clear inputs
   _Input.clear();
   _InitialGuess = NULL;
+  _CheckpointFile.clear();
+  _ResumeFile.clear();
+  // Discard kept resolution pyramids
+  this->ReleasePyramid();
 }
 
 // -----------------------------------------------------------------------------
@@ -723,6 +734,49 @@ void irtkGenericRegistrationFilter::AddInput(const irtkBaseImage *image)
   _Input.push_back(image);
 }
 
+// -----------------------------------------------------------------------------
+void irtkGenericRegistrationFilter::KeepPyramid(const irtkBaseImage *image)
+{
+  if (image == NULL || FindKeptPyramid(image) != NULL) return;
+  KeptPyramid pyramid;
+  pyramid._Input                        = image;
+  pyramid._NumberOfLevels               = 0;
+  pyramid._UseGaussianResolutionPyramid = -1;
+  pyramid._DownsampleWithPadding        = false;
+  pyramid._CropPadImages                = false;
+  pyramid._Background                   = MIN_GREY;
+  pyramid._UserPadding                  = MIN_GREY;
+  pyramid._Padding                      = MIN_GREY;
+  pyramid._HasCentroid                  = false;
+  _KeptPyramid.push_back(pyramid);
+}
+
+// -----------------------------------------------------------------------------
+void irtkGenericRegistrationFilter::ReleasePyramid(const irtkBaseImage *image)
+{
+  if (image == NULL) {
+    _KeptPyramid.clear();
+  } else {
+    vector<KeptPyramid>::iterator it;
+    for (it = _KeptPyramid.begin(); it != _KeptPyramid.end(); ++it) {
+      if (it->_Input == image) {
+        _KeptPyramid.erase(it);
+        break;
+      }
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+irtkGenericRegistrationFilter::KeptPyramid *
+irtkGenericRegistrationFilter::FindKeptPyramid(const irtkBaseImage *image)
+{
+  for (size_t i = 0; i < _KeptPyramid.size(); ++i) {
+    if (_KeptPyramid[i]._Input == image) return &_KeptPyramid[i];
+  }
+  return NULL;
+}
+
 // -----------------------------------------------------------------------------
 void irtkGenericRegistrationFilter::Input(const irtkBaseImage *target, const irtkBaseImage *source)
 {
@@ -2080,20 +2134,49 @@ void irtkGenericRegistrationFilter::Run()
   // Guess parameters not specified by user
   this->GuessParameter();
 
+  // Count reuse of image buffers by this registration only
+  irtkBufferPool::Instance().ResetStatistics();
+
+  // Restore state of interrupted registration
+  const irtkTransformation * const dofin = _InitialGuess;
+  irtkTransformation *resumed = NULL;
+  _CurrentModelIndex = 0;
+  _ResumeLevel       = 0;
+  if (!_ResumeFile.empty()) {
+    int level;
+    resumed = this->ReadCheckpoint(_CurrentModelIndex, level);
+    if (level > 1) {
+      _ResumeLevel = level;
+    } else {
+      // Continue with next transformation model
+      ++_CurrentModelIndex;
+      _InitialGuess = resumed;
+      // Unless the registration was already completed
+      if (_CurrentModelIndex == static_cast<int>(_TransformationModel.size())) {
+        _InitialGuess = dofin;
+        Output(resumed);
+        return;
+      }
+    }
+  }
+
   // Initialize image resolution pyramid
   this->InitializePyramid();
   this->InitializePointSets();
 
   // Make initial guess of transformation if none provided
-  const irtkTransformation * const dofin = _InitialGuess;
-  if (!_InitialGuess) _InitialGuess = this->MakeInitialGuess();
+  if (!_InitialGuess && !resumed) _InitialGuess = this->MakeInitialGuess();
 
   IRTK_DEBUG_TIMING(1, "initialization of registration");
 
   // For each transformation model (usually increasing number of DoFs)...
-  irtkIteration model(0, _TransformationModel.size());
+  irtkIteration model(_CurrentModelIndex, _TransformationModel.size());
   while (!model.End()) {
-    _CurrentModel = _TransformationModel[model.Iter()];
+    _CurrentModelIndex = model.Iter();
+    _CurrentModel      = _TransformationModel[_CurrentModelIndex];
+
+    // Continue with transformation estimate of last completed level
+    if (_ResumeLevel > 1) _Transformation = resumed;
 
     // Broadcast status message
     if (_TransformationModel.size() > 1) {
@@ -2121,6 +2204,16 @@ void irtkGenericRegistrationFilter::Run()
   // Restore initial user guess
   _InitialGuess = dofin;
 
+  // Report reuse of image buffers of pyramid, energy terms, and filters
+  const irtkBufferPool::Statistics stats = irtkBufferPool::Instance().GetStatistics();
+  const double MB = 1024.0 * 1024.0;
+  ostringstream msg;
+  msg << "\nImage buffers: " << stats._Reuses << " of " << stats._Allocations
+      << " allocations reused (" << stats._ReusedBytes / MB << " MB), peak memory "
+      << stats._PeakInUseBytes / MB << " MB in use, "
+      << stats._PeakBytes / MB << " MB incl. cached buffers\n";
+  Broadcast(LogEvent, msg.str().c_str());
+
   IRTK_DEBUG_TIMING(1, "registration");
 }
 
@@ -2129,7 +2222,8 @@ void irtkGenericRegistrationFilter::MultiResolutionOptimization()
 {
   // For each resolution level (coarse to fine)...
   // Note: Zero-th level is used to store global registration settings
-  irtkIteration level(_NumberOfLevels, 0);
+  irtkIteration level(_ResumeLevel > 1 ? _ResumeLevel - 1 : _NumberOfLevels, 0);
+  _ResumeLevel = 0;
   while (!level.End()) {
     _CurrentLevel = level.Iter();
     IRTK_START_TIMING();
@@ -2147,14 +2241,155 @@ void irtkGenericRegistrationFilter::MultiResolutionOptimization()
     this->Finalize();
     Broadcast(FinishEvent, &level);
 
+    // Release cached image buffers of this level, because the buffers of
+    // the next level are of a different size
+    irtkBufferPool::Instance().Trim();
+
+    // Save state of registration such that it can be resumed
+    if (!_CheckpointFile.empty()) this->WriteCheckpoint();
+
     IRTK_DEBUG_TIMING(2, "registration at level " << level.Iter());
     ++level;
   }
 }
 
+// -----------------------------------------------------------------------------
+void irtkGenericRegistrationFilter::WriteCheckpoint() const
+{
+  // Write to temporary file first such that previous checkpoint remains
+  // valid when the registration is interrupted while writing the new one
+  const string fname = _CheckpointFile + ".tmp";
+
+  irtkCofstream to;
+  to.Open(fname.c_str());
+  to.WriteAsUInt(CHECKPOINT_MAGIC);
+  to.WriteAsInt(static_cast<int>(_TransformationModel.size()));
+  to.WriteAsInt(_CurrentModelIndex);
+  to.WriteAsInt(static_cast<int>(_CurrentModel));
+  to.WriteAsInt(_NumberOfLevels);
+  to.WriteAsInt(_CurrentLevel);
+  to.WriteAsDouble(&_MinControlPointSpacing[0][0], 4 * MAX_NO_RESOLUTIONS);
+  to.WriteAsDouble(&_MaxControlPointSpacing[0][0], 4 * MAX_NO_RESOLUTIONS);
+  _Transformation->Write(to);
+  // Status of local transformations is not part of the transformation file
+  const irtkMultiLevelTransformation *mffd;
+  mffd = dynamic_cast<const irtkMultiLevelTransformation *>(_Transformation);
+  if (mffd) {
+    for (int l = 0; l < mffd->NumberOfLevels(); ++l) {
+      to.WriteAsInt(static_cast<int>(mffd->LocalTransformationStatus(l)));
+    }
+  }
+  to.Close();
+
+  if (rename(fname.c_str(), _CheckpointFile.c_str()) != 0) {
+    cerr << "irtkGenericRegistrationFilter::WriteCheckpoint: Failed to rename "
+         << fname << " to " << _CheckpointFile << endl;
+    exit(1);
+  }
+}
+
+// -----------------------------------------------------------------------------
+irtkTransformation *irtkGenericRegistrationFilter::ReadCheckpoint(int &model, int &level)
+{
+  irtkCifstream from;
+  from.Open(_ResumeFile.c_str());
+
+  unsigned int magic_no;
+  from.ReadAsUInt(&magic_no, 1);
+  if (magic_no != CHECKPOINT_MAGIC) {
+    cerr << "irtkGenericRegistrationFilter::ReadCheckpoint: Not a registration checkpoint file: " << _ResumeFile << endl;
+    exit(1);
+  }
+
+  // Check that checkpoint matches current registration settings
+  int nmodels, type, nlevels;
+  from.ReadAsInt(&nmodels, 1);
+  from.ReadAsInt(&model,   1);
+  from.ReadAsInt(&type,    1);
+  from.ReadAsInt(&nlevels, 1);
+  from.ReadAsInt(&level,   1);
+  if (nmodels != static_cast<int>(_TransformationModel.size()) ||
+      model   <  0 || model >= nmodels ||
+      type    != static_cast<int>(_TransformationModel[model]) ||
+      nlevels != _NumberOfLevels || level < 1 || level > nlevels) {
+    cerr << "irtkGenericRegistrationFilter::ReadCheckpoint: Checkpoint " << _ResumeFile
+         << " does not match transformation model(s) and number of resolution levels" << endl;
+    exit(1);
+  }
+
+  // Control point spacing of each level as modified during the registration
+  from.ReadAsDouble(&_MinControlPointSpacing[0][0], 4 * MAX_NO_RESOLUTIONS);
+  from.ReadAsDouble(&_MaxControlPointSpacing[0][0], 4 * MAX_NO_RESOLUTIONS);
+
+  // Transformation estimate after last completed level
+  const long   offset = from.Tell();
+  unsigned int dof_type;
+  from.ReadAsUInt(&magic_no, 1);
+  from.ReadAsUInt(&dof_type, 1);
+  if (magic_no != IRTKTRANSFORMATION_MAGIC) {
+    cerr << "irtkGenericRegistrationFilter::ReadCheckpoint: Invalid transformation in " << _ResumeFile << endl;
+    exit(1);
+  }
+  from.Seek(offset);
+  irtkTransformation *dof = irtkTransformation::New(dof_type);
+  dof->Read(from);
+  irtkMultiLevelTransformation *mffd = dynamic_cast<irtkMultiLevelTransformation *>(dof);
+  if (mffd) {
+    int status;
+    for (int l = 0; l < mffd->NumberOfLevels(); ++l) {
+      from.ReadAsInt(&status, 1);
+      mffd->LocalTransformationStatus(l, static_cast<DOFStatus>(status));
+    }
+  }
+  from.Close();
+
+  return dof;
+}
+
 // -----------------------------------------------------------------------------
 void irtkGenericRegistrationFilter::InitializePyramid()
 {
+  // Coarser levels are not needed when resuming the last transformation model
+  int nlevels = _NumberOfLevels;
+  if (_ResumeLevel > 1 && _CurrentModelIndex + 1 == static_cast<int>(_TransformationModel.size())) {
+    nlevels = _ResumeLevel - 1;
+  }
+
+  // Find kept resolution pyramids of input images with unchanged settings
+  // (not used when emulating the pre-processing of registration2++ package)
+  vector<KeptPyramid *> kept  (NumberOfImages(), NULL);
+  vector<bool>          cached(NumberOfImages(), false);
+  if (version >= irtkVersion(3, 0) && nlevels == _NumberOfLevels) {
+    for (int n = 0; n < NumberOfImages(); ++n) {
+      KeptPyramid *pyramid = FindKeptPyramid(_Input[n]);
+      for (int m = 0; pyramid && m < n; ++m) {
+        if (kept[m] == pyramid) pyramid = NULL;
+      }
+      if (pyramid == NULL) continue;
+      bool same = (pyramid->_NumberOfLevels               == _NumberOfLevels                &&
+                   pyramid->_UseGaussianResolutionPyramid == _UseGaussianResolutionPyramid  &&
+                   pyramid->_DownsampleWithPadding        == _DownsampleWithPadding         &&
+                   pyramid->_CropPadImages                == _CropPadImages                 &&
+                   pyramid->_Background                   == _Background[n]                 &&
+                   pyramid->_UserPadding                  == _Padding[n]);
+      for (int l = 1; same && l <= _NumberOfLevels; ++l) {
+        same = (pyramid->_Blurring[l] == _Blurring[l][n]);
+        if (same && !_UseGaussianResolutionPyramid) {
+          same = (pyramid->_Resolution[l] == _Resolution[l][n]);
+        }
+      }
+      if (!same) {
+        pyramid->_NumberOfLevels = 0;
+        pyramid->_HasCentroid    = false;
+        pyramid->_Background     = _Background[n];
+        pyramid->_UserPadding    = _Padding[n];
+        pyramid->_Image.clear();
+      }
+      kept  [n] = pyramid;
+      cached[n] = same;
+    }
+  }
+
   // Compute centers of foreground mass (if needed)
   bool centering = false;
   for (int l = 1; !centering && l <= _NumberOfLevels; ++l) {
@@ -2170,11 +2405,19 @@ void irtkGenericRegistrationFilter::InitializePyramid()
     Broadcast(LogEvent, "Computing centroids .....");
     _Centroid.resize(NumberOfImages());
     for (int n = 0; n < NumberOfImages(); ++n) {
+      if (kept[n] && kept[n]->_HasCentroid) {
+        _Centroid[n] = kept[n]->_Centroid;
+        continue;
+      }
       if (CenterOfForeground(_Input[n], _Padding[n], _Centroid[n]) == 0) {
         Broadcast(LogEvent, " failed\n");
         cerr << "Error: Input image " << (n + 1) << " contains background only!" << endl;
         exit(1);
       }
+      if (kept[n]) {
+        kept[n]->_HasCentroid = true;
+        kept[n]->_Centroid    = _Centroid[n];
+      }
     }
     Broadcast(LogEvent, " done\n");
   } else {
@@ -2193,40 +2436,64 @@ void irtkGenericRegistrationFilter::InitializePyramid()
   // Allocate image list for each level even if empty
   _Image.resize(_NumberOfLevels + 1);
 
+  // Ranges of consecutive images whose pyramid is not kept from previous run
   // Note: Level indices are in the range [1, N]
-  blocked_range  <int> images (0,  NumberOfImages());
-  blocked_range  <int> levels (1, _NumberOfLevels+1);
-  blocked_range2d<int> pyramid(1, _NumberOfLevels+1, 0, NumberOfImages());
-  const blocked_range<int> &level = images;
+  vector<blocked_range<int> > images;
+  for (int n = 0; n < NumberOfImages(); ++n) {
+    if (cached[n]) continue;
+    int m = n + 1;
+    while (m < NumberOfImages() && !cached[m]) ++m;
+    images.push_back(blocked_range<int>(n, m));
+    n = m;
+  }
+  blocked_range<int> levels(1, nlevels+1);
 
   if (NumberOfImages() > 0) {
 
+    // Instantiate resolution pyramid
+    for (int l = 1; l <= _NumberOfLevels; ++l) {
+      _Image[l].resize(NumberOfImages());
+    }
+
+    // Copy kept pyramids
+    for (int n = 0; n < NumberOfImages(); ++n) {
+      if (cached[n]) {
+        _Padding[n] = kept[n]->_Padding;
+        for (int l = 1; l <= _NumberOfLevels; ++l) {
+          _Image[l][n] = kept[n]->_Image[l];
+        }
+      }
+    }
+
     // Set background value to minimum intensity - 1 if not user defined
     //
     // The background value is only used for cropping the images to reduce
     // the computational cost of the registration. For defining the foreground
     // region to consider during the registration, the padding value is used.
     InitPadding init_padding(_Input, _Padding);
-    parallel_for(images, init_padding);
+    for (size_t r = 0; r < images.size(); ++r) {
+      parallel_for(images[r], init_padding);
+    }
     for (int i = 0; i < NumberOfImages(); ++i) {
       if (_Background[i] == MIN_GREY) _Background[i] = _Padding[i];
     }
+  }
 
-    // Instantiate resolution pyramid
-    _Image.resize(_NumberOfLevels + 1);
-    for (int l = 1; l <= _NumberOfLevels; ++l) {
-      _Image[l].resize(NumberOfImages());
-    }
+  if (!images.empty()) {
 
     // Copy/cast foreground of input images
     if (_CropPadImages) {
       Broadcast(LogEvent, "Crop/pad images .........");
       CropImages crop(_Input, _Background, _Blurring[1], _Image[1]);
-      parallel_for(images, crop);
+      for (size_t r = 0; r < images.size(); ++r) {
+        parallel_for(images[r], crop);
+      }
     } else {
       Broadcast(LogEvent, "Padding images ..........");
       PadImages pad(_Input, _Background, _Image[1]);
-      parallel_for(images, pad);
+      for (size_t r = 0; r < images.size(); ++r) {
+        parallel_for(images[r], pad);
+      }
     }
     Broadcast(LogEvent, " done\n");
 
@@ -2258,79 +2525,138 @@ void irtkGenericRegistrationFilter::InitializePyramid()
     // Otherwise just copy first level to remaining levels which will be
     // blurred and resampled by the following processing steps. Optionally,
     // the images are cropped to minimal foreground size while being copied.
-    if (_UseGaussianResolutionPyramid && _NumberOfLevels > 1) {
+    if (_UseGaussianResolutionPyramid && nlevels > 1) {
       Broadcast(LogEvent, "Downsample images .......");
       if (debug_time) Broadcast(LogEvent, "\n");
     }
-    for (int l = 2; l <= _NumberOfLevels; ++l) {
-      if (_UseGaussianResolutionPyramid) {
-        DownsampleImages downsample(_Image, l, padding);
-        parallel_for(level, downsample);
-      } else if (_CropPadImages) {
-        CropImages crop(_Input, _Background, _Blurring[l], _Image[l]);
-        parallel_for(level, crop);
-      } else {
-        CopyImages copy(_Image[1], _Image[l]);
-        parallel_for(level, copy);
+    for (int l = 2; l <= nlevels; ++l) {
+      for (size_t r = 0; r < images.size(); ++r) {
+        if (_UseGaussianResolutionPyramid) {
+          DownsampleImages downsample(_Image, l, padding);
+          parallel_for(images[r], downsample);
+        } else if (_CropPadImages) {
+          CropImages crop(_Input, _Background, _Blurring[l], _Image[l]);
+          parallel_for(images[r], crop);
+        } else {
+          CopyImages copy(_Image[1], _Image[l]);
+          parallel_for(images[r], copy);
+        }
       }
     }
-    if (_UseGaussianResolutionPyramid && _NumberOfLevels > 1) {
+    if (_UseGaussianResolutionPyramid && nlevels > 1) {
       if (debug_time) Broadcast(LogEvent, "Downsample images .......");
       Broadcast(LogEvent, " done\n");
     }
 
     // Blur images (by default only if no Gaussian pyramid is used)
     bool anything_to_blur = false;
-    for (int l = 1; l <= _NumberOfLevels;   ++l)
+    for (int l = 1; l <= nlevels;           ++l)
     for (int n = 0; n <   NumberOfImages(); ++n) {
-      if (_Blurring[l][n] > .0) anything_to_blur = true;
+      if (!cached[n] && _Blurring[l][n] > .0) anything_to_blur = true;
     }
     if (anything_to_blur) {
       Broadcast(LogEvent, "Blurring images .........");
       if (debug_time) Broadcast(LogEvent, "\n");
       BlurImages blur(_Image, _Blurring, padding);
-      parallel_for(pyramid, blur);
+      for (size_t r = 0; r < images.size(); ++r) {
+        blocked_range2d<int> pyramid(1, nlevels+1, images[r].begin(), images[r].end());
+        parallel_for(pyramid, blur);
+      }
       if (debug_time) Broadcast(LogEvent, "Blurring images .........");
       Broadcast(LogEvent, " done\n");
     }
 
     // Resample images after blurring if no Gaussian pyramid is used
+    if (!_UseGaussianResolutionPyramid) {
+      Broadcast(LogEvent, "Resample images .........");
+      if (debug_time) Broadcast(LogEvent, "\n");
+      ResampleImages resample(_Image, _Resolution, padding);
+      for (size_t r = 0; r < images.size(); ++r) {
+        blocked_range2d<int> pyramid(1, nlevels+1, images[r].begin(), images[r].end());
+        parallel_for(pyramid, resample);
+      }
+      if (debug_time) Broadcast(LogEvent, "Resample images .........");
+      Broadcast(LogEvent, " done\n");
+    }
+  } // if (!images.empty())
+
+  if (NumberOfImages() > 0) {
+
+    // Actual resolution of downsampled images
     if (_UseGaussianResolutionPyramid) {
-      for (int l = 1; l <= _NumberOfLevels;   ++l)
+      for (int l = 1; l <= nlevels;           ++l)
       for (int n = 0; n <   NumberOfImages(); ++n) {
         _Resolution[l][n]._x = _Image[l][n].GetXSize();
         _Resolution[l][n]._y = _Image[l][n].GetYSize();
         _Resolution[l][n]._z = _Image[l][n].GetZSize();
       }
-    } else {
-      Broadcast(LogEvent, "Resample images .........");
-      if (debug_time) Broadcast(LogEvent, "\n");
-      ResampleImages resample(_Image, _Resolution, padding);
-      parallel_for(pyramid, resample);
-      if (debug_time) Broadcast(LogEvent, "Resample images .........");
-      Broadcast(LogEvent, " done\n");
     }
 
     // From now on, use padding value as background value
-    for (int l = 1; l <= _NumberOfLevels;   ++l)
+    for (int l = 1; l <= nlevels;           ++l)
     for (int n = 0; n <   NumberOfImages(); ++n) {
       _Image[l][n].PutBackgroundValueAsDouble(_Padding[n]);
     }
+
+    // Keep copy of pyramids for subsequent runs
+    for (int n = 0; n < NumberOfImages(); ++n) {
+      if (kept[n] && !cached[n]) {
+        KeptPyramid &pyramid = *kept[n];
+        pyramid._NumberOfLevels               = _NumberOfLevels;
+        pyramid._UseGaussianResolutionPyramid = _UseGaussianResolutionPyramid;
+        pyramid._DownsampleWithPadding        = _DownsampleWithPadding;
+        pyramid._CropPadImages                = _CropPadImages;
+        pyramid._Padding                      = _Padding[n];
+        pyramid._Blurring  .resize(_NumberOfLevels + 1);
+        pyramid._Resolution.resize(_NumberOfLevels + 1);
+        pyramid._Image     .resize(_NumberOfLevels + 1);
+        for (int l = 1; l <= _NumberOfLevels; ++l) {
+          pyramid._Blurring  [l] = _Blurring  [l][n];
+          pyramid._Resolution[l] = _Resolution[l][n];
+          pyramid._Image     [l] = _Image     [l][n];
+        }
+      }
+    }
   } // if (NumberOfImages() > 0)
 
   // Resample domain mask
   _Mask.resize(_NumberOfLevels + 1, NULL);
   if (_Domain) {
-    Broadcast(LogEvent, "Resample mask ...........");
-    if (debug_time) Broadcast(LogEvent, "\n");
     vector<irtkVector3D<double> > res(_NumberOfLevels + 1);
-    for (int l = 1; l <= _NumberOfLevels; ++l) {
+    for (int l = 1; l <= nlevels; ++l) {
       res[l] = this->AverageOutputResolution(l);
     }
-    ResampleMask resample(_Domain, _Mask, res);
-    parallel_for(levels, resample);
-    if (debug_time) Broadcast(LogEvent, "Resample mask ...........");
-    Broadcast(LogEvent, " done\n");
+    KeptPyramid *pyramid = NULL;
+    if (version >= irtkVersion(3, 0) && nlevels == _NumberOfLevels) {
+      pyramid = FindKeptPyramid(_Domain);
+    }
+    bool same = (pyramid && pyramid->_NumberOfLevels == _NumberOfLevels);
+    for (int l = 1; same && l <= _NumberOfLevels; ++l) {
+      same = (pyramid->_Resolution[l] == res[l]);
+    }
+    if (same) {
+      for (int l = 1; l <= _NumberOfLevels; ++l) {
+        if (_Mask[l] != _Domain) Delete(_Mask[l]);
+        if (pyramid->_Mask[l].IsEmpty()) _Mask[l] = _Domain;
+        else _Mask[l] = new irtkBinaryImage(pyramid->_Mask[l]);
+      }
+    } else {
+      Broadcast(LogEvent, "Resample mask ...........");
+      if (debug_time) Broadcast(LogEvent, "\n");
+      ResampleMask resample(_Domain, _Mask, res);
+      parallel_for(levels, resample);
+      if (debug_time) Broadcast(LogEvent, "Resample mask ...........");
+      Broadcast(LogEvent, " done\n");
+      if (pyramid) {
+        pyramid->_NumberOfLevels = _NumberOfLevels;
+        pyramid->_Resolution     = res;
+        pyramid->_Mask.clear();
+        pyramid->_Mask.resize(_NumberOfLevels + 1);
+        for (int l = 1; l <= _NumberOfLevels; ++l) {
+          if (_Mask[l] != _Domain) pyramid->_Mask[l] = *_Mask[l];
+        }
+      }
+    }
   }
 
   IRTK_DEBUG_TIMING(1, "downsampling of images");
@@ -3805,8 +4131,8 @@ void irtkGenericRegistrationFilter::InitializeOptimizer()
 {
   IRTK_START_TIMING();
 
-  if (InitialLevel()) {
-    // Instantiate optimizer
+  if (!_Optimizer) {
+    // Instantiate optimizer (at initial or resumed level)
     _Optimizer = irtkLocalOptimizer::New(_OptimizationMethod, &_Energy);
     // Enable forwarding of optimization events
     _Optimizer->AddObserver(_EventDelegate);
@@ -602,6 +602,12 @@ void irtkGradientFieldSimilarity
   }
 }
 
+// -----------------------------------------------------------------------------
+bool irtkGradientFieldSimilarity::IsNeighborhoodBased() const
+{
+  return true;
+}
+
 // -----------------------------------------------------------------------------
 void irtkGradientFieldSimilarity::Update(bool hessian)
 {
@@ -614,7 +620,7 @@ void irtkGradientFieldSimilarity::Update(bool hessian)
       if (_InitialUpdate) {
         _TargetTransformedGradient.Initialize(_Target->Attributes(), 3);
       }
-      _TargetTransformedGradient.CopyFrom(_Target->Data(0, 0, 0, 1));
+      copy(_Target->Data(0, 0, 0, 1), _Target->Data(0, 0, 0, 4), _TargetTransformedGradient.Data());
     }
 
     // Reorient gradient and hessian (if needed) of the target image according
@@ -630,7 +636,7 @@ void irtkGradientFieldSimilarity::Update(bool hessian)
       if (_InitialUpdate) {
         _SourceTransformedGradient.Initialize(_Source->Attributes(), 3);
       }
-      _SourceTransformedGradient.CopyFrom(_Source->Data(0, 0, 0, 1));
+      copy(_Source->Data(0, 0, 0, 1), _Source->Data(0, 0, 0, 4), _SourceTransformedGradient.Data());
     }
 
     // Reorient gradient and hessian (if needed) of the source image according
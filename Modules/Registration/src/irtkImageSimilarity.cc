@@ -17,6 +17,8 @@
 #include <irtkImageSimilarity.h>
 #include <irtkVoxelFunction.h>
 
+#include <boost/random.hpp>
+
 
 // =============================================================================
 // Factory
@@ -261,6 +263,101 @@ public:
   }
 };
 
+// -----------------------------------------------------------------------------
+/// Post-multiply similarity gradient by transformed image gradient at the
+/// sampled voxels only
+class MultiplySampledSimilarityGradientByImageGradient
+{
+  typedef irtkImageSimilarity::GradientType GradientType;
+
+  const irtkImageSimilarity           *_Similarity;
+  const irtkRegisteredImage::VoxelType *_Image;
+  GradientType                         *_Gradient;
+  int                                   _NumberOfVoxels;
+  int                                   _dx, _dy, _dz;
+
+public:
+
+  MultiplySampledSimilarityGradientByImageGradient(const irtkImageSimilarity *sim,
+                                                   const irtkRegisteredImage *image,
+                                                   irtkImageSimilarity::GradientImageType *gradient)
+  :
+    _Similarity    (sim),
+    _Image         (image->Data()),
+    _Gradient      (gradient->Data()),
+    _NumberOfVoxels(image->NumberOfVoxels()),
+    _dx            (image->Offset(irtkRegisteredImage::Dx)),
+    _dy            (image->Offset(irtkRegisteredImage::Dy)),
+    _dz            (image->Offset(irtkRegisteredImage::Dz))
+  {}
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int n = re.begin(); n != re.end(); ++n) {
+      const int idx = _Similarity->SampledVoxel(n);
+      const irtkRegisteredImage::VoxelType *dI = _Image + idx;
+      GradientType *gradient = _Gradient + idx;
+      (*gradient) *= dI[_dx]; gradient += _NumberOfVoxels;
+      (*gradient) *= dI[_dy]; gradient += _NumberOfVoxels;
+      (*gradient) *= dI[_dz];
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Get world coordinates and non-parametric gradient vectors of sampled voxels
+class GetSampledGradientVectors
+{
+  typedef irtkImageSimilarity::GradientType GradientType;
+
+  const irtkImageSimilarity  *_Similarity;
+  const irtkRegisteredImage  *_Image;
+  const double               *_WorldCoords;
+  const GradientType         *_Gradient;
+  int                         _NumberOfVoxels;
+  irtkPointSet               *_Points;
+  irtkVector3D<double>       *_Vectors;
+
+public:
+
+  GetSampledGradientVectors(const irtkImageSimilarity                    *sim,
+                            const irtkRegisteredImage                    *image,
+                            const irtkImageSimilarity::GradientImageType *gradient,
+                            irtkPointSet *points, irtkVector3D<double> *vectors)
+  :
+    _Similarity    (sim),
+    _Image         (image),
+    _WorldCoords   (image->ImageToWorld() ? image->ImageToWorld()->Data() : NULL),
+    _Gradient      (gradient->Data()),
+    _NumberOfVoxels(image->NumberOfVoxels()),
+    _Points        (points),
+    _Vectors       (vectors)
+  {}
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int nx = _Image->X(), ny = _Image->Y();
+    for (int n = re.begin(); n != re.end(); ++n) {
+      const int idx = _Similarity->SampledVoxel(n);
+      irtkPoint &p = (*_Points)(n);
+      if (_WorldCoords) {
+        p._x = _WorldCoords[idx];
+        p._y = _WorldCoords[idx +     _NumberOfVoxels];
+        p._z = _WorldCoords[idx + 2 * _NumberOfVoxels];
+      } else {
+        p._x = idx % nx;
+        p._y = (idx / nx) % ny;
+        p._z = idx / (nx * ny);
+        _Image->ImageToWorld(p);
+      }
+      irtkVector3D<double> &v = _Vectors[n];
+      v._x = _Gradient[idx];
+      v._y = _Gradient[idx +     _NumberOfVoxels];
+      v._z = _Gradient[idx + 2 * _NumberOfVoxels];
+    }
+  }
+};
+
 
 } // namespace irtkImageSimilarityUtils
 using namespace irtkImageSimilarityUtils;
@@ -282,6 +379,11 @@ irtkImageSimilarity::irtkImageSimilarity(const char *name, double weight)
   _UseApproximateGradient  (false),
   _VoxelWisePreconditioning(.0),
   _NodeBasedPreconditioning(.0),
+  _SamplingFraction        (1.0),
+  _NumberOfSamples         (0),
+  _JitteredGridSampling    (false),
+  _SamplingSeed            (0),
+  _SampleMask              (NULL),
   _InitialUpdate           (false)
 {
   _ParameterPrefix.push_back("Image (dis-)similarity ");
@@ -305,8 +407,18 @@ irtkImageSimilarity::irtkImageSimilarity(const irtkImageSimilarity &other)
   _UseApproximateGradient  (other._UseApproximateGradient),
   _VoxelWisePreconditioning(other._VoxelWisePreconditioning),
   _NodeBasedPreconditioning(other._NodeBasedPreconditioning),
+  _SamplingFraction        (other._SamplingFraction),
+  _NumberOfSamples         (other._NumberOfSamples),
+  _JitteredGridSampling    (other._JitteredGridSampling),
+  _SamplingSeed            (other._SamplingSeed),
+  _SampledVoxels           (other._SampledVoxels),
+  _SampleMask              (other._SampleMask ? new irtkBinaryImage(*other._SampleMask) : NULL),
   _InitialUpdate           (other._InitialUpdate)
 {
+  if (_SampleMask) {
+    _Target->SampledVoxels(&_SampledVoxels);
+    _Source->SampledVoxels(&_SampledVoxels);
+  }
 }
 
 // -----------------------------------------------------------------------------
@@ -318,13 +430,24 @@ irtkImageSimilarity &irtkImageSimilarity::operator =(const irtkImageSimilarity &
   Delete(_GradientWrtTarget);
   Delete(_GradientWrtSource);
   Deallocate(_Gradient);
+  Delete(_SampleMask);
   _Target = other._Target ? new irtkRegisteredImage(*other._Target) : NULL;
   _Source = other._Source ? new irtkRegisteredImage(*other._Source) : NULL;
   _NumberOfVoxels           = other._NumberOfVoxels;
   _UseApproximateGradient   = other._UseApproximateGradient;
   _VoxelWisePreconditioning = other._VoxelWisePreconditioning;
   _NodeBasedPreconditioning = other._NodeBasedPreconditioning;
+  _SamplingFraction         = other._SamplingFraction;
+  _NumberOfSamples          = other._NumberOfSamples;
+  _JitteredGridSampling     = other._JitteredGridSampling;
+  _SamplingSeed             = other._SamplingSeed;
+  _SampledVoxels            = other._SampledVoxels;
+  _SampleMask               = other._SampleMask ? new irtkBinaryImage(*other._SampleMask) : NULL;
   _InitialUpdate            = other._InitialUpdate;
+  if (_SampleMask) {
+    _Target->SampledVoxels(&_SampledVoxels);
+    _Source->SampledVoxels(&_SampledVoxels);
+  }
   return *this;
 }
 
@@ -336,6 +459,7 @@ irtkImageSimilarity::~irtkImageSimilarity()
   Delete(_GradientWrtTarget);
   Delete(_GradientWrtSource);
   Deallocate(_Gradient);
+  Delete(_SampleMask);
 }
 
 // =============================================================================
@@ -386,6 +510,106 @@ void irtkImageSimilarity::Initialize()
   }
   // Number of voxels per registered image
   _NumberOfVoxels = _Domain.NumberOfSpatialPoints();
+  // Draw voxel samples
+  this->InitializeSamples();
+}
+
+// -----------------------------------------------------------------------------
+void irtkImageSimilarity::InitializeSamples()
+{
+  _SampledVoxels.clear();
+  Delete(_SampleMask);
+  _Target->SampledVoxels(NULL);
+  _Source->SampledVoxels(NULL);
+
+  // Number of voxels within domain
+  int nvoxels = _NumberOfVoxels;
+  if (_Mask) {
+    nvoxels = 0;
+    for (int idx = 0; idx < _NumberOfVoxels; ++idx) {
+      if (_Mask->Get(idx)) ++nvoxels;
+    }
+  }
+
+  // Number of samples
+  int nsamples = _NumberOfSamples;
+  if (nsamples <= 0) nsamples = static_cast<int>(round(_SamplingFraction * nvoxels));
+  if (nsamples >= nvoxels) return; // use all voxels
+  if (nsamples <  1) nsamples = 1;
+
+  // Registered images are only updated at the sampled voxels
+  if (this->IsNeighborhoodBased()) {
+    cerr << this->NameOfClass() << "::Initialize: Voxel subsampling not supported by this"
+         << " similarity measure, because it evaluates the images at neighboring voxels" << endl;
+    exit(1);
+  }
+
+  IRTK_START_TIMING();
+
+  typedef boost::mt19937                                                 RandomNumberGenerator;
+  typedef boost::variate_generator<RandomNumberGenerator &, boost::uniform_int<> > UniformInt;
+  RandomNumberGenerator rng(static_cast<unsigned int>(_SamplingSeed));
+
+  if (_JitteredGridSampling) {
+    // Regular grid of cells which contain on average one sample each
+    const int    ndims = (_Domain._z > 1 ? 3 : (_Domain._y > 1 ? 2 : 1));
+    const double size  = max(1.0, pow(static_cast<double>(nvoxels) / nsamples, 1.0 / ndims));
+    const int    nx    = max(1, static_cast<int>(round(_Domain._x / size)));
+    const int    ny    = max(1, static_cast<int>(round(_Domain._y / size)));
+    const int    nz    = max(1, static_cast<int>(round(_Domain._z / size)));
+    _SampledVoxels.reserve(nx * ny * nz);
+    int i1, i2, j1, j2, k1, k2, i, j, k, idx;
+    for (int ck = 0; ck < nz; ++ck) {
+      k1 = (ck * _Domain._z) / nz, k2 = ((ck + 1) * _Domain._z) / nz - 1;
+      for (int cj = 0; cj < ny; ++cj) {
+        j1 = (cj * _Domain._y) / ny, j2 = ((cj + 1) * _Domain._y) / ny - 1;
+        for (int ci = 0; ci < nx; ++ci) {
+          i1 = (ci * _Domain._x) / nx, i2 = ((ci + 1) * _Domain._x) / nx - 1;
+          // Draw random voxel within cell
+          boost::uniform_int<> di(i1, i2), dj(j1, j2), dk(k1, k2);
+          i = UniformInt(rng, di)();
+          j = UniformInt(rng, dj)();
+          k = UniformInt(rng, dk)();
+          idx = (k * _Domain._y + j) * _Domain._x + i;
+          if (!_Mask || _Mask->Get(idx)) _SampledVoxels.push_back(idx);
+        }
+      }
+    }
+  } else {
+    // Draw samples uniformly at random without replacement
+    vector<int> voxels;
+    voxels.reserve(nvoxels);
+    for (int idx = 0; idx < _NumberOfVoxels; ++idx) {
+      if (!_Mask || _Mask->Get(idx)) voxels.push_back(idx);
+    }
+    for (int n = 0; n < nsamples; ++n) {
+      boost::uniform_int<> dist(n, nvoxels - 1);
+      swap(voxels[n], voxels[UniformInt(rng, dist)()]);
+    }
+    _SampledVoxels.assign(voxels.begin(), voxels.begin() + nsamples);
+  }
+
+  // Jittered grid cells may all lie outside the mask
+  if (_SampledVoxels.empty()) {
+    cerr << this->NameOfClass() << "::Initialize: No voxel samples drawn within mask,"
+         << " increase the number of samples or use random sampling instead" << endl;
+    exit(1);
+  }
+
+  // Sort samples to improve memory locality
+  sort(_SampledVoxels.begin(), _SampledVoxels.end());
+
+  // Mask of sampled voxels used by IsForeground
+  _SampleMask = new irtkBinaryImage(_Domain);
+  for (size_t n = 0; n < _SampledVoxels.size(); ++n) {
+    _SampleMask->Put(_SampledVoxels[n], true);
+  }
+
+  // Only update registered images at sampled voxels
+  _Target->SampledVoxels(&_SampledVoxels);
+  _Source->SampledVoxels(&_SampledVoxels);
+
+  IRTK_DEBUG_TIMING(2, "drawing of " << _SampledVoxels.size() << " voxel samples");
 }
 
 // =============================================================================
@@ -400,6 +624,23 @@ bool irtkImageSimilarity::Set(const char *param, const char *value)
   if (name == "Approximate gradient") {
     return FromString(value, _UseApproximateGradient);
   }
+  if (name == "Sampling fraction") {
+    return FromString(value, _SamplingFraction) && _SamplingFraction > .0 && _SamplingFraction <= 1.0;
+  }
+  if (name == "No. of samples") {
+    return FromString(value, _NumberOfSamples);
+  }
+  if (name == "Sampling method") {
+    string method = value;
+    transform(method.begin(), method.end(), method.begin(), ::tolower);
+    if      (method == "random")                                 _JitteredGridSampling = false;
+    else if (method == "jittered grid" || method == "jittered") _JitteredGridSampling = true;
+    else return false;
+    return true;
+  }
+  if (name == "Sampling seed") {
+    return FromString(value, _SamplingSeed);
+  }
   if (name == "Preconditioning (voxel-wise)") {
     return FromString(value, _VoxelWisePreconditioning);
   }
@@ -438,6 +679,10 @@ irtkParameterList irtkImageSimilarity::Parameter() const
     Insert(params, _Name + " preconditioning (node-based)", ToString(_NodeBasedPreconditioning));
     Insert(params, _Name + " blurring of image gradient",   ToString(_Target->GradientSigma()));
     Insert(params, _Name + " blurring of image hessian",    ToString(_Target->HessianSigma()));
+    Insert(params, _Name + " sampling fraction",            ToString(_SamplingFraction));
+    Insert(params, _Name + " no. of samples",               ToString(_NumberOfSamples));
+    Insert(params, _Name + " sampling method",              _JitteredGridSampling ? "Jittered grid" : "Random");
+    Insert(params, _Name + " sampling seed",                ToString(_SamplingSeed));
   }
   return params;
 }
@@ -458,6 +703,34 @@ void irtkImageSimilarity::Update(bool gradient)
   _InitialUpdate = false;
 }
 
+// -----------------------------------------------------------------------------
+void irtkImageSimilarity::BeginLineSearch()
+{
+  if (_Target->Transformation()) _Target->BeginLineSearch();
+  if (_Source->Transformation()) _Source->BeginLineSearch();
+}
+
+// -----------------------------------------------------------------------------
+void irtkImageSimilarity::CacheLineSearchDirection()
+{
+  if (_Target->Transformation()) _Target->CacheLineSearchDirection();
+  if (_Source->Transformation()) _Source->CacheLineSearchDirection();
+}
+
+// -----------------------------------------------------------------------------
+void irtkImageSimilarity::LineSearchStep(double alpha)
+{
+  _Target->LineSearchStep(alpha);
+  _Source->LineSearchStep(alpha);
+}
+
+// -----------------------------------------------------------------------------
+void irtkImageSimilarity::EndLineSearch()
+{
+  _Target->EndLineSearch();
+  _Source->EndLineSearch();
+}
+
 // -----------------------------------------------------------------------------
 void irtkImageSimilarity::Exclude(const blocked_range3d<int> &)
 {
@@ -481,8 +754,13 @@ void irtkImageSimilarity::MultiplyByImageGradient(const irtkRegisteredImage *ima
   memcpy(gradient->GetPointerToVoxels(0, 0, 0, 2), gx, nbytes);
   // Apply chain rule (dSimilarity / dy) = (dSimilarity / dI) * (dI / dy)
   // where y = T(x) to obtain the non-parametric similarity gradient
-  MultiplySimilarityGradientByImageGradient times_dIdx(image);
-  ParallelForEachVoxel(image, gradient, times_dIdx);
+  if (IsSubsampled()) {
+    MultiplySampledSimilarityGradientByImageGradient times_dIdx(this, image, gradient);
+    parallel_for(blocked_range<int>(0, NumberOfSampledVoxels()), times_dIdx);
+  } else {
+    MultiplySimilarityGradientByImageGradient times_dIdx(image);
+    ParallelForEachVoxel(image, gradient, times_dIdx);
+  }
 }
 
 // -----------------------------------------------------------------------------
@@ -522,7 +800,18 @@ void irtkImageSimilarity::ParametricGradient(const irtkRegisteredImage *image,
   const irtkWorldCoordsImage *i2w = image->ImageToWorld();
   const double                t0  = image->GetTOrigin();
   np_gradient->PutTOrigin(image->InputImage()->GetTOrigin());
-  T->ParametricGradient(np_gradient, gradient, i2w, t0, weight);
+  if (IsSubsampled()) {
+    // Apply chain rule only at the sampled voxels, the non-parametric
+    // gradient being zero at all other voxels
+    const int n = NumberOfSampledVoxels();
+    irtkPointSet                 pos(n);
+    vector<irtkVector3D<double> > vec(n);
+    GetSampledGradientVectors get(this, image, np_gradient, &pos, &vec[0]);
+    parallel_for(blocked_range<int>(0, n), get);
+    T->ParametricGradient(pos, &vec[0], gradient, np_gradient->ImageToTime(.0), t0, weight);
+  } else {
+    T->ParametricGradient(np_gradient, gradient, i2w, t0, weight);
+  }
 }
 
 // -----------------------------------------------------------------------------
@@ -766,6 +1055,10 @@ void irtkImageSimilarity::Print(irtkIndent indent) const
   } else {
     cout << " None" << endl;
   }
+  if (_SampleMask) {
+    cout << indent << "No. of samples: " << _SampledVoxels.size()
+         << (_JitteredGridSampling ? " (jittered grid)" : " (random)") << endl;
+  }
 }
 
 // -----------------------------------------------------------------------------
@@ -30,7 +30,10 @@ irtkInexactLineSearch::irtkInexactLineSearch(irtkObjectiveFunction *f)
   _StrictStepLengthRange  (1),
   _AllowSignChange        (NULL),
   _CurrentDoFValues       (NULL),
-  _ScaledDirection        (NULL)
+  _ScaledDirection        (NULL),
+  _CachedLineSearch       (false),
+  _LineSearchStep         (.0),
+  _PreviousLineSearchStep (.0)
 {
   if (f) {
     Allocate(_CurrentDoFValues, f->NumberOfDOFs());
@@ -47,7 +50,10 @@ irtkInexactLineSearch::irtkInexactLineSearch(const irtkInexactLineSearch &other)
   _StrictStepLengthRange  (other._StrictStepLengthRange),
   _AllowSignChange        (other._AllowSignChange),
   _CurrentDoFValues       (NULL),
-  _ScaledDirection        (NULL)
+  _ScaledDirection        (NULL),
+  _CachedLineSearch       (false),
+  _LineSearchStep         (.0),
+  _PreviousLineSearchStep (.0)
 {
   if (Function()) {
     Allocate(_CurrentDoFValues, Function()->NumberOfDOFs());
@@ -141,15 +147,43 @@ irtkParameterList irtkInexactLineSearch::Parameter() const
 // Optimization
 // =============================================================================
 
+// -----------------------------------------------------------------------------
+void irtkInexactLineSearch::BeginLineSearch()
+{
+  _LineSearchStep = _PreviousLineSearchStep = .0;
+  _CachedLineSearch = (_StepLengthUnit != .0 && !_AllowSignChange &&
+                       Function()->BeginLineSearch(_Direction));
+  // Re-evaluate current value using cached state such that it is compared
+  // to the values of the trial steps which are computed the same way
+  if (_CachedLineSearch) {
+    Function()->LineSearchStep(.0);
+    Function()->Update(false);
+    _CurrentValue = Function()->Value();
+  }
+}
+
+// -----------------------------------------------------------------------------
+void irtkInexactLineSearch::EndLineSearch()
+{
+  if (_CachedLineSearch) Function()->EndLineSearch();
+  _CachedLineSearch = false;
+}
+
 // -----------------------------------------------------------------------------
 double irtkInexactLineSearch::Advance(double alpha)
 {
   if (_StepLengthUnit == .0) return .0;
-  // Backup current function parameter values
-  Function()->Get(_CurrentDoFValues);
   // Compute gradient for given step length
   alpha /= _StepLengthUnit;
   if (_Descent) alpha *= -1.0;
+  // Move along search direction using cached state of objective function
+  if (_CachedLineSearch) {
+    _PreviousLineSearchStep = _LineSearchStep;
+    _LineSearchStep        += alpha;
+    return Function()->LineSearchStep(_LineSearchStep);
+  }
+  // Backup current function parameter values
+  Function()->Get(_CurrentDoFValues);
   const int ndofs = Function()->NumberOfDOFs();
   for (int dof = 0; dof < ndofs; ++dof) {
     _ScaledDirection[dof] = alpha * _Direction[dof];
@@ -178,5 +212,10 @@ double irtkInexactLineSearch::Advance(double alpha)
 void irtkInexactLineSearch::Retreat(double alpha)
 {
   if (_StepLengthUnit == .0) return;
-  Function()->Put(_CurrentDoFValues);
+  if (_CachedLineSearch) {
+    _LineSearchStep = _PreviousLineSearchStep;
+    Function()->LineSearchStep(_LineSearchStep);
+  } else {
+    Function()->Put(_CurrentDoFValues);
+  }
 }
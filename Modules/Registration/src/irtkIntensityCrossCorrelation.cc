@@ -49,18 +49,19 @@ irtkIntensityCrossCorrelation::~irtkIntensityCrossCorrelation()
 // -----------------------------------------------------------------------------
 double irtkIntensityCrossCorrelation::Evaluate()
 {
-  VoxelType *tgt = Target()->GetPointerToVoxels();
-  VoxelType *src = Source()->GetPointerToVoxels();
+  const VoxelType *tgt = Target()->GetPointerToVoxels();
+  const VoxelType *src = Source()->GetPointerToVoxels();
 
   double x = .0, y = .0, xy = .0, x2 = .0, y2 = .0;
   int    n =  0;
-  for (int idx = 0; idx < NumberOfVoxels(); ++idx) {
+  for (int i = 0; i < NumberOfSampledVoxels(); ++i) {
+    const int idx = SampledVoxel(i);
     if (IsForeground(idx)) {
-      x  += *tgt;
-      y  += *src;
-      xy += (*tgt) * (*src);
-      x2 += (*tgt) * (*tgt);
-      y2 += (*tgt) * (*tgt);
+      x  += tgt[idx];
+      y  += src[idx];
+      xy += tgt[idx] * src[idx];
+      x2 += tgt[idx] * tgt[idx];
+      y2 += src[idx] * src[idx];
       ++n;
     }
   }
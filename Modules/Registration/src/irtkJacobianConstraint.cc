@@ -23,6 +23,80 @@
 
 namespace irtkJacobianConstraintUtils {
 
+typedef irtkJacobianConstraint::Matrix3x3         Matrix3x3;
+typedef irtkFreeFormTransformation::CPValue        CPValue;
+typedef irtkFreeFormTransformation::CPImage        CPImage;
+typedef irtkFreeFormTransformation::CPExtrapolator CPExtrapolator;
+typedef irtkBSplineFreeFormTransformation3D::Kernel Kernel;
+
+// -----------------------------------------------------------------------------
+/// Derivative weights of cubic B-spline tensor product at sample points
+///
+/// The weights do not depend on the lattice and are thus computed only once
+/// for sample points at control points and at centers of lattice cells,
+/// respectively. The weights of the control point at offset (a, b, c) from the
+/// first control point in the support of a sample point are stored at index
+/// a + n * (b + n * c), where n is the number of control points in the support
+/// along each dimension.
+struct SplineDerivativeWeights
+{
+  int    _N;            ///< Number of control points in support along each dimension
+  double _W[64][3];     ///< Derivative weights w.r.t. each lattice coordinate
+
+  SplineDerivativeWeights(bool cell_centers)
+  {
+    double w[2][4];
+    if (cell_centers) {
+      _N = 4;
+      for (int a = 0; a < 4; ++a) {
+        w[0][a] = Kernel::B  (1.5 - a);
+        w[1][a] = Kernel::B_I(1.5 - a);
+      }
+    } else {
+      _N = 3;
+      for (int a = 0; a < 3; ++a) {
+        w[0][a] = Kernel::LatticeWeights  [a];
+        w[1][a] = Kernel::LatticeWeights_I[a];
+      }
+    }
+    int n = 0;
+    for (int c = 0; c < _N; ++c)
+    for (int b = 0; b < _N; ++b)
+    for (int a = 0; a < _N; ++a, ++n) {
+      _W[n][0] = w[1][a] * w[0][b] * w[0][c];
+      _W[n][1] = w[0][a] * w[1][b] * w[0][c];
+      _W[n][2] = w[0][a] * w[0][b] * w[1][c];
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Get table of derivative weights of cubic B-spline at sample points
+inline const SplineDerivativeWeights &DerivativeWeights(bool cell_centers)
+{
+  static const SplineDerivativeWeights cp_weights  (false);
+  static const SplineDerivativeWeights cell_weights(true);
+  return cell_centers ? cell_weights : cp_weights;
+}
+
+// -----------------------------------------------------------------------------
+/// Compute adjugate and determinant of 3x3 matrix
+///
+/// Written without branches and temporaries on the heap such that the compiler
+/// can evaluate the cofactors using SIMD instructions.
+inline double Adjugate(const Matrix3x3 &m, Matrix3x3 &adj)
+{
+  adj(0, 0) = m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1);
+  adj(0, 1) = m(0, 2) * m(2, 1) - m(0, 1) * m(2, 2);
+  adj(0, 2) = m(0, 1) * m(1, 2) - m(0, 2) * m(1, 1);
+  adj(1, 0) = m(1, 2) * m(2, 0) - m(1, 0) * m(2, 2);
+  adj(1, 1) = m(0, 0) * m(2, 2) - m(0, 2) * m(2, 0);
+  adj(1, 2) = m(0, 2) * m(1, 0) - m(0, 0) * m(1, 2);
+  adj(2, 0) = m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0);
+  adj(2, 1) = m(0, 1) * m(2, 0) - m(0, 0) * m(2, 1);
+  adj(2, 2) = m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0);
+  return m(0, 0) * adj(0, 0) + m(0, 1) * adj(1, 0) + m(0, 2) * adj(2, 0);
+}
 
 // -----------------------------------------------------------------------------
 /// Body of Update function for parallel execution
@@ -32,35 +106,97 @@ private:
 
   const irtkJacobianConstraint     *_This;
   const irtkFreeFormTransformation *_FFD;
-  irtkMatrix                       *_AdjJacobian;
+  const SplineDerivativeWeights    *_Weights;
+  const CPImage                    *_Coefficients;
+  const CPExtrapolator             *_Extrapolator;
+  Matrix3x3                        *_AdjJacobian;
   double                           *_DetJacobian;
 
+  /// Compute Jacobian of B-spline function from control point coefficients
+  void SplineJacobian(int i, int j, int k, Matrix3x3 &jac) const
+  {
+    const int n = _Weights->_N;
+    // First control point in support of sample point
+    --i, --j, --k;
+    // Derivatives w.r.t. lattice coordinates
+    double dx[3] = {.0, .0, .0};
+    double dy[3] = {.0, .0, .0};
+    double dz[3] = {.0, .0, .0};
+    const double (*w)[3] = _Weights->_W;
+    if (0 <= i && i + n <= _FFD->X() &&
+        0 <= j && j + n <= _FFD->Y() &&
+        0 <= k && k + n <= _FFD->Z()) {
+      const CPValue *coeff;
+      for (int c = 0; c < n; ++c)
+      for (int b = 0; b < n; ++b) {
+        coeff = _Coefficients->Data(i, j + b, k + c);
+        for (int a = 0; a < n; ++a, ++w, ++coeff) {
+          dx[0] += (*w)[0] * coeff->_x, dx[1] += (*w)[0] * coeff->_y, dx[2] += (*w)[0] * coeff->_z;
+          dy[0] += (*w)[1] * coeff->_x, dy[1] += (*w)[1] * coeff->_y, dy[2] += (*w)[1] * coeff->_z;
+          dz[0] += (*w)[2] * coeff->_x, dz[1] += (*w)[2] * coeff->_y, dz[2] += (*w)[2] * coeff->_z;
+        }
+      }
+    } else {
+      CPValue coeff;
+      for (int c = 0; c < n; ++c)
+      for (int b = 0; b < n; ++b)
+      for (int a = 0; a < n; ++a, ++w) {
+        coeff = _Extrapolator->Get(i + a, j + b, k + c);
+        dx[0] += (*w)[0] * coeff._x, dx[1] += (*w)[0] * coeff._y, dx[2] += (*w)[0] * coeff._z;
+        dy[0] += (*w)[1] * coeff._x, dy[1] += (*w)[1] * coeff._y, dy[2] += (*w)[1] * coeff._z;
+        dz[0] += (*w)[2] * coeff._x, dz[1] += (*w)[2] * coeff._y, dz[2] += (*w)[2] * coeff._z;
+      }
+    }
+    // Derivatives w.r.t. world coordinates of T(x) = x + FFD(x)
+    for (int r = 0; r < 3; ++r) {
+      _FFD->JacobianToWorld(dx[r], dy[r], dz[r]);
+      jac(r, 0) = dx[r], jac(r, 1) = dy[r], jac(r, 2) = dz[r];
+    }
+    jac(0, 0) += 1.0;
+    jac(1, 1) += 1.0;
+    jac(2, 2) += 1.0;
+  }
+
 public:
 
   void operator()(const blocked_range<int> &re) const
   {
-    int    i, j, k, l;
-    double x, y, z, t;
-    for (int cp = re.begin(); cp != re.end(); ++cp) {
-      _FFD->IndexToLattice(cp, i, j, k, l);
-      x = i, y = j, z = k, t = _FFD->LatticeToTime(l);
-      _FFD->LatticeToWorld(x, y, z);
-      _DetJacobian[cp] = _This->Jacobian(_FFD, x, y, z, t, _AdjJacobian[cp]);
+    int       i, j, k, l;
+    double    x, y, z, t, h;
+    Matrix3x3 jac;
+    h = (_This->SampleCellCenters() ? .5 : .0);
+    for (int n = re.begin(); n != re.end(); ++n) {
+      _This->SampleToLattice(_FFD, n, i, j, k, l);
+      if (_Weights) {
+        SplineJacobian(i, j, k, jac);
+      } else {
+        x = i + h, y = j + h, z = k + h, t = _FFD->LatticeToTime(l + h);
+        _FFD->LatticeToWorld(x, y, z);
+        _This->Jacobian(_FFD, x, y, z, t, jac);
+      }
+      _DetJacobian[n] = _This->ThresholdDeterminant(Adjugate(jac, _AdjJacobian[n]));
     }
   }
 
   static void Run(const irtkJacobianConstraint     *obj,
                   const irtkFreeFormTransformation *ffd,
                   double                           *det,
-                  irtkMatrix                       *adj)
+                  Matrix3x3                        *adj)
   {
     irtkJacobianConstraintUpdate body;
-    body._This        = obj;
-    body._FFD         = ffd;
-    body._AdjJacobian = adj;
-    body._DetJacobian = det;
-    blocked_range<int> cps(0, ffd->NumberOfCPs());
-    parallel_for(cps, body);
+    body._This         = obj;
+    body._FFD          = ffd;
+    body._Weights      = NULL;
+    body._Coefficients = NULL;
+    body._Extrapolator = ffd->Extrapolator();
+    body._AdjJacobian  = adj;
+    body._DetJacobian  = det;
+    if (body._Extrapolator && obj->IsSplineJacobian(ffd)) {
+      body._Weights      = &DerivativeWeights(obj->SampleCellCenters());
+      body._Coefficients = body._Extrapolator->Input();
+    }
+    blocked_range<int> samples(0, obj->NumberOfSamples(ffd));
+    parallel_for(samples, body);
   }
 };
 
@@ -73,12 +209,13 @@ using namespace irtkJacobianConstraintUtils;
 // =============================================================================
 
 // -----------------------------------------------------------------------------
-irtkJacobianConstraint::irtkJacobianConstraint(const char *name)
+irtkJacobianConstraint::irtkJacobianConstraint(const char *name, bool cell_centers)
 :
   irtkTransformationConstraint(name),
+  _SampleCellCenters(cell_centers),
   _DetJacobian(NULL),
   _AdjJacobian(NULL),
-  _NumberOfCPs(0)
+  _NumberOfSamples(0)
 {
 }
 
@@ -93,6 +230,71 @@ irtkJacobianConstraint::~irtkJacobianConstraint()
 // Evaluation
 // =============================================================================
 
+// -----------------------------------------------------------------------------
+int irtkJacobianConstraint::NumberOfSamples(const irtkFreeFormTransformation *ffd) const
+{
+  if (_SampleCellCenters) {
+    return (ffd->X() + 1) * (ffd->Y() + 1) * (ffd->Z() + 1) * (ffd->T() > 1 ? ffd->T() + 1 : 1);
+  }
+  return ffd->NumberOfCPs();
+}
+
+// -----------------------------------------------------------------------------
+void irtkJacobianConstraint
+::SampleToLattice(const irtkFreeFormTransformation *ffd, int n,
+                  int &i, int &j, int &k, int &l) const
+{
+  if (_SampleCellCenters) {
+    const int nx = ffd->X() + 1;
+    const int ny = ffd->Y() + 1;
+    const int nz = ffd->Z() + 1;
+    i = n % nx - 1, n /= nx;
+    j = n % ny - 1, n /= ny;
+    k = n % nz - 1, n /= nz;
+    l = (ffd->T() > 1 ? n - 1 : 0);
+  } else {
+    ffd->IndexToLattice(n, i, j, k, l);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void irtkJacobianConstraint
+::Jacobian(const irtkFreeFormTransformation *ffd,
+           double x, double y, double z, double t, Matrix3x3 &jac) const
+{
+  irtkMatrix m;
+  ffd->Jacobian(m, x, y, z, t, t);
+  jac = m;
+}
+
+// -----------------------------------------------------------------------------
+bool irtkJacobianConstraint::IsSplineJacobian(const irtkFreeFormTransformation *ffd) const
+{
+  // Jacobian of local transformation of SV FFD is not the one of the
+  // B-spline function parameterizing the velocity field
+  return ffd->TypeOfClass() == IRTKTRANSFORMATION_BSPLINE_FFD_3D &&
+         ffd->Z() > 1 && ffd->T() == 1;
+}
+
+// -----------------------------------------------------------------------------
+void irtkJacobianConstraint
+::JacobianDetDerivative(const irtkFreeFormTransformation *ffd, double drv[27][3])
+{
+  const double *w[2] = {
+    Kernel::LatticeWeights,
+    Kernel::LatticeWeights_I
+  };
+  int n = 0;
+  for (int c = 0; c < 3; ++c)
+  for (int b = 0; b < 3; ++b)
+  for (int a = 0; a < 3; ++a, ++n) {
+    drv[n][0] = w[1][a] * w[0][b] * w[0][c];
+    drv[n][1] = w[0][a] * w[1][b] * w[0][c];
+    drv[n][2] = w[0][a] * w[0][b] * w[1][c];
+    ffd->JacobianToWorld(drv[n][0], drv[n][1], drv[n][2]);
+  }
+}
+
 // -----------------------------------------------------------------------------
 void irtkJacobianConstraint::Update(bool)
 {
@@ -103,28 +305,35 @@ void irtkJacobianConstraint::Update(bool)
 
   (mffd = MFFD()) || (ffd = FFD());
 
-  int ncps = 0;
-  if      (ffd)  ncps =  ffd->NumberOfCPs();
-  else if (mffd) ncps = mffd->NumberOfCPs(true);
-  if (ncps == 0) return;
+  int nsamples = 0;
+  if (mffd) {
+    for (int n = 0; n < mffd->NumberOfLevels(); ++n) {
+      if (mffd->LocalTransformationIsActive(n)) {
+        nsamples += NumberOfSamples(mffd->GetLocalTransformation(n));
+      }
+    }
+  } else if (ffd) {
+    nsamples = NumberOfSamples(ffd);
+  }
+  if (nsamples == 0) return;
 
-  if (ncps != _NumberOfCPs) {
+  if (nsamples != _NumberOfSamples) {
     Deallocate(_DetJacobian);
     Deallocate(_AdjJacobian);
-    _NumberOfCPs = ncps;
-    _DetJacobian = Allocate<double>    (ncps);
-    _AdjJacobian = Allocate<irtkMatrix>(ncps);
+    _NumberOfSamples = nsamples;
+    _DetJacobian     = Allocate<double>   (nsamples);
+    _AdjJacobian     = Allocate<Matrix3x3>(nsamples);
   }
 
   if (mffd) {
-    double     *det = _DetJacobian;
-    irtkMatrix *adj = _AdjJacobian;
+    double    *det = _DetJacobian;
+    Matrix3x3 *adj = _AdjJacobian;
     for (int n = 0; n < mffd->NumberOfLevels(); ++n) {
       if (mffd->LocalTransformationIsActive(n)) {
         ffd = mffd->GetLocalTransformation(n);
         Body::Run(this, ffd, det, adj);
-        det += ffd->NumberOfCPs();
-        adj += ffd->NumberOfCPs();
+        det += NumberOfSamples(ffd);
+        adj += NumberOfSamples(ffd);
       }
     }
   } else if (ffd) {
@@ -140,7 +349,13 @@ void irtkJacobianConstraint::Update(bool)
 void irtkJacobianConstraint
 ::WriteJacobian(const char *fname, const irtkFreeFormTransformation *ffd, const double *det) const
 {
-  irtkGenericImage<double> jacobian(ffd->Attributes(), const_cast<double *>(det));
+  irtkImageAttributes attr = ffd->Attributes();
+  if (_SampleCellCenters) {
+    // Center of lattice of cell centers coincides with center of FFD lattice
+    attr._x += 1, attr._y += 1, attr._z += 1;
+    if (attr._t > 1) attr._t += 1;
+  }
+  irtkGenericImage<double> jacobian(attr, const_cast<double *>(det));
   jacobian.Write(fname);
 }
 
@@ -160,7 +375,7 @@ void irtkJacobianConstraint::WriteDataSets(const char *p, const char *suffix, bo
   (mffd = MFFD()) || (ffd = FFD());
 
   if (mffd) {
-    double     *det = _DetJacobian;
+    const double *det = _DetJacobian;
     for (int n = 0; n < mffd->NumberOfLevels(); ++n) {
       if (mffd->LocalTransformationIsActive(n)) {
         ffd = mffd->GetLocalTransformation(n);
@@ -170,7 +385,7 @@ void irtkJacobianConstraint::WriteDataSets(const char *p, const char *suffix, bo
           snprintf(fname, sz, "%sjacobian_determinant_of_ffd_at_level_%d%s.nii.gz", prefix, n+1, suffix);
         }
         WriteJacobian(fname, ffd, det);
-        det += ffd->NumberOfCPs();
+        det += NumberOfSamples(ffd);
       }
     }
   } else if (ffd) {
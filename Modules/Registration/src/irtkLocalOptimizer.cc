@@ -26,6 +26,7 @@
 //#include <irtkConstrainedGradientDescent.h>
 //#include <irtkSteepestGradientDescent.h>
 #include <irtkConjugateGradientDescent.h>
+#include <irtkGaussNewtonDescent.h>
 #ifdef HAS_LBFGS
 #include <irtkLimitedMemoryBFGSDescent.h>
 #endif
@@ -43,6 +44,7 @@ irtkLocalOptimizer *irtkLocalOptimizer::New(irtkOptimizationMethod m, irtkObject
     //case GradientDescentConstrained: return new irtkConstrainedGradientDescent(f);
     //case SteepestGradientDescent:    return new irtkSteepestGradientDescent(f);
     case ConjugateGradientDescent:   return new irtkConjugateGradientDescent(f);
+    case GaussNewton:                return new irtkGaussNewtonDescent(f);
 #ifdef HAS_LBFGS
     case LBFGS:                      return new irtkLimitedMemoryBFGSDescent(f);
 #endif
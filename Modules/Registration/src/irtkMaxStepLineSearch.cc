@@ -57,6 +57,9 @@ double irtkMaxStepLineSearch::Run()
   // Get current value of objective function
   irtkLineSearch::Run();
 
+  // Cache state of objective function along search direction if possible
+  BeginLineSearch();
+
   // Define "aliases" for event data for prettier code below
   irtkLineSearchStep step;
   step._Direction   = _Direction;
@@ -136,6 +139,9 @@ double irtkMaxStepLineSearch::Run()
   // Notify observers about end of line search
   Broadcast(LineSearchEndEvent, &step);
 
+  // Discard cached state of objective function
+  EndLineSearch();
+
   // Return new value of objective function
   return current;
 }
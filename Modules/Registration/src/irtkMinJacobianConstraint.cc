@@ -23,6 +23,8 @@
 
 namespace irtkMinJacobianConstraintUtils {
 
+typedef irtkJacobianConstraint::Matrix3x3 Matrix3x3;
+
 
 // -----------------------------------------------------------------------------
 /// Body of Evaluate function for parallel execution
@@ -94,7 +96,8 @@ struct irtkMinJacobianConstraintEvaluateGradient
 {
   const irtkBSplineFreeFormTransformation3D *_FFD;
   const double                              *_DetJacobian;
-  const irtkMatrix                          *_AdjJacobian;
+  const Matrix3x3                           *_AdjJacobian;
+  double                                     _DetDerivative[27][3];
   double                                     _Gamma;
   double                                    *_Gradient;
   double                                     _Weight;
@@ -102,9 +105,9 @@ struct irtkMinJacobianConstraintEvaluateGradient
 
   void operator()(const blocked_range3d<int> &re) const
   {
-    int        xdof, ydof, zdof, n, cp, i1, j1, k1, i2, j2, k2;
-    double     pendrv, pengrad[3];
-    irtkMatrix detdrv[3];
+    int           xdof, ydof, zdof, n, cp, i1, j1, k1, i2, j2, k2;
+    double        pendrv, pengrad[3];
+    const double *detdrv;
 
     // Loop over control points
     for (int ck = re.pages().begin(); ck != re.pages().end(); ++ck)
@@ -134,20 +137,20 @@ struct irtkMinJacobianConstraintEvaluateGradient
           pendrv = -2.0 * _Gamma / pow(_DetJacobian[cp], 3);
 
           // Derivative of Jacobian determinant w.r.t. DoFs
-          _FFD->JacobianDetDerivative(detdrv, ni - ci, nj - cj, nk - ck);
+          detdrv = _DetDerivative[(ni - ci + 1) + 3 * ((nj - cj + 1) + 3 * (nk - ck + 1))];
 
           // Apply chain rule and Jacobi's formula
           // (cf. https://en.wikipedia.org/wiki/Jacobi's_formula )
-          const irtkMatrix &adj = _AdjJacobian[cp];
-          pengrad[0] += pendrv * (adj(0, 0) * detdrv[0](0, 0) +
-                                  adj(1, 0) * detdrv[0](0, 1) +
-                                  adj(2, 0) * detdrv[0](0, 2));
-          pengrad[1] += pendrv * (adj(0, 1) * detdrv[1](1, 0) +
-                                  adj(1, 1) * detdrv[1](1, 1) +
-                                  adj(2, 1) * detdrv[1](1, 2));
-          pengrad[2] += pendrv * (adj(0, 2) * detdrv[2](2, 0) +
-                                  adj(1, 2) * detdrv[2](2, 1) +
-                                  adj(2, 2) * detdrv[2](2, 2));
+          const Matrix3x3 &adj = _AdjJacobian[cp];
+          pengrad[0] += pendrv * (adj(0, 0) * detdrv[0] +
+                                  adj(1, 0) * detdrv[1] +
+                                  adj(2, 0) * detdrv[2]);
+          pengrad[1] += pendrv * (adj(0, 1) * detdrv[0] +
+                                  adj(1, 1) * detdrv[1] +
+                                  adj(2, 1) * detdrv[2]);
+          pengrad[2] += pendrv * (adj(0, 2) * detdrv[0] +
+                                  adj(1, 2) * detdrv[1] +
+                                  adj(2, 2) * detdrv[2]);
         }
 
         n = (i2 - i1 + 1) * (j2 - j1 + 1) * (k2 - k1 + 1) - 1;
@@ -160,7 +163,7 @@ struct irtkMinJacobianConstraintEvaluateGradient
 
   static void Run(const irtkFreeFormTransformation *ffd,
                   const double                     *det,
-                  const irtkMatrix                 *adj,
+                  const Matrix3x3                  *adj,
                   double                            gamma,
                   double                           *gradient,
                   double                            weight,
@@ -172,6 +175,7 @@ struct irtkMinJacobianConstraintEvaluateGradient
       cerr << "irtkMinJacobianConstraint::EvaluateGradient: Only implemented for 3D B-spline FFD" << endl;
       exit(1);
     }
+    irtkJacobianConstraint::JacobianDetDerivative(ffd, body._DetDerivative);
     body._DetJacobian          = det;
     body._AdjJacobian          = adj;
     body._Gamma                = gamma;
@@ -287,7 +291,7 @@ void irtkMinJacobianConstraint::EvaluateGradient(double *gradient, double, doubl
 
   if (mffd) {
     double     *det = _DetJacobian;
-    irtkMatrix *adj = _AdjJacobian;
+    Matrix3x3  *adj = _AdjJacobian;
     for (int n = 0; n < mffd->NumberOfLevels(); ++n) {
       if (mffd->LocalTransformationIsActive(n)) {
         ffd = mffd->GetLocalTransformation(n);
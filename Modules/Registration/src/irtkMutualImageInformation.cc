@@ -66,13 +66,22 @@ double irtkMutualImageInformation::RawValue(double value) const
 }
 
 // -----------------------------------------------------------------------------
+// Derivative of the entropies w.r.t. the transformed image intensities as
+// in irtkNormalizedMutualImageInformation::NonParametricGradient. It is exact
+// when the joint histogram is estimated using cubic B-spline Parzen windows.
 bool irtkMutualImageInformation
 ::NonParametricGradient(const irtkRegisteredImage *image, GradientImageType *gradient)
 {
-  // TODO Implement gradient computation of MI, using NMI as reference
-  cerr << "irtkMutualImageInformation::NonParametricGradient: Not implemented" << endl;
+  IRTK_START_TIMING();
+
+  const double sign = ((version < irtkVersion(3, 1)) ? 1.0 : -1.0);
+
+  // Evaluate similarity gradient w.r.t given transformed image
+  EntropyDerivative(image, gradient, 1.0, sign * _Histogram->NumberOfSamples());
 
   // Apply chain rule to obtain gradient w.r.t y = T(x)
   MultiplyByImageGradient(image, gradient);
+
+  IRTK_DEBUG_TIMING(2, "similarity gradient computation (MI)");
   return true;
 }
@@ -83,13 +83,14 @@ double irtkNormalizedGradientFieldSimilarity::NormalizationFactor(irtkRegistered
   double norm = .0;
   int    n    = 0;
 
-  VoxelType *dx = image->GetPointerToVoxels(0, 0, 0, 1);
-  VoxelType *dy = image->GetPointerToVoxels(0, 0, 0, 2);
-  VoxelType *dz = image->GetPointerToVoxels(0, 0, 0, 3);
+  const VoxelType *dx = image->GetPointerToVoxels(0, 0, 0, 1);
+  const VoxelType *dy = image->GetPointerToVoxels(0, 0, 0, 2);
+  const VoxelType *dz = image->GetPointerToVoxels(0, 0, 0, 3);
 
-  for (int idx = 0; idx < NumberOfVoxels(); ++idx, ++dx, ++dy, ++dz) {
+  for (int i = 0; i < NumberOfSampledVoxels(); ++i) {
+    const int idx = SampledVoxel(i);
     if (IsForeground(idx)) {
-      norm += sqrt((*dx) * (*dx) + (*dy) * (*dy) + (*dz) * (*dz));
+      norm += sqrt(dx[idx] * dx[idx] + dy[idx] * dy[idx] + dz[idx] * dz[idx]);
       ++n;
     }
   }
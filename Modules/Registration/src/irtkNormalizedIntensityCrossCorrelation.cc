@@ -283,8 +283,8 @@ struct EvaluateLNCCGradient : public irtkVoxelFunction
     }
   }
 
-  template <class TImage, class T1, class T2>
-  void operator()(const TImage &, int, const T1 *tgt, const T1 *src, const T2 *g1, const T2 *g2, const T2 *g3, T2 *g)
+  template <class TImage, class T1, class T2, class T3>
+  void operator()(const TImage &, int, const T1 *tgt, const T1 *src, const T2 *g1, const T2 *g2, const T2 *g3, T3 *g)
   {
     (*g) = (*g1) * (*tgt) - (*g2) * (*src) + (*g3);
   }
@@ -425,8 +425,8 @@ private:
 // -----------------------------------------------------------------------------
 struct EvaluateBoxWindowLNCCGradient : public irtkVoxelFunction
 {
-  template <class TImage, class T>
-  void operator()(const TImage &, int, const T *a, const T *b, const T *c, const T *s, const T *t, T *g)
+  template <class TImage, class T, class TGradient>
+  void operator()(const TImage &, int, const T *a, const T *b, const T *c, const T *s, const T *t, TGradient *g)
   {
     (*g) = 2.0 * ((*a) / ((*b) * (*c))) * ((*t) - ((*a) / (*b)) * (*s));
     if (IsNaN(*g) || IsInf(*g)) (*g) = .0;
@@ -523,9 +523,9 @@ irtkNormalizedIntensityCrossCorrelation
 :
   irtkImageSimilarity(other),
   _KernelType(other._KernelType),
-  _KernelX(other._KernelX ? new RealImage(*other._KernelX) : NULL),
-  _KernelY(other._KernelY ? new RealImage(*other._KernelY) : NULL),
-  _KernelZ(other._KernelZ ? new RealImage(*other._KernelZ) : NULL),
+  _KernelX(other._KernelX ? new KernelImage(*other._KernelX) : NULL),
+  _KernelY(other._KernelY ? new KernelImage(*other._KernelY) : NULL),
+  _KernelZ(other._KernelZ ? new KernelImage(*other._KernelZ) : NULL),
   _A      (other._A       ? new RealImage(*other._A      ) : NULL),
   _B      (other._B       ? new RealImage(*other._B      ) : NULL),
   _C      (other._C       ? new RealImage(*other._C      ) : NULL),
@@ -785,7 +785,7 @@ void irtkNormalizedIntensityCrossCorrelation::ClearKernel()
 }
 
 // -----------------------------------------------------------------------------
-irtkNormalizedIntensityCrossCorrelation::RealImage *
+irtkNormalizedIntensityCrossCorrelation::KernelImage *
 irtkNormalizedIntensityCrossCorrelation::CreateGaussianKernel(double sigma)
 {
   // Ignore sign of standard deviation parameter (negative --> voxel units)
@@ -795,11 +795,11 @@ irtkNormalizedIntensityCrossCorrelation::CreateGaussianKernel(double sigma)
   irtkScalarGaussian func(sigma, 1, 1, 0, 0, 0);
 
   // Create filter kernel for 1D Gaussian function
-  const int  size   = 2 * static_cast<int>(3.0 * sigma) + 1;
-  RealImage *kernel = new RealImage(size, 1, 1);
+  const int    size   = 2 * static_cast<int>(3.0 * sigma) + 1;
+  KernelImage *kernel = new KernelImage(size, 1, 1);
 
   // Sample scalar function at discrete kernel positions
-  irtkScalarFunctionToImage<RealType> sampler;
+  irtkScalarFunctionToImage<KernelImage::VoxelType> sampler;
   sampler.SetInput (&func);
   sampler.SetOutput(kernel);
   sampler.Run();
@@ -812,16 +812,16 @@ void irtkNormalizedIntensityCrossCorrelation
 ::ComputeWeightedAverage(const blocked_range3d<int> &region, RealImage *image)
 {
   // Average along x axis
-  ConvolveTruncatedForegroundInX<RealType> convX(image, _KernelX->Data(), _KernelX->X());
+  ConvolveTruncatedForegroundInX<KernelImage::VoxelType> convX(image, _KernelX->Data(), _KernelX->X());
   ParallelForEachVoxel(region, image, &_Temp, convX);
 
   // Average along y axis
-  ConvolveTruncatedForegroundInY<RealType> convY(image, _KernelY->Data(), _KernelY->X());
+  ConvolveTruncatedForegroundInY<KernelImage::VoxelType> convY(image, _KernelY->Data(), _KernelY->X());
   ParallelForEachVoxel(region, &_Temp, image, convY);
 
   // Average along z axis
   if (_KernelZ) {
-    ConvolveTruncatedForegroundInZ<RealType> convZ(image, _KernelZ->Data(), _KernelZ->X());
+    ConvolveTruncatedForegroundInZ<KernelImage::VoxelType> convZ(image, _KernelZ->Data(), _KernelZ->X());
     ParallelForEachVoxel(region, image, &_Temp, convZ);
     ParallelForEachVoxel(irtkBinaryVoxelFunction::Copy(), region, &_Temp, image);
   }
@@ -924,6 +924,12 @@ void irtkNormalizedIntensityCrossCorrelation::Initialize()
   IRTK_DEBUG_TIMING(2, "initialization of LNCC");
 }
 
+// -----------------------------------------------------------------------------
+bool irtkNormalizedIntensityCrossCorrelation::IsNeighborhoodBased() const
+{
+  return true;
+}
+
 // -----------------------------------------------------------------------------
 void irtkNormalizedIntensityCrossCorrelation::Update(bool gradient)
 {
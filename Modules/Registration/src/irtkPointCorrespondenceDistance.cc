@@ -680,6 +680,111 @@ void irtkPointCorrespondenceDistance::ForwardEvent(irtkObservable *obj, irtkEven
   }
 }
 
+// =============================================================================
+// Gauss-Newton approximation
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+irtkRegisteredPointSet *irtkPointCorrespondenceDistance::GaussNewtonPointSet() const
+{
+  if (_Target->Transformation() && _Source->Transformation()) return NULL;
+  if (_Target->Transformation() && _GradientWrtTarget && !_GradientWrtSource) return _Target;
+  if (_Source->Transformation() && _GradientWrtSource && !_GradientWrtTarget) return _Source;
+  return NULL;
+}
+
+// -----------------------------------------------------------------------------
+void irtkPointCorrespondenceDistance
+::GaussNewtonPoints(const irtkRegisteredPointSet *pset, irtkPointSet &points) const
+{
+  const vector<int> &sample = (pset == _Target ? _TargetSample : _SourceSample);
+  const int n = irtkPointCorrespondence::GetNumberOfPoints(pset, &sample);
+  points.Resize(n);
+  if (sample.empty()) {
+    for (int k = 0; k < n; ++k) pset->GetInputPoint(k, points(k));
+  } else {
+    for (int k = 0; k < n; ++k) pset->GetInputPoint(sample[k], points(k));
+  }
+  pset->Transformation()->Transform(points, pset->Time(), pset->InputTime());
+}
+
+// -----------------------------------------------------------------------------
+bool irtkPointCorrespondenceDistance::BeginGaussNewton()
+{
+  irtkRegisteredPointSet *pset = GaussNewtonPointSet();
+  if (!pset) return false;
+
+  const vector<int> &sample = (pset == _Target ? _TargetSample : _SourceSample);
+  const int n = irtkPointCorrespondence::GetNumberOfPoints(pset, &sample);
+  _Correspondence->DefaultDirection(pset == _Target
+                                    ? irtkPointCorrespondence::TargetToSource
+                                    : irtkPointCorrespondence::SourceToTarget);
+
+  // Weights of point correspondences at current parameters
+  irtkPoint p1, p2;
+  _GaussNewtonWeight.resize(n);
+  for (int k = 0; k < n; ++k) {
+    irtkPointCorrespondence::GetPoint(p1, pset, &sample, k);
+    if (_Correspondence->GetPoint(k, p2)) {
+      _GaussNewtonWeight[k] = _ErrorFunction->Derivative(p1.SquaredDistance(p2)) * 2.0 / n;
+    } else {
+      _GaussNewtonWeight[k] = .0;
+    }
+  }
+
+  // Transformed points at current parameters
+  GaussNewtonPoints(pset, _GaussNewtonOrigin);
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+void irtkPointCorrespondenceDistance::CacheGaussNewtonDirection(double eps)
+{
+  irtkRegisteredPointSet *pset = GaussNewtonPointSet();
+  if (!pset || _GaussNewtonWeight.empty()) return;
+
+  // Store change of transformed points in non-parametric gradient
+  irtkPointSet points;
+  GaussNewtonPoints(pset, points);
+  GradientType *d = (pset == _Target ? _GradientWrtTarget : _GradientWrtSource);
+  for (int k = 0; k < points.Size(); ++k) {
+    d[k] = (points(k) - _GaussNewtonOrigin(k)) / eps;
+  }
+}
+
+// -----------------------------------------------------------------------------
+void irtkPointCorrespondenceDistance::EvaluateGaussNewtonDiagonal(double *diag, double weight)
+{
+  irtkRegisteredPointSet *pset = GaussNewtonPointSet();
+  if (!pset || _GaussNewtonWeight.empty()) return;
+
+  GradientType *d = (pset == _Target ? _GradientWrtTarget : _GradientWrtSource);
+  for (size_t k = 0; k < _GaussNewtonWeight.size(); ++k) {
+    d[k] = _GaussNewtonWeight[k];
+  }
+  this->ParametricGradient(pset, d, diag, weight);
+}
+
+// -----------------------------------------------------------------------------
+void irtkPointCorrespondenceDistance::EvaluateGaussNewtonProduct(double *Hv, double weight)
+{
+  irtkRegisteredPointSet *pset = GaussNewtonPointSet();
+  if (!pset || _GaussNewtonWeight.empty()) return;
+
+  GradientType *d = (pset == _Target ? _GradientWrtTarget : _GradientWrtSource);
+  for (size_t k = 0; k < _GaussNewtonWeight.size(); ++k) {
+    d[k] *= _GaussNewtonWeight[k];
+  }
+  this->ParametricGradient(pset, d, Hv, weight);
+}
+
+// -----------------------------------------------------------------------------
+void irtkPointCorrespondenceDistance::EndGaussNewton()
+{
+  _GaussNewtonOrigin.Clear();
+  _GaussNewtonWeight.clear();
+}
+
 // =============================================================================
 // Debugging
 // =============================================================================
@@ -18,6 +18,7 @@
 
 #include <irtkParallel.h>
 #include <irtkVoxelFunction.h>
+#include <irtkBSpline.h>
 
 
 // =============================================================================
@@ -28,110 +29,280 @@ namespace irtkProbabilisticImageSimilarityUtils {
 
 
 // -----------------------------------------------------------------------------
-/// Add rescaled samples to joint histogram
-class FillHistogram_v1
+/// Get joint histogram bin of rescaled samples
+class JointHistogramBin_v1
 {
-  const irtkProbabilisticImageSimilarity               *_Similarity;
-  irtkProbabilisticImageSimilarity::JointHistogramType *_Histogram;
-  irtkProbabilisticImageSimilarity::JointHistogramType *_Output;
+  const irtkProbabilisticImageSimilarity *_Similarity;
+  const irtkRegisteredImage::VoxelType   *_Target;
+  const irtkRegisteredImage::VoxelType   *_Source;
+  int                                     _NumberOfTargetBins;
 
 public:
 
-  FillHistogram_v1(const irtkProbabilisticImageSimilarity               *sim,
-                   irtkProbabilisticImageSimilarity::JointHistogramType *hist)
+  JointHistogramBin_v1(const irtkProbabilisticImageSimilarity                     *sim,
+                       const irtkProbabilisticImageSimilarity::JointHistogramType *hist)
   :
-    _Similarity(sim), _Histogram(hist), _Output(hist)
+    _Similarity(sim),
+    _Target(sim->Target()->Data()),
+    _Source(sim->Source()->Data()),
+    _NumberOfTargetBins(hist->NumberOfBinsX())
   {}
 
-  FillHistogram_v1(const FillHistogram_v1 &lhs, split)
-  :
-    _Similarity(lhs._Similarity), _Histogram(NULL), _Output(lhs._Output)
+  int operator ()(int idx) const
   {
-    _Histogram = new irtkProbabilisticImageSimilarity::JointHistogramType(_Output->NumberOfBinsX(),
-                                                                          _Output->NumberOfBinsY());
+    if (!_Similarity->IsForeground(idx)) return -1;
+    return round(_Source[idx]) * _NumberOfTargetBins + static_cast<int>(_Target[idx]);
   }
+};
+
+// -----------------------------------------------------------------------------
+/// Get joint histogram bin of samples (no rescaling required)
+class JointHistogramBin_v2
+{
+  const irtkProbabilisticImageSimilarity                     *_Similarity;
+  const irtkProbabilisticImageSimilarity::JointHistogramType *_Histogram;
+  const irtkRegisteredImage::VoxelType                       *_Target;
+  const irtkRegisteredImage::VoxelType                       *_Source;
+  int                                                         _NumberOfTargetBins;
 
-  ~FillHistogram_v1()
+public:
+
+  JointHistogramBin_v2(const irtkProbabilisticImageSimilarity                     *sim,
+                       const irtkProbabilisticImageSimilarity::JointHistogramType *hist)
+  :
+    _Similarity(sim),
+    _Histogram(hist),
+    _Target(sim->Target()->Data()),
+    _Source(sim->Source()->Data()),
+    _NumberOfTargetBins(hist->NumberOfBinsX())
+  {}
+
+  int operator ()(int idx) const
   {
-    if (_Histogram != _Output) Delete(_Histogram);
+    if (!_Similarity->IsForeground(idx)) return -1;
+    return _Histogram->ValToBinY(_Source[idx]) * _NumberOfTargetBins
+         + _Histogram->ValToBinX(_Target[idx]);
   }
+};
 
-  void join(const FillHistogram_v1 &rhs)
+// -----------------------------------------------------------------------------
+/// Get joint histogram bin of n-th sampled voxel
+template <class BinFunction>
+class SampledVoxelBin
+{
+  const vector<int> &_Index;
+  BinFunction        _Bin;
+
+public:
+
+  SampledVoxelBin(const vector<int> &index, const BinFunction &bin)
+  :
+    _Index(index), _Bin(bin)
+  {}
+
+  int operator ()(int n) const
   {
-    const int nbins = _Histogram->NumberOfBins();
-    irtkProbabilisticImageSimilarity::JointHistogramType::BinType *l = _Histogram->RawPointer();
-    irtkProbabilisticImageSimilarity::JointHistogramType::BinType *r = rhs._Histogram->RawPointer();
-    for (int i = 0; i < nbins; ++i, ++l, ++r) (*l) += (*r);
-    _Histogram->NumberOfSamples(_Histogram->NumberOfSamples() + rhs._Histogram->NumberOfSamples());
+    return _Bin(_Index[n]);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Count joint histogram samples either at all or only at sampled voxels
+///
+/// \param[in] samples Indices of sampled voxels or NULL if all are used.
+template <class BinFunction>
+void CountSamples(irtkPartialHistograms &counts, int nbins, int nvox,
+                  const vector<int> *samples, const BinFunction &bin)
+{
+  if (samples) {
+    SampledVoxelBin<BinFunction> sample(*samples, bin);
+    counts.Count(nbins, static_cast<int>(samples->size()), sample);
+  } else {
+    counts.Count(nbins, nvox, bin);
   }
+}
+
+// -----------------------------------------------------------------------------
+/// Map intensity to continuous bin coordinate as used for the gradient
+/// computation of the probabilistic similarity measures
+inline double ParzenWindowCenter(double val, double min, double max, int nbins)
+{
+  if (version >= irtkVersion(2, 2)) {
+    if (val < min) return .0;
+    if (val > max) return static_cast<double>(nbins - 1);
+    return nbins * (val - min) / (max - min) - .5;
+  }
+  return val;
+}
 
-  void operator ()(const blocked_range<int> &re)
+// -----------------------------------------------------------------------------
+/// Cubic B-spline Parzen window of sample clamped to the histogram bins
+struct ParzenWindow
+{
+  int    t1, t2, s1, s2;
+  double wt[4], ws[4];
+
+  ParzenWindow(double tv, double sv, int tbins, int sbins)
   {
-    const irtkRegisteredImage::VoxelType *tgt = _Similarity->Target()->Data(re.begin());
-    const irtkRegisteredImage::VoxelType *src = _Similarity->Source()->Data(re.begin());
-    for (int idx = re.begin(); idx != re.end(); ++idx, ++tgt, ++src) {
-      if (_Similarity->IsForeground(idx)) {
-        _Histogram->Add(*tgt, round(*src));
-      }
-    }
+    t1 = static_cast<int>(     tv ) - 1;
+    t2 = static_cast<int>(ceil(tv)) + 1;
+    s1 = static_cast<int>(     sv ) - 1;
+    s2 = static_cast<int>(ceil(sv)) + 1;
+
+    if (t1 <  0    ) t1 = 0;
+    if (t2 >= tbins) t2 = tbins - 1;
+    if (s1 <  0    ) s1 = 0;
+    if (s2 >= sbins) s2 = sbins - 1;
+
+    for (int t = t1; t <= t2; ++t) wt[t - t1] = irtkBSpline<double>::B(static_cast<double>(t) - tv);
+    for (int s = s1; s <= s2; ++s) ws[s - s1] = irtkBSpline<double>::B(static_cast<double>(s) - sv);
   }
 };
 
 // -----------------------------------------------------------------------------
-/// Add samples to joint histogram (no rescaling required)
-class FillHistogram_v2
+/// Add (n > 0) or remove (n < 0) cubic B-spline Parzen window of sample
+inline void AddParzenWindow(irtkProbabilisticImageSimilarity::JointHistogramType *hist,
+                            double tv, double sv, double n = 1.0)
 {
-  const irtkProbabilisticImageSimilarity               *_Similarity;
-  irtkProbabilisticImageSimilarity::JointHistogramType *_Histogram;
-  irtkProbabilisticImageSimilarity::JointHistogramType *_Output;
+  ParzenWindow w(tv, sv, hist->NumberOfBinsX(), hist->NumberOfBinsY());
+  for (int s = w.s1; s <= w.s2; ++s)
+  for (int t = w.t1; t <= w.t2; ++t) {
+    hist->Add(t, s, n * w.wt[t - w.t1] * w.ws[s - w.s1]);
+  }
+}
 
-public:
+// -----------------------------------------------------------------------------
+/// Add cubic B-spline Parzen window of sample to partial joint histogram
+///
+/// Fill function of irtkGenericPartialHistograms<double>::Fill, where the
+/// partial bins are stored in the same order as the joint histogram bins.
+class ParzenWindowSample
+{
+  typedef irtkProbabilisticImageSimilarity::JointHistogramType JointHistogramType;
 
-  FillHistogram_v2(const irtkProbabilisticImageSimilarity               *sim,
-                   irtkProbabilisticImageSimilarity::JointHistogramType *hist)
-  :
-    _Similarity(sim), _Histogram(hist), _Output(hist)
-  {}
+  const irtkProbabilisticImageSimilarity *_Similarity;
+  const vector<int>                      *_Samples;
+  const irtkRegisteredImage::VoxelType   *_Target;
+  const irtkRegisteredImage::VoxelType   *_Source;
+  int                                     _NumberOfTargetBins;
+  int                                     _NumberOfSourceBins;
+  double                                  _TargetMin, _TargetMax;
+  double                                  _SourceMin, _SourceMax;
+
+public:
 
-  FillHistogram_v2(const FillHistogram_v2 &lhs, split)
+  ParzenWindowSample(const irtkProbabilisticImageSimilarity *sim,
+                     const JointHistogramType               *hist,
+                     const vector<int>                      *samples)
   :
-    _Similarity(lhs._Similarity), _Histogram(NULL), _Output(lhs._Output)
+    _Similarity(sim), _Samples(samples),
+    _Target(sim->Target()->Data()),
+    _Source(sim->Source()->Data()),
+    _NumberOfTargetBins(hist->NumberOfBinsX()),
+    _NumberOfSourceBins(hist->NumberOfBinsY())
   {
-    double xmin, ymin, xmax, ymax, xwidth, ywidth;
-    _Output->GetMin  (&xmin,   &ymin);
-    _Output->GetMax  (&xmax,   &ymax);
-    _Output->GetWidth(&xwidth, &ywidth);
-    _Histogram = new irtkProbabilisticImageSimilarity::JointHistogramType(xmin, xmax, xwidth,
-                                                                          ymin, ymax, ywidth);
-    if (_Histogram->NumberOfBinsX() != _Output->NumberOfBinsX() ||
-        _Histogram->NumberOfBinsY() != _Output->NumberOfBinsY()) {
-      _Histogram->PutNumberOfBins(_Output->NumberOfBinsX(), _Output->NumberOfBinsY());
-    }
+    hist->GetMin(&_TargetMin, &_SourceMin);
+    hist->GetMax(&_TargetMax, &_SourceMax);
   }
 
-  ~FillHistogram_v2()
+  void operator ()(int n, double *bins) const
   {
-    if (_Histogram != _Output) Delete(_Histogram);
+    const int idx = (_Samples ? (*_Samples)[n] : n);
+    if (!_Similarity->IsForeground(idx)) return;
+    ParzenWindow w(ParzenWindowCenter(_Target[idx], _TargetMin, _TargetMax, _NumberOfTargetBins),
+                   ParzenWindowCenter(_Source[idx], _SourceMin, _SourceMax, _NumberOfSourceBins),
+                   _NumberOfTargetBins, _NumberOfSourceBins);
+    for (int s = w.s1; s <= w.s2; ++s) {
+      double *row = bins + s * _NumberOfTargetBins;
+      for (int t = w.t1; t <= w.t2; ++t) {
+        row[t] += w.wt[t - w.t1] * w.ws[s - w.s1];
+      }
+    }
   }
+};
+
+// -----------------------------------------------------------------------------
+/// Derivative of entropy-based similarity w.r.t. intensities of transformed
+/// image at the sampled voxels
+class EvaluateEntropyDerivative
+{
+  typedef irtkProbabilisticImageSimilarity::GradientType GradientType;
+
+  const irtkProbabilisticImageSimilarity *_Similarity;
+  const irtkRegisteredImage::VoxelType   *_Fixed;
+  const irtkRegisteredImage::VoxelType   *_Moving;
+  GradientType                           *_Gradient;
+  const irtkHistogram_2D<double>         &_LogJointHistogram;
+  const irtkHistogram_1D<double>         &_LogMarginalXHistogram;
+  const irtkHistogram_1D<double>         &_LogMarginalYHistogram;
+  double                                  _JointWeight;
+  double                                  _Denominator;
 
-  void join(const FillHistogram_v2 &rhs)
+public:
+
+  EvaluateEntropyDerivative(const irtkProbabilisticImageSimilarity *sim,
+                            const irtkRegisteredImage *fixed,
+                            const irtkRegisteredImage *moving,
+                            irtkProbabilisticImageSimilarity::GradientImageType *gradient,
+                            const irtkHistogram_2D<double> &logJointHistogram,
+                            const irtkHistogram_1D<double> &logMarginalXHistogram,
+                            const irtkHistogram_1D<double> &logMarginalYHistogram,
+                            double w, double denominator)
+  :
+    _Similarity(sim),
+    _Fixed(fixed->Data()),
+    _Moving(moving->Data()),
+    _Gradient(gradient->Data()),
+    _LogJointHistogram(logJointHistogram),
+    _LogMarginalXHistogram(logMarginalXHistogram),
+    _LogMarginalYHistogram(logMarginalYHistogram),
+    _JointWeight(w),
+    _Denominator(denominator)
+  {}
+
+  void operator ()(const blocked_range<int> &re) const
   {
-    const int nbins = _Histogram->NumberOfBins();
-    irtkProbabilisticImageSimilarity::JointHistogramType::BinType *l = _Histogram->RawPointer();
-    irtkProbabilisticImageSimilarity::JointHistogramType::BinType *r = rhs._Histogram->RawPointer();
-    for (int i = 0; i < nbins; ++i, ++l, ++r) (*l) += (*r);
-    _Histogram->NumberOfSamples(_Histogram->NumberOfSamples() + rhs._Histogram->NumberOfSamples());
+    for (int n = re.begin(); n != re.end(); ++n) {
+      const int idx = _Similarity->SampledVoxel(n);
+      if (_Similarity->IsForeground(idx)) Evaluate(idx);
+    }
   }
 
-  void operator ()(const blocked_range<int> &re)
+  /// Evaluate derivative at voxel
+  void Evaluate(int idx) const
   {
-    const irtkRegisteredImage::VoxelType *tgt = _Similarity->Target()->Data(re.begin());
-    const irtkRegisteredImage::VoxelType *src = _Similarity->Source()->Data(re.begin());
-    for (int idx = re.begin(); idx != re.end(); ++idx, ++tgt, ++src) {
-      if (_Similarity->IsForeground(idx)) {
-        _Histogram->Add(_Histogram->ValToBinX(*tgt), _Histogram->ValToBinY(*src));
-      }
+    const int    target_nbins = _LogMarginalXHistogram.NumberOfBins();
+    const int    source_nbins = _LogMarginalYHistogram.NumberOfBins();
+    const double target_value = ParzenWindowCenter(_Fixed[idx],  _LogMarginalXHistogram.Min(),
+                                                   _LogMarginalXHistogram.Max(), target_nbins);
+    const double source_value = ParzenWindowCenter(_Moving[idx], _LogMarginalYHistogram.Min(),
+                                                   _LogMarginalYHistogram.Max(), source_nbins);
+
+    int t1 = static_cast<int>(     target_value ) - 1;
+    int t2 = static_cast<int>(ceil(target_value)) + 1;
+    int s1 = static_cast<int>(     source_value ) - 1;
+    int s2 = static_cast<int>(ceil(source_value)) + 1;
+
+    if (t1 <  0           ) t1 = 0;
+    if (t2 >= target_nbins) t2 = target_nbins - 1;
+    if (s1 <  0           ) s1 = 0;
+    if (s2 >= source_nbins) s2 = source_nbins - 1;
+
+    double jointEntropyGrad  = .0;
+    double targetEntropyGrad = .0;
+    double sourceEntropyGrad = .0;
+    double w;
+
+    for (int t = t1; t <= t2; ++t)
+    for (int s = s1; s <= s2; ++s) {
+      w = irtkBSpline<double>::B  (static_cast<double>(t) - target_value) *
+          irtkBSpline<double>::B_I(static_cast<double>(s) - source_value);
+      jointEntropyGrad  += w * _LogJointHistogram(t, s);
+      targetEntropyGrad += w * _LogMarginalXHistogram(t);
+      sourceEntropyGrad += w * _LogMarginalYHistogram(s);
     }
+
+    _Gradient[idx] = (targetEntropyGrad + sourceEntropyGrad - _JointWeight * jointEntropyGrad) / _Denominator;
   }
 };
 
@@ -150,7 +321,8 @@ irtkProbabilisticImageSimilarity::irtkProbabilisticImageSimilarity(const char *n
   _Samples           (NULL),
   _Histogram         (NULL),
   _NumberOfTargetBins(0),
-  _NumberOfSourceBins(0)
+  _NumberOfSourceBins(0),
+  _ParzenWindowEstimation(false)
 {
 }
 
@@ -161,7 +333,8 @@ irtkProbabilisticImageSimilarity::irtkProbabilisticImageSimilarity(const irtkPro
   _Samples           (other._Samples   ? new JointHistogramType(*other._Samples)   : NULL),
   _Histogram         (other._Histogram ? new JointHistogramType(*other._Histogram) : NULL),
   _NumberOfTargetBins(other._NumberOfTargetBins),
-  _NumberOfSourceBins(other._NumberOfSourceBins)
+  _NumberOfSourceBins(other._NumberOfSourceBins),
+  _ParzenWindowEstimation(other._ParzenWindowEstimation)
 {
 }
 
@@ -173,6 +346,7 @@ irtkProbabilisticImageSimilarity &irtkProbabilisticImageSimilarity::operator =(c
   _Histogram          = other._Histogram ? new JointHistogramType(*other._Histogram) : NULL;
   _NumberOfTargetBins = other._NumberOfTargetBins;
   _NumberOfSourceBins = other._NumberOfSourceBins;
+  _ParzenWindowEstimation = other._ParzenWindowEstimation;
   return *this;
 }
 
@@ -201,6 +375,9 @@ bool irtkProbabilisticImageSimilarity::Set(const char *param, const char *value)
   if (strcmp(param, "No. of source bins") == 0) {
     return FromString(value, _NumberOfSourceBins) && _NumberOfSourceBins > 0;
   }
+  if (strcmp(param, "Parzen window estimation") == 0) {
+    return FromString(value, _ParzenWindowEstimation);
+  }
   return irtkImageSimilarity::Set(param, value);
 }
 
@@ -214,6 +391,7 @@ irtkParameterList irtkProbabilisticImageSimilarity::Parameter() const
     Insert(params, "No. of target bins", ToString(_NumberOfTargetBins));
     Insert(params, "No. of source bins", ToString(_NumberOfSourceBins));
   }
+  Insert(params, "Parzen window estimation", ToString(_ParzenWindowEstimation));
   return params;
 }
 
@@ -284,19 +462,33 @@ void irtkProbabilisticImageSimilarity::Update(bool gradient)
 
   IRTK_START_TIMING();
 
-  // Reset histogram
-  _Samples->Reset();
+  // Add cubic B-spline Parzen windows of samples using one private histogram
+  // per worker thread, which are reused by subsequent updates
+  const vector<int> *samples = (IsSubsampled() ? &_SampledVoxels : NULL);
+  if (_ParzenWindowEstimation) {
+    const int n = (samples ? static_cast<int>(samples->size()) : _NumberOfVoxels);
+    _PartialParzenHistograms.Fill(_Histogram->NumberOfBins(), n,
+                                  ParzenWindowSample(this, _Histogram, samples));
+    _Histogram->Reset();
+    _Histogram->NumberOfSamples(_PartialParzenHistograms.AddTo(_Histogram->RawPointer()));
+    IRTK_DEBUG_TIMING(2, "update of joint histogram (Parzen windows)");
+    return;
+  }
 
-  // Add histogram samples
-  blocked_range<int> voxels(0, _NumberOfVoxels, _NumberOfVoxels / 8);
+  // Count histogram samples using one private histogram per worker thread
+  const int nbins = _Samples->NumberOfBins();
   if (version >= irtkVersion(2, 2)) {
-    FillHistogram_v2 add(this, _Samples);
-    parallel_reduce(voxels, add);
+    CountSamples(_PartialHistograms, nbins, _NumberOfVoxels, samples,
+                 JointHistogramBin_v2(this, _Samples));
   } else {
-    FillHistogram_v1 add(this, _Samples);
-    parallel_reduce(voxels, add);
+    CountSamples(_PartialHistograms, nbins, _NumberOfVoxels, samples,
+                 JointHistogramBin_v1(this, _Samples));
   }
 
+  // Merge partial histograms
+  _Samples->Reset();
+  _Samples->NumberOfSamples(_PartialHistograms.AddTo(_Samples->RawPointer()));
+
   // Smooth histogram
   //
   // Note that the _Samples cannot be smoothed directly because of the
@@ -308,10 +500,83 @@ void irtkProbabilisticImageSimilarity::Update(bool gradient)
   IRTK_DEBUG_TIMING(2, "update of joint histogram");
 }
 
+// -----------------------------------------------------------------------------
+void irtkProbabilisticImageSimilarity::AddParzenWindows(const blocked_range3d<int> &region, double n)
+{
+  const int tbins = _Histogram->NumberOfBinsX();
+  const int sbins = _Histogram->NumberOfBinsY();
+  double tmin, smin, tmax, smax;
+  _Histogram->GetMin(&tmin, &smin);
+  _Histogram->GetMax(&tmax, &smax);
+  for (int k = region.pages().begin(); k < region.pages().end(); ++k)
+  for (int j = region.rows ().begin(); j < region.rows ().end(); ++j)
+  for (int i = region.cols ().begin(); i < region.cols ().end(); ++i) {
+    if (IsForeground(i, j, k)) {
+      AddParzenWindow(_Histogram, ParzenWindowCenter(_Target->Get(i, j, k), tmin, tmax, tbins),
+                                  ParzenWindowCenter(_Source->Get(i, j, k), smin, smax, sbins), n);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void irtkProbabilisticImageSimilarity
+::EntropyDerivative(const irtkRegisteredImage *image, GradientImageType *gradient,
+                    double w, double d)
+{
+  // Swap target and source if similarity derived w.r.t transformed "target"
+  irtkRegisteredImage *fixed = Target();
+  int tbin = _Histogram->NumberOfBinsX();
+  int sbin = _Histogram->NumberOfBinsY();
+  double tmin, smin, tmax, smax;
+  _Histogram->GetMin(&tmin, &smin);
+  _Histogram->GetMax(&tmax, &smax);
+
+  if (image == Target()) {
+    fixed = Source();
+    swap(tbin, sbin);
+    swap(tmin, smin);
+    swap(tmax, smax);
+  }
+
+  // Log transform histograms
+  irtkHistogram_2D<double>  logJointHistogram(tbin, sbin);
+  irtkHistogram_1D<double>  logMarginalXHistogram(tbin);
+  irtkHistogram_1D<double>  logMarginalYHistogram(sbin);
+
+  logJointHistogram.PutMin(tmin, smin);
+  logJointHistogram.PutMax(tmax, smax);
+  logMarginalXHistogram.PutMin(tmin);
+  logMarginalXHistogram.PutMax(tmax);
+  logMarginalYHistogram.PutMin(smin);
+  logMarginalYHistogram.PutMax(smax);
+
+  for (int s = 0; s < sbin; s++)
+  for (int t = 0; t < tbin; t++) {
+    double num = ((image == Target()) ? (*_Histogram)(s, t) : (*_Histogram)(t, s));
+    logJointHistogram.Add(t, s, num);
+    logMarginalXHistogram.Add(t, num);
+    logMarginalYHistogram.Add(s, num);
+  }
+
+  logJointHistogram    .Log();
+  logMarginalXHistogram.Log();
+  logMarginalYHistogram.Log();
+
+  // Evaluate similarity derivative w.r.t given transformed image
+  EvaluateEntropyDerivative eval(this, fixed, image, gradient,
+                                 logJointHistogram,
+                                 logMarginalXHistogram,
+                                 logMarginalYHistogram, w, d);
+  memset(gradient->Data(), 0, _NumberOfVoxels * sizeof(GradientType));
+  parallel_for(blocked_range<int>(0, NumberOfSampledVoxels()), eval);
+}
+
 // -----------------------------------------------------------------------------
 void irtkProbabilisticImageSimilarity::Exclude(const blocked_range3d<int> &region)
 {
-  if (version >= irtkVersion(2, 2)) {
+  if (_ParzenWindowEstimation) {
+    AddParzenWindows(region, -1.0);
+  } else if (version >= irtkVersion(2, 2)) {
     for (int k = region.pages().begin(); k < region.pages().end(); ++k)
     for (int j = region.rows ().begin(); j < region.rows ().end(); ++j)
     for (int i = region.cols ().begin(); i < region.cols ().end(); ++i) {
@@ -334,6 +599,10 @@ void irtkProbabilisticImageSimilarity::Exclude(const blocked_range3d<int> &regio
 // -----------------------------------------------------------------------------
 void irtkProbabilisticImageSimilarity::Include(const blocked_range3d<int> &region)
 {
+  if (_ParzenWindowEstimation) {
+    AddParzenWindows(region, 1.0);
+    return;
+  }
   bool changed = false;
   if (version >= irtkVersion(2, 2)) {
     for (int k = region.pages().begin(); k < region.pages().end(); ++k)
@@ -380,7 +649,12 @@ void irtkProbabilisticImageSimilarity::Print(irtkIndent indent) const
   cout << indent << "No. of bins:     " << _Samples->NumberOfBinsX() << " x "
                                         << _Samples->NumberOfBinsY() << endl;
   cout << indent << "Bin size:        " << xwidth << " x " << ywidth << endl;
-  cout << indent << "No. of samples:  " << _Samples->NumberOfSamples() << endl;
+  cout << indent << "Parzen windows:  " << ToString(_ParzenWindowEstimation) << endl;
+  if (_ParzenWindowEstimation) {
+    cout << indent << "No. of samples:  " << _Histogram->NumberOfSamples() << endl;
+  } else {
+    cout << indent << "No. of samples:  " << _Samples->NumberOfSamples() << endl;
+  }
 }
 
 // -----------------------------------------------------------------------------
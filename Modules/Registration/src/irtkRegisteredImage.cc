@@ -40,6 +40,9 @@ irtkRegisteredImage::irtkRegisteredImage()
   _ExternalDisplacement  (NULL),
   _FixedDisplacement     (NULL),
   _Displacement          (NULL),
+  _LineSearchOrigin      (NULL),
+  _LineSearchDirection   (NULL),
+  _LineSearchStep        (.0),
   _CacheWorldCoordinates (true),  // FIXME: MUST be true to also cache anything else...
   _CacheFixedDisplacement(false), // by default, only if required by transformation
   _CacheDisplacement     (false), // (c.f. irtkTransformation::RequiresCachingOfDisplacements)
@@ -49,6 +52,7 @@ irtkRegisteredImage::irtkRegisteredImage()
   _GradientSigma         (.0),
   _HessianSigma          (.0),
   _PrecomputeDerivatives (false),
+  _SampledVoxels         (NULL),
   _NumberOfActiveLevels  (0),
   _NumberOfPassiveLevels (0)
 {
@@ -58,7 +62,7 @@ irtkRegisteredImage::irtkRegisteredImage()
 // -----------------------------------------------------------------------------
 irtkRegisteredImage::irtkRegisteredImage(const irtkRegisteredImage &other)
 :
-  irtkGenericImage<double>(other),
+  irtkGenericImage<irtkRegisteredPixel>(other),
   _InputImage            (other._InputImage),
   _InputGradient         (other._InputGradient  ? new GradientImageType(*other._InputGradient)  : NULL),
   _InputHessian          (other._InputHessian   ? new GradientImageType(*other._InputHessian)   : NULL),
@@ -70,6 +74,9 @@ irtkRegisteredImage::irtkRegisteredImage(const irtkRegisteredImage &other)
   _ExternalDisplacement  (other._ExternalDisplacement),
   _FixedDisplacement     (other._FixedDisplacement ? new DisplacementImageType(*other._FixedDisplacement) : NULL),
   _Displacement          (other._Displacement      ? new DisplacementImageType(*other._Displacement)      : NULL),
+  _LineSearchOrigin      (NULL),
+  _LineSearchDirection   (NULL),
+  _LineSearchStep        (.0),
   _CacheWorldCoordinates (other._CacheWorldCoordinates),
   _CacheFixedDisplacement(other._CacheFixedDisplacement),
   _CacheDisplacement     (other._CacheDisplacement),
@@ -79,6 +86,7 @@ irtkRegisteredImage::irtkRegisteredImage(const irtkRegisteredImage &other)
   _GradientSigma         (other._GradientSigma),
   _HessianSigma          (other._HessianSigma),
   _PrecomputeDerivatives (other._PrecomputeDerivatives),
+  _SampledVoxels         (other._SampledVoxels),
   _NumberOfActiveLevels  (other._NumberOfActiveLevels),
   _NumberOfPassiveLevels (other._NumberOfPassiveLevels)
 {
@@ -88,7 +96,7 @@ irtkRegisteredImage::irtkRegisteredImage(const irtkRegisteredImage &other)
 // -----------------------------------------------------------------------------
 irtkRegisteredImage &irtkRegisteredImage::operator =(const irtkRegisteredImage &other)
 {
-  irtkGenericImage<double>::operator =(other);
+  irtkGenericImage<irtkRegisteredPixel>::operator =(other);
   _InputImage             = other._InputImage;
   _InputGradient          = other._InputGradient  ? new GradientImageType(*other._InputGradient)  : NULL;
   _InputHessian           = other._InputHessian   ? new GradientImageType(*other._InputHessian)   : NULL;
@@ -100,6 +108,9 @@ irtkRegisteredImage &irtkRegisteredImage::operator =(const irtkRegisteredImage &
   _ExternalDisplacement   = other._ExternalDisplacement;
   _FixedDisplacement      = other._FixedDisplacement ? new DisplacementImageType(*other._FixedDisplacement) : NULL;
   _Displacement           = other._Displacement      ? new DisplacementImageType(*other._Displacement)      : NULL;
+  Delete(_LineSearchOrigin);
+  Delete(_LineSearchDirection);
+  _LineSearchStep         = .0;
   _CacheWorldCoordinates  = other._CacheWorldCoordinates;
   _CacheFixedDisplacement = other._CacheFixedDisplacement;
   _CacheDisplacement      = other._CacheDisplacement;
@@ -109,6 +120,7 @@ irtkRegisteredImage &irtkRegisteredImage::operator =(const irtkRegisteredImage &
   _GradientSigma          = other._GradientSigma;
   _HessianSigma           = other._HessianSigma;
   _PrecomputeDerivatives  = other._PrecomputeDerivatives;
+  _SampledVoxels          = other._SampledVoxels;
   _NumberOfActiveLevels   = other._NumberOfActiveLevels;
   _NumberOfPassiveLevels  = other._NumberOfPassiveLevels;
   memcpy(_Offset, other._Offset, 13 * sizeof(int));
@@ -121,6 +133,8 @@ irtkRegisteredImage::~irtkRegisteredImage()
   if (_ImageToWorld != _WorldCoordinates) delete _ImageToWorld;
   delete _FixedDisplacement;
   delete _Displacement;
+  delete _LineSearchOrigin;
+  delete _LineSearchDirection;
   if (_InputGradient != _InputImage) delete _InputGradient;
   delete _InputHessian;
 }
@@ -149,7 +163,7 @@ void irtkRegisteredImage::Initialize(const irtkImageAttributes &attr, int t)
     cerr << "irtkRegisteredImage::Initialize: Number of registered image channels must be either 1, 4, 10 or 13" << endl;
     exit(1);
   }
-  irtkGenericImage<double>::Initialize(attr, t);
+  irtkGenericImage<irtkRegisteredPixel>::Initialize(attr, t);
 
   // Set background value/foreground mask
   if (_InputImage->HasBackgroundValue()) {
@@ -328,7 +342,8 @@ void irtkRegisteredImage::ComputeInputHessian(double sigma)
 // Base class of voxel transformation functors
 struct Transformer
 {
-  typedef irtkWorldCoordsImage::VoxelType CoordType;
+  typedef irtkWorldCoordsImage::VoxelType                       CoordType;
+  typedef irtkRegisteredImage::DisplacementImageType::VoxelType DisplacementType;
 
   /// Constructor
   Transformer()
@@ -369,7 +384,7 @@ struct Transformer
   }
 
   /// Transform output voxel using pre-computed world coordinates and displacements
-  void operator ()(double &x, double &y, double &z, const CoordType *wc, const double *dx)
+  void operator ()(double &x, double &y, double &z, const CoordType *wc, const DisplacementType *dx)
   {
     x = wc[_x] + dx[_x];
     y = wc[_y] + dx[_y];
@@ -399,7 +414,7 @@ struct DefaultTransformer : public Transformer
 
   /// As this transformer is only used when no fixed transformation is cached,
   /// this overloaded operator should never be invoked
-  void operator ()(double &, double &, double &, const CoordType *, const double *, const double *)
+  void operator ()(double &, double &, double &, const CoordType *, const DisplacementType *, const DisplacementType *)
   {
     cerr << "irtkRegisteredImage::DefaultTransformer used even though _FixedDisplacement assumed to be NULL ?!?" << endl;
     exit(1);
@@ -413,7 +428,7 @@ struct AdditiveTransformer : public Transformer
   using Transformer::operator();
 
   /// Transform output voxel using pre-computed world coordinates and displacements
-  void operator ()(double &x, double &y, double &z, const CoordType *wc, const double *d1, const double *d2)
+  void operator ()(double &x, double &y, double &z, const CoordType *wc, const DisplacementType *d1, const DisplacementType *d2)
   {
     x = wc[_x] + d1[_x] + d2[_x];
     y = wc[_y] + d1[_y] + d2[_y];
@@ -433,7 +448,7 @@ struct FluidTransformer : public Transformer
   /// Because fluid composition of displacement fields would require interpolation,
   /// let irtkTransformation::Displacement handle the fluid composition already when
   /// computing the second displacement field.
-  void operator ()(double &x, double &y, double &z, const CoordType *wc, const double *, const double *dx)
+  void operator ()(double &x, double &y, double &z, const CoordType *wc, const DisplacementType *, const DisplacementType *dx)
   {
     x = wc[_x] + dx[_x];
     y = wc[_y] + dx[_y];
@@ -442,6 +457,34 @@ struct FluidTransformer : public Transformer
   }
 };
 
+// -----------------------------------------------------------------------------
+// Transform output voxel using displacements cached along line search direction
+struct LineSearchTransformer : public Transformer
+{
+  using Transformer::operator();
+
+  /// Initialize data members
+  void Initialize(irtkRegisteredImage *o, const irtkBaseImage *i, const irtkTransformation *t)
+  {
+    Transformer::Initialize(o, i, t);
+    _Step = o->LineSearchStep();
+  }
+
+  /// Transform output voxel using pre-computed world coordinates, displacements
+  /// at start of line search, and change of displacements along search direction
+  void operator ()(double &x, double &y, double &z, const CoordType *wc, const DisplacementType *d0, const DisplacementType *dd)
+  {
+    x = wc[_x] + d0[_x] + _Step * dd[_x];
+    y = wc[_y] + d0[_y] + _Step * dd[_y];
+    z = wc[_z] + d0[_z] + _Step * dd[_z];
+    _Input->WorldToImage(x, y, z);
+  }
+
+protected:
+
+  double _Step; ///< Multiple of search direction
+};
+
 // -----------------------------------------------------------------------------
 // Transformer used when no transformation is set or custom displacement field given
 struct FixedTransformer : public Transformer
@@ -467,14 +510,14 @@ struct FixedTransformer : public Transformer
   }
 
   /// Transform output voxel using pre-computed world coordinates and displacements
-  void operator ()(double &x, double &y, double &z, const CoordType *wc, const double *dx)
+  void operator ()(double &x, double &y, double &z, const CoordType *wc, const DisplacementType *dx)
   {
     Transformer::operator()(x, y, z, wc, dx);
   }
 
   /// As this transformer is only used when no transformation is set,
   /// this overloaded operator should never be invoked
-  void operator ()(double &, double &, double &, const CoordType *, const double *, const double *)
+  void operator ()(double &, double &, double &, const CoordType *, const DisplacementType *, const DisplacementType *)
   {
     cerr << "irtkRegisteredImage::FixedTransformer(..., d1, d2) used even though _Transformation assumed to be NULL ?!?" << endl;
     exit(1);
@@ -563,6 +606,8 @@ class Interpolator
 {
 protected:
 
+  typedef irtkRegisteredImage::VoxelType VoxelType;
+
   IntensityFunction   *_IntensityFunction;
   GradientFunction    *_GradientFunction;
   HessianFunction     *_HessianFunction;
@@ -708,50 +753,70 @@ public:
   /// Interpolate input intensity function
   ///
   /// \return The interpolation mode, i.e., result of inside/outside domain check.
-  int InterpolateIntensity(double x, double y, double z, double *o)
+  int InterpolateIntensity(double x, double y, double z, VoxelType *o)
   {
+    double value;
     // Check if location is inside image domain
     int mode = InterpolationMode(x, y, z, false);
     if (mode == 1) {
       // Either interpolate using the input padding value to exclude background
       if (_InterpolateWithPadding) {
-        *o = _IntensityFunction->EvaluateWithPaddingInside(x, y, z);
+        value = _IntensityFunction->EvaluateWithPaddingInside(x, y, z);
       // or simply ignore the input background value as done by nreg2
       } else {
-        *o = _IntensityFunction->EvaluateInside(x, y, z);
+        value = _IntensityFunction->EvaluateInside(x, y, z);
       }
       // Set background to output padding value
-      if (*o == _IntensityFunction->DefaultValue()) {
-        *o = _PaddingValue;
-        if (_InterpolateWithPadding) return -1;
+      if (value == _IntensityFunction->DefaultValue()) {
+        value = _PaddingValue;
+        if (_InterpolateWithPadding) mode = -1;
       // Rescale foreground to desired [min, max] range
       } else if (_RescaleSlope != 1.0 || _RescaleIntercept != .0) {
-        *o = (*o) * _RescaleSlope + _RescaleIntercept;
-        if      (*o < _MinIntensity) *o = _MinIntensity;
-        else if (*o > _MaxIntensity) *o = _MaxIntensity;
+        value = value * _RescaleSlope + _RescaleIntercept;
+        if      (value < _MinIntensity) value = _MinIntensity;
+        else if (value > _MaxIntensity) value = _MaxIntensity;
       }
     // Otherwise, set output intensity to outside value
     } else {
-      *o = _PaddingValue;
+      value = _PaddingValue;
     }
+    *o = static_cast<VoxelType>(value);
     // Pass inside/outside check result on to derivative interpolation
     // functions such that these boundary checks are only done once.
     // This requires the same interpolation mode for all channels.
     return mode;
   }
 
+  /// Interpolate multi-channel function inside input domain
+  template <class Function>
+  void EvaluateInside(const Function *f, double x, double y, double z, double *o, int) const
+  {
+    if (_InterpolateWithPadding) {
+      f->EvaluateWithPaddingInside(o, x, y, z, _NumberOfVoxels);
+    } else {
+      f->EvaluateInside(o, x, y, z, _NumberOfVoxels);
+    }
+  }
+
+  /// Interpolate multi-channel function inside input domain and convert
+  /// the interpolated values to single-precision registered image channels
+  template <class Function>
+  void EvaluateInside(const Function *f, double x, double y, double z, float *o, int n) const
+  {
+    double v[9];
+    if (_InterpolateWithPadding) f->EvaluateWithPaddingInside(v, x, y, z, 1);
+    else                         f->EvaluateInside           (v, x, y, z, 1);
+    for (int c = 0; c < n; ++c, o += _NumberOfVoxels) *o = static_cast<float>(v[c]);
+  }
+
   /// Interpolate 1st order derivatives of input intensity function
-  void InterpolateGradient(double x, double y, double z, double *o, int mode = 0)
+  void InterpolateGradient(double x, double y, double z, VoxelType *o, int mode = 0)
   {
     o += _NumberOfVoxels;
     switch (mode) {
       // Inside
       case 1:
-        if (_InterpolateWithPadding) {
-          _GradientFunction->EvaluateWithPaddingInside(o, x, y, z, _NumberOfVoxels);
-        } else {
-          _GradientFunction->EvaluateInside(o, x, y, z, _NumberOfVoxels);
-        }
+        EvaluateInside(_GradientFunction, x, y, z, o, 3);
         break;
       // Outside/Boundary
       default: for (int c = 1; c <= 3; ++c, o += _NumberOfVoxels) *o = .0;
@@ -759,17 +824,13 @@ public:
   }
 
   /// Interpolate 2nd order derivatives of input intensity function
-  void InterpolateHessian(double x, double y, double z, double *o, int mode = 0)
+  void InterpolateHessian(double x, double y, double z, VoxelType *o, int mode = 0)
   {
     o += 4 * _NumberOfVoxels;
     switch (mode) {
       // Inside
       case 1:
-        if (_InterpolateWithPadding) {
-          _HessianFunction->EvaluateWithPaddingInside(o, x, y, z, _NumberOfVoxels);
-        } else {
-          _HessianFunction->EvaluateInside(o, x, y, z, _NumberOfVoxels);
-        }
+        EvaluateInside(_HessianFunction, x, y, z, o, _NumberOfChannels - 4);
         break;
       // Outside/Boundary
       default: for (int c = 4; c < _NumberOfChannels; ++c, o += _NumberOfVoxels) *o = .0;
@@ -782,7 +843,7 @@ public:
 template <class IntensityFunction, class GradientFunction, class HessianFunction>
 struct IntensityInterpolator : public Interpolator<IntensityFunction, GradientFunction, HessianFunction>
 {
-  void operator()(double x, double y, double z, double *o)
+  void operator()(double x, double y, double z, irtkRegisteredImage::VoxelType *o)
   {
     this->InterpolateIntensity(x, y, z, o);
   }
@@ -793,7 +854,7 @@ struct IntensityInterpolator : public Interpolator<IntensityFunction, GradientFu
 template <class IntensityFunction, class GradientFunction, class HessianFunction>
 struct GradientInterpolator : public Interpolator<IntensityFunction, GradientFunction, HessianFunction>
 {
-  void operator()(double x, double y, double z, double *o)
+  void operator()(double x, double y, double z, irtkRegisteredImage::VoxelType *o)
   {
     int mode = this->InterpolationMode  (x, y, z);
     this           ->InterpolateGradient(x, y, z, o, mode);
@@ -805,7 +866,7 @@ struct GradientInterpolator : public Interpolator<IntensityFunction, GradientFun
 template <class IntensityFunction, class GradientFunction, class HessianFunction>
 struct HessianInterpolator : public Interpolator<IntensityFunction, GradientFunction, HessianFunction>
 {
-  void operator()(double x, double y, double z, double *o)
+  void operator()(double x, double y, double z, irtkRegisteredImage::VoxelType *o)
   {
     int mode = this->InterpolationMode (x, y, z);
     this           ->InterpolateHessian(x, y, z, o, mode);
@@ -817,7 +878,7 @@ struct HessianInterpolator : public Interpolator<IntensityFunction, GradientFunc
 template <class IntensityFunction, class GradientFunction, class HessianFunction>
 struct IntensityAndGradientInterpolator : public Interpolator<IntensityFunction, GradientFunction, HessianFunction>
 {
-  void operator()(double x, double y, double z, double *o)
+  void operator()(double x, double y, double z, irtkRegisteredImage::VoxelType *o)
   {
     int mode = this->InterpolateIntensity(x, y, z, o);
     this           ->InterpolateGradient (x, y, z, o, mode);
@@ -829,7 +890,7 @@ struct IntensityAndGradientInterpolator : public Interpolator<IntensityFunction,
 template <class IntensityFunction, class GradientFunction, class HessianFunction>
 struct IntensityAndHessianInterpolator : public Interpolator<IntensityFunction, GradientFunction, HessianFunction>
 {
-  void operator()(double x, double y, double z, double *o)
+  void operator()(double x, double y, double z, irtkRegisteredImage::VoxelType *o)
   {
     int mode = this->InterpolateIntensity(x, y, z, o);
     this           ->InterpolateHessian  (x, y, z, o, mode);
@@ -841,7 +902,7 @@ struct IntensityAndHessianInterpolator : public Interpolator<IntensityFunction,
 template <class IntensityFunction, class GradientFunction, class HessianFunction>
 struct GradientAndHessianInterpolator : public Interpolator<IntensityFunction, GradientFunction, HessianFunction>
 {
-  void operator()(double x, double y, double z, double *o)
+  void operator()(double x, double y, double z, irtkRegisteredImage::VoxelType *o)
   {
     int mode = this->InterpolationMode  (x, y, z);
     this           ->InterpolateGradient(x, y, z, o, mode);
@@ -854,7 +915,7 @@ struct GradientAndHessianInterpolator : public Interpolator<IntensityFunction, G
 template <class IntensityFunction, class GradientFunction, class HessianFunction>
 struct IntensityAndGradientAndHessianInterpolator : public Interpolator<IntensityFunction, GradientFunction, HessianFunction>
 {
-  void operator()(double x, double y, double z, double *o)
+  void operator()(double x, double y, double z, irtkRegisteredImage::VoxelType *o)
   {
     int mode = this->InterpolateIntensity(x, y, z, o);
     this           ->InterpolateGradient (x, y, z, o, mode);
@@ -869,7 +930,9 @@ struct UpdateFunction : public irtkVoxelFunction
 {
 private:
 
-  typedef typename Transformer::CoordType CoordType;
+  typedef typename Transformer::CoordType        CoordType;
+  typedef typename Transformer::DisplacementType DisplacementType;
+  typedef irtkRegisteredImage::VoxelType         VoxelType;
 
   Transformer  _Transform;
   Interpolator _Interpolate;
@@ -890,7 +953,7 @@ public:
   }
 
   /// Resample input without pre-computed maps
-  void operator ()(int i, int j, int k, int, double *o)
+  void operator ()(int i, int j, int k, int, VoxelType *o)
   {
     double x = i, y = j, z = k;
     _Transform  (x, y, z);
@@ -898,7 +961,7 @@ public:
   }
 
   /// Resample input using pre-computed world coordinates
-  void operator ()(int i, int j, int k, int, const CoordType *wc, double *o)
+  void operator ()(int i, int j, int k, int, const CoordType *wc, VoxelType *o)
   {
     double x = i, y = j, z = k;
     _Transform  (x, y, z, wc);
@@ -906,7 +969,7 @@ public:
   }
 
   /// Resample input using pre-computed world coordinates and displacements
-  void operator ()(int i, int j, int k, int, const CoordType *wc, const double *dx, double *o)
+  void operator ()(int i, int j, int k, int, const CoordType *wc, const DisplacementType *dx, VoxelType *o)
   {
     double x = i, y = j, z = k;
     _Transform  (x, y, z, wc, dx);
@@ -914,7 +977,7 @@ public:
   }
 
   /// Resample input using pre-computed world coordinates and additive displacements
-  void operator ()(int i, int j, int k, int, const CoordType *wc, const double *d1, const double *d2, double *o)
+  void operator ()(int i, int j, int k, int, const CoordType *wc, const DisplacementType *d1, const DisplacementType *d2, VoxelType *o)
   {
     double x = i, y = j, z = k;
     _Transform  (x, y, z, wc, d1, d2);
@@ -922,6 +985,57 @@ public:
   }
 };
 
+// -----------------------------------------------------------------------------
+// Resample input image at list of sampled output voxels
+template <class Function>
+class UpdateSampledVoxelsBody
+{
+  typedef irtkWorldCoordsImage::VoxelType                       CoordType;
+  typedef irtkRegisteredImage::DisplacementImageType::VoxelType DisplacementType;
+  typedef irtkRegisteredImage::VoxelType                        VoxelType;
+
+  const vector<int>      &_Index;
+  irtkRegisteredImage    *_Output;
+  const CoordType        *_WorldCoords;
+  const DisplacementType *_Displacement1;
+  const DisplacementType *_Displacement2;
+  const Function         &_Function;
+
+public:
+
+  UpdateSampledVoxelsBody(const vector<int> &index, irtkRegisteredImage *o,
+                          const CoordType *wc, const DisplacementType *d1, const DisplacementType *d2,
+                          const Function &f)
+  :
+    _Index(index), _Output(o), _WorldCoords(wc),
+    _Displacement1(d1), _Displacement2(d2), _Function(f)
+  {}
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    Function f(_Function);
+    const int nx  = _Output->X();
+    const int nxy = _Output->X() * _Output->Y();
+    VoxelType *o = _Output->Data();
+    int idx, i, j, k;
+    for (int n = re.begin(); n != re.end(); ++n) {
+      idx = _Index[n];
+      k   = idx / nxy;
+      j   = (idx - k * nxy) / nx;
+      i   = idx - k * nxy - j * nx;
+      if (_Displacement2) {
+        f(i, j, k, 0, _WorldCoords + idx, _Displacement1 + idx, _Displacement2 + idx, o + idx);
+      } else if (_Displacement1) {
+        f(i, j, k, 0, _WorldCoords + idx, _Displacement1 + idx, o + idx);
+      } else if (_WorldCoords) {
+        f(i, j, k, 0, _WorldCoords + idx, o + idx);
+      } else {
+        f(i, j, k, 0, o + idx);
+      }
+    }
+  }
+};
+
 // -----------------------------------------------------------------------------
 template <class Transformer, class Interpolator>
 void irtkRegisteredImage::Update3(const blocked_range3d<int> &region,
@@ -933,7 +1047,28 @@ void irtkRegisteredImage::Update3(const blocked_range3d<int> &region,
              hessian    ? _InputHessian        : NULL,
              _Transformation, this,
              _MinIntensity, _MaxIntensity);
-  if (_ImageToWorld) {
+  if (_SampledVoxels &&
+      region.cols ().begin() == 0 && region.cols ().end() == this->X() &&
+      region.rows ().begin() == 0 && region.rows ().end() == this->Y() &&
+      region.pages().begin() == 0 && region.pages().end() == this->Z()) {
+    const DisplacementImageType::VoxelType *d1 = NULL, *d2 = NULL;
+    if (_ImageToWorld) {
+      if (_ExternalDisplacement) {
+        d1 = _ExternalDisplacement->Data();
+      } else if (_Displacement) {
+        if (_FixedDisplacement) {
+          d1 = _FixedDisplacement->Data();
+          d2 = _Displacement     ->Data();
+        } else {
+          d1 = _Displacement->Data();
+        }
+      }
+    }
+    UpdateSampledVoxelsBody<Function> body(*_SampledVoxels, this,
+                                           _ImageToWorld ? _ImageToWorld->Data() : NULL,
+                                           d1, d2, f);
+    parallel_for(blocked_range<int>(0, static_cast<int>(_SampledVoxels->size())), body);
+  } else if (_ImageToWorld) {
     if (_ExternalDisplacement) {
       ParallelForEachVoxel(region, _ImageToWorld, _ExternalDisplacement, this, f);
     } else if (_Displacement) {
@@ -1120,6 +1255,18 @@ void irtkRegisteredImage::Update(const blocked_range3d<int> &region,
     // Always use provided externally updated displacement field if given
     Update1<DefaultTransformer>(region, intensity, gradient, hessian);
 
+  } else if (_LineSearchDirection) {
+
+    // Use displacements cached at start of line search and their change
+    // along the search direction in place of the own displacement fields
+    DisplacementImageType * const _disp  = _Displacement;
+    DisplacementImageType * const _fixed = _FixedDisplacement;
+    _FixedDisplacement = _LineSearchOrigin;
+    _Displacement      = _LineSearchDirection;
+    Update1<LineSearchTransformer>(region, intensity, gradient, hessian);
+    _Displacement      = _disp;
+    _FixedDisplacement = _fixed;
+
   } else {
 
     // End time point of deformation and initial time for velocity-based
@@ -1296,3 +1443,59 @@ void irtkRegisteredImage::Update(const blocked_range3d<int>  &region,
   _Displacement      = _disp;
   _FixedDisplacement = _fixed;
 }
+
+// =============================================================================
+// Line search
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void irtkRegisteredImage::BeginLineSearch()
+{
+  Delete(_LineSearchDirection);
+  _LineSearchStep = .0;
+
+  // Displacements of other transformations cannot be interpolated linearly
+  if (!_Transformation || !_SelfUpdate || _ExternalDisplacement ||
+      !_Transformation->DisplacementIsLinearInDOFs()) {
+    Delete(_LineSearchOrigin);
+    return;
+  }
+
+  // Image to world map required by Update3
+  if (!_ImageToWorld) {
+    _ImageToWorld = new irtkWorldCoordsImage();
+    this->ImageToWorld(*_ImageToWorld, true /* i.e., always 3D vectors */);
+  }
+
+  // Compute displacements for current transformation parameters
+  if (!_LineSearchOrigin) _LineSearchOrigin = new DisplacementImageType();
+  _LineSearchOrigin->Initialize(_attr, 3);
+  _Transformation->Displacement(*_LineSearchOrigin, _InputImage->GetTOrigin(),
+                                this->GetTOrigin(), _ImageToWorld);
+}
+
+// -----------------------------------------------------------------------------
+void irtkRegisteredImage::CacheLineSearchDirection()
+{
+  if (!_LineSearchOrigin) return;
+
+  // Compute displacements for parameters advanced by search direction
+  if (!_LineSearchDirection) _LineSearchDirection = new DisplacementImageType();
+  _LineSearchDirection->Initialize(_attr, 3);
+  _Transformation->Displacement(*_LineSearchDirection, _InputImage->GetTOrigin(),
+                                this->GetTOrigin(), _ImageToWorld);
+
+  // Subtract displacements at start of line search
+  const int n = _LineSearchDirection->GetNumberOfVoxels();
+  const DisplacementImageType::VoxelType *d0 = _LineSearchOrigin->Data();
+  DisplacementImageType::VoxelType       *dd = _LineSearchDirection->Data();
+  for (int idx = 0; idx < n; ++idx, ++d0, ++dd) *dd -= *d0;
+}
+
+// -----------------------------------------------------------------------------
+void irtkRegisteredImage::EndLineSearch()
+{
+  Delete(_LineSearchOrigin);
+  Delete(_LineSearchDirection);
+  _LineSearchStep = .0;
+}
@@ -40,7 +40,7 @@ using namespace irtk::polydata;
 namespace irtkRegisteredPointSetUtils {
 
 /// Type of interpolator used to interpolate dense displacement field
-typedef irtkGenericLinearInterpolateImageFunction<irtkGenericImage<double> > DisplacementInterpolator;
+typedef irtkGenericLinearInterpolateImageFunction<irtkRegisteredPointSet::DisplacementImageType> DisplacementInterpolator;
 
 // -----------------------------------------------------------------------------
 /// Copy VTK points to IRTK point set
@@ -543,7 +543,7 @@ void irtkRegisteredPointSet::Update(bool force)
       IRTK_DEBUG_TIMING(7, "transforming points");
     } else if (_Transformation->RequiresCachingOfDisplacements() && _Domain) {
       IRTK_START_TIMING();
-      if (!_Displacement) _Displacement = new irtkGenericImage<double>();
+      if (!_Displacement) _Displacement = new DisplacementImageType();
       _Displacement->Initialize(_Domain, 3);
       _Transformation->Displacement(*_Displacement, _Time, _InputTime);
       DisplacementInterpolator disp;
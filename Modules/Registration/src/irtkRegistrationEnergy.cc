@@ -139,7 +139,9 @@ irtkRegistrationEnergy::irtkRegistrationEnergy()
 :
   _Transformation    (NULL),
   _NormalizeGradients(false),
-  _Preconditioning   (.0)
+  _Preconditioning   (.0),
+  _LineSearchNorm    (.0),
+  _LineSearchStep    (.0)
 {
   // Bind broadcast method to energy term events
   _EventDelegate.Bind(LogEvent, MakeDelegate(this, &irtkObservable::Broadcast));
@@ -373,6 +375,7 @@ int irtkRegistrationEnergy::NumberOfDOFs() const
 // -----------------------------------------------------------------------------
 void irtkRegistrationEnergy::Put(const double *x)
 {
+  if (!_LineSearchDirection.empty()) this->EndLineSearch();
   _Transformation->Put(x);
   _Transformation->Changed(true); // in case Put does not do this
   for (size_t i = 0; i < _Term.size(); ++i) {
@@ -395,6 +398,7 @@ double irtkRegistrationEnergy::Get(int dof) const
 // -----------------------------------------------------------------------------
 double irtkRegistrationEnergy::Step(const double *dx)
 {
+  if (!_LineSearchDirection.empty()) this->EndLineSearch();
   double max_delta = _Transformation->Update(dx);
   if (max_delta > .0) _Transformation->Changed(true); // in case Update does not do this
   for (size_t i = 0; i < _Term.size(); ++i) {
@@ -403,6 +407,172 @@ double irtkRegistrationEnergy::Step(const double *dx)
   return max_delta;
 }
 
+// =============================================================================
+// Line search
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+bool irtkRegistrationEnergy::BeginLineSearch(const double *dir)
+{
+  if (!_LineSearchDirection.empty()) this->EndLineSearch();
+  if (!_Transformation->DisplacementIsLinearInDOFs()) return false;
+
+  IRTK_START_TIMING();
+
+  const int ndofs = this->NumberOfDOFs();
+  if (ndofs == 0) return false;
+  _LineSearchOrigin   .resize(ndofs);
+  _LineSearchDirection.assign(dir, dir + ndofs);
+  _LineSearchNorm = _LineSearchStep = .0;
+  for (int dof = 0; dof < ndofs; ++dof) {
+    if (fabs(dir[dof]) > _LineSearchNorm) _LineSearchNorm = fabs(dir[dof]);
+  }
+
+  // Cache displacements for current parameters
+  _Transformation->Get(&_LineSearchOrigin[0]);
+  for (size_t i = 0; i < _Term.size(); ++i) {
+    if (_Term[i]->Weight() != .0) _Term[i]->BeginLineSearch();
+  }
+
+  // Cache change of displacements along search direction
+  vector<double> x(ndofs);
+  for (int dof = 0; dof < ndofs; ++dof) {
+    x[dof] = _LineSearchOrigin[dof] + _LineSearchDirection[dof];
+  }
+  _Transformation->Put(&x[0]);
+  for (size_t i = 0; i < _Term.size(); ++i) {
+    if (_Term[i]->Weight() != .0) _Term[i]->CacheLineSearchDirection();
+  }
+
+  // Restore current parameters
+  _Transformation->Put(&_LineSearchOrigin[0]);
+  _Transformation->Changed(true);
+  for (size_t i = 0; i < _Term.size(); ++i) {
+    if (_Term[i]->Weight() != .0) _Term[i]->LineSearchStep(.0);
+  }
+
+  IRTK_DEBUG_TIMING(3, "caching of displacements along line search direction");
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+double irtkRegistrationEnergy::LineSearchStep(double alpha)
+{
+  const int ndofs = static_cast<int>(_LineSearchDirection.size());
+  vector<double> x(ndofs);
+  for (int dof = 0; dof < ndofs; ++dof) {
+    x[dof] = _LineSearchOrigin[dof] + alpha * _LineSearchDirection[dof];
+  }
+  const double max_delta = fabs(alpha - _LineSearchStep) * _LineSearchNorm;
+  _LineSearchStep = alpha;
+  _Transformation->Put(&x[0]);
+  _Transformation->Changed(true);
+  for (size_t i = 0; i < _Term.size(); ++i) {
+    if (_Term[i]->Weight() != .0) _Term[i]->LineSearchStep(alpha);
+    _Value[i] = numeric_limits<double>::quiet_NaN();
+  }
+  return max_delta;
+}
+
+// -----------------------------------------------------------------------------
+void irtkRegistrationEnergy::EndLineSearch()
+{
+  // Discard cached displacements and force update of transformed inputs
+  // such that subsequent evaluations are based on the exact displacements
+  for (size_t i = 0; i < _Term.size(); ++i) {
+    _Term[i]->EndLineSearch();
+    _Value[i] = numeric_limits<double>::quiet_NaN();
+  }
+  _LineSearchOrigin   .clear();
+  _LineSearchDirection.clear();
+  _Transformation->Changed(true);
+}
+
+// =============================================================================
+// Gauss-Newton approximation
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+bool irtkRegistrationEnergy::BeginGaussNewton()
+{
+  if (!_GaussNewtonOrigin.empty()) this->EndGaussNewton();
+  if (_NormalizeGradients || _Preconditioning > .0) return false;
+
+  const int ndofs = this->NumberOfDOFs();
+  if (ndofs == 0) return false;
+
+  for (size_t i = 0; i < _Term.size(); ++i) {
+    if (_Term[i]->Weight() != .0 && !_Term[i]->BeginGaussNewton()) {
+      for (size_t j = 0; j < i; ++j) _Term[j]->EndGaussNewton();
+      return false;
+    }
+  }
+
+  _GaussNewtonOrigin.resize(ndofs);
+  _Transformation->Get(&_GaussNewtonOrigin[0]);
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+void irtkRegistrationEnergy::GaussNewtonDiagonal(double *diag)
+{
+  memset(diag, 0, this->NumberOfDOFs() * sizeof(double));
+  for (size_t i = 0; i < _Term.size(); ++i) {
+    if (_Term[i]->Weight() != .0) _Term[i]->GaussNewtonDiagonal(diag);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void irtkRegistrationEnergy::GaussNewtonProduct(const double *v, double *Hv)
+{
+  IRTK_START_TIMING();
+
+  const int ndofs = static_cast<int>(_GaussNewtonOrigin.size());
+  memset(Hv, 0, ndofs * sizeof(double));
+
+  // Finite difference step such that the maximum change of a parameter is
+  // small compared to the typical control point spacing, translation, or
+  // rotation angle. The product is exact for energy terms whose residuals
+  // depend linearly on the displacements if these are linear in the DoFs.
+  double norm = .0;
+  for (int dof = 0; dof < ndofs; ++dof) {
+    if (fabs(v[dof]) > norm) norm = fabs(v[dof]);
+  }
+  if (norm == .0) return;
+  const double eps = 1e-3 / norm;
+
+  // Cache change of transformed inputs along given direction
+  vector<double> x(ndofs);
+  for (int dof = 0; dof < ndofs; ++dof) {
+    x[dof] = _GaussNewtonOrigin[dof] + eps * v[dof];
+  }
+  _Transformation->Put(&x[0]);
+  for (size_t i = 0; i < _Term.size(); ++i) {
+    if (_Term[i]->Weight() != .0) _Term[i]->CacheGaussNewtonDirection(eps);
+  }
+
+  // Restore parameters and apply transposed Jacobian of transformation
+  _Transformation->Put(&_GaussNewtonOrigin[0]);
+  _Transformation->Changed(true);
+  for (size_t i = 0; i < _Term.size(); ++i) {
+    if (_Term[i]->Weight() != .0) _Term[i]->GaussNewtonProduct(Hv);
+  }
+
+  IRTK_DEBUG_TIMING(3, "evaluation of Gauss-Newton Hessian product");
+}
+
+// -----------------------------------------------------------------------------
+void irtkRegistrationEnergy::EndGaussNewton()
+{
+  // Energy terms may have updated their internal state for other parameters
+  for (size_t i = 0; i < _Term.size(); ++i) {
+    _Term[i]->EndGaussNewton();
+    _Value[i] = numeric_limits<double>::quiet_NaN();
+  }
+  _GaussNewtonOrigin.clear();
+  _Transformation->Changed(true);
+}
+
 // =============================================================================
 // Evaluation
 // =============================================================================
@@ -100,3 +100,14 @@ void irtkSparsityConstraint::EvaluateGradient(double *gradient, double step, dou
 {
   this->EvaluateGradient(gradient, step, weight, NULL);
 }
+
+// -----------------------------------------------------------------------------
+bool irtkSparsityConstraint::BeginGaussNewton()
+{
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+void irtkSparsityConstraint::CacheGaussNewtonDirection(double)
+{
+}
@@ -69,22 +69,115 @@ struct EvaluateSumOfSquaredDifferences : public irtkVoxelReduction
 };
 
 // -----------------------------------------------------------------------------
-/// Evaluate gradient of sum of squared intensity differences
-struct EvaluateSumOfSquaredDifferencesGradient : public irtkVoxelFunction
+/// Sum the squared intensity differences at the sampled voxels
+struct EvaluateSampledSumOfSquaredDifferences
 {
-  irtkSumOfSquaredIntensityDifferences *_Sim;
+  const irtkSumOfSquaredIntensityDifferences *_Sim;
+  const VoxelType                            *_Target;
+  const VoxelType                            *_Source;
+  double                                      _Sum;
+  int                                         _Cnt;
 
-  EvaluateSumOfSquaredDifferencesGradient(irtkSumOfSquaredIntensityDifferences *sim)
+  EvaluateSampledSumOfSquaredDifferences(const irtkSumOfSquaredIntensityDifferences *sim)
   :
-    _Sim(sim)
+    _Sim(sim), _Target(sim->Target()->Data()), _Source(sim->Source()->Data()), _Sum(.0), _Cnt(0)
   {}
 
-  void operator ()(int i, int j, int k, int, const VoxelType *t, const VoxelType *s, GradientType *g)
+  EvaluateSampledSumOfSquaredDifferences(const EvaluateSampledSumOfSquaredDifferences &lhs, split)
+  :
+    _Sim(lhs._Sim), _Target(lhs._Target), _Source(lhs._Source), _Sum(.0), _Cnt(0)
+  {}
+
+  void join(const EvaluateSampledSumOfSquaredDifferences &rhs)
   {
-    if (_Sim->IsForeground(i, j, k)) {
-      *g = -2.0 * static_cast<double>(*t - *s);
-    } else {
-      *g = .0;
+    _Sum += rhs._Sum;
+    _Cnt += rhs._Cnt;
+  }
+
+  void operator ()(const blocked_range<int> &re)
+  {
+    for (int n = re.begin(); n != re.end(); ++n) {
+      const int idx = _Sim->SampledVoxel(n);
+      if (_Sim->IsForeground(idx)) {
+        _Sum += static_cast<double>(pow(_Target[idx] - _Source[idx], 2));
+        ++_Cnt;
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Evaluate gradient of sum of squared intensity differences at sampled voxels
+struct EvaluateSumOfSquaredDifferencesGradient
+{
+  const irtkSumOfSquaredIntensityDifferences *_Sim;
+  const VoxelType                            *_Fixed;
+  const VoxelType                            *_Moving;
+  GradientType                               *_Gradient;
+  double                                      _Norm;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int n = re.begin(); n != re.end(); ++n) {
+      const int idx = _Sim->SampledVoxel(n);
+      if (_Sim->IsForeground(idx)) {
+        _Gradient[idx] = -2.0 * _Norm * static_cast<double>(_Fixed[idx] - _Moving[idx]);
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Multiply change of displacements by outer product of image gradient
+struct MultiplyByOuterProductOfImageGradient
+{
+  const irtkSumOfSquaredIntensityDifferences *_Sim;
+  const VoxelType                            *_Image;
+  GradientType                               *_Direction;
+  int                                         _NumberOfVoxels;
+  int                                         _dx, _dy, _dz;
+  double                                      _Norm;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int n = re.begin(); n != re.end(); ++n) {
+      const int idx = _Sim->SampledVoxel(n);
+      const VoxelType *I = _Image + idx;
+      GradientType *dx = _Direction + idx, *dy = dx + _NumberOfVoxels, *dz = dy + _NumberOfVoxels;
+      if (_Sim->IsForeground(idx)) {
+        const double s = _Norm * (I[_dx] * (*dx) + I[_dy] * (*dy) + I[_dz] * (*dz));
+        *dx = s * I[_dx], *dy = s * I[_dy], *dz = s * I[_dz];
+      } else {
+        *dx = *dy = *dz = .0;
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Evaluate diagonal of outer product of image gradient
+struct EvaluateSquaredImageGradient
+{
+  const irtkSumOfSquaredIntensityDifferences *_Sim;
+  const VoxelType                            *_Image;
+  GradientType                               *_Diagonal;
+  int                                         _NumberOfVoxels;
+  int                                         _dx, _dy, _dz;
+  double                                      _Norm;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    for (int n = re.begin(); n != re.end(); ++n) {
+      const int idx = _Sim->SampledVoxel(n);
+      const VoxelType *I = _Image + idx;
+      GradientType *dx = _Diagonal + idx, *dy = dx + _NumberOfVoxels, *dz = dy + _NumberOfVoxels;
+      if (_Sim->IsForeground(idx)) {
+        *dx = _Norm * I[_dx] * I[_dx];
+        *dy = _Norm * I[_dy] * I[_dy];
+        *dz = _Norm * I[_dz] * I[_dz];
+      } else {
+        *dx = *dy = *dz = .0;
+      }
     }
   }
 };
@@ -102,7 +195,8 @@ irtkSumOfSquaredIntensityDifferences
 ::irtkSumOfSquaredIntensityDifferences(const char *name)
 :
   irtkImageSimilarity(name),
-  _MaxSqDiff(1.0), _Value(.0), _N(0)
+  _MaxSqDiff(1.0), _Value(.0), _N(0),
+  _GaussNewtonOrigin(NULL), _GaussNewtonDirection(NULL)
 {
 }
 
@@ -111,13 +205,16 @@ irtkSumOfSquaredIntensityDifferences
 ::irtkSumOfSquaredIntensityDifferences(const irtkSumOfSquaredIntensityDifferences &other)
 :
   irtkImageSimilarity(other),
-  _MaxSqDiff(other._MaxSqDiff), _Value(other._Value), _N(other._N)
+  _MaxSqDiff(other._MaxSqDiff), _Value(other._Value), _N(other._N),
+  _GaussNewtonOrigin(NULL), _GaussNewtonDirection(NULL)
 {
 }
 
 // -----------------------------------------------------------------------------
 irtkSumOfSquaredIntensityDifferences::~irtkSumOfSquaredIntensityDifferences()
 {
+  Delete(_GaussNewtonOrigin);
+  Delete(_GaussNewtonDirection);
 }
 
 // =============================================================================
@@ -149,9 +246,9 @@ void irtkSumOfSquaredIntensityDifferences::Update(bool gradient)
 {
   // Upate base class and moving image(s)
   irtkImageSimilarity::Update(gradient);
-  // Evaluate sum of squared differences over all voxels
-  EvaluateSumOfSquaredDifferences ssd(this);
-  ParallelForEachVoxel(_Domain, _Target, _Source, ssd);
+  // Evaluate sum of squared differences at all (sampled) voxels
+  EvaluateSampledSumOfSquaredDifferences ssd(this);
+  parallel_reduce(blocked_range<int>(0, NumberOfSampledVoxels()), ssd);
   _Value = ssd._Sum, _N = ssd._Cnt;
 }
 
@@ -182,11 +279,119 @@ bool irtkSumOfSquaredIntensityDifferences
 ::NonParametricGradient(const irtkRegisteredImage *image, GradientImageType *gradient)
 {
   // Compute gradient of similarity w.r.t given moving image
-  EvaluateSumOfSquaredDifferencesGradient eval(this);
-  ParallelForEachVoxel(_Domain, (image == Target() ? Source() : Target()), image, gradient, eval);
-  if (_N > 0) *gradient /= _N * _MaxSqDiff;
+  memset(gradient->Data(), 0, _NumberOfVoxels * sizeof(GradientType));
+  EvaluateSumOfSquaredDifferencesGradient eval;
+  eval._Sim      = this;
+  eval._Fixed    = (image == Target() ? Source() : Target())->Data();
+  eval._Moving   = image->Data();
+  eval._Gradient = gradient->Data();
+  eval._Norm     = (_N > 0 ? 1.0 / (_N * _MaxSqDiff) : 1.0);
+  parallel_for(blocked_range<int>(0, NumberOfSampledVoxels()), eval);
 
   // Apply chain rule to obtain gradient w.r.t y = T(x)
   MultiplyByImageGradient(image, gradient);
   return true;
 }
+
+// =============================================================================
+// Gauss-Newton approximation
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+irtkRegisteredImage *irtkSumOfSquaredIntensityDifferences::GaussNewtonImage() const
+{
+  if (_Target->Transformation() && _Source->Transformation()) return NULL;
+  if (_Source->Transformation()) return _Source;
+  if (_Target->Transformation()) return _Target;
+  return NULL;
+}
+
+// -----------------------------------------------------------------------------
+bool irtkSumOfSquaredIntensityDifferences::BeginGaussNewton()
+{
+  irtkRegisteredImage *image = GaussNewtonImage();
+  if (!image) return false;
+
+  // Compute displacements for current transformation parameters
+  if (!_GaussNewtonOrigin) _GaussNewtonOrigin = new GradientImageType();
+  _GaussNewtonOrigin->Initialize(_Domain, 3);
+  image->Transformation()->Displacement(*_GaussNewtonOrigin,
+                                        image->InputImage()->GetTOrigin(),
+                                        image->GetTOrigin(), image->ImageToWorld());
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+void irtkSumOfSquaredIntensityDifferences::CacheGaussNewtonDirection(double eps)
+{
+  if (!_GaussNewtonOrigin) return;
+  irtkRegisteredImage *image = GaussNewtonImage();
+
+  // Compute displacements for parameters advanced along direction
+  if (!_GaussNewtonDirection) _GaussNewtonDirection = new GradientImageType();
+  _GaussNewtonDirection->Initialize(_Domain, 3);
+  image->Transformation()->Displacement(*_GaussNewtonDirection,
+                                        image->InputImage()->GetTOrigin(),
+                                        image->GetTOrigin(), image->ImageToWorld());
+
+  // Subtract displacements at parameters of Gauss-Newton approximation
+  const int n = _GaussNewtonDirection->GetNumberOfVoxels();
+  const GradientType *d0 = _GaussNewtonOrigin->Data();
+  GradientType       *dd = _GaussNewtonDirection->Data();
+  for (int idx = 0; idx < n; ++idx, ++d0, ++dd) *dd = (*dd - *d0) / eps;
+}
+
+// -----------------------------------------------------------------------------
+void irtkSumOfSquaredIntensityDifferences::EvaluateGaussNewtonDiagonal(double *diag, double weight)
+{
+  irtkRegisteredImage *image = GaussNewtonImage();
+  if (!image || _N == 0) return;
+
+  // Diagonal of outer product of image gradient at each voxel. The parametric
+  // gradient of this field is the row sum of the Hessian w.r.t. the control
+  // points of a FFD whose basis functions are non-negative and sum to one.
+  if (!_GaussNewtonDirection) _GaussNewtonDirection = new GradientImageType();
+  _GaussNewtonDirection->Initialize(_Domain, 3);
+
+  EvaluateSquaredImageGradient eval;
+  eval._Sim            = this;
+  eval._Image          = image->Data();
+  eval._Diagonal       = _GaussNewtonDirection->Data();
+  eval._NumberOfVoxels = image->NumberOfVoxels();
+  eval._dx             = image->Offset(irtkRegisteredImage::Dx);
+  eval._dy             = image->Offset(irtkRegisteredImage::Dy);
+  eval._dz             = image->Offset(irtkRegisteredImage::Dz);
+  eval._Norm           = 2.0 / (_N * _MaxSqDiff);
+  parallel_for(blocked_range<int>(0, NumberOfSampledVoxels()), eval);
+
+  this->ParametricGradient(image, _GaussNewtonDirection, diag, weight);
+}
+
+// -----------------------------------------------------------------------------
+void irtkSumOfSquaredIntensityDifferences::EvaluateGaussNewtonProduct(double *Hv, double weight)
+{
+  irtkRegisteredImage *image = GaussNewtonImage();
+  if (!image || !_GaussNewtonDirection || _N == 0) return;
+
+  // Multiply change of displacements by Hessian w.r.t. displacements
+  MultiplyByOuterProductOfImageGradient mul;
+  mul._Sim            = this;
+  mul._Image          = image->Data();
+  mul._Direction      = _GaussNewtonDirection->Data();
+  mul._NumberOfVoxels = image->NumberOfVoxels();
+  mul._dx             = image->Offset(irtkRegisteredImage::Dx);
+  mul._dy             = image->Offset(irtkRegisteredImage::Dy);
+  mul._dz             = image->Offset(irtkRegisteredImage::Dz);
+  mul._Norm           = 2.0 / (_N * _MaxSqDiff);
+  parallel_for(blocked_range<int>(0, NumberOfSampledVoxels()), mul);
+
+  // Apply transposed Jacobian of transformation
+  this->ParametricGradient(image, _GaussNewtonDirection, Hv, weight);
+}
+
+// -----------------------------------------------------------------------------
+void irtkSumOfSquaredIntensityDifferences::EndGaussNewton()
+{
+  Delete(_GaussNewtonOrigin);
+  Delete(_GaussNewtonDirection);
+}
@@ -17,45 +17,124 @@
 #include <irtkTopologyPreservationConstraint.h>
 
 
+// =============================================================================
+// Auxiliaries
+// =============================================================================
+
+namespace irtkTopologyPreservationConstraintUtils {
+
+
+// -----------------------------------------------------------------------------
+/// Body of Evaluate function for parallel execution
+struct irtkTopologyPreservationConstraintEvaluate
+{
+private:
+
+  const irtkTopologyPreservationConstraint *_This;
+  const irtkFreeFormTransformation         *_FFD;
+  const double                             *_DetJacobian;
+  double                                    _Penalty;
+  int                                       _N;
+
+public:
+
+  irtkTopologyPreservationConstraintEvaluate() {}
+
+  irtkTopologyPreservationConstraintEvaluate(irtkTopologyPreservationConstraintEvaluate &lhs, split)
+  :
+    _This(lhs._This),
+    _FFD(lhs._FFD),
+    _DetJacobian(lhs._DetJacobian),
+    _Penalty(.0), _N(0)
+  {}
+
+  void join(irtkTopologyPreservationConstraintEvaluate &rhs)
+  {
+    _Penalty += rhs._Penalty;
+    _N       += rhs._N;
+  }
+
+  void operator()(const blocked_range<int> &re)
+  {
+    int    i, j, k, l;
+    double det;
+    for (int n = re.begin(); n != re.end(); ++n) {
+      if (!_This->ConstrainPassiveDoFs()) {
+        _This->SampleToLattice(_FFD, n, i, j, k, l);
+        if (i < 0 || j < 0 || k < 0 || l < 0 || !_FFD->IsActive(i, j, k, l)) continue;
+      }
+      det = _DetJacobian[n];
+      if (det < 0.3) {
+        // 10 * det(J)^2 + 1 / (10 * det(J)^2) - 2
+        det      *= 10.0 * det;
+        _Penalty += det + 1.0 / det - 2.0;
+      }
+      ++_N;
+    }
+  }
+
+  static void Run(const irtkTopologyPreservationConstraint *obj,
+                  const irtkFreeFormTransformation         *ffd,
+                  const double                             *det,
+                  double                                   &penalty,
+                  int                                      &num)
+  {
+    irtkTopologyPreservationConstraintEvaluate body;
+    body._This        = obj;
+    body._FFD         = ffd;
+    body._DetJacobian = det;
+    body._Penalty     = .0;
+    body._N           = 0;
+    parallel_reduce(blocked_range<int>(0, obj->NumberOfSamples(ffd)), body);
+    penalty += body._Penalty;
+    num     += body._N;
+  }
+};
+
+
+} // namespace irtkTopologyPreservationConstraintUtils
+using namespace irtkTopologyPreservationConstraintUtils;
+
+// =============================================================================
+// Construction/destruction
+// =============================================================================
+
 // -----------------------------------------------------------------------------
 irtkTopologyPreservationConstraint::irtkTopologyPreservationConstraint(const char *name)
 :
-  irtkTransformationConstraint(name)
+  irtkJacobianConstraint(name, true)
 {
   _ConstrainPassiveDoFs = true;
 }
 
+// =============================================================================
+// Evaluation
+// =============================================================================
+
 // -----------------------------------------------------------------------------
 double irtkTopologyPreservationConstraint::Evaluate()
 {
-  const irtkFreeFormTransformation *ffd = FFD();
-  if (!ffd) return .0; // No penalty for non-deformable transformation
+  typedef irtkTopologyPreservationConstraintEvaluate Body;
+
+  const irtkMultiLevelTransformation *mffd = NULL;
+  const irtkFreeFormTransformation   *ffd  = NULL;
+
+  (mffd = MFFD()) || (ffd = FFD());
 
   double penalty = .0;
   int    nactive = 0;
 
-  double x, y, z, det;
-  for (int l = -1; l < ffd->T(); ++l) {
-    for (int k = -1; k < ffd->Z(); ++k) {
-      for (int j = -1; j < ffd->Y(); ++j) {
-        for (int i = -1; i < ffd->X(); ++i) {
-          if (_ConstrainPassiveDoFs ||
-              (i >= 0 && j >= 0 && k >= 0 && l >= 0 && ffd->IsActive(i, j, k, l))) {
-            x = i + 0.5;
-            y = j + 0.5;
-            z = k + 0.5;
-            ffd->LatticeToWorld(x, y, z);
-            det = ffd->LocalJacobian(x, y, z, ffd->LatticeToTime(l + 0.5));
-            if (det < 0.3) {
-              // 10 * det(J)^2 + 1 / (10 * det(J)^2) - 2
-              det     *= 10.0 * det;
-              penalty += det + 1.0 / det - 2.0;
-            }
-            ++nactive;
-          }
-        }
+  if (mffd) {
+    const double *det = _DetJacobian;
+    for (int n = 0; n < mffd->NumberOfLevels(); ++n) {
+      if (mffd->LocalTransformationIsActive(n)) {
+        ffd = mffd->GetLocalTransformation(n);
+        Body::Run(this, ffd, det, penalty, nactive);
+        det += NumberOfSamples(ffd);
       }
     }
+  } else if (ffd) {
+    Body::Run(this, ffd, _DetJacobian, penalty, nactive);
   }
 
   if (nactive) penalty /= nactive;
@@ -107,3 +107,48 @@ irtkParameterList irtkTransformationConstraint::Parameter() const
   }
   return params;
 }
+
+// =============================================================================
+// Gauss-Newton approximation
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+bool irtkTransformationConstraint::BeginGaussNewton()
+{
+  _GaussNewtonGradient.assign(_Transformation->NumberOfDOFs(), .0);
+  _GaussNewtonDirection.clear();
+  if (!_GaussNewtonGradient.empty()) {
+    this->EvaluateGradient(&_GaussNewtonGradient[0], .0, 1.0);
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+void irtkTransformationConstraint::CacheGaussNewtonDirection(double eps)
+{
+  const int ndofs = static_cast<int>(_GaussNewtonGradient.size());
+  if (ndofs == 0) return;
+  this->Update(true);
+  _GaussNewtonDirection.assign(ndofs, .0);
+  this->EvaluateGradient(&_GaussNewtonDirection[0], .0, 1.0);
+  for (int dof = 0; dof < ndofs; ++dof) {
+    _GaussNewtonDirection[dof] -= _GaussNewtonGradient[dof];
+    _GaussNewtonDirection[dof] /= eps;
+  }
+}
+
+// -----------------------------------------------------------------------------
+void irtkTransformationConstraint::EvaluateGaussNewtonProduct(double *Hv, double weight)
+{
+  const int ndofs = static_cast<int>(_GaussNewtonDirection.size());
+  for (int dof = 0; dof < ndofs; ++dof) {
+    Hv[dof] += weight * _GaussNewtonDirection[dof];
+  }
+}
+
+// -----------------------------------------------------------------------------
+void irtkTransformationConstraint::EndGaussNewton()
+{
+  _GaussNewtonGradient .clear();
+  _GaussNewtonDirection.clear();
+}
@@ -233,9 +233,42 @@ public:
   // ---------------------------------------------------------------------------
   // Point transformation
 
+  using irtkFreeFormTransformation3D::Displacement;
+
+  /// Whether the displacements are an affine function of the parameters
+  virtual bool DisplacementIsLinearInDOFs() const;
+
   /// Transforms a single point using the local transformation component only
   virtual void LocalTransform(double &, double &, double &, double = 0, double = -1) const;
 
+  /// Calculates the displacement vectors for a whole image domain
+  ///
+  /// When the image lattice is aligned with the control point lattice, the
+  /// tensor product B-spline is evaluated separably for all voxels at which
+  /// the input displacement is zero.
+  ///
+  /// \attention The displacements are computed at the positions after applying the
+  ///            current displacements at each voxel. These displacements are then
+  ///            added to the current displacements. Therefore, set the input
+  ///            displacements to zero if only interested in the displacements of
+  ///            this transformation at the voxel positions.
+  virtual void Displacement(irtkGenericImage<double> &, double, double,
+                            const irtkWorldCoordsImage * = NULL) const;
+
+  /// Calculates the displacement vectors for a whole image domain
+  ///
+  /// When the image lattice is aligned with the control point lattice, the
+  /// tensor product B-spline is evaluated separably for all voxels at which
+  /// the input displacement is zero.
+  ///
+  /// \attention The displacements are computed at the positions after applying the
+  ///            current displacements at each voxel. These displacements are then
+  ///            added to the current displacements. Therefore, set the input
+  ///            displacements to zero if only interested in the displacements of
+  ///            this transformation at the voxel positions.
+  virtual void Displacement(irtkGenericImage<float> &, double, double,
+                            const irtkWorldCoordsImage * = NULL) const;
+
   /// Whether this transformation implements a more efficient update of a given
   /// displacement field given the desired change of a transformation parameter
   virtual bool CanModifyDisplacement(int = -1) const;
@@ -475,6 +508,12 @@ inline void irtkBSplineFreeFormTransformation3D
 // Point transformation
 // =============================================================================
 
+// -----------------------------------------------------------------------------
+inline bool irtkBSplineFreeFormTransformation3D::DisplacementIsLinearInDOFs() const
+{
+  return true;
+}
+
 // -----------------------------------------------------------------------------
 inline void irtkBSplineFreeFormTransformation3D
 ::LocalTransform(double &x, double &y, double &z, double, double) const
@@ -206,6 +206,9 @@ public:
   /// Transforms a single point using the local transformation component only
   virtual void LocalTransform(double &, double &, double &, double, double = -1) const;
 
+  /// Whether the displacements are an affine function of the parameters
+  virtual bool DisplacementIsLinearInDOFs() const;
+
   // ---------------------------------------------------------------------------
   // Derivatives
 
@@ -383,6 +386,12 @@ inline void irtkBSplineFreeFormTransformation4D
 // Point transformation
 // =============================================================================
 
+// -----------------------------------------------------------------------------
+inline bool irtkBSplineFreeFormTransformation4D::DisplacementIsLinearInDOFs() const
+{
+  return true;
+}
+
 // -----------------------------------------------------------------------------
 inline void irtkBSplineFreeFormTransformation4D
 ::LocalTransform(double &x, double &y, double &z, double t, double) const
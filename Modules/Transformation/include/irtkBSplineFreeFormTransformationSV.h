@@ -311,6 +311,9 @@ public:
   /// for the scaling and squaring method.
   virtual bool RequiresCachingOfDisplacements() const;
 
+  /// Whether the displacements are an affine function of the parameters
+  virtual bool DisplacementIsLinearInDOFs() const;
+
   /// Transforms a single point using the local transformation component only
   virtual void LocalTransform(double &, double &, double &, double = 0, double = -1) const;
 
@@ -713,6 +716,13 @@ inline bool irtkBSplineFreeFormTransformationSV::RequiresCachingOfDisplacements(
   return (_IntegrationMethod == FFDIM_SS || _IntegrationMethod == FFDIM_FastSS);
 }
 
+// -----------------------------------------------------------------------------
+inline bool irtkBSplineFreeFormTransformationSV::DisplacementIsLinearInDOFs() const
+{
+  // Displacements are obtained by exponentiation of the velocity field
+  return false;
+}
+
 // -----------------------------------------------------------------------------
 inline double irtkBSplineFreeFormTransformationSV::UpperIntegrationLimit(double t, double t0) const
 {
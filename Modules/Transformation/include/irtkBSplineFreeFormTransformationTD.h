@@ -132,6 +132,9 @@ public:
   /// Transforms a single point using the inverse transformation
   virtual bool LocalInverse(double &, double &, double &, double, double) const;
 
+  /// Whether the displacements are an affine function of the parameters
+  virtual bool DisplacementIsLinearInDOFs() const;
+
   /// Calculates the displacement vectors for a whole image domain
   ///
   /// \attention The displacements are computed at the positions after applying the
@@ -235,6 +238,13 @@ public:
 // Point transformation
 // =============================================================================
 
+// -----------------------------------------------------------------------------
+inline bool irtkBSplineFreeFormTransformationTD::DisplacementIsLinearInDOFs() const
+{
+  // Displacements are obtained by integration of the velocity field
+  return false;
+}
+
 // -----------------------------------------------------------------------------
 inline bool irtkBSplineFreeFormTransformationTD
 ::LocalInverse(double &x, double &y, double &z, double t, double t0) const
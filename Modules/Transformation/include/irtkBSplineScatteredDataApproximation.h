@@ -0,0 +1,90 @@
+/* The Image Registration Toolkit (IRTK)
+ *
+ * Copyright 2008-2015 Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#ifndef _IRTKBSPLINESCATTEREDDATAAPPROXIMATION_H
+#define _IRTKBSPLINESCATTEREDDATAAPPROXIMATION_H
+
+#include <irtkFreeFormTransformation.h>
+
+
+/**
+ * Parallel approximation of scattered displacements by cubic B-spline FFD
+ *
+ * Implements the scattered data approximation of Lee et al. (1997) used by
+ * ApproximateDOFs and ApproximateDOFsGradient of the cubic B-spline FFDs.
+ * The points are binned by the lattice cell which determines the 4^d control
+ * points in the support of the B-spline kernel at each point. Cells whose
+ * indices are congruent modulo 4 along each lattice dimension have disjoint
+ * supports. The cells of each such colour are therefore processed in parallel
+ * and add their contributions to the shared control point sums without
+ * atomics or per-thread copies. The order of summation does not depend on
+ * the number of threads. The normalization factor of each point, i.e., the
+ * sum of its squared kernel weights, is the product of the sums of squared
+ * weights along each dimension, which are precomputed for each entry of the
+ * B-spline lookup table.
+ */
+class irtkBSplineScatteredDataApproximation
+{
+public:
+
+  typedef irtkFreeFormTransformation::Vector Vector;
+
+  /// Constructor
+  ///
+  /// \param[in] ffd Free-form transformation defining the control point lattice.
+  /// \param[in] dim Number of lattice dimensions, i.e., 2, 3, or 4. The z
+  ///                coordinates are ignored in 2D, and the time in 2D and 3D.
+  irtkBSplineScatteredDataApproximation(const irtkFreeFormTransformation *ffd, int dim);
+
+  /// Bin scattered points by lattice cell
+  ///
+  /// \param[in] wx        World x coordinates of points.
+  /// \param[in] wy        World y coordinates of points.
+  /// \param[in] wz        World z coordinates of points.
+  /// \param[in] wt        Time of points (4D only, may be NULL otherwise).
+  /// \param[in] dx        Displacements along x, which are not copied.
+  /// \param[in] dy        Displacements along y, which are not copied.
+  /// \param[in] dz        Displacements along z, which are not copied.
+  /// \param[in] no        Number of points.
+  /// \param[in] skip_zero Whether to ignore points with zero displacement.
+  void Initialize(const double *wx, const double *wy, const double *wz, const double *wt,
+                  const double *dx, const double *dy, const double *dz, int no,
+                  bool skip_zero = false);
+
+  /// Set control point values to the approximation of the displacements
+  void Approximate(Vector *) const;
+
+  /// Set control point values to the sum of the displacements weighted by
+  /// the B-spline kernel centered at each control point
+  void Accumulate(Vector *) const;
+
+private:
+
+  /// Add weighted displacements of all points to control point sums
+  void Accumulate(Vector *, double *) const;
+
+  const irtkFreeFormTransformation *_FFD;   ///< Control point lattice
+  int           _Dimension;                 ///< Number of lattice dimensions
+  int           _Size[4];                   ///< Lattice size
+  int           _Cells[4];                  ///< Size of cell grid
+  const double *_DX, *_DY, *_DZ;            ///< Scattered displacements
+  vector<int>   _Index;                     ///< Lookup table indices of points
+  vector<int>   _Order;                     ///< Points sorted by cell
+  vector<int>   _Offset;                    ///< Offset of first point of cell
+};
+
+
+#endif
@@ -79,6 +79,9 @@ public:
   /// Returns the number of DOFs (rows of _ShapeVector)
   virtual int NumberOfDOFs() const;
 
+  /// Whether the displacements are an affine function of the parameters
+  virtual bool DisplacementIsLinearInDOFs() const;
+
   /// Puts a shape parameter
   virtual void Put(int, double);
 
@@ -136,6 +139,13 @@ inline int irtkEigenFreeFormTransformation::NumberOfDOFs() const
   return _ShapeVector.Rows();
 }
 
+// -----------------------------------------------------------------------------
+inline bool irtkEigenFreeFormTransformation::DisplacementIsLinearInDOFs() const
+{
+  // Shape parameters are not interchangeable with control point displacements
+  return false;
+}
+
 // -----------------------------------------------------------------------------
 inline double irtkEigenFreeFormTransformation::Get(int index) const
 {
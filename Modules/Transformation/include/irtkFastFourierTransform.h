@@ -0,0 +1,207 @@
+/* The Image Registration Toolkit (IRTK)
+ *
+ * Copyright 2008-2015 Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#ifndef _IRTKFASTFOURIERTRANSFORM_H
+#define _IRTKFASTFOURIERTRANSFORM_H
+
+#include <irtkCommon.h>
+#include <irtkImage.h>
+
+
+/**
+ * Plan of one-dimensional complex discrete Fourier transform
+ *
+ * A plan factorizes the transform length into radix-4, radix-2, and other
+ * small prime factors which are processed by the stages of a self-sorting
+ * (Stockham) mixed-radix FFT. The twiddle factors of each stage are
+ * pre-computed upon construction. Lengths with a prime factor greater than
+ * MaxRadix are instead transformed using Bluestein's algorithm, i.e., as
+ * convolution with a chirp evaluated by FFTs whose length is a power of two.
+ * Plans are thus available for any length and are cached by Instance such
+ * that subsequent transforms of the same length reuse them.
+ *
+ * The transform is applied to a batch of BatchSize lines at once. These are
+ * stored interleaved in separate arrays of real and imaginary parts, i.e.,
+ * the k-th sample of line b at index k * BatchSize + b. The innermost loops
+ * of the butterflies thereby run over consecutive memory of independent
+ * lines, which allows the compiler to vectorize them.
+ *
+ * The transform computes X[k] = sum_j x[j] exp(sign * 2 pi i j k / n) and
+ * is not normalized.
+ */
+class irtkFFTPlan
+{
+public:
+
+  /// Number of lines transformed at once
+  static const int BatchSize = 4;
+
+  /// Maximum prime factor transformed by a mixed-radix stage
+  static const int MaxRadix = 31;
+
+  // ---------------------------------------------------------------------------
+  // Construction/Destruction
+
+  /// Get shared plan for transforms of given length
+  static const irtkFFTPlan *Instance(int n);
+
+  /// Destructor
+  ~irtkFFTPlan();
+
+private:
+
+  /// Constructor
+  irtkFFTPlan(int n);
+
+  /// Copy constructor
+  /// \note Intentionally not implemented
+  irtkFFTPlan(const irtkFFTPlan &);
+
+  /// Assignment operator
+  /// \note Intentionally not implemented
+  void operator =(const irtkFFTPlan &);
+
+  // ---------------------------------------------------------------------------
+  // Transform
+public:
+
+  /// Length of transform
+  int Size() const;
+
+  /// Required number of elements of each work buffer passed to Transform
+  int WorkSize() const;
+
+  /// Transform batch of interleaved lines in place
+  ///
+  /// \param[in,out] re   Real parts of Size() * BatchSize interleaved samples.
+  /// \param[in,out] im   Imaginary parts of interleaved samples.
+  /// \param[in]     sign Sign of exponent, i.e., +1 or -1.
+  /// \param[in]     wre  Work buffer of size WorkSize().
+  /// \param[in]     wim  Work buffer of size WorkSize().
+  void Transform(double *re, double *im, int sign, double *wre, double *wim) const;
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+private:
+
+  /// Mixed-radix stage
+  struct Stage
+  {
+    int            _Radix;     ///< Radix of butterflies
+    int            _Span;      ///< Product of radices of previous stages
+    vector<double> _TwiddleRe; ///< Real part of twiddle factors
+    vector<double> _TwiddleIm; ///< Imaginary part of twiddle factors
+    vector<double> _RootRe;    ///< Real part of roots of unity of generic radix
+    vector<double> _RootIm;    ///< Imaginary part of roots of unity of generic radix
+  };
+
+  /// Length of transform
+  int _Size;
+
+  /// Stages of mixed-radix FFT
+  vector<Stage> _Stages;
+
+  /// Power of two FFT used to evaluate Bluestein's convolution or NULL
+  irtkFFTPlan *_Convolution;
+
+  /// Real part of Bluestein chirp exp(i pi k^2 / n)
+  vector<double> _ChirpRe;
+
+  /// Imaginary part of Bluestein chirp exp(i pi k^2 / n)
+  vector<double> _ChirpIm;
+
+  /// Real part of normalized FFT of conjugate chirp for sign +1 and -1
+  vector<double> _KernelRe[2];
+
+  /// Imaginary part of normalized FFT of conjugate chirp for sign +1 and -1
+  vector<double> _KernelIm[2];
+
+  // ---------------------------------------------------------------------------
+  // Auxiliary functions
+
+  /// Execute mixed-radix stages
+  void Stockham(double *, double *, int, double *, double *) const;
+
+  /// Execute Bluestein's algorithm
+  void Bluestein(double *, double *, int, double *, double *) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+////////////////////////////////////////////////////////////////////////////////
+
+// -----------------------------------------------------------------------------
+inline int irtkFFTPlan::Size() const
+{
+  return _Size;
+}
+
+// -----------------------------------------------------------------------------
+inline int irtkFFTPlan::WorkSize() const
+{
+  if (_Convolution) return 2 * _Convolution->Size() * BatchSize;
+  return _Size * BatchSize;
+}
+
+
+/**
+ * Multi-threaded discrete Fourier transform of 2D/3D images
+ *
+ * The image is transformed along each dimension using the cached irtkFFTPlan
+ * of the respective length, where batches of lines are processed in parallel.
+ * The image size is not restricted to powers of two. Both the forward and the
+ * inverse transform are normalized by 1/sqrt(n) along each dimension, i.e.,
+ * the transform is unitary.
+ *
+ * Besides the transform of complex images given by separate real and
+ * imaginary parts, the transform of a real image is computed only for the
+ * non-redundant half of its Hermitian symmetric spectrum, i.e., for the
+ * frequencies k = 0, ..., nx/2 along the x axis. Pairs of real lines are
+ * transformed by one complex FFT of the same length.
+ */
+class irtkFastFourierTransform
+{
+public:
+
+  /// Transform complex image in place
+  ///
+  /// \param[in,out] re   Real part of image.
+  /// \param[in,out] im   Imaginary part of image.
+  /// \param[in]     sign Sign of exponent, i.e., +1 or -1.
+  static void Transform(irtkGenericImage<float> *re, irtkGenericImage<float> *im, int sign);
+
+  /// Transform real image to non-redundant half of its spectrum
+  ///
+  /// \param[in]  image Real image of size nx x ny x nz.
+  /// \param[out] re    Real part of spectrum of size (nx/2+1) x ny x nz.
+  /// \param[out] im    Imaginary part of spectrum of size (nx/2+1) x ny x nz.
+  /// \param[in]  sign  Sign of exponent, i.e., +1 or -1.
+  static void TransformReal(const irtkGenericImage<float> *image,
+                            vector<float> &re, vector<float> &im, int sign);
+
+  /// Inverse of TransformReal
+  ///
+  /// \param[in,out] re    Real part of spectrum of size (nx/2+1) x ny x nz.
+  ///                      Overwritten by intermediate results.
+  /// \param[in,out] im    Imaginary part of spectrum. Overwritten as well.
+  /// \param[out]    image Real image of size nx x ny x nz.
+  /// \param[in]     sign  Sign of exponent of inverse transform.
+  static void InverseReal(vector<float> &re, vector<float> &im,
+                          irtkGenericImage<float> *image, int sign);
+};
+
+
+#endif
@@ -585,6 +585,11 @@ public:
   /// Transforms a single point using the inverse of the transformation
   virtual bool Inverse(double &, double &, double &, double = 0, double = -1) const;
 
+  /// Sort points by control point lattice cell such that the points which
+  /// depend on the same control points are processed by the same thread
+  virtual bool OrderPoints(int, const double *, const double *, const double *,
+                           vector<int> &) const;
+
   // ---------------------------------------------------------------------------
   // Derivatives
   using irtkTransformation::Jacobian;
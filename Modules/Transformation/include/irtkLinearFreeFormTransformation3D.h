@@ -131,6 +131,9 @@ public:
   /// Transforms a single point using the inverse of the local transformation only
   virtual bool LocalInverse(double &, double &, double &, double = 0, double = -1) const;
 
+  /// Whether the displacements are an affine function of the parameters
+  virtual bool DisplacementIsLinearInDOFs() const;
+
   // ---------------------------------------------------------------------------
   // Derivatives
   using irtkFreeFormTransformation3D::LocalJacobian;
@@ -212,6 +215,12 @@ inline void irtkLinearFreeFormTransformation3D
 // Point transformation
 // =============================================================================
 
+// -----------------------------------------------------------------------------
+inline bool irtkLinearFreeFormTransformation3D::DisplacementIsLinearInDOFs() const
+{
+  return true;
+}
+
 // -----------------------------------------------------------------------------
 inline void irtkLinearFreeFormTransformation3D
 ::LocalTransform(double &x, double &y, double &z, double, double) const
@@ -141,6 +141,9 @@ public:
   /// Transforms a single point using the inverse of the local transformation only
   virtual bool LocalInverse(double &, double &, double &, double, double = 1) const;
 
+  /// Whether the displacements are an affine function of the parameters
+  virtual bool DisplacementIsLinearInDOFs() const;
+
   // ---------------------------------------------------------------------------
   // Derivatives
 
@@ -214,6 +217,12 @@ inline void irtkLinearFreeFormTransformation4D
 // Point transformation
 // =============================================================================
 
+// -----------------------------------------------------------------------------
+inline bool irtkLinearFreeFormTransformation4D::DisplacementIsLinearInDOFs() const
+{
+  return true;
+}
+
 // -----------------------------------------------------------------------------
 inline void irtkLinearFreeFormTransformation4D
 ::LocalTransform(double &x, double &y, double &z, double t, double) const
@@ -120,6 +120,9 @@ public:
   /// Transforms a single point using the inverse transformation
   virtual bool LocalInverse(double &, double &, double &, double, double) const;
 
+  /// Whether the displacements are an affine function of the parameters
+  virtual bool DisplacementIsLinearInDOFs() const;
+
   // ---------------------------------------------------------------------------
   // I/O
 
@@ -147,6 +150,13 @@ protected:
 // Point transformation
 // =============================================================================
 
+// -----------------------------------------------------------------------------
+inline bool irtkLinearFreeFormTransformationTD::DisplacementIsLinearInDOFs() const
+{
+  // Displacements are obtained by integration of the velocity field
+  return false;
+}
+
 // -----------------------------------------------------------------------------
 inline void irtkLinearFreeFormTransformationTD::LocalTransform(double &x, double &y, double &z, double t1, double t2) const
 {
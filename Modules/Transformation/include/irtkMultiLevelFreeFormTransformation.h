@@ -157,6 +157,9 @@ public:
   using irtkMultiLevelTransformation::Displacement;
   using irtkMultiLevelTransformation::InverseDisplacement;
 
+  /// Whether the displacements are an affine function of the parameters
+  virtual bool DisplacementIsLinearInDOFs() const;
+
   /// Transforms a single point using the local transformation component only
   virtual void LocalTransform(int, int, double &, double &, double &, double = 0, double = -1) const;
 
@@ -282,6 +285,22 @@ public:
 // Inline definitions
 ////////////////////////////////////////////////////////////////////////////////
 
+// =============================================================================
+// Point transformation
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+inline bool irtkMultiLevelFreeFormTransformation::DisplacementIsLinearInDOFs() const
+{
+  // Displacements of the additive levels are summed up, where only the
+  // parameters of the active levels are the DoFs of the transformation
+  for (int l = 0; l < this->NumberOfLevels(); ++l) {
+    if (!this->LocalTransformationIsActive(l)) continue;
+    if (!this->GetLocalTransformation(l)->DisplacementIsLinearInDOFs()) return false;
+  }
+  return true;
+}
+
 // =============================================================================
 // Bounding box
 // =============================================================================
@@ -341,6 +341,10 @@ public:
   /// Transforms a set of points
   virtual void Transform(int, irtkPointSet &, double = 0, double = -1) const;
 
+  /// Sort points by lattice cell of finest local transformation level
+  virtual bool OrderPoints(int, const double *, const double *, const double *,
+                           vector<int> &) const;
+
   /// Calculates the displacement of a single point using the local transformation component only
   virtual void LocalDisplacement(int, int, double &, double &, double &, double = 0, double = -1) const;
 
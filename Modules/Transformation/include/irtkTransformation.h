@@ -48,6 +48,7 @@
 enum irtkTransformationType
 {
   IRTKTRANSFORMATION_MAGIC                           = 815007,
+  IRTKTRANSFORMATION_CONTAINER_MAGIC                 = 815009,
   IRTKTRANSFORMATION_UNKNOWN                         =      0,
   // linear transformations
   IRTKTRANSFORMATION_HOMOGENEOUS                     =      1,
@@ -410,6 +411,15 @@ public:
   /// for the scaling and squaring method.
   virtual bool RequiresCachingOfDisplacements() const;
 
+  /// Whether the displacements are an affine function of the parameters
+  ///
+  /// If so, the displacement of any point after a change of the parameters by
+  /// alpha * dx equals its current displacement plus alpha times the change of
+  /// the displacement due to dx. A line search can thus evaluate its trial steps
+  /// by interpolating between two cached displacement fields instead of
+  /// re-evaluating the transformation (cf. irtkRegisteredImage::BeginLineSearch).
+  virtual bool DisplacementIsLinearInDOFs() const;
+
   /// Transforms a single point using the global transformation component only
   virtual void GlobalTransform(double &, double &, double &, double = 0, double = -1) const = 0;
 
@@ -431,6 +441,21 @@ public:
   /// Transforms a set of points
   virtual void Transform(int, double *, double *, double *, const double *, double = -1) const;
 
+  /// Determine order in which to process a set of points for locality of memory access
+  ///
+  /// Used by the batched point transformation functions. The default implementation
+  /// keeps the given order. FFDs sort the points by control point lattice cell.
+  ///
+  /// \param[in]  no    Number of points.
+  /// \param[in]  x     World x coordinates of points.
+  /// \param[in]  y     World y coordinates of points.
+  /// \param[in]  z     World z coordinates of points.
+  /// \param[out] order Indices of points in the order in which to process them.
+  ///
+  /// \returns Whether the points should be processed in the returned order.
+  virtual bool OrderPoints(int no, const double *x, const double *y, const double *z,
+                           vector<int> &order) const;
+
   /// Transforms world coordinates of image voxels
   virtual void Transform(irtkWorldCoordsImage &, double = -1) const;
 
@@ -510,6 +535,11 @@ public:
   /// \returns Number of points at which transformation is non-invertible.
   virtual int Inverse(irtkPointSet &, double = 0, double = -1) const;
 
+  /// Transforms a set of points using the inverse of the transformation
+  ///
+  /// \returns Number of points at which transformation is non-invertible.
+  virtual int Inverse(int, double *, double *, double *, double = 0, double = -1) const;
+
   /// Calculates the displacement of a single point using the inverse of the global transformation only
   virtual void GlobalInverseDisplacement(double &, double &, double &, double = 0, double = -1) const;
 
@@ -583,6 +613,20 @@ public:
   /// Calculates the determinant of the Jacobian of the transformation w.r.t world coordinates
   virtual double Jacobian(double, double, double, double = 0, double = -1) const;
 
+  /// Calculates the Jacobian of the transformation w.r.t world coordinates at a set of points
+  ///
+  /// \param[in]  no  Number of points.
+  /// \param[in]  x   World x coordinates of points.
+  /// \param[in]  y   World y coordinates of points.
+  /// \param[in]  z   World z coordinates of points.
+  /// \param[out] jac Jacobian matrices in row-major order, i.e., 9 values per point.
+  ///                 No matrices are returned if NULL.
+  /// \param[out] det Determinants of the Jacobian matrices. Not computed if NULL.
+  /// \param[in]  t   Time of points.
+  /// \param[in]  t0  Time of target image.
+  virtual void Jacobian(int no, const double *x, const double *y, const double *z,
+                        double *jac, double *det = NULL, double t = 0, double t0 = -1) const;
+
   /// Calculates the Hessian for each component of the global transformation w.r.t world coordinates
   virtual void GlobalHessian(irtkMatrix [3], double, double, double, double = 0, double = -1) const;
 
@@ -659,9 +703,16 @@ public:
   virtual void Print(irtkIndent = 0) const = 0;
 
   /// Reads a transformation from a file
+  ///
+  /// The file can be either a legacy transformation file or a container
+  /// file written by irtkTransformationContainer.
   virtual void Read(const char *);
 
   /// Writes a transformation to a file
+  ///
+  /// Files with extension .dofc are written as irtkTransformationContainer
+  /// with uncompressed blocks, and files with extension .dofz as container
+  /// with compressed blocks. All other files are written in legacy format.
   virtual void Write(const char *) const;
 
   /// Reads a transformation from a file stream
@@ -869,15 +920,15 @@ inline bool irtkTransformation::RequiresCachingOfDisplacements() const
 }
 
 // -----------------------------------------------------------------------------
-inline void irtkTransformation::Transform(irtkPoint &p, double t, double t0) const
+inline bool irtkTransformation::DisplacementIsLinearInDOFs() const
 {
-  this->Transform(p._x, p._y, p._z, t, t0);
+  return false;
 }
 
 // -----------------------------------------------------------------------------
-inline void irtkTransformation::Transform(irtkPointSet &pset, double t, double t0) const
+inline void irtkTransformation::Transform(irtkPoint &p, double t, double t0) const
 {
-  for (int i = 0; i < pset.Size(); i++) this->Transform(pset(i), t, t0);
+  this->Transform(p._x, p._y, p._z, t, t0);
 }
 
 // -----------------------------------------------------------------------------
@@ -886,16 +937,6 @@ inline bool irtkTransformation::Inverse(irtkPoint &p, double t, double t0) const
   return this->Inverse(p._x, p._y, p._z, t, t0);
 }
 
-// -----------------------------------------------------------------------------
-inline int irtkTransformation::Inverse(irtkPointSet &pset, double t, double t0) const
-{
-  int n = 0;
-  for (int i = 0; i < pset.Size(); ++i) {
-    if (!this->Inverse(pset(i), t, t0)) ++n;
-  }
-  return n;
-}
-
 // -----------------------------------------------------------------------------
 inline void irtkTransformation::GlobalDisplacement(double &x, double &y, double &z, double t, double t0) const
 {
@@ -1128,7 +1169,8 @@ inline irtkTransformationType irtkTransformation::TypeOfClass() const
 ///
 /// \param[in] name File name.
 ///
-/// \returns Whether the named file exists and stores an IRTK transformation.
+/// \returns Whether the named file exists and stores an IRTK transformation,
+///          either in legacy format or as transformation container.
 bool IsTransformation(const char *name);
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1161,6 +1203,7 @@ bool IsTransformation(const char *name);
 #include <irtkMultiLevelFreeFormTransformation.h>
 #include <irtkMultiLevelStationaryVelocityTransformation.h>
 #include <irtkFluidFreeFormTransformation.h>
+#include <irtkTransformationContainer.h>
 
 // Decorators (i.e., wrappers)
 #include <irtkInverseAffineTransformation.h>
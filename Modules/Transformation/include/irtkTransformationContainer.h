@@ -0,0 +1,229 @@
+/* The Image Registration Toolkit (IRTK)
+ *
+ * Copyright 2008-2015 Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#ifndef _IRTKTRANSFORMATIONCONTAINER_H
+#define _IRTKTRANSFORMATIONCONTAINER_H
+
+
+/**
+ * Transformation file with table of contents and individually readable blocks
+ *
+ * A container file starts with a header which consists of the magic number
+ * IRTKTRANSFORMATION_CONTAINER_MAGIC, the version of the container format,
+ * the type of the stored transformation, and the number of blocks. It is
+ * followed by a table of contents with the type, the level index, the
+ * compression method, the file offset, the stored size, and the uncompressed
+ * size of each block. All values are stored as 32-bit unsigned integers
+ * in big-endian byte order. Each block starts at a file offset which is a
+ * multiple of BlockAlignment and is fetched with a single bulk read.
+ *
+ * The blocks contain the transformation in the legacy file format, i.e., as
+ * written by irtkTransformation::Write(irtkCofstream &). The global and local
+ * transformations of a multi-level free-form deformation are stored in
+ * separate blocks such that individual levels can be read on demand without
+ * parsing the preceding levels. Other transformations are stored as a single
+ * block. Blocks can optionally be compressed using zlib.
+ */
+class irtkTransformationContainer : public irtkObject
+{
+  irtkObjectMacro(irtkTransformationContainer);
+
+public:
+
+  /// Version of container format
+  static const unsigned int Version = 1;
+
+  /// Alignment of block file offsets in bytes
+  static const unsigned int BlockAlignment = 64;
+
+  /// Type of content stored in block
+  enum BlockType
+  {
+    TransformationBlock       = 0, ///< Complete transformation
+    GlobalTransformationBlock = 1, ///< Global transformation of multi-level transformation
+    LocalTransformationBlock  = 2  ///< Local transformation of multi-level transformation
+  };
+
+  /// Compression method of block
+  enum BlockCompression
+  {
+    NoCompression   = 0, ///< Uncompressed block
+    ZlibCompression = 1  ///< Block compressed using zlib
+  };
+
+  /// Table of contents entry
+  struct Block
+  {
+    BlockType        _Type;        ///< Type of block content
+    int              _Level;       ///< Level index of local transformation
+    BlockCompression _Compression; ///< Compression method
+    long             _Offset;      ///< File offset of block
+    long             _Size;        ///< Size of block in file
+    long             _RawSize;     ///< Size of uncompressed block
+  };
+
+  // ---------------------------------------------------------------------------
+  // Attributes
+
+  /// Type of stored transformation
+  irtkReadOnlyAttributeMacro(irtkTransformationType, TypeOfTransformation);
+
+  /// Number of local transformations of stored multi-level transformation
+  irtkReadOnlyAttributeMacro(int, NumberOfLevels);
+
+protected:
+
+  /// Container file
+  mutable irtkCifstream _File;
+
+  /// Name of container file
+  string _FileName;
+
+  /// Table of contents
+  vector<Block> _Block;
+
+  /// Index of global transformation block or -1 if not present
+  int _GlobalBlock;
+
+  /// Indices of local transformation blocks
+  vector<int> _LocalBlock;
+
+private:
+
+  /// Copy constructor
+  /// \note Intentionally not implemented
+  irtkTransformationContainer(const irtkTransformationContainer &);
+
+  /// Assignment operator
+  /// \note Intentionally not implemented
+  void operator =(const irtkTransformationContainer &);
+
+  // ---------------------------------------------------------------------------
+  // Construction/Destruction
+public:
+
+  /// Constructor
+  irtkTransformationContainer(const char * = NULL);
+
+  /// Destructor
+  virtual ~irtkTransformationContainer();
+
+  /// Open container file and read its table of contents
+  void Open(const char *);
+
+  /// Close container file
+  void Close();
+
+  // ---------------------------------------------------------------------------
+  // Table of contents
+
+  /// Number of blocks
+  int NumberOfBlocks() const;
+
+  /// Get table of contents entry
+  const Block &GetBlock(int) const;
+
+  /// Whether the stored transformation is a multi-level transformation whose
+  /// global and local transformations are stored in separate blocks
+  bool IsMultiLevel() const;
+
+  // ---------------------------------------------------------------------------
+  // Reading
+
+  /// Read stored transformation
+  ///
+  /// \returns New transformation instance which must be deleted by the caller.
+  irtkTransformation *Read() const;
+
+  /// Read stored transformation into given transformation instance
+  void Read(irtkTransformation *) const;
+
+  /// Read global transformation only
+  ///
+  /// \returns New transformation instance which must be deleted by the caller,
+  ///          or NULL if the stored transformation is neither a homogeneous
+  ///          nor a multi-level transformation.
+  irtkHomogeneousTransformation *ReadGlobalTransformation() const;
+
+  /// Read local transformation of multi-level transformation only
+  ///
+  /// \param[in] l Level index. Negative indices count from the last level.
+  ///
+  /// \returns New transformation instance which must be deleted by the caller.
+  irtkFreeFormTransformation *ReadLocalTransformation(int l) const;
+
+  // ---------------------------------------------------------------------------
+  // Writing
+
+  /// Write transformation to container file
+  ///
+  /// \param[in] name     Name of output file.
+  /// \param[in] t        Transformation.
+  /// \param[in] compress Whether to compress blocks. A block is stored
+  ///                     uncompressed nevertheless if compression does
+  ///                     not reduce its size.
+  static void Write(const char *name, const irtkTransformation *t, bool compress = false);
+
+protected:
+
+  /// Read uncompressed content of block
+  void ReadBlock(int, vector<char> &) const;
+
+  /// Read transformation stored in block
+  irtkTransformation *ReadTransformation(int) const;
+
+  /// Read transformation stored in block into given transformation instance
+  void ReadTransformation(int, irtkTransformation *) const;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline definitions
+////////////////////////////////////////////////////////////////////////////////
+
+// -----------------------------------------------------------------------------
+inline int irtkTransformationContainer::NumberOfBlocks() const
+{
+  return static_cast<int>(_Block.size());
+}
+
+// -----------------------------------------------------------------------------
+inline const irtkTransformationContainer::Block &
+irtkTransformationContainer::GetBlock(int i) const
+{
+  return _Block[i];
+}
+
+// -----------------------------------------------------------------------------
+inline bool irtkTransformationContainer::IsMultiLevel() const
+{
+  return (_GlobalBlock != -1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Auxiliary functions
+////////////////////////////////////////////////////////////////////////////////
+
+// -----------------------------------------------------------------------------
+/// Check whether a named file is an IRTK transformation container file
+///
+/// \param[in] name File name.
+///
+/// \returns Whether the named file exists and is a transformation container.
+bool IsTransformationContainer(const char *name);
+
+
+#endif
@@ -64,28 +64,177 @@ class TransformPoints
   const irtkTransformation *_Transformation;
   double                   *_x, *_y, *_z, _t0, _t1;
   const double             *_t;
+  const int                *_Order;
 
 public:
 
-  TransformPoints(const irtkTransformation *transformation, double *x, double *y, double *z, double t, double t0)
+  TransformPoints(const irtkTransformation *transformation, double *x, double *y, double *z, double t, double t0,
+                  const int *order = NULL)
   :
     _Transformation(transformation),
-    _x(x), _y(y), _z(z), _t0(t0), _t1(t), _t(NULL)
+    _x(x), _y(y), _z(z), _t0(t0), _t1(t), _t(NULL), _Order(order)
   {}
 
-  TransformPoints(const irtkTransformation *transformation, double *x, double *y, double *z, const double *t, double t0)
+  TransformPoints(const irtkTransformation *transformation, double *x, double *y, double *z, const double *t, double t0,
+                  const int *order = NULL)
   :
     _Transformation(transformation),
-    _x(x), _y(y), _z(z), _t0(t0), _t1(.0), _t(t)
+    _x(x), _y(y), _z(z), _t0(t0), _t1(.0), _t(t), _Order(order)
   {}
 
   void operator ()(const blocked_range<int> &idx) const
   {
-    double *x = _x + idx.begin();
-    double *y = _y + idx.begin();
-    double *z = _z + idx.begin();
-    for (int i = idx.begin(); i != idx.end(); ++i, ++x, ++y, ++z) {
-      _Transformation->Transform(*x, *y, *z, (_t ? _t[i] : _t1), _t0);
+    if (_Order) {
+      int n;
+      for (int i = idx.begin(); i != idx.end(); ++i) {
+        n = _Order[i];
+        _Transformation->Transform(_x[n], _y[n], _z[n], (_t ? _t[n] : _t1), _t0);
+      }
+    } else {
+      double *x = _x + idx.begin();
+      double *y = _y + idx.begin();
+      double *z = _z + idx.begin();
+      for (int i = idx.begin(); i != idx.end(); ++i, ++x, ++y, ++z) {
+        _Transformation->Transform(*x, *y, *z, (_t ? _t[i] : _t1), _t0);
+      }
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Body of irtkTransformation::Inverse(int, double *, double *, double *, ...)
+class InversePoints
+{
+  const irtkTransformation *_Transformation;
+  double                   *_x, *_y, *_z, _t, _t0;
+  const int                *_Order;
+
+public:
+
+  int _NumberOfFailures;
+
+  InversePoints(const irtkTransformation *transformation, double *x, double *y, double *z, double t, double t0,
+                const int *order = NULL)
+  :
+    _Transformation(transformation),
+    _x(x), _y(y), _z(z), _t(t), _t0(t0), _Order(order), _NumberOfFailures(0)
+  {}
+
+  InversePoints(const InversePoints &other, split)
+  :
+    _Transformation(other._Transformation),
+    _x(other._x), _y(other._y), _z(other._z), _t(other._t), _t0(other._t0),
+    _Order(other._Order), _NumberOfFailures(0)
+  {}
+
+  void join(const InversePoints &rhs)
+  {
+    _NumberOfFailures += rhs._NumberOfFailures;
+  }
+
+  void operator ()(const blocked_range<int> &idx)
+  {
+    int n;
+    for (int i = idx.begin(); i != idx.end(); ++i) {
+      n = (_Order ? _Order[i] : i);
+      if (!_Transformation->Inverse(_x[n], _y[n], _z[n], _t, _t0)) ++_NumberOfFailures;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Body of irtkTransformation::Jacobian(int, const double *, const double *, ...)
+class EvaluateJacobian
+{
+  const irtkTransformation *_Transformation;
+  const double             *_x, *_y, *_z;
+  double                   *_Jacobian, *_Determinant, _t, _t0;
+  const int                *_Order;
+
+public:
+
+  EvaluateJacobian(const irtkTransformation *transformation,
+                   const double *x, const double *y, const double *z,
+                   double *jac, double *det, double t, double t0, const int *order = NULL)
+  :
+    _Transformation(transformation), _x(x), _y(y), _z(z),
+    _Jacobian(jac), _Determinant(det), _t(t), _t0(t0), _Order(order)
+  {}
+
+  void operator ()(const blocked_range<int> &idx) const
+  {
+    int        n;
+    irtkMatrix jac(3, 3);
+    for (int i = idx.begin(); i != idx.end(); ++i) {
+      n = (_Order ? _Order[i] : i);
+      _Transformation->Jacobian(jac, _x[n], _y[n], _z[n], _t, _t0);
+      if (_Jacobian) {
+        double *J = _Jacobian + 9 * n;
+        for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c, ++J) {
+          *J = jac(r, c);
+        }
+      }
+      if (_Determinant) _Determinant[n] = jac.Det3x3();
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Body of irtkTransformation::Transform(irtkPointSet &, ...)
+class TransformPointSet
+{
+  const irtkTransformation *_Transformation;
+  irtkPointSet             *_PointSet;
+  double                    _t, _t0;
+
+public:
+
+  TransformPointSet(const irtkTransformation *transformation, irtkPointSet &pset, double t, double t0)
+  :
+    _Transformation(transformation), _PointSet(&pset), _t(t), _t0(t0)
+  {}
+
+  void operator ()(const blocked_range<int> &idx) const
+  {
+    for (int i = idx.begin(); i != idx.end(); ++i) {
+      _Transformation->Transform((*_PointSet)(i), _t, _t0);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Body of irtkTransformation::Inverse(irtkPointSet &, ...)
+class InversePointSet
+{
+  const irtkTransformation *_Transformation;
+  irtkPointSet             *_PointSet;
+  double                    _t, _t0;
+
+public:
+
+  int _NumberOfFailures;
+
+  InversePointSet(const irtkTransformation *transformation, irtkPointSet &pset, double t, double t0)
+  :
+    _Transformation(transformation), _PointSet(&pset), _t(t), _t0(t0), _NumberOfFailures(0)
+  {}
+
+  InversePointSet(const InversePointSet &other, split)
+  :
+    _Transformation(other._Transformation), _PointSet(other._PointSet),
+    _t(other._t), _t0(other._t0), _NumberOfFailures(0)
+  {}
+
+  void join(const InversePointSet &rhs)
+  {
+    _NumberOfFailures += rhs._NumberOfFailures;
+  }
+
+  void operator ()(const blocked_range<int> &idx)
+  {
+    for (int i = idx.begin(); i != idx.end(); ++i) {
+      if (!_Transformation->Inverse((*_PointSet)(i), _t, _t0)) ++_NumberOfFailures;
     }
   }
 };
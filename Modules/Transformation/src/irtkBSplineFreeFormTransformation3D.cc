@@ -16,6 +16,7 @@
 
 #include <irtkTransformation.h>
 #include <irtkImageToInterpolationCoefficients.h>
+#include <irtkBSplineScatteredDataApproximation.h>
 
 
 // =============================================================================
@@ -91,114 +92,10 @@ void irtkBSplineFreeFormTransformation3D
 ::ApproximateDOFs(const double *wx, const double *wy, const double *wz, const double *,
                   const double *dx, const double *dy, const double *dz, int no)
 {
-  int    i, j, k, ci, cj, ck, A, B, C;
-  double x, y, z, w[3], basis, sum;
-
-  // Allocate memory
-  Vector ***data = CAllocate<Vector>(_x, _y, _z);
-  double ***norm = CAllocate<double>(_x, _y, _z);
-
-  // Initial loop: Calculate change of control points
-  for (int idx = 0; idx < no; ++idx) {
-    if (dx[idx] == .0 && dy[idx] == .0 && dz[idx] == .0) continue;
-
-    x = wx[idx], y = wy[idx], z = wz[idx];
-    this->WorldToLattice(x, y, z);
-
-    i = static_cast<int>(floor(x));
-    j = static_cast<int>(floor(y));
-
-    A = Kernel::VariableToIndex(x - i);
-    B = Kernel::VariableToIndex(y - j);
-    --i, --j;
-
-    // 2D
-    if (_z == 1) {
-
-      sum = .0;
-      for (int b = 0; b <= 3; ++b) {
-        w[1] = Kernel::LookupTable[B][b];
-        for (int a = 0; a <= 3; ++a) {
-          w[0] = Kernel::LookupTable[A][a] * w[1];
-          sum += w[0] * w[0];
-        }
-      }
-
-      for (int b = 0; b <= 3; ++b) {
-        cj = j + b;
-        if (cj < 0 || cj >= _y) continue;
-        w[1] = Kernel::LookupTable[B][b];
-        for (int a = 0; a <= 3; ++a) {
-          ci = i + a;
-          if (ci < 0 || ci >= _x) continue;
-          w[0]  = Kernel::LookupTable[A][a] * w[1];
-          basis = w[0] * w[0];
-          norm[0][cj][ci] += basis;
-          basis *= w[0] / sum;
-          data[0][cj][ci]._x += basis * dx[idx];
-          data[0][cj][ci]._y += basis * dy[idx];
-          data[0][cj][ci]._z += basis * dz[idx];
-        }
-      }
-
-    // 3D
-    } else {
-
-      k = static_cast<int>(floor(z));
-      C = Kernel::VariableToIndex(z - k);
-      --k;
-
-      sum = .0;
-      for (int c = 0; c <= 3; ++c) {
-        w[2] = Kernel::LookupTable[C][c];
-        for (int b = 0; b <= 3; ++b) {
-          w[1] = Kernel::LookupTable[B][b] * w[2];
-          for (int a = 0; a <= 3; ++a) {
-            w[0] = Kernel::LookupTable[A][a] * w[1];
-            sum += w[0] * w[0];
-          }
-        }
-      }
-
-      for (int c = 0; c <= 3; ++c) {
-        ck = k + c;
-        if (ck < 0 || ck >= _z) continue;
-        w[2] = Kernel::LookupTable[C][c];
-        for (int b = 0; b <= 3; ++b) {
-          cj = j + b;
-          if (cj < 0 || cj >= _y) continue;
-          w[1] = Kernel::LookupTable[B][b] * w[2];
-          for (int a = 0; a <= 3; ++a) {
-            ci = i + a;
-            if (ci < 0 || ci >= _x) continue;
-            w[0]  = Kernel::LookupTable[A][a] * w[1];
-            basis = w[0] * w[0];
-            norm[ck][cj][ci] += basis;
-            basis *= w[0] / sum;
-            data[ck][cj][ci]._x += basis * dx[idx];
-            data[ck][cj][ci]._y += basis * dy[idx];
-            data[ck][cj][ci]._z += basis * dz[idx];
-          }
-        }
-      }
-
-    }
-  }
-
-  // Final loop: Calculate new control points
-  const Vector zero(.0);
-
-  Vector *in  = data[0][0];
-  double *div = norm[0][0];
-  Vector *out = _CPImage.Data();
-
-  for (int cp = 0; cp < NumberOfCPs(); ++cp, ++out, ++in, ++div) {
-    (*out) = ((*div) ? ((*in) / (*div)) : zero);
-  }
-
-  // Deallocate memory
-  Deallocate(data);
-  Deallocate(norm);
+  // Approximate control point values in parallel
+  irtkBSplineScatteredDataApproximation approximation(this, _z == 1 ? 2 : 3);
+  approximation.Initialize(wx, wy, wz, NULL, dx, dy, dz, no, true);
+  approximation.Approximate(_CPImage.Data());
 
   this->Changed(true);
 }
@@ -209,74 +106,16 @@ void irtkBSplineFreeFormTransformation3D
                           const double *dx, const double *dy, const double *dz,
                           int no, double *gradient, double weight) const
 {
-  int    i, j, k, ci, cj, ck, A, B, C;
-  double x, y, z, w[3];
-
-  // Allocate memory
-  Vector ***data = CAllocate<Vector>(_x, _y, _z);
-
-  // Initial loop: Calculate change of control points
-  for (int idx = 0; idx < no; ++idx) {
-    if (dx[idx] == .0 && dy[idx] == .0 && dz[idx] == .0) continue;
-
-    x = wx[idx], y = wy[idx], z = wz[idx];
-    this->WorldToLattice(x, y, z);
-
-    i = static_cast<int>(floor(x));
-    j = static_cast<int>(floor(y));
-    A = Kernel::VariableToIndex(x - i);
-    B = Kernel::VariableToIndex(y - j);
-    --i, --j;
-
-    // 2D
-    if (_z == 1) {
-
-      for (int b = 0; b <= 3; ++b) {
-        cj = j + b;
-        if (cj < 0 || cj >= _y) continue;
-        w[1] = Kernel::LookupTable[B][b];
-        for (int a = 0; a <= 3; ++a) {
-          ci = i + a;
-          if (ci < 0 || ci >= _x) continue;
-          w[0] = Kernel::LookupTable[A][a] * w[1];
-          data[0][cj][ci]._x += w[0] * dx[idx];
-          data[0][cj][ci]._y += w[0] * dy[idx];
-          data[0][cj][ci]._z += w[0] * dz[idx];
-        }
-      }
-
-    // 3D
-    } else {
+  // Sum of weighted displacements at each control point
+  irtkBSplineScatteredDataApproximation approximation(this, _z == 1 ? 2 : 3);
+  approximation.Initialize(wx, wy, wz, NULL, dx, dy, dz, no, true);
 
-      k = static_cast<int>(floor(z));
-      C = Kernel::VariableToIndex(z - k);
-      --k;
-
-      for (int c = 0; c <= 3; ++c) {
-        ck = k + c;
-        if (ck < 0 || ck >= _z) continue;
-        w[2] = Kernel::LookupTable[C][c];
-        for (int b = 0; b <= 3; ++b) {
-          cj = j + b;
-          if (cj < 0 || cj >= _y) continue;
-          w[1] = Kernel::LookupTable[B][b] * w[2];
-          for (int a = 0; a <= 3; ++a) {
-            ci = i + a;
-            if (ci < 0 || ci >= _x) continue;
-            w[0] = Kernel::LookupTable[A][a] * w[1];
-            data[ck][cj][ci]._x += w[0] * dx[idx];
-            data[ck][cj][ci]._y += w[0] * dy[idx];
-            data[ck][cj][ci]._z += w[0] * dz[idx];
-          }
-        }
-      }
-
-    }
-  }
+  Vector *data = Allocate<Vector>(NumberOfCPs());
+  approximation.Accumulate(data);
 
   // Final loop
   int           xdof, ydof, zdof;
-  const Vector *grad = data[0][0];
+  const Vector *grad = data;
 
   for (int cp = 0; cp < NumberOfCPs(); ++cp, ++grad) {
     if (!IsActive(cp)) continue;
@@ -1101,6 +940,224 @@ void irtkBSplineFreeFormTransformation3D
   }
 }
 
+// -----------------------------------------------------------------------------
+/// Separable evaluation of a 3D B-spline FFD at the voxels of an image lattice
+/// whose axes are aligned with those of the control point lattice
+///
+/// The control point coefficients are first contracted along z for each
+/// output slice, then along y for each output row, and finally along x for
+/// each voxel. The cubic B-spline weights of each voxel row, column, and slice
+/// are computed only once and stored in per-axis tables. The intermediate plane
+/// and row buffers are allocated per slab, i.e., the memory required does not
+/// depend on the size of the output image.
+template <class TReal>
+class EvaluateBSplineFFD3DOnAlignedLattice
+{
+  typedef irtkBSplineFreeFormTransformation3D::Vector         Vector;
+  typedef irtkBSplineFreeFormTransformation3D::CPImage        CPImage;
+  typedef irtkBSplineFreeFormTransformation3D::CPExtrapolator CPExtrapolator;
+
+  const irtkBSplineFreeFormTransformation3D *_FFD;
+  const CPImage                             *_Coefficient;
+  const CPExtrapolator                      *_Extrapolator;
+  irtkGenericImage<TReal>                   *_Output;
+
+  int     _NumberOfVoxels;   ///< Number of voxels per vector component
+  int    *_Index [3];        ///< Index of first control point along each axis
+  double *_Weight[3];        ///< Kernel weights of voxels along each axis
+  int     _i1, _i2, _j1, _j2; ///< Range of control point indices in x and y
+
+  // ---------------------------------------------------------------------------
+  /// Get (extrapolated) control point coefficient
+  Vector Coefficient(int i, int j, int k) const
+  {
+    if (0 <= i && i < _Coefficient->X() &&
+        0 <= j && j < _Coefficient->Y() &&
+        0 <= k && k < _Coefficient->Z()) {
+      return _Coefficient->Get(i, j, k);
+    }
+    return _Extrapolator->Get(i, j, k);
+  }
+
+public:
+
+  // ---------------------------------------------------------------------------
+  EvaluateBSplineFFD3DOnAlignedLattice(const irtkBSplineFreeFormTransformation3D *ffd,
+                                       const CPImage                             *coeff,
+                                       const CPExtrapolator                      *extrapolator,
+                                       irtkGenericImage<TReal>                   *disp,
+                                       const double                               m[3][2])
+  :
+    _FFD(ffd), _Coefficient(coeff), _Extrapolator(extrapolator), _Output(disp),
+    _NumberOfVoxels(disp->NumberOfSpatialVoxels())
+  {
+    const int n[3] = { disp->X(), disp->Y(), disp->Z() };
+    double x;
+    int    i;
+    for (int d = 0; d < 3; ++d) {
+      Allocate(_Index [d],     n[d]);
+      Allocate(_Weight[d], 4 * n[d]);
+      for (int v = 0; v < n[d]; ++v) {
+        x = m[d][0] * v + m[d][1];
+        i = static_cast<int>(floor(x));
+        _Index[d][v] = i - 1;
+        irtkBSpline<double>::Weights(x - i, _Weight[d] + 4 * v);
+      }
+    }
+    _i1 = min(_Index[0][0], _Index[0][n[0]-1]), _i2 = max(_Index[0][0], _Index[0][n[0]-1]) + 3;
+    _j1 = min(_Index[1][0], _Index[1][n[1]-1]), _j2 = max(_Index[1][0], _Index[1][n[1]-1]) + 3;
+  }
+
+  // ---------------------------------------------------------------------------
+  ~EvaluateBSplineFFD3DOnAlignedLattice()
+  {
+    for (int d = 0; d < 3; ++d) {
+      Deallocate(_Index [d]);
+      Deallocate(_Weight[d]);
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int nx = _i2 - _i1 + 1;
+    const int ny = _j2 - _j1 + 1;
+
+    Vector *plane = Allocate<Vector>(nx * ny);
+    Vector *row   = Allocate<Vector>(nx);
+    Vector *p, *r, v;
+
+    const double *wx, *wy, *wz;
+    TReal        *dx, *dy, *dz;
+    double        x, y, z;
+    int           ci, cj, ck;
+
+    for (int k = re.begin(); k < re.end(); ++k) {
+
+      // Contract coefficients along z
+      ck = _Index[2][k], wz = _Weight[2] + 4 * k;
+      p  = plane;
+      for (int j = _j1; j <= _j2; ++j) {
+        for (int i = _i1; i <= _i2; ++i, ++p) {
+          *p  = Coefficient(i, j, ck    ) * wz[0];
+          *p += Coefficient(i, j, ck + 1) * wz[1];
+          *p += Coefficient(i, j, ck + 2) * wz[2];
+          *p += Coefficient(i, j, ck + 3) * wz[3];
+        }
+      }
+
+      dx = _Output->Data(0, 0, k);
+      dy = dx + _NumberOfVoxels;
+      dz = dy + _NumberOfVoxels;
+
+      for (int j = 0; j < _Output->Y(); ++j) {
+
+        // Contract plane along y
+        cj = _Index[1][j] - _j1, wy = _Weight[1] + 4 * j;
+        p  = plane + cj * nx;
+        for (int i = 0; i < nx; ++i, ++p) {
+          row[i]  = p[0]      * wy[0];
+          row[i] += p[nx]     * wy[1];
+          row[i] += p[2 * nx] * wy[2];
+          row[i] += p[3 * nx] * wy[3];
+        }
+
+        // Contract row along x
+        for (int i = 0; i < _Output->X(); ++i, ++dx, ++dy, ++dz) {
+          if (*dx == TReal(0) && *dy == TReal(0) && *dz == TReal(0)) {
+            ci = _Index[0][i] - _i1, wx = _Weight[0] + 4 * i;
+            r  = row + ci;
+            v  = r[0] * wx[0];
+            v += r[1] * wx[1];
+            v += r[2] * wx[2];
+            v += r[3] * wx[3];
+            *dx = static_cast<TReal>(v._x);
+            *dy = static_cast<TReal>(v._y);
+            *dz = static_cast<TReal>(v._z);
+          } else {
+            // Evaluate FFD at displaced voxel position
+            x = i, y = j, z = k;
+            _Output->ImageToWorld(x, y, z);
+            x += *dx, y += *dy, z += *dz;
+            _FFD->WorldToLattice(x, y, z);
+            _FFD->Evaluate(x, y, z);
+            *dx += static_cast<TReal>(x);
+            *dy += static_cast<TReal>(y);
+            *dz += static_cast<TReal>(z);
+          }
+        }
+      }
+    }
+
+    Deallocate(plane);
+    Deallocate(row);
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Get affine map from image voxel indices to control point lattice coordinates
+///
+/// \returns Whether the axes of the image lattice are aligned with those of
+///          the control point lattice. If so, the lattice coordinate along
+///          dimension d of voxel v is m[d][0] * v + m[d][1].
+static bool LatticeAxesAligned(const irtkFreeFormTransformation *ffd,
+                               const irtkBaseImage *image, double m[3][2])
+{
+  double o[3] = {.0, .0, .0}, e[3][3];
+  image->ImageToWorld(o[0], o[1], o[2]);
+  ffd  ->WorldToLattice(o[0], o[1], o[2]);
+  for (int d = 0; d < 3; ++d) {
+    e[d][0] = (d == 0 ? 1.0 : .0);
+    e[d][1] = (d == 1 ? 1.0 : .0);
+    e[d][2] = (d == 2 ? 1.0 : .0);
+    image->ImageToWorld(e[d][0], e[d][1], e[d][2]);
+    ffd  ->WorldToLattice(e[d][0], e[d][1], e[d][2]);
+    e[d][0] -= o[0], e[d][1] -= o[1], e[d][2] -= o[2];
+  }
+  const double tol = 1e-6;
+  for (int d = 0; d < 3; ++d) {
+    for (int c = 0; c < 3; ++c) {
+      if (c != d && fabs(e[d][c]) > tol) return false;
+    }
+    m[d][0] = e[d][d];
+    m[d][1] = o[d];
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+template <class TReal>
+static bool EvaluateOnAlignedLattice(const irtkBSplineFreeFormTransformation3D *ffd,
+                                     const irtkFreeFormTransformation::CPImage *coeff,
+                                     const irtkFreeFormTransformation::CPExtrapolator *extrapolator,
+                                     irtkGenericImage<TReal> &disp)
+{
+  double m[3][2];
+  if (ffd->GetZ() == 1 || disp.T() != 3 || !extrapolator) return false;
+  if (!LatticeAxesAligned(ffd, &disp, m)) return false;
+  EvaluateBSplineFFD3DOnAlignedLattice<TReal> eval(ffd, coeff, extrapolator, &disp, m);
+  parallel_for(blocked_range<int>(0, disp.Z()), eval);
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+void irtkBSplineFreeFormTransformation3D
+::Displacement(irtkGenericImage<double> &disp, double t, double t0, const irtkWorldCoordsImage *wc) const
+{
+  if (!EvaluateOnAlignedLattice(this, &_CPImage, _CPValue, disp)) {
+    irtkFreeFormTransformation3D::Displacement(disp, t, t0, wc);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void irtkBSplineFreeFormTransformation3D
+::Displacement(irtkGenericImage<float> &disp, double t, double t0, const irtkWorldCoordsImage *wc) const
+{
+  if (!EvaluateOnAlignedLattice(this, &_CPImage, _CPValue, disp)) {
+    irtkFreeFormTransformation3D::Displacement(disp, t, t0, wc);
+  }
+}
+
 // =============================================================================
 // Derivatives
 // =============================================================================
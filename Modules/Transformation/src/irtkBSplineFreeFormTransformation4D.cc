@@ -16,6 +16,7 @@
 
 #include <irtkTransformation.h>
 #include <irtkImageToInterpolationCoefficients.h>
+#include <irtkBSplineScatteredDataApproximation.h>
 
 // =============================================================================
 // Construction/Destruction
@@ -86,90 +87,10 @@ void irtkBSplineFreeFormTransformation4D
 ::ApproximateDOFs(const double *wx, const double *wy, const double *wz, const double *wt,
                   const double *dx, const double *dy, const double *dz, int no)
 {
-  int    i, j, k, l, ci, cj, ck, cl, A, B, C, D;
-  double x, y, z, t, w[4], basis, sum;
-
-  // Allocate memory
-  Vector ****data = CAllocate<Vector>(_x, _y, _z, _t);
-  double ****norm = CAllocate<double>(_x, _y, _z, _t);
-
-  // Initial loop: Calculate change of control points
-  for (int idx = 0; idx < no; idx++) {
-    x = wx[idx], y = wy[idx], z = wz[idx];
-    this->WorldToLattice(x, y, z);
-    t = this->TimeToLattice(wt[idx]);
-
-    i = static_cast<int>(floor(x));
-    j = static_cast<int>(floor(y));
-    k = static_cast<int>(floor(z));
-    l = static_cast<int>(floor(t));
-    A = Kernel::VariableToIndex(x - i);
-    B = Kernel::VariableToIndex(y - j);
-    C = Kernel::VariableToIndex(z - k);
-    D = Kernel::VariableToIndex(t - l);
-    --i, --j, --k, --l;
-
-    sum = .0;
-    for (int d = 0; d <= 3; ++d) {
-      w[3] = Kernel::LookupTable[D][d];
-      for (int c = 0; c <= 3; ++c) {
-        w[2] = Kernel::LookupTable[C][c] * w[3];
-        for (int b = 0; b <= 3; ++b) {
-          w[1] = Kernel::LookupTable[B][b] * w[2];
-          for (int a = 0; a <= 3; ++a) {
-            w[0] = Kernel::LookupTable[A][a] * w[1];
-            sum += w[0] * w[0];
-          }
-        }
-      }
-    }
-
-    for (int d = 0; d <= 3; ++d) {
-      cl = l + d;
-      if (0 <= cl && cl < _t) {
-        w[3] = Kernel::LookupTable[D][d];
-        for (int c = 0; c <= 3; ++c) {
-          ck = k + c;
-          if (0 <= ck && ck < _z) {
-            w[2] = Kernel::LookupTable[C][c] * w[3];
-            for (int b = 0; b <= 3; ++b) {
-              cj = j + b;
-              if (0 <= cj && cj < _y) {
-                w[1] = Kernel::LookupTable[B][b] * w[2];
-                for (int a = 0; a <= 3; ++a) {
-                  ci = i + a;
-                  if (0 <= ci && ci < _x) {
-                    w[0]  = Kernel::LookupTable[A][a] * w[1];
-                    basis = w[0] * w[0];
-                    norm[cl][ck][cj][ci] += basis;
-                    basis *= w[0] / sum;
-                    data[cl][ck][cj][ci]._x += basis * dx[idx];
-                    data[cl][ck][cj][ci]._y += basis * dy[idx];
-                    data[cl][ck][cj][ci]._z += basis * dz[idx];
-                  }
-                }
-              }
-            }
-          }
-        }
-      }
-    }
-  }
-
-  // Final loop: Calculate new control points
-  const Vector zero(.0);
-
-  Vector *in  = data[0][0][0];
-  double *div = norm[0][0][0];
-  Vector *out = _CPImage.Data();
-
-  for (int cp = 0; cp < NumberOfCPs(); ++cp, ++out, ++in, ++div) {
-    (*out) = ((*div) ? ((*in) / (*div)) : zero);
-  }
-
-  // Deallocate memory
-  Deallocate(data);
-  Deallocate(norm);
+  // Approximate control point values in parallel
+  irtkBSplineScatteredDataApproximation approximation(this, 4);
+  approximation.Initialize(wx, wy, wz, wt, dx, dy, dz, no);
+  approximation.Approximate(_CPImage.Data());
 }
 
 // -----------------------------------------------------------------------------
@@ -178,60 +99,16 @@ void irtkBSplineFreeFormTransformation4D
                           const double *dx, const double *dy, const double *dz,
                           int no, double *gradient, double weight) const
 {
-  int    i, j, k, l, ci, cj, ck, cl, A, B, C, D;
-  double x, y, z, t, w[4];
-
-  // Allocate memory
-  Vector ****data = CAllocate<Vector>(_x, _y, _z, _t);
-
-  // Initial loop: Calculate change of control points
-  for (int idx = 0; idx < no; ++idx) {
-    x = wx[idx], y = wy[idx], z = wz[idx];
-    this->WorldToLattice(x, y, z);
-    t = this->TimeToLattice(wt[idx]);
-
-    i = static_cast<int>(floor(x));
-    j = static_cast<int>(floor(y));
-    k = static_cast<int>(floor(z));
-    l = static_cast<int>(floor(t));
-    A = Kernel::VariableToIndex(x - i);
-    B = Kernel::VariableToIndex(y - j);
-    C = Kernel::VariableToIndex(z - k);
-    D = Kernel::VariableToIndex(t - l);
-    --i, --j, --k, --l;
-
-    for (int d = 0; d <= 3; ++d) {
-      cl = l + d;
-      if (0 <= cl && cl < _t) {
-        w[3] = Kernel::LookupTable[D][d];
-        for (int c = 0; c <= 3; ++c) {
-          ck = k + c;
-          if (0 <= ck && ck < _z) {
-            w[2] = Kernel::LookupTable[C][c] * w[3];
-            for (int b = 0; b <= 3; ++b) {
-              cj = j + b;
-              if (0 <= cj && cj < _y) {
-                w[1] = Kernel::LookupTable[B][b] * w[2];
-                for (int a = 0; a <= 3; ++a) {
-                  ci = i + a;
-                  if (0 <= ci && ci < _x) {
-                    w[0] = Kernel::LookupTable[A][a] * w[1];
-                    data[cl][ck][cj][ci]._x += w[0] * dx[idx];
-                    data[cl][ck][cj][ci]._y += w[0] * dy[idx];
-                    data[cl][ck][cj][ci]._z += w[0] * dz[idx];
-                  }
-                }
-              }
-            }
-          }
-        }
-      }
-    }
-  }
+  // Sum of weighted displacements at each control point
+  irtkBSplineScatteredDataApproximation approximation(this, 4);
+  approximation.Initialize(wx, wy, wz, wt, dx, dy, dz, no);
+
+  Vector *data = Allocate<Vector>(NumberOfCPs());
+  approximation.Accumulate(data);
 
   // Final loop
   int           xdof, ydof, zdof;
-  const Vector *grad = data[0][0][0];
+  const Vector *grad = data;
 
   for (int cp = 0; cp < NumberOfCPs(); ++cp, ++grad) {
     this->IndexToDOFs(cp, xdof, ydof, zdof);
@@ -0,0 +1,294 @@
+/* The Image Registration Toolkit (IRTK)
+ *
+ * Copyright 2008-2015 Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#include <irtkTransformation.h>
+#include <irtkBSplineScatteredDataApproximation.h>
+
+
+// =============================================================================
+// Auxiliary functors
+// =============================================================================
+
+namespace irtkBSplineScatteredDataApproximationUtils {
+
+typedef irtkBSplineFreeFormTransformation3D::Kernel Kernel;
+typedef irtkBSplineScatteredDataApproximation::Vector Vector;
+
+// -----------------------------------------------------------------------------
+/// Determine lattice cell and kernel lookup table indices of each point
+///
+/// The cell index along each lattice dimension is the index of the first
+/// control point in the support of the kernel plus three, such that cells
+/// whose support overlaps with the lattice have non-negative indices.
+struct BinPoints
+{
+  const irtkFreeFormTransformation *_FFD;
+  int           _Dimension;
+  const int    *_Cells;
+  const double *_WX, *_WY, *_WZ, *_WT;
+  const double *_DX, *_DY, *_DZ;
+  bool          _SkipZero;
+  int          *_Cell;
+  int          *_Index;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    double p[4];
+    int    i, c;
+    for (int n = re.begin(); n != re.end(); ++n) {
+      _Cell[n] = -1;
+      if (_SkipZero && _DX[n] == .0 && _DY[n] == .0 && _DZ[n] == .0) continue;
+      p[0] = _WX[n], p[1] = _WY[n], p[2] = _WZ[n];
+      _FFD->WorldToLattice(p[0], p[1], p[2]);
+      p[3] = (_Dimension > 3 ? _FFD->TimeToLattice(_WT[n]) : .0);
+      int cell = 0;
+      for (int d = 3; d >= 0; --d) {
+        if (d < _Dimension) {
+          i = static_cast<int>(floor(p[d]));
+          _Index[4*n+d] = Kernel::VariableToIndex(p[d] - i);
+          c = i + 2;
+          if (c < 0 || c >= _Cells[d]) {
+            cell = -1;
+            break;
+          }
+        } else {
+          _Index[4*n+d] = 0;
+          c = 0;
+        }
+        cell = cell * _Cells[d] + c;
+      }
+      _Cell[n] = cell;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Add weighted displacements of points in cells of one colour
+struct AccumulateCells
+{
+  int           _Dimension;
+  const int    *_Size;
+  const int    *_Cells;
+  const int    *_Index;
+  const int    *_Order;
+  const int    *_Offset;
+  const double *_DX, *_DY, *_DZ;
+  const double *_SumOfSquares;
+  int           _Colour[4];
+  int           _Count[4];
+  Vector       *_Data;
+  double       *_Norm;
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    int    c[4], s[4], cell, m;
+    double w[4][4];
+    for (int n = re.begin(); n != re.end(); ++n) {
+      m = n;
+      for (int d = 0; d < 4; ++d) {
+        c[d] = _Colour[d] + 4 * (m % _Count[d]);
+        m   /= _Count[d];
+      }
+      cell = ((c[3] * _Cells[2] + c[2]) * _Cells[1] + c[1]) * _Cells[0] + c[0];
+      for (int d = 0; d < 4; ++d) {
+        if (d < _Dimension) c[d] -= 3, s[d] = 4;
+        else                c[d]  = 0, s[d] = 1, w[d][0] = 1.0;
+      }
+      for (int p = _Offset[cell]; p < _Offset[cell+1]; ++p) {
+        const int  idx = _Order[p];
+        const int *A   = _Index + 4 * idx;
+        double sum = 1.0;
+        for (int d = 0; d < _Dimension; ++d) {
+          for (int a = 0; a < 4; ++a) w[d][a] = Kernel::LookupTable[A[d]][a];
+          sum *= _SumOfSquares[A[d]];
+        }
+        AddPoint(c, s, w, sum, _DX[idx], _DY[idx], _DZ[idx]);
+      }
+    }
+  }
+
+  void AddPoint(const int c[4], const int s[4], const double w[4][4], double sum,
+                double dx, double dy, double dz) const
+  {
+    int    ci, cj, ck, cl, cp;
+    double w0, w1, w2, w3, basis;
+    for (int d = 0; d < s[3]; ++d) {
+      cl = c[3] + d;
+      if (cl < 0 || cl >= _Size[3]) continue;
+      w3 = w[3][d];
+      for (int k = 0; k < s[2]; ++k) {
+        ck = c[2] + k;
+        if (ck < 0 || ck >= _Size[2]) continue;
+        w2 = w[2][k] * w3;
+        for (int j = 0; j < s[1]; ++j) {
+          cj = c[1] + j;
+          if (cj < 0 || cj >= _Size[1]) continue;
+          w1 = w[1][j] * w2;
+          for (int i = 0; i < s[0]; ++i) {
+            ci = c[0] + i;
+            if (ci < 0 || ci >= _Size[0]) continue;
+            w0 = w[0][i] * w1;
+            cp = ((cl * _Size[2] + ck) * _Size[1] + cj) * _Size[0] + ci;
+            if (_Norm) {
+              basis = w0 * w0;
+              _Norm[cp] += basis;
+              basis *= w0 / sum;
+            } else {
+              basis = w0;
+            }
+            _Data[cp]._x += basis * dx;
+            _Data[cp]._y += basis * dy;
+            _Data[cp]._z += basis * dz;
+          }
+        }
+      }
+    }
+  }
+};
+
+
+} // namespace irtkBSplineScatteredDataApproximationUtils
+using namespace irtkBSplineScatteredDataApproximationUtils;
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+irtkBSplineScatteredDataApproximation
+::irtkBSplineScatteredDataApproximation(const irtkFreeFormTransformation *ffd, int dim)
+:
+  _FFD(ffd), _Dimension(dim), _DX(NULL), _DY(NULL), _DZ(NULL)
+{
+  if (dim < 2 || dim > 4) {
+    cerr << "irtkBSplineScatteredDataApproximation: Invalid number of dimensions: " << dim << endl;
+    exit(1);
+  }
+  _Size[0] = ffd->GetX();
+  _Size[1] = ffd->GetY();
+  _Size[2] = ffd->GetZ();
+  _Size[3] = ffd->GetT();
+  for (int d = 0; d < 4; ++d) {
+    _Cells[d] = (d < _Dimension ? _Size[d] + 3 : 1);
+  }
+}
+
+// =============================================================================
+// Approximation
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void irtkBSplineScatteredDataApproximation
+::Initialize(const double *wx, const double *wy, const double *wz, const double *wt,
+             const double *dx, const double *dy, const double *dz, int no, bool skip_zero)
+{
+  _DX = dx, _DY = dy, _DZ = dz;
+
+  // Determine cell of each point
+  vector<int> cell(no);
+  _Index.resize(4 * no);
+
+  BinPoints bin;
+  bin._FFD       = _FFD;
+  bin._Dimension = _Dimension;
+  bin._Cells     = _Cells;
+  bin._WX        = wx;
+  bin._WY        = wy;
+  bin._WZ        = wz;
+  bin._WT        = wt;
+  bin._DX        = dx;
+  bin._DY        = dy;
+  bin._DZ        = dz;
+  bin._SkipZero  = skip_zero;
+  bin._Cell      = (no > 0 ? &cell[0]   : NULL);
+  bin._Index     = (no > 0 ? &_Index[0] : NULL);
+  parallel_for(blocked_range<int>(0, no), bin);
+
+  // Sort points by cell, keeping the order of points within each cell
+  const int ncells = _Cells[0] * _Cells[1] * _Cells[2] * _Cells[3];
+  _Offset.assign(ncells + 1, 0);
+  for (int n = 0; n < no; ++n) {
+    if (cell[n] >= 0) ++_Offset[cell[n] + 1];
+  }
+  for (int c = 0; c < ncells; ++c) _Offset[c + 1] += _Offset[c];
+  _Order.resize(_Offset[ncells]);
+  vector<int> next(_Offset.begin(), _Offset.end() - 1);
+  for (int n = 0; n < no; ++n) {
+    if (cell[n] >= 0) _Order[next[cell[n]]++] = n;
+  }
+}
+
+// -----------------------------------------------------------------------------
+void irtkBSplineScatteredDataApproximation::Accumulate(Vector *data, double *norm) const
+{
+  // Sum of squared kernel weights along one dimension
+  const int ntable = static_cast<int>(Kernel::LookupTableSize);
+  vector<double> sum2(ntable, .0);
+  for (int i = 0; i < ntable; ++i) {
+    for (int a = 0; a < 4; ++a) {
+      sum2[i] += Kernel::LookupTable[i][a] * Kernel::LookupTable[i][a];
+    }
+  }
+
+  AccumulateCells body;
+  body._Dimension    = _Dimension;
+  body._Size         = _Size;
+  body._Cells        = _Cells;
+  body._Index        = (_Index.empty() ? NULL : &_Index[0]);
+  body._Order        = (_Order.empty() ? NULL : &_Order[0]);
+  body._Offset       = &_Offset[0];
+  body._DX           = _DX;
+  body._DY           = _DY;
+  body._DZ           = _DZ;
+  body._SumOfSquares = &sum2[0];
+  body._Data         = data;
+  body._Norm         = norm;
+
+  // Process cells of each colour in parallel
+  const int ncolours = 1 << (2 * _Dimension);
+  for (int colour = 0; colour < ncolours; ++colour) {
+    int ncells = 1;
+    for (int d = 0; d < 4; ++d) {
+      body._Colour[d] = (d < _Dimension ? (colour >> (2 * d)) & 3 : 0);
+      body._Count [d] = (_Cells[d] - body._Colour[d] + 3) / 4;
+      ncells *= body._Count[d];
+    }
+    if (ncells > 0) parallel_for(blocked_range<int>(0, ncells), body);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void irtkBSplineScatteredDataApproximation::Approximate(Vector *cp) const
+{
+  const int    ncps = _FFD->NumberOfCPs();
+  const Vector zero(.0);
+
+  vector<Vector> data(ncps, zero);
+  vector<double> norm(ncps, .0);
+  this->Accumulate(&data[0], &norm[0]);
+
+  for (int n = 0; n < ncps; ++n) {
+    cp[n] = (norm[n] ? (data[n] / norm[n]) : zero);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void irtkBSplineScatteredDataApproximation::Accumulate(Vector *cp) const
+{
+  const int ncps = _FFD->NumberOfCPs();
+  for (int n = 0; n < ncps; ++n) cp[n] = Vector(.0);
+  this->Accumulate(cp, NULL);
+}
@@ -0,0 +1,587 @@
+/* The Image Registration Toolkit (IRTK)
+ *
+ * Copyright 2008-2015 Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#include <irtkFastFourierTransform.h>
+
+#include <map>
+#include <mutex>
+
+
+namespace irtkFastFourierTransformUtils {
+
+/// Number of interleaved lines of a batch
+static const int NB = irtkFFTPlan::BatchSize;
+
+// =============================================================================
+// Butterflies
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Radix-2 stage of self-sorting FFT
+void Radix2(int n, int ns, const double *twr, const double *twi, int sign,
+            const double *xr, const double *xi, double *yr, double *yi)
+{
+  const int m = n / 2;
+  for (int j = 0; j < m; ++j) {
+    const int    jj = j % ns;
+    const int    d  = (j - jj) * 2 + jj;
+    const double wr = twr[jj], wi = sign * twi[jj];
+    const double *x0r = xr +  j      * NB, *x0i = xi +  j      * NB;
+    const double *x1r = xr + (j + m) * NB, *x1i = xi + (j + m) * NB;
+    double       *y0r = yr +  d       * NB, *y0i = yi +  d       * NB;
+    double       *y1r = yr + (d + ns) * NB, *y1i = yi + (d + ns) * NB;
+    for (int b = 0; b < NB; ++b) {
+      const double br = x1r[b] * wr - x1i[b] * wi;
+      const double bi = x1r[b] * wi + x1i[b] * wr;
+      y0r[b] = x0r[b] + br, y0i[b] = x0i[b] + bi;
+      y1r[b] = x0r[b] - br, y1i[b] = x0i[b] - bi;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Radix-3 stage of self-sorting FFT
+void Radix3(int n, int ns, const double *twr, const double *twi, int sign,
+            const double *xr, const double *xi, double *yr, double *yi)
+{
+  const int    m = n / 3;
+  const double s = sign * .86602540378443864676; // sin(2 pi / 3)
+  double a1r[NB], a1i[NB], a2r[NB], a2i[NB];
+  for (int j = 0; j < m; ++j) {
+    const int     jj = j % ns;
+    const int     d  = (j - jj) * 3 + jj;
+    const double *w  = twr + 2 * jj, *v = twi + 2 * jj;
+    const double *x0r = xr +  j          * NB, *x0i = xi +  j          * NB;
+    const double *x1r = xr + (j +     m) * NB, *x1i = xi + (j +     m) * NB;
+    const double *x2r = xr + (j + 2 * m) * NB, *x2i = xi + (j + 2 * m) * NB;
+    for (int b = 0; b < NB; ++b) {
+      a1r[b] = x1r[b] * w[0] - x1i[b] * sign * v[0];
+      a1i[b] = x1r[b] * sign * v[0] + x1i[b] * w[0];
+      a2r[b] = x2r[b] * w[1] - x2i[b] * sign * v[1];
+      a2i[b] = x2r[b] * sign * v[1] + x2i[b] * w[1];
+    }
+    double *y0r = yr +  d           * NB, *y0i = yi +  d           * NB;
+    double *y1r = yr + (d +     ns) * NB, *y1i = yi + (d +     ns) * NB;
+    double *y2r = yr + (d + 2 * ns) * NB, *y2i = yi + (d + 2 * ns) * NB;
+    for (int b = 0; b < NB; ++b) {
+      const double t1r = a1r[b] + a2r[b], t1i = a1i[b] + a2i[b];
+      const double t2r = x0r[b] - .5 * t1r, t2i = x0i[b] - .5 * t1i;
+      const double t3r = s * (a1r[b] - a2r[b]), t3i = s * (a1i[b] - a2i[b]);
+      y0r[b] = x0r[b] + t1r, y0i[b] = x0i[b] + t1i;
+      y1r[b] = t2r - t3i,    y1i[b] = t2i + t3r;
+      y2r[b] = t2r + t3i,    y2i[b] = t2i - t3r;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Radix-4 stage of self-sorting FFT
+void Radix4(int n, int ns, const double *twr, const double *twi, int sign,
+            const double *xr, const double *xi, double *yr, double *yi)
+{
+  const int m = n / 4;
+  double ar[3][NB], ai[3][NB];
+  for (int j = 0; j < m; ++j) {
+    const int     jj = j % ns;
+    const int     d  = (j - jj) * 4 + jj;
+    const double *w  = twr + 3 * jj, *v = twi + 3 * jj;
+    const double *x0r = xr + j * NB, *x0i = xi + j * NB;
+    for (int r = 1; r < 4; ++r) {
+      const double *xrr = xr + (j + r * m) * NB, *xri = xi + (j + r * m) * NB;
+      const double  wr  = w[r-1], wi = sign * v[r-1];
+      for (int b = 0; b < NB; ++b) {
+        ar[r-1][b] = xrr[b] * wr - xri[b] * wi;
+        ai[r-1][b] = xrr[b] * wi + xri[b] * wr;
+      }
+    }
+    double *y0r = yr +  d           * NB, *y0i = yi +  d           * NB;
+    double *y1r = yr + (d +     ns) * NB, *y1i = yi + (d +     ns) * NB;
+    double *y2r = yr + (d + 2 * ns) * NB, *y2i = yi + (d + 2 * ns) * NB;
+    double *y3r = yr + (d + 3 * ns) * NB, *y3i = yi + (d + 3 * ns) * NB;
+    for (int b = 0; b < NB; ++b) {
+      const double t0r = x0r[b] + ar[1][b], t0i = x0i[b] + ai[1][b];
+      const double t1r = x0r[b] - ar[1][b], t1i = x0i[b] - ai[1][b];
+      const double t2r = ar[0][b] + ar[2][b], t2i = ai[0][b] + ai[2][b];
+      const double t3r = sign * (ar[0][b] - ar[2][b]);
+      const double t3i = sign * (ai[0][b] - ai[2][b]);
+      y0r[b] = t0r + t2r, y0i[b] = t0i + t2i;
+      y1r[b] = t1r - t3i, y1i[b] = t1i + t3r;
+      y2r[b] = t0r - t2r, y2i[b] = t0i - t2i;
+      y3r[b] = t1r + t3i, y3i[b] = t1i - t3r;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+/// Stage of self-sorting FFT with odd prime radix p <= irtkFFTPlan::MaxRadix
+void RadixP(int p, int n, int ns, const double *twr, const double *twi,
+            const double *rootr, const double *rooti, int sign,
+            const double *xr, const double *xi, double *yr, double *yi)
+{
+  const int m = n / p;
+  double ar[irtkFFTPlan::MaxRadix][NB], ai[irtkFFTPlan::MaxRadix][NB];
+  for (int j = 0; j < m; ++j) {
+    const int     jj = j % ns;
+    const int     d  = (j - jj) * p + jj;
+    const double *w  = twr + (p - 1) * jj, *v = twi + (p - 1) * jj;
+    memcpy(ar[0], xr + j * NB, NB * sizeof(double));
+    memcpy(ai[0], xi + j * NB, NB * sizeof(double));
+    for (int r = 1; r < p; ++r) {
+      const double *xrr = xr + (j + r * m) * NB, *xri = xi + (j + r * m) * NB;
+      const double  wr  = w[r-1], wi = sign * v[r-1];
+      for (int b = 0; b < NB; ++b) {
+        ar[r][b] = xrr[b] * wr - xri[b] * wi;
+        ai[r][b] = xrr[b] * wi + xri[b] * wr;
+      }
+    }
+    for (int q = 0; q < p; ++q) {
+      double *yqr = yr + (d + q * ns) * NB, *yqi = yi + (d + q * ns) * NB;
+      memcpy(yqr, ar[0], NB * sizeof(double));
+      memcpy(yqi, ai[0], NB * sizeof(double));
+      for (int r = 1, t = q; r < p; ++r, t = (t + q) % p) {
+        const double wr = rootr[t], wi = sign * rooti[t];
+        for (int b = 0; b < NB; ++b) {
+          yqr[b] += ar[r][b] * wr - ai[r][b] * wi;
+          yqi[b] += ar[r][b] * wi + ai[r][b] * wr;
+        }
+      }
+    }
+  }
+}
+
+// =============================================================================
+// Image transforms
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Transform complex lines of 3D array along one axis
+class TransformLines
+{
+  float             *_Re;
+  float             *_Im;
+  int                _Nx, _Ny, _Nz;
+  int                _Axis;
+  int                _Sign;
+  double             _Norm;
+  const irtkFFTPlan *_Plan;
+
+public:
+
+  TransformLines(float *re, float *im, int nx, int ny, int nz, int axis, int sign)
+  :
+    _Re(re), _Im(im), _Nx(nx), _Ny(ny), _Nz(nz), _Axis(axis), _Sign(sign)
+  {
+    const int n = (axis == 0 ? nx : (axis == 1 ? ny : nz));
+    _Plan = irtkFFTPlan::Instance(n);
+    _Norm = 1.0 / sqrt(static_cast<double>(n));
+  }
+
+  int NumberOfLines() const
+  {
+    return _Nx * _Ny * _Nz / _Plan->Size();
+  }
+
+  int NumberOfBatches() const
+  {
+    return (NumberOfLines() + NB - 1) / NB;
+  }
+
+  int Offset(int l) const
+  {
+    switch (_Axis) {
+      case 0:  return l * _Nx;
+      case 1:  return (l % _Nx) + (l / _Nx) * _Nx * _Ny;
+      default: return l;
+    }
+  }
+
+  int Stride() const
+  {
+    switch (_Axis) {
+      case 0:  return 1;
+      case 1:  return _Nx;
+      default: return _Nx * _Ny;
+    }
+  }
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int n      = _Plan->Size();
+    const int nw     = _Plan->WorkSize();
+    const int nlines = NumberOfLines();
+    const int stride = Stride();
+    vector<double> buffer(2 * n * NB + 2 * nw);
+    double *xr = &buffer[0], *xi = xr + n * NB, *wr = xi + n * NB, *wi = wr + nw;
+    int offset[NB], nl;
+    for (int batch = re.begin(); batch != re.end(); ++batch) {
+      nl = min(NB, nlines - batch * NB);
+      for (int b = 0; b < nl; ++b) offset[b] = Offset(batch * NB + b);
+      for (int k = 0; k < n; ++k) {
+        for (int b = 0; b < nl; ++b) {
+          xr[k * NB + b] = _Re[offset[b] + k * stride];
+          xi[k * NB + b] = _Im[offset[b] + k * stride];
+        }
+        for (int b = nl; b < NB; ++b) xr[k * NB + b] = xi[k * NB + b] = .0;
+      }
+      _Plan->Transform(xr, xi, _Sign, wr, wi);
+      for (int k = 0; k < n; ++k) {
+        for (int b = 0; b < nl; ++b) {
+          _Re[offset[b] + k * stride] = static_cast<float>(_Norm * xr[k * NB + b]);
+          _Im[offset[b] + k * stride] = static_cast<float>(_Norm * xi[k * NB + b]);
+        }
+      }
+    }
+  }
+
+  void Run()
+  {
+    if (_Plan->Size() > 1) {
+      parallel_for(blocked_range<int>(0, NumberOfBatches()), *this);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+/// Transform pairs of real lines along x axis to half spectra or vice versa
+class TransformRealLines
+{
+  float             *_Image;
+  float             *_Re;
+  float             *_Im;
+  int                _NumberOfLines;
+  int                _Sign;
+  bool               _Inverse;
+  double             _Norm;
+  const irtkFFTPlan *_Plan;
+
+public:
+
+  TransformRealLines(float *image, float *re, float *im, int nx, int nlines, int sign, bool inverse)
+  :
+    _Image(image), _Re(re), _Im(im), _NumberOfLines(nlines), _Sign(sign), _Inverse(inverse)
+  {
+    _Plan = irtkFFTPlan::Instance(nx);
+    _Norm = 1.0 / sqrt(static_cast<double>(nx));
+  }
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int n  = _Plan->Size();
+    const int h  = n / 2 + 1;
+    const int nw = _Plan->WorkSize();
+    vector<double> buffer(2 * n * NB + 2 * nw);
+    double *xr = &buffer[0], *xi = xr + n * NB, *wr = xi + n * NB, *wi = wr + nw;
+    int l1, l2;
+    for (int batch = re.begin(); batch != re.end(); ++batch) {
+      // Lane b holds the lines l1 = 2 * (batch * NB + b) and l2 = l1 + 1
+      // as real and imaginary part, respectively
+      if (_Inverse) {
+        for (int b = 0; b < NB; ++b) {
+          l1 = 2 * (batch * NB + b), l2 = l1 + 1;
+          if (l1 >= _NumberOfLines) {
+            for (int k = 0; k < n; ++k) xr[k * NB + b] = xi[k * NB + b] = .0;
+            continue;
+          }
+          const float *a1r = _Re + l1 * h, *a1i = _Im + l1 * h;
+          const float *a2r = _Re + l2 * h, *a2i = _Im + l2 * h;
+          for (int k = 0; k < n; ++k) {
+            double ar, ai, br = .0, bi = .0;
+            if (k < h) {
+              ar = a1r[k], ai = a1i[k];
+              if (l2 < _NumberOfLines) br = a2r[k], bi = a2i[k];
+            } else {
+              ar = a1r[n-k], ai = -a1i[n-k];
+              if (l2 < _NumberOfLines) br = a2r[n-k], bi = -a2i[n-k];
+            }
+            xr[k * NB + b] = ar - bi;
+            xi[k * NB + b] = ai + br;
+          }
+        }
+        _Plan->Transform(xr, xi, _Sign, wr, wi);
+        for (int b = 0; b < NB; ++b) {
+          l1 = 2 * (batch * NB + b), l2 = l1 + 1;
+          if (l1 >= _NumberOfLines) break;
+          float *f1 = _Image + l1 * n, *f2 = _Image + l2 * n;
+          for (int k = 0; k < n; ++k) f1[k] = static_cast<float>(_Norm * xr[k * NB + b]);
+          if (l2 < _NumberOfLines) {
+            for (int k = 0; k < n; ++k) f2[k] = static_cast<float>(_Norm * xi[k * NB + b]);
+          }
+        }
+      } else {
+        for (int b = 0; b < NB; ++b) {
+          l1 = 2 * (batch * NB + b), l2 = l1 + 1;
+          const float *f1 = _Image + l1 * n, *f2 = _Image + l2 * n;
+          for (int k = 0; k < n; ++k) {
+            xr[k * NB + b] = (l1 < _NumberOfLines ? f1[k] : .0);
+            xi[k * NB + b] = (l2 < _NumberOfLines ? f2[k] : .0);
+          }
+        }
+        _Plan->Transform(xr, xi, _Sign, wr, wi);
+        const double norm = .5 * _Norm;
+        for (int b = 0; b < NB; ++b) {
+          l1 = 2 * (batch * NB + b), l2 = l1 + 1;
+          if (l1 >= _NumberOfLines) break;
+          float *a1r = _Re + l1 * h, *a1i = _Im + l1 * h;
+          float *a2r = _Re + l2 * h, *a2i = _Im + l2 * h;
+          for (int k = 0; k < h; ++k) {
+            const int    c   = (n - k) % n;
+            const double zr  = xr[k * NB + b], zi  = xi[k * NB + b];
+            const double zcr = xr[c * NB + b], zci = xi[c * NB + b];
+            a1r[k] = static_cast<float>(norm * (zr + zcr));
+            a1i[k] = static_cast<float>(norm * (zi - zci));
+            if (l2 < _NumberOfLines) {
+              a2r[k] = static_cast<float>(norm * (zi + zci));
+              a2i[k] = static_cast<float>(norm * (zcr - zr));
+            }
+          }
+        }
+      }
+    }
+  }
+
+  void Run()
+  {
+    const int nbatches = (_NumberOfLines + 2 * NB - 1) / (2 * NB);
+    parallel_for(blocked_range<int>(0, nbatches), *this);
+  }
+};
+
+
+} // namespace irtkFastFourierTransformUtils
+using namespace irtkFastFourierTransformUtils;
+
+// =============================================================================
+// irtkFFTPlan
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+const irtkFFTPlan *irtkFFTPlan::Instance(int n)
+{
+  static std::map<int, irtkFFTPlan *> plans;
+  static std::mutex                   mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+  irtkFFTPlan *&plan = plans[n];
+  if (plan == NULL) plan = new irtkFFTPlan(n);
+  return plan;
+}
+
+// -----------------------------------------------------------------------------
+irtkFFTPlan::irtkFFTPlan(int n)
+:
+  _Size(n), _Convolution(NULL)
+{
+  if (n < 1) {
+    cerr << "irtkFFTPlan: Invalid transform length: " << n << endl;
+    exit(1);
+  }
+  // Factorize length
+  vector<int> radix;
+  int m = n;
+  while (m % 4 == 0) radix.push_back(4), m /= 4;
+  while (m % 2 == 0) radix.push_back(2), m /= 2;
+  for (int p = 3; p <= MaxRadix && m > 1; p += 2) {
+    while (m % p == 0) radix.push_back(p), m /= p;
+  }
+  // Use Bluestein's algorithm if length has a large prime factor
+  if (m > 1) {
+    int size = 1;
+    while (size < 2 * n - 1) size *= 2;
+    _Convolution = new irtkFFTPlan(size);
+    _ChirpRe.resize(n);
+    _ChirpIm.resize(n);
+    for (int k = 0; k < n; ++k) {
+      const long   k2    = (static_cast<long>(k) * k) % (2L * n);
+      const double angle = M_PI * static_cast<double>(k2) / n;
+      _ChirpRe[k] = cos(angle);
+      _ChirpIm[k] = sin(angle);
+    }
+    vector<double> work(2 * _Convolution->WorkSize());
+    for (int s = 0; s < 2; ++s) {
+      const double sign = (s == 0 ? 1.0 : -1.0);
+      vector<double> re(size * BatchSize, .0), im(size * BatchSize, .0);
+      for (int k = 0; k < n; ++k) {
+        re[k * BatchSize] =   _ChirpRe[k];
+        im[k * BatchSize] = - _ChirpIm[k] * sign;
+        if (k > 0) {
+          re[(size - k) * BatchSize] = re[k * BatchSize];
+          im[(size - k) * BatchSize] = im[k * BatchSize];
+        }
+      }
+      _Convolution->Transform(&re[0], &im[0], +1, &work[0], &work[work.size()/2]);
+      _KernelRe[s].resize(size);
+      _KernelIm[s].resize(size);
+      for (int k = 0; k < size; ++k) {
+        _KernelRe[s][k] = re[k * BatchSize] / size;
+        _KernelIm[s][k] = im[k * BatchSize] / size;
+      }
+    }
+    return;
+  }
+  // Pre-compute twiddle factors of mixed-radix stages
+  _Stages.resize(radix.size());
+  for (size_t i = 0, span = 1; i < radix.size(); span *= radix[i], ++i) {
+    Stage &stage = _Stages[i];
+    const int p = radix[i];
+    stage._Radix = p;
+    stage._Span  = static_cast<int>(span);
+    stage._TwiddleRe.resize(span * (p - 1));
+    stage._TwiddleIm.resize(span * (p - 1));
+    for (int j = 0; j < stage._Span; ++j) {
+      for (int r = 1; r < p; ++r) {
+        const double angle = 2.0 * M_PI * static_cast<double>(j * r) / static_cast<double>(span * p);
+        stage._TwiddleRe[j * (p - 1) + r - 1] = cos(angle);
+        stage._TwiddleIm[j * (p - 1) + r - 1] = sin(angle);
+      }
+    }
+    if (p > 4) {
+      stage._RootRe.resize(p);
+      stage._RootIm.resize(p);
+      for (int t = 0; t < p; ++t) {
+        stage._RootRe[t] = cos(2.0 * M_PI * t / p);
+        stage._RootIm[t] = sin(2.0 * M_PI * t / p);
+      }
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+irtkFFTPlan::~irtkFFTPlan()
+{
+  delete _Convolution;
+}
+
+// =============================================================================
+// Transform
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void irtkFFTPlan::Transform(double *re, double *im, int sign, double *wre, double *wim) const
+{
+  if (_Convolution) Bluestein(re, im, sign, wre, wim);
+  else              Stockham (re, im, sign, wre, wim);
+}
+
+// -----------------------------------------------------------------------------
+void irtkFFTPlan::Stockham(double *re, double *im, int sign, double *wre, double *wim) const
+{
+  double *xr = re,  *xi = im;
+  double *yr = wre, *yi = wim;
+  for (size_t i = 0; i < _Stages.size(); ++i) {
+    const Stage &stage = _Stages[i];
+    const double *twr = stage._TwiddleRe.empty() ? NULL : &stage._TwiddleRe[0];
+    const double *twi = stage._TwiddleIm.empty() ? NULL : &stage._TwiddleIm[0];
+    switch (stage._Radix) {
+      case 2:  Radix2(_Size, stage._Span, twr, twi, sign, xr, xi, yr, yi); break;
+      case 3:  Radix3(_Size, stage._Span, twr, twi, sign, xr, xi, yr, yi); break;
+      case 4:  Radix4(_Size, stage._Span, twr, twi, sign, xr, xi, yr, yi); break;
+      default: RadixP(stage._Radix, _Size, stage._Span, twr, twi,
+                      &stage._RootRe[0], &stage._RootIm[0], sign, xr, xi, yr, yi);
+    }
+    swap(xr, yr);
+    swap(xi, yi);
+  }
+  if (xr != re) {
+    memcpy(re, xr, _Size * BatchSize * sizeof(double));
+    memcpy(im, xi, _Size * BatchSize * sizeof(double));
+  }
+}
+
+// -----------------------------------------------------------------------------
+void irtkFFTPlan::Bluestein(double *re, double *im, int sign, double *wre, double *wim) const
+{
+  const int     m  = _Convolution->Size();
+  const int     s  = (sign > 0 ? 0 : 1);
+  const double *kr = &_KernelRe[s][0];
+  const double *ki = &_KernelIm[s][0];
+  double *ar = wre, *ai = wim;
+  // Multiply input by chirp and pad with zeros
+  for (int k = 0; k < _Size; ++k) {
+    const double cr = _ChirpRe[k], ci = sign * _ChirpIm[k];
+    for (int b = 0; b < BatchSize; ++b) {
+      const double xr = re[k * BatchSize + b], xi = im[k * BatchSize + b];
+      ar[k * BatchSize + b] = xr * cr - xi * ci;
+      ai[k * BatchSize + b] = xr * ci + xi * cr;
+    }
+  }
+  memset(ar + _Size * BatchSize, 0, (m - _Size) * BatchSize * sizeof(double));
+  memset(ai + _Size * BatchSize, 0, (m - _Size) * BatchSize * sizeof(double));
+  // Convolve with conjugate chirp
+  double *cwr = wre + m * BatchSize, *cwi = wim + m * BatchSize;
+  _Convolution->Transform(ar, ai, +1, cwr, cwi);
+  for (int k = 0; k < m; ++k) {
+    for (int b = 0; b < BatchSize; ++b) {
+      const double xr = ar[k * BatchSize + b], xi = ai[k * BatchSize + b];
+      ar[k * BatchSize + b] = xr * kr[k] - xi * ki[k];
+      ai[k * BatchSize + b] = xr * ki[k] + xi * kr[k];
+    }
+  }
+  _Convolution->Transform(ar, ai, -1, cwr, cwi);
+  // Multiply result by chirp
+  for (int k = 0; k < _Size; ++k) {
+    const double cr = _ChirpRe[k], ci = sign * _ChirpIm[k];
+    for (int b = 0; b < BatchSize; ++b) {
+      const double xr = ar[k * BatchSize + b], xi = ai[k * BatchSize + b];
+      re[k * BatchSize + b] = xr * cr - xi * ci;
+      im[k * BatchSize + b] = xr * ci + xi * cr;
+    }
+  }
+}
+
+// =============================================================================
+// irtkFastFourierTransform
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void irtkFastFourierTransform
+::Transform(irtkGenericImage<float> *re, irtkGenericImage<float> *im, int sign)
+{
+  const int nx = re->X(), ny = re->Y(), nz = re->Z();
+  float *r = re->Data(), *i = im->Data();
+  TransformLines(r, i, nx, ny, nz, 0, sign).Run();
+  TransformLines(r, i, nx, ny, nz, 1, sign).Run();
+  TransformLines(r, i, nx, ny, nz, 2, sign).Run();
+}
+
+// -----------------------------------------------------------------------------
+void irtkFastFourierTransform
+::TransformReal(const irtkGenericImage<float> *image,
+                vector<float> &re, vector<float> &im, int sign)
+{
+  const int nx = image->X(), ny = image->Y(), nz = image->Z();
+  const int h  = nx / 2 + 1;
+  re.resize(h * ny * nz);
+  im.resize(h * ny * nz);
+  float *f = const_cast<float *>(image->Data());
+  TransformRealLines(f, &re[0], &im[0], nx, ny * nz, sign, false).Run();
+  TransformLines(&re[0], &im[0], h, ny, nz, 1, sign).Run();
+  TransformLines(&re[0], &im[0], h, ny, nz, 2, sign).Run();
+}
+
+// -----------------------------------------------------------------------------
+void irtkFastFourierTransform
+::InverseReal(vector<float> &re, vector<float> &im,
+              irtkGenericImage<float> *image, int sign)
+{
+  const int nx = image->X(), ny = image->Y(), nz = image->Z();
+  const int h  = nx / 2 + 1;
+  if (re.size() != static_cast<size_t>(h * ny * nz) || im.size() != re.size()) {
+    cerr << "irtkFastFourierTransform::InverseReal: Spectrum size does not match image size" << endl;
+    exit(1);
+  }
+  TransformLines(&re[0], &im[0], h, ny, nz, 2, sign).Run();
+  TransformLines(&re[0], &im[0], h, ny, nz, 1, sign).Run();
+  TransformRealLines(image->Data(), &re[0], &im[0], nx, ny * nz, sign, true).Run();
+}
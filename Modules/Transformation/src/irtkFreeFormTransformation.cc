@@ -947,6 +947,76 @@ void irtkFreeFormTransformation::PutBoundingBox(double x1, double y1, double z1,
   PutBoundingBox(t1, t2);
 }
 
+// =============================================================================
+// Point transformation
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+/// Determine index of lattice cell containing each point
+///
+/// Points outside the lattice are assigned to the nearest boundary cell.
+class irtkFreeFormTransformationLatticeCellBody
+{
+  const irtkFreeFormTransformation *_FFD;
+  const double *_x, *_y, *_z;
+  int          *_Cell;
+
+public:
+
+  irtkFreeFormTransformationLatticeCellBody(const irtkFreeFormTransformation *ffd,
+                                            const double *x, const double *y, const double *z,
+                                            int *cell)
+  :
+    _FFD(ffd), _x(x), _y(y), _z(z), _Cell(cell)
+  {}
+
+  void operator ()(const blocked_range<int> &re) const
+  {
+    const int nx = _FFD->GetX() + 1;
+    const int ny = _FFD->GetY() + 1;
+    const int nz = _FFD->GetZ() + 1;
+    double x, y, z;
+    int    i, j, k;
+    for (int n = re.begin(); n != re.end(); ++n) {
+      x = _x[n], y = _y[n], z = _z[n];
+      _FFD->WorldToLattice(x, y, z);
+      i = static_cast<int>(floor(x)) + 1;
+      j = static_cast<int>(floor(y)) + 1;
+      k = static_cast<int>(floor(z)) + 1;
+      if      (i <  0) i = 0;
+      else if (i >= nx) i = nx - 1;
+      if      (j <  0) j = 0;
+      else if (j >= ny) j = ny - 1;
+      if      (k <  0) k = 0;
+      else if (k >= nz) k = nz - 1;
+      _Cell[n] = (k * ny + j) * nx + i;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+bool irtkFreeFormTransformation
+::OrderPoints(int no, const double *x, const double *y, const double *z, vector<int> &order) const
+{
+  // Not worth sorting few points or points which are sparse w.r.t. the lattice
+  const int ncells = (_x + 1) * (_y + 1) * (_z + 1);
+  if (no < 1024 || no < ncells) return false;
+
+  // Determine lattice cell of each point
+  vector<int> cell(no);
+  irtkFreeFormTransformationLatticeCellBody body(this, x, y, z, &cell[0]);
+  parallel_for(blocked_range<int>(0, no), body);
+
+  // Sort points by cell, keeping the order of points within each cell
+  vector<int> offset(ncells + 1, 0);
+  for (int n = 0; n < no; ++n) ++offset[cell[n] + 1];
+  for (int c = 0; c < ncells; ++c) offset[c + 1] += offset[c];
+  order.resize(no);
+  for (int n = 0; n < no; ++n) order[offset[cell[n]]++] = n;
+
+  return true;
+}
+
 // =============================================================================
 // Derivatives
 // =============================================================================
@@ -17,237 +17,96 @@
 
 #include <irtkImageFastFourierTransform.h>
 
-void four1NR(float * data, unsigned long nn, int isign)
+namespace irtkImageFastFourierTransformUtils {
+
+// -----------------------------------------------------------------------------
+/// Whether all values of the image are zero
+bool IsZero(const irtkGenericImage<float> *image)
 {
-  unsigned long n,mmax,m,j,istep,i;
-  double wtemp,wr,wpr,wpi,wi,theta;
-  float tempr,tempi;
-
-  n=nn << 1;
-  j=1;
-  for (i=1;i<n;i+=2) {
-    if (j > i) {
-      tempr=data[j]; data[j]=data[i]; data[i]=tempr;
-      tempr=data[j+1]; data[j+1]=data[i+1]; data[i+1]=tempr;
-    }
-    m=n >> 1;
-    while (m >= 2 && j > m) {
-      j -= m;
-      m >>= 1;
-    }
-    j += m;
+  const int    n   = image->X() * image->Y() * image->Z();
+  const float *ptr = image->Data();
+  for (int idx = 0; idx < n; ++idx, ++ptr) {
+    if (*ptr != .0f) return false;
   }
-  mmax=2;
-  while (n > mmax) {
-    istep=mmax << 1;
-    theta=isign*(6.28318530717959/mmax);
-    wtemp=sin(0.5*theta);
-    wpr = -2.0*wtemp*wtemp;
-    wpi=sin(theta);
-    wr=1.0;
-    wi=0.0;
-    for (m=1;m<mmax;m+=2) {
-      for (i=m;i<=n;i+=istep) {
-        j=i+mmax;
-        tempr=wr*data[j]-wi*data[j+1];
-        tempi=wr*data[j+1]+wi*data[j];
-        data[j]=data[i]-tempr;
-        data[j+1]=data[i+1]-tempi;
-        data[i] += tempr;
-        data[i+1] += tempi;
-      }
-      wr=(wtemp=wr)*wpr-wi*wpi+wr;
-      wi=wi*wpr+wtemp*wpi+wi;
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+/// Multiply (or divide) complex spectrum by filter spectrum
+void Filter(float *a, float *b, const float *c, const float *d, int n, float coef, bool deconv)
+{
+  float re, im, cr, ci, norm;
+  for (int idx = 0; idx < n; ++idx) {
+    cr = c[idx] * coef;
+    ci = d[idx] * coef;
+    if (deconv) {
+      norm = cr * cr + ci * ci;
+      re   = (a[idx] * cr + b[idx] * ci) / norm;
+      im   = (cr * b[idx] - a[idx] * ci) / norm;
+    } else {
+      re   = a[idx] * cr - b[idx] * ci;
+      im   = cr * b[idx] + a[idx] * ci;
     }
-    mmax=istep;
+    a[idx] = re;
+    b[idx] = im;
   }
 }
 
+// -----------------------------------------------------------------------------
+/// Filter complex image by complex filter in Fourier space
+void FilterInFourier(irtkGenericImage<float> *RealPartSignal,
+                     irtkGenericImage<float> *ImaginaryPartSignal,
+                     irtkGenericImage<float> *RealPartFilter,
+                     irtkGenericImage<float> *ImaginaryPartFilter,
+                     bool transform_filter, bool deconv)
+{
+  const int   n        = RealPartSignal->X() * RealPartSignal->Y() * RealPartSignal->Z();
+  const float CoefMult = static_cast<float>(sqrt(static_cast<double>(n)));
+
+  // Compute only half spectra of real image and filter
+  if (transform_filter && IsZero(ImaginaryPartSignal) && IsZero(ImaginaryPartFilter)) {
+    vector<float> a, b, c, d;
+    irtkFastFourierTransform::TransformReal(RealPartSignal, a, b, +1);
+    irtkFastFourierTransform::TransformReal(RealPartFilter, c, d, +1);
+    Filter(&a[0], &b[0], &c[0], &d[0], static_cast<int>(a.size()), CoefMult, deconv);
+    irtkFastFourierTransform::InverseReal(a, b, RealPartSignal, -1);
+    return;
+  }
 
+  //1) FFT
+  DirectFFT(RealPartSignal,ImaginaryPartSignal);
+  if (transform_filter) DirectFFT(RealPartFilter,ImaginaryPartFilter);
 
-void DirectFFT(irtkGenericImage<float> * RealSignal,irtkGenericImage<float> * ImaginarySignal){
-  int SizeX,SizeY,SizeZ;
-  float SqrtSizeX,SqrtSizeY,SqrtSizeZ;
-  int x,y,z;
-  float * dataX;
-  float * dataY;
-  float * dataZ;
-  
-  //1) extract the size of the images
-  SizeX=RealSignal->GetX();
-  SizeY=RealSignal->GetY();
-  SizeZ=RealSignal->GetZ();
-  
-  SqrtSizeX=static_cast<float>(sqrt(static_cast<double>(SizeX)));
-  SqrtSizeY=static_cast<float>(sqrt(static_cast<double>(SizeY)));
-  SqrtSizeZ=static_cast<float>(sqrt(static_cast<double>(SizeZ)));
+  //2) filtering in Fourier spaces
+  Filter(RealPartSignal->Data(), ImaginaryPartSignal->Data(),
+         RealPartFilter->Data(), ImaginaryPartFilter->Data(), n, CoefMult, deconv);
 
-  
-  //2) perform the fft along x axis
-  dataX = new float [SizeX*2+1];
-  for (z = 0; z < SizeZ; z++) for (y = 0; y < SizeY; y++){
-    for (x = 0; x < SizeX; x++){
-      dataX[2*x+1]=RealSignal->Get(x, y, z, 0);
-      dataX[2*x+2]=ImaginarySignal->Get(x, y, z, 0);
-    }
-    four1NR(dataX, (unsigned long)SizeX, 1);
-    for (x = 0; x < SizeX; x++){
-      RealSignal->Put(x, y, z, 0,dataX[2*x+1]/SqrtSizeX);
-      ImaginarySignal->Put(x, y, z, 0,dataX[2*x+2]/SqrtSizeX);
-    }
-  }
-  delete dataX;
-  
-  //3) perform the fft along y axis
-  dataY = new float [SizeY*2+1];
-  for (z = 0; z < SizeZ; z++) for (x = 0; x < SizeX; x++){
-    for (y = 0; y < SizeY; y++){
-      dataY[2*y+1]=RealSignal->Get(x, y, z, 0);
-      dataY[2*y+2]=ImaginarySignal->Get(x, y, z, 0);
-    }
-    four1NR(dataY, (unsigned long)SizeY, 1);
-    for (y = 0; y < SizeY; y++){
-      RealSignal->Put(x, y, z, 0,dataY[2*y+1]/SqrtSizeY);
-      ImaginarySignal->Put(x, y, z, 0,dataY[2*y+2]/SqrtSizeY);
-    }
-  }
-  delete dataY;
-  
-  
-  //4) perform the fft along z axis
-  dataZ = new float [SizeZ*2+1];
-  for (y = 0; y < SizeY; y++) for (x = 0; x < SizeX; x++){
-    for (z = 0; z < SizeZ; z++){
-      dataZ[2*z+1]=RealSignal->Get(x, y, z, 0);
-      dataZ[2*z+2]=ImaginarySignal->Get(x, y, z, 0);
-    }
-    four1NR(dataZ, (unsigned long)SizeZ, 1);
-    for (z = 0; z < SizeZ; z++){
-      RealSignal->Put(x, y, z, 0,dataZ[2*z+1]/SqrtSizeZ);
-      ImaginarySignal->Put(x, y, z, 0,dataZ[2*z+2]/SqrtSizeZ);
-    }
-  }
-  delete dataZ;
+  //3) IFFT
+  InverseFFT(RealPartSignal,ImaginaryPartSignal);
+  if (transform_filter) InverseFFT(RealPartFilter,ImaginaryPartFilter);
+}
+
+
+} // namespace irtkImageFastFourierTransformUtils
+using namespace irtkImageFastFourierTransformUtils;
+
+
+void DirectFFT(irtkGenericImage<float> * RealSignal,irtkGenericImage<float> * ImaginarySignal){
+  irtkFastFourierTransform::Transform(RealSignal, ImaginarySignal, +1);
 }
 
 
 void InverseFFT(irtkGenericImage<float> * RealSignal,irtkGenericImage<float> * ImaginarySignal){
-  int SizeX,SizeY,SizeZ;
-  float SqrtSizeX,SqrtSizeY,SqrtSizeZ;
-  int x,y,z;
-  float * dataX;
-  float * dataY;
-  float * dataZ;
-  
-  //1) extract the size of the images
-  SizeX=RealSignal->GetX();
-  SizeY=RealSignal->GetY();
-  SizeZ=RealSignal->GetZ();
-  
-  SqrtSizeX=static_cast<float>(sqrt(static_cast<double>(SizeX)));
-  SqrtSizeY=static_cast<float>(sqrt(static_cast<double>(SizeY)));
-  SqrtSizeZ=static_cast<float>(sqrt(static_cast<double>(SizeZ)));
-  
-  
-  //2) perform the ifft along z axis
-  dataZ = new float [SizeZ*2+1];
-  for (y = 0; y < SizeY; y++) for (x = 0; x < SizeX; x++){
-    for (z = 0; z < SizeZ; z++){
-      dataZ[2*z+1]=RealSignal->Get(x, y, z, 0);
-      dataZ[2*z+2]=ImaginarySignal->Get(x, y, z, 0);
-    }
-    four1NR(dataZ, (unsigned long)SizeZ, -1);
-    for (z = 0; z < SizeZ; z++){
-      RealSignal->Put(x, y, z, 0,dataZ[2*z+1]/SqrtSizeZ);
-      ImaginarySignal->Put(x, y, z, 0,dataZ[2*z+2]/SqrtSizeZ);
-    }
-  }
-  delete dataZ;
-  
-  //3) perform the ifft along y axis
-  dataY = new float [SizeY*2+1];
-  for (z = 0; z < SizeZ; z++) for (x = 0; x < SizeX; x++){
-    for (y = 0; y < SizeY; y++){
-      dataY[2*y+1]=RealSignal->Get(x, y, z, 0);
-      dataY[2*y+2]=ImaginarySignal->Get(x, y, z, 0);
-    }
-    four1NR(dataY, (unsigned long)SizeY, -1);
-    for (y = 0; y < SizeY; y++){
-      RealSignal->Put(x, y, z, 0,dataY[2*y+1]/SqrtSizeY);
-      ImaginarySignal->Put(x, y, z, 0,dataY[2*y+2]/SqrtSizeY);
-    }
-  }
-  delete dataY;
-  
-  //4) perform the ifft along x axis
-  dataX = new float [SizeX*2+1];
-  for (z = 0; z < SizeZ; z++) for (y = 0; y < SizeY; y++){
-    for (x = 0; x < SizeX; x++){
-      dataX[2*x+1]=RealSignal->Get(x, y, z, 0);
-      dataX[2*x+2]=ImaginarySignal->Get(x, y, z, 0);
-    }
-    four1NR(dataX, (unsigned long)SizeX, -1);
-    for (x = 0; x < SizeX; x++){
-      RealSignal->Put(x, y, z, 0,dataX[2*x+1]/SqrtSizeX);
-      ImaginarySignal->Put(x, y, z, 0,dataX[2*x+2]/SqrtSizeX);
-    }
-  }
-  delete dataX;
+  irtkFastFourierTransform::Transform(RealSignal, ImaginarySignal, -1);
 }
 
 void ConvolutionInFourier(irtkGenericImage<float> * RealPartSignal,irtkGenericImage<float> * ImaginaryPartSignal,irtkGenericImage<float> * RealPartFilter,irtkGenericImage<float> * ImaginaryPartFilter){
-  int x,y,z;
-  float a,b,c,d;
-  float CoefMult;
-  
-  
-  //1) FFT
-  DirectFFT(RealPartSignal,ImaginaryPartSignal);
-  DirectFFT(RealPartFilter,ImaginaryPartFilter);
-  
-  //2) filtering in Fourier spaces
-  CoefMult=(float)(sqrt((double)RealPartSignal->GetX())*sqrt((double)RealPartSignal->GetY())*sqrt((double)RealPartSignal->GetZ()));
-  
-  for (z = 0; z < RealPartSignal->GetZ(); z++) for (y = 0; y < RealPartSignal->GetY(); y++) for (x = 0; x < RealPartSignal->GetX(); x++){
-    a=RealPartSignal->Get(x, y, z, 0);
-    b=ImaginaryPartSignal->Get(x, y, z, 0);
-    c=RealPartFilter->Get(x, y, z, 0)*CoefMult;
-    d=ImaginaryPartFilter->Get(x, y, z, 0)*CoefMult;
-    
-    RealPartSignal->Put(x, y, z, 0, a*c-b*d);
-    ImaginaryPartSignal->Put(x, y, z, 0, c*b+a*d);
-  }
-  
-  //3) IFFT
-  InverseFFT(RealPartSignal,ImaginaryPartSignal);
-  InverseFFT(RealPartFilter,ImaginaryPartFilter);
+  FilterInFourier(RealPartSignal, ImaginaryPartSignal, RealPartFilter, ImaginaryPartFilter, true, false);
 }
 
 
 void ConvolutionInFourierNoFilterTransfo(irtkGenericImage<float> * RealPartSignal,irtkGenericImage<float> * ImaginaryPartSignal,irtkGenericImage<float> * RealPartFilterTransformedFrSpace,irtkGenericImage<float> * ImaginaryPartFilterTransformedFrSpace){
-  int x,y,z;
-  float a,b,c,d;
-  float CoefMult;
-  
-  
-  //1) FFT
-  DirectFFT(RealPartSignal,ImaginaryPartSignal);
-  
-  //2) filtering in Fourier spaces
-  CoefMult=(float)(sqrt((double)RealPartSignal->GetX())*sqrt((double)RealPartSignal->GetY())*sqrt((double)RealPartSignal->GetZ()));
-  
-  for (z = 0; z < RealPartSignal->GetZ(); z++) for (y = 0; y < RealPartSignal->GetY(); y++) for (x = 0; x < RealPartSignal->GetX(); x++){
-    a=RealPartSignal->Get(x, y, z, 0);
-    b=ImaginaryPartSignal->Get(x, y, z, 0);
-    c=RealPartFilterTransformedFrSpace->Get(x, y, z, 0)*CoefMult;
-    d=ImaginaryPartFilterTransformedFrSpace->Get(x, y, z, 0)*CoefMult;
-    
-    RealPartSignal->Put(x, y, z, 0, a*c-b*d);
-    ImaginaryPartSignal->Put(x, y, z, 0, c*b+a*d);
-  }
-  
-  //3) IFFT
-  InverseFFT(RealPartSignal,ImaginaryPartSignal);
+  FilterInFourier(RealPartSignal, ImaginaryPartSignal, RealPartFilterTransformedFrSpace, ImaginaryPartFilterTransformedFrSpace, false, false);
 }
 
 
@@ -257,31 +116,7 @@ void ConvolutionInFourierNoFilterTransfo(irtkGenericImage<float> * RealPartSigna
 
 
 void DeconvolutionInFourier(irtkGenericImage<float> * RealPartSignal,irtkGenericImage<float> * ImaginaryPartSignal,irtkGenericImage<float> * RealPartFilter,irtkGenericImage<float> * ImaginaryPartFilter){
-  int x,y,z;
-  float a,b,c,d;
-  float CoefMult;
-  
-  
-  //1) FFT
-  DirectFFT(RealPartSignal,ImaginaryPartSignal);
-  DirectFFT(RealPartFilter,ImaginaryPartFilter);
-  
-  //2) filtering in Fourier spaces
-  CoefMult=(float)(sqrt((double)RealPartSignal->GetX())*sqrt((double)RealPartSignal->GetY())*sqrt((double)RealPartSignal->GetZ()));
-  
-  for (z = 0; z < RealPartSignal->GetZ(); z++) for (y = 0; y < RealPartSignal->GetY(); y++) for (x = 0; x < RealPartSignal->GetX(); x++){
-    a=RealPartSignal->Get(x, y, z, 0);
-    b=ImaginaryPartSignal->Get(x, y, z, 0);
-    c=RealPartFilter->Get(x, y, z, 0)*CoefMult;
-    d=ImaginaryPartFilter->Get(x, y, z, 0)*CoefMult;
-    
-    RealPartSignal->Put(x, y, z, 0, (a*c+b*d)/(c*c+d*d));
-    ImaginaryPartSignal->Put(x, y, z, 0, (c*b-a*d)/(c*c+d*d));
-  }
-  
-  //3) IFFT
-  InverseFFT(RealPartSignal,ImaginaryPartSignal);
-  InverseFFT(RealPartFilter,ImaginaryPartFilter);
+  FilterInFourier(RealPartSignal, ImaginaryPartSignal, RealPartFilter, ImaginaryPartFilter, true, true);
 }
 
 
@@ -289,29 +124,7 @@ void DeconvolutionInFourier(irtkGenericImage<float> * RealPartSignal,irtkGeneric
 
 
 void DeconvolutionInFourierNoFilterTransfo(irtkGenericImage<float> * RealPartSignal,irtkGenericImage<float> * ImaginaryPartSignal,irtkGenericImage<float> * RealPartFilterTransformedFrSpace,irtkGenericImage<float> * ImaginaryPartFilterTransformedFrSpace){
-  int x,y,z;
-  float a,b,c,d;
-  float CoefMult;
-  
-  
-  //1) FFT
-  DirectFFT(RealPartSignal,ImaginaryPartSignal);
-  
-  //2) filtering in Fourier spaces
-  CoefMult=(float)(sqrt((double)RealPartSignal->GetX())*sqrt((double)RealPartSignal->GetY())*sqrt((double)RealPartSignal->GetZ()));
-  
-  for (z = 0; z < RealPartSignal->GetZ(); z++) for (y = 0; y < RealPartSignal->GetY(); y++) for (x = 0; x < RealPartSignal->GetX(); x++){
-    a=RealPartSignal->Get(x, y, z, 0);
-    b=ImaginaryPartSignal->Get(x, y, z, 0);
-    c=RealPartFilterTransformedFrSpace->Get(x, y, z, 0)*CoefMult;
-    d=ImaginaryPartFilterTransformedFrSpace->Get(x, y, z, 0)*CoefMult;
-    
-    RealPartSignal->Put(x, y, z, 0, (a*c+b*d)/(c*c+d*d));
-    ImaginaryPartSignal->Put(x, y, z, 0, (c*b-a*d)/(c*c+d*d));
-  }
-  
-  //3) IFFT
-  InverseFFT(RealPartSignal,ImaginaryPartSignal);
+  FilterInFourier(RealPartSignal, ImaginaryPartSignal, RealPartFilterTransformedFrSpace, ImaginaryPartFilterTransformedFrSpace, false, true);
 }
 
 
@@ -643,6 +643,14 @@ bool irtkMultiLevelTransformation
   return EvaluateInverse(this, m, n, x, y, z, t, t0);
 }
 
+// -----------------------------------------------------------------------------
+bool irtkMultiLevelTransformation
+::OrderPoints(int no, const double *x, const double *y, const double *z, vector<int> &order) const
+{
+  if (_NumberOfLevels == 0) return false;
+  return _LocalTransformation[_NumberOfLevels-1]->OrderPoints(no, x, y, z, order);
+}
+
 // -----------------------------------------------------------------------------
 template <class VoxelType>
 class irtkMultiLevelTransformationToDisplacementField
@@ -303,6 +303,12 @@ irtkTransformation *irtkTransformation::New(const char *name)
   unsigned int magic_no;
   from.ReadAsUInt(&magic_no, 1);
 
+  if (magic_no == IRTKTRANSFORMATION_CONTAINER_MAGIC) {
+    from.Close();
+    irtkTransformationContainer container(name);
+    return container.Read();
+  }
+
   if (magic_no != IRTKTRANSFORMATION_MAGIC) {
     from.Close();
     cerr << "irtkTransformation::New: Not a transformation file: " << name << endl;
@@ -1147,20 +1153,55 @@ void irtkTransformation::DisplacementAfterDOFChange(int dof, double dv, irtkGene
   const_cast<irtkTransformation *>(this)->Put(dof, v);
 }
 
+// -----------------------------------------------------------------------------
+bool irtkTransformation::OrderPoints(int, const double *, const double *, const double *, vector<int> &) const
+{
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+void irtkTransformation::Transform(irtkPointSet &pset, double t, double t0) const
+{
+  irtkTransformationUtils::TransformPointSet transform(this, pset, t, t0);
+  parallel_for(blocked_range<int>(0, pset.Size()), transform);
+}
+
 // -----------------------------------------------------------------------------
 void irtkTransformation::Transform(int no, double *x, double *y, double *z, double t, double t0) const
 {
-  irtkTransformationUtils::TransformPoints transform(this, x, y, z, t, t0);
+  vector<int> order;
+  const int *o = (this->OrderPoints(no, x, y, z, order) ? &order[0] : NULL);
+  irtkTransformationUtils::TransformPoints transform(this, x, y, z, t, t0, o);
   parallel_for(blocked_range<int>(0, no), transform);
 }
 
 // -----------------------------------------------------------------------------
 void irtkTransformation::Transform(int no, double *x, double *y, double *z, const double *t, double t0) const
 {
-  irtkTransformationUtils::TransformPoints transform(this, x, y, z, t, t0);
+  vector<int> order;
+  const int *o = (this->OrderPoints(no, x, y, z, order) ? &order[0] : NULL);
+  irtkTransformationUtils::TransformPoints transform(this, x, y, z, t, t0, o);
   parallel_for(blocked_range<int>(0, no), transform);
 }
 
+// -----------------------------------------------------------------------------
+int irtkTransformation::Inverse(irtkPointSet &pset, double t, double t0) const
+{
+  irtkTransformationUtils::InversePointSet inverse(this, pset, t, t0);
+  parallel_reduce(blocked_range<int>(0, pset.Size()), inverse);
+  return inverse._NumberOfFailures;
+}
+
+// -----------------------------------------------------------------------------
+int irtkTransformation::Inverse(int no, double *x, double *y, double *z, double t, double t0) const
+{
+  vector<int> order;
+  const int *o = (this->OrderPoints(no, x, y, z, order) ? &order[0] : NULL);
+  irtkTransformationUtils::InversePoints inverse(this, x, y, z, t, t0, o);
+  parallel_reduce(blocked_range<int>(0, no), inverse);
+  return inverse._NumberOfFailures;
+}
+
 // -----------------------------------------------------------------------------
 void irtkTransformation::Transform(irtkWorldCoordsImage &coords, double t0) const
 {
@@ -1640,6 +1681,16 @@ int irtkTransformation::InverseDisplacement(irtkGenericImage<float> &disp, doubl
 // Derivatives
 // =============================================================================
 
+// -----------------------------------------------------------------------------
+void irtkTransformation::Jacobian(int no, const double *x, const double *y, const double *z,
+                                  double *jac, double *det, double t, double t0) const
+{
+  vector<int> order;
+  const int *o = (this->OrderPoints(no, x, y, z, order) ? &order[0] : NULL);
+  irtkTransformationUtils::EvaluateJacobian eval(this, x, y, z, jac, det, t, t0, o);
+  parallel_for(blocked_range<int>(0, no), eval);
+}
+
 // -----------------------------------------------------------------------------
 class irtkTransformationParametricGradientBody
 {
@@ -1930,6 +1981,13 @@ void irtkTransformation::Read(const char *name)
   from.Open(name);
   from.ReadAsUInt(&magic_no, 1);
 
+  if (magic_no == IRTKTRANSFORMATION_CONTAINER_MAGIC) {
+    from.Close();
+    irtkTransformationContainer container(name);
+    container.Read(this);
+    return;
+  }
+
   if (magic_no != IRTKTRANSFORMATION_MAGIC) {
     from.Close();
     cerr << "irtkTransformation::Read: Not a transformation file" << endl;
@@ -1944,6 +2002,15 @@ void irtkTransformation::Read(const char *name)
 // -----------------------------------------------------------------------------
 void irtkTransformation::Write(const char *name) const
 {
+  const size_t len = strlen(name);
+  if (len > 5 && strcmp(name + len - 5, ".dofc") == 0) {
+    irtkTransformationContainer::Write(name, this, false);
+    return;
+  }
+  if (len > 5 && strcmp(name + len - 5, ".dofz") == 0) {
+    irtkTransformationContainer::Write(name, this, true);
+    return;
+  }
   irtkCofstream to;
   to.Open(name);
   Write(to);
@@ -2049,5 +2116,6 @@ bool IsTransformation(const char *name)
   from.Open(name);
   from.ReadAsUInt(&magic_no, 1);
   from.Close();
-  return (magic_no == IRTKTRANSFORMATION_MAGIC);
+  return (magic_no == IRTKTRANSFORMATION_MAGIC ||
+          magic_no == IRTKTRANSFORMATION_CONTAINER_MAGIC);
 }
@@ -0,0 +1,472 @@
+/* The Image Registration Toolkit (IRTK)
+ *
+ * Copyright 2008-2015 Imperial College London
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#include <irtkTransformation.h>
+
+#include <climits>
+
+
+// =============================================================================
+// Auxiliary functions
+// =============================================================================
+
+namespace irtkTransformationContainerUtils {
+
+typedef irtkTransformationContainer::Block Block;
+
+// -----------------------------------------------------------------------------
+/// Serialize transformation in legacy file format as new block
+void AddBlock(vector<Block> &toc, vector<vector<char> > &data,
+              irtkTransformationContainer::BlockType type, int level,
+              const irtkTransformation *t, bool compress)
+{
+  Block block;
+  block._Type        = type;
+  block._Level       = level;
+  block._Compression = irtkTransformationContainer::NoCompression;
+  block._Offset      = 0;
+
+  data.push_back(vector<char>());
+  vector<char> &raw = data.back();
+  irtkCofstream to;
+  to.Open(raw);
+  t->Write(to);
+  to.Close();
+  block._RawSize = static_cast<long>(raw.size());
+  block._Size    = block._RawSize;
+
+  if (compress) {
+#ifdef HAS_ZLIB
+    uLongf size = compressBound(static_cast<uLong>(raw.size()));
+    vector<char> zdata(size);
+    if (compress2(reinterpret_cast<Bytef *>(&zdata[0]), &size,
+                  reinterpret_cast<const Bytef *>(&raw[0]),
+                  static_cast<uLong>(raw.size()), Z_DEFAULT_COMPRESSION) == Z_OK &&
+        size < raw.size()) {
+      zdata.resize(size);
+      raw.swap(zdata);
+      block._Compression = irtkTransformationContainer::ZlibCompression;
+      block._Size        = static_cast<long>(size);
+    }
+#else
+    cerr << "irtkTransformationContainer::Write: Cannot compress blocks without zlib" << endl;
+    exit(1);
+#endif
+  }
+
+  toc.push_back(block);
+}
+
+// -----------------------------------------------------------------------------
+/// Round up file offset to next multiple of block alignment
+inline long AlignOffset(long offset)
+{
+  const long alignment = irtkTransformationContainer::BlockAlignment;
+  return ((offset + alignment - 1) / alignment) * alignment;
+}
+
+
+} // namespace irtkTransformationContainerUtils
+using namespace irtkTransformationContainerUtils;
+
+// =============================================================================
+// Construction/Destruction
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+irtkTransformationContainer::irtkTransformationContainer(const char *name)
+:
+  _TypeOfTransformation(IRTKTRANSFORMATION_UNKNOWN),
+  _NumberOfLevels(0),
+  _GlobalBlock(-1)
+{
+  if (name) Open(name);
+}
+
+// -----------------------------------------------------------------------------
+irtkTransformationContainer::~irtkTransformationContainer()
+{
+  Close();
+}
+
+// -----------------------------------------------------------------------------
+void irtkTransformationContainer::Open(const char *name)
+{
+  Close();
+
+  _File.Open(name);
+  _FileName = name;
+
+  // Read header
+  unsigned int header[4];
+  if (!_File.ReadAsUInt(header, 4) || header[0] != IRTKTRANSFORMATION_CONTAINER_MAGIC) {
+    cerr << this->NameOfClass() << "::Open: Not a transformation container file: " << name << endl;
+    exit(1);
+  }
+  if (header[1] < 1 || header[1] > Version) {
+    cerr << this->NameOfClass() << "::Open: Unsupported container version " << header[1]
+         << " of file " << name << endl;
+    exit(1);
+  }
+  _TypeOfTransformation = static_cast<irtkTransformationType>(header[2]);
+
+  // Read table of contents
+  const int nblocks = static_cast<int>(header[3]);
+  if (nblocks < 1 || nblocks > MAX_TRANS + 1) {
+    cerr << this->NameOfClass() << "::Open: Invalid number of blocks in file " << name << endl;
+    exit(1);
+  }
+  vector<unsigned int> toc(6 * nblocks);
+  if (!_File.ReadAsUInt(&toc[0], 6 * nblocks)) {
+    cerr << this->NameOfClass() << "::Open: Invalid table of contents in file " << name << endl;
+    exit(1);
+  }
+  _Block.resize(nblocks);
+  for (int i = 0; i < nblocks; ++i) {
+    const unsigned int *entry = &toc[6 * i];
+    Block &block = _Block[i];
+    block._Type        = static_cast<BlockType>(entry[0]);
+    block._Level       = static_cast<int>(entry[1]);
+    block._Compression = static_cast<BlockCompression>(entry[2]);
+    block._Offset      = static_cast<long>(entry[3]);
+    block._Size        = static_cast<long>(entry[4]);
+    block._RawSize     = static_cast<long>(entry[5]);
+    switch (block._Type) {
+      case TransformationBlock:
+        if (nblocks != 1) {
+          cerr << this->NameOfClass() << "::Open: Transformation block must be only block in file " << name << endl;
+          exit(1);
+        }
+        break;
+      case GlobalTransformationBlock:
+        _GlobalBlock = i;
+        break;
+      case LocalTransformationBlock:
+        if (block._Level < 0 || block._Level >= MAX_TRANS) {
+          cerr << this->NameOfClass() << "::Open: Invalid level index " << block._Level
+               << " in table of contents of file " << name << endl;
+          exit(1);
+        }
+        if (block._Level >= static_cast<int>(_LocalBlock.size())) {
+          _LocalBlock.resize(block._Level + 1, -1);
+        }
+        _LocalBlock[block._Level] = i;
+        break;
+      default:
+        cerr << this->NameOfClass() << "::Open: Unknown block type " << block._Type
+             << " in table of contents of file " << name << endl;
+        exit(1);
+    }
+  }
+
+  // Check that multi-level transformation is complete
+  _NumberOfLevels = static_cast<int>(_LocalBlock.size());
+  if (_NumberOfLevels > 0 && _GlobalBlock == -1) {
+    cerr << this->NameOfClass() << "::Open: Missing global transformation block in file " << name << endl;
+    exit(1);
+  }
+  for (int l = 0; l < _NumberOfLevels; ++l) {
+    if (_LocalBlock[l] == -1) {
+      cerr << this->NameOfClass() << "::Open: Missing block of level " << l << " in file " << name << endl;
+      exit(1);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void irtkTransformationContainer::Close()
+{
+  _File.Close();
+  _FileName.clear();
+  _Block.clear();
+  _LocalBlock.clear();
+  _GlobalBlock          = -1;
+  _NumberOfLevels       = 0;
+  _TypeOfTransformation = IRTKTRANSFORMATION_UNKNOWN;
+}
+
+// =============================================================================
+// Reading
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void irtkTransformationContainer::ReadBlock(int i, vector<char> &data) const
+{
+  const Block &block = _Block[i];
+  if (block._Compression == NoCompression) {
+    data.resize(block._Size);
+    if (block._Size > 0 && !_File.Read(&data[0], block._Offset, block._Size)) {
+      cerr << this->NameOfClass() << "::ReadBlock: Failed to read block " << i
+           << " of file " << _FileName << endl;
+      exit(1);
+    }
+  } else if (block._Compression == ZlibCompression) {
+#ifdef HAS_ZLIB
+    vector<char> zdata(block._Size);
+    if (block._Size > 0 && !_File.Read(&zdata[0], block._Offset, block._Size)) {
+      cerr << this->NameOfClass() << "::ReadBlock: Failed to read block " << i
+           << " of file " << _FileName << endl;
+      exit(1);
+    }
+    uLongf size = static_cast<uLongf>(block._RawSize);
+    data.resize(block._RawSize);
+    if (uncompress(reinterpret_cast<Bytef *>(&data[0]), &size,
+                   reinterpret_cast<const Bytef *>(&zdata[0]),
+                   static_cast<uLong>(zdata.size())) != Z_OK ||
+        static_cast<long>(size) != block._RawSize) {
+      cerr << this->NameOfClass() << "::ReadBlock: Failed to decompress block " << i
+           << " of file " << _FileName << endl;
+      exit(1);
+    }
+#else
+    cerr << this->NameOfClass() << "::ReadBlock: Cannot read compressed block without zlib" << endl;
+    exit(1);
+#endif
+  } else {
+    cerr << this->NameOfClass() << "::ReadBlock: Unknown compression method " << block._Compression
+         << " of block " << i << " of file " << _FileName << endl;
+    exit(1);
+  }
+}
+
+// -----------------------------------------------------------------------------
+irtkTransformation *irtkTransformationContainer::ReadTransformation(int i) const
+{
+  vector<char> data;
+  ReadBlock(i, data);
+
+  irtkCifstream from;
+  from.Open(data.empty() ? NULL : &data[0], static_cast<long>(data.size()));
+
+  unsigned int magic_no, trans_type;
+  if (!from.ReadAsUInt(&magic_no, 1) || magic_no != IRTKTRANSFORMATION_MAGIC ||
+      !from.ReadAsUInt(&trans_type, 1)) {
+    cerr << this->NameOfClass() << "::ReadTransformation: Not a valid transformation found in block "
+         << i << " of file " << _FileName << endl;
+    exit(1);
+  }
+
+  irtkTransformation *t = irtkTransformation::New(static_cast<irtkTransformationType>(trans_type));
+  if (t == NULL) {
+    cerr << this->NameOfClass() << "::ReadTransformation: Block " << i << " of file "
+         << _FileName << " has unknown format: " << trans_type << endl;
+    exit(1);
+  }
+
+  from.Seek(0);
+  t->Read(from);
+  from.Close();
+  return t;
+}
+
+// -----------------------------------------------------------------------------
+void irtkTransformationContainer::ReadTransformation(int i, irtkTransformation *t) const
+{
+  vector<char> data;
+  ReadBlock(i, data);
+
+  irtkCifstream from;
+  from.Open(data.empty() ? NULL : &data[0], static_cast<long>(data.size()));
+  t->Read(from);
+  from.Close();
+}
+
+// -----------------------------------------------------------------------------
+irtkTransformation *irtkTransformationContainer::Read() const
+{
+  irtkTransformation *t = irtkTransformation::New(_TypeOfTransformation);
+  if (t == NULL) {
+    cerr << this->NameOfClass() << "::Read: Transformation container " << _FileName
+         << " has unknown format: " << _TypeOfTransformation << endl;
+    exit(1);
+  }
+  this->Read(t);
+  return t;
+}
+
+// -----------------------------------------------------------------------------
+void irtkTransformationContainer::Read(irtkTransformation *t) const
+{
+  if (_Block.empty()) {
+    cerr << this->NameOfClass() << "::Read: No container file opened" << endl;
+    exit(1);
+  }
+
+  if (!IsMultiLevel()) {
+    ReadTransformation(0, t);
+    return;
+  }
+
+  irtkMultiLevelTransformation *mffd = dynamic_cast<irtkMultiLevelTransformation *>(t);
+  if (mffd == NULL || !mffd->CanRead(_TypeOfTransformation)) {
+    cerr << t->NameOfClass() << "::Read: Not a valid transformation type" << endl;
+    exit(1);
+  }
+
+  // Status of local transformations is not stored in the file and therefore
+  // left unchanged by the legacy reader, whereas it is modified by
+  // irtkMultiLevelTransformation::PushLocalTransformation
+  vector<irtkMultiLevelTransformation::FFDStatus> status(_NumberOfLevels);
+  for (int l = 0; l < _NumberOfLevels; ++l) {
+    status[l] = mffd->LocalTransformationStatus(l);
+  }
+
+  mffd->Clear();
+  ReadTransformation(_GlobalBlock, mffd->GetGlobalTransformation());
+  for (int l = 0; l < _NumberOfLevels; ++l) {
+    irtkTransformation         *dof = ReadTransformation(_LocalBlock[l]);
+    irtkFreeFormTransformation *ffd = dynamic_cast<irtkFreeFormTransformation *>(dof);
+    if (ffd == NULL) {
+      cerr << mffd->NameOfClass() << "::Read: Not a valid FFD (ID " << dof->TypeOfClass()
+           << ") found in block " << _LocalBlock[l] << " of file " << _FileName << endl;
+      exit(1);
+    }
+    mffd->PushLocalTransformation(ffd);
+  }
+
+  for (int l = 0; l < _NumberOfLevels; ++l) {
+    mffd->LocalTransformationStatus(l, status[l]);
+  }
+}
+
+// -----------------------------------------------------------------------------
+irtkHomogeneousTransformation *irtkTransformationContainer::ReadGlobalTransformation() const
+{
+  if (IsMultiLevel()) {
+    irtkTransformation            *t   = ReadTransformation(_GlobalBlock);
+    irtkHomogeneousTransformation *lin = dynamic_cast<irtkHomogeneousTransformation *>(t);
+    if (lin == NULL) {
+      cerr << this->NameOfClass() << "::ReadGlobalTransformation: Not a valid global transformation in file "
+           << _FileName << endl;
+      exit(1);
+    }
+    return lin;
+  }
+  irtkTransformation            *t   = irtkTransformation::New(_TypeOfTransformation);
+  irtkHomogeneousTransformation *lin = dynamic_cast<irtkHomogeneousTransformation *>(t);
+  if (lin == NULL) {
+    delete t;
+    return NULL;
+  }
+  this->Read(lin);
+  return lin;
+}
+
+// -----------------------------------------------------------------------------
+irtkFreeFormTransformation *irtkTransformationContainer::ReadLocalTransformation(int l) const
+{
+  if (l < 0) l += _NumberOfLevels;
+  if (!IsMultiLevel() || l < 0 || l >= _NumberOfLevels) {
+    cerr << this->NameOfClass() << "::ReadLocalTransformation: No local transformation at level "
+         << l << " in file " << _FileName << endl;
+    exit(1);
+  }
+  irtkTransformation         *t   = ReadTransformation(_LocalBlock[l]);
+  irtkFreeFormTransformation *ffd = dynamic_cast<irtkFreeFormTransformation *>(t);
+  if (ffd == NULL) {
+    cerr << this->NameOfClass() << "::ReadLocalTransformation: Not a valid FFD (ID " << t->TypeOfClass()
+         << ") found in block " << _LocalBlock[l] << " of file " << _FileName << endl;
+    exit(1);
+  }
+  return ffd;
+}
+
+// =============================================================================
+// Writing
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+void irtkTransformationContainer::Write(const char *name, const irtkTransformation *t, bool compress)
+{
+  vector<Block>          toc;
+  vector<vector<char> >  data;
+
+  // Serialize global and local transformations of multi-level transformation
+  // separately, provided that these are all the parameters it stores
+  const irtkMultiLevelTransformation *mffd = dynamic_cast<const irtkMultiLevelTransformation *>(t);
+  if (mffd && (t->TypeOfClass() == IRTKTRANSFORMATION_MFFD ||
+               t->TypeOfClass() == IRTKTRANSFORMATION_MFFD_SV)) {
+    AddBlock(toc, data, GlobalTransformationBlock, 0, mffd->GetGlobalTransformation(), compress);
+    for (int l = 0; l < mffd->NumberOfLevels(); ++l) {
+      AddBlock(toc, data, LocalTransformationBlock, l, mffd->GetLocalTransformation(l), compress);
+    }
+  } else {
+    AddBlock(toc, data, TransformationBlock, 0, t, compress);
+  }
+
+  // Determine aligned block offsets
+  const int nblocks = static_cast<int>(toc.size());
+  long offset = 4 * sizeof(unsigned int) + 6 * nblocks * sizeof(unsigned int);
+  for (int i = 0; i < nblocks; ++i) {
+    toc[i]._Offset = AlignOffset(offset);
+    offset = toc[i]._Offset + toc[i]._Size;
+  }
+  if (offset > static_cast<long>(UINT_MAX)) {
+    cerr << "irtkTransformationContainer::Write: Transformation too large for container format" << endl;
+    exit(1);
+  }
+
+  // Write header and table of contents
+  irtkCofstream to;
+  to.Open(name);
+
+  unsigned int header[4];
+  header[0] = IRTKTRANSFORMATION_CONTAINER_MAGIC;
+  header[1] = Version;
+  header[2] = t->TypeOfClass();
+  header[3] = static_cast<unsigned int>(nblocks);
+  to.WriteAsUInt(header, 4);
+
+  vector<unsigned int> entries(6 * nblocks);
+  for (int i = 0; i < nblocks; ++i) {
+    unsigned int *entry = &entries[6 * i];
+    entry[0] = static_cast<unsigned int>(toc[i]._Type);
+    entry[1] = static_cast<unsigned int>(toc[i]._Level);
+    entry[2] = static_cast<unsigned int>(toc[i]._Compression);
+    entry[3] = static_cast<unsigned int>(toc[i]._Offset);
+    entry[4] = static_cast<unsigned int>(toc[i]._Size);
+    entry[5] = static_cast<unsigned int>(toc[i]._RawSize);
+  }
+  to.WriteAsUInt(&entries[0], 6 * nblocks);
+
+  // Write zero padded blocks
+  const vector<char> padding(BlockAlignment, 0);
+  offset = 4 * sizeof(unsigned int) + 6 * nblocks * sizeof(unsigned int);
+  for (int i = 0; i < nblocks; ++i) {
+    if (toc[i]._Offset > offset) {
+      to.WriteAsChar(&padding[0], toc[i]._Offset - offset);
+    }
+    if (!data[i].empty()) to.WriteAsChar(&data[i][0], static_cast<long>(data[i].size()));
+    offset = toc[i]._Offset + toc[i]._Size;
+  }
+
+  to.Close();
+}
+
+// =============================================================================
+// Auxiliary functions
+// =============================================================================
+
+// -----------------------------------------------------------------------------
+bool IsTransformationContainer(const char *name)
+{
+  unsigned int magic_no;
+  irtkCifstream from;
+  from.Open(name);
+  const bool ok = from.ReadAsUInt(&magic_no, 1);
+  from.Close();
+  return (ok && magic_no == IRTKTRANSFORMATION_CONTAINER_MAGIC);
+}